@@ -0,0 +1,151 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * Copyright 2015 Blender Foundation
+ *
+ * This file is part of AudaSpace.
+ *
+ * Audaspace is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * AudaSpace is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Audaspace; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file audaspace/benchmark/AUD_MixBenchmark.cpp
+ *  \ingroup audaspace
+ *
+ * Mixes a number of sounds offline into a read device and reports how many
+ * voices a single core can mix in realtime. The sounds are mono and have a
+ * different rate than the stereo device, so every voice goes through the
+ * resampler, the channel mapper and the mixer like in a game or sequencer.
+ * The sounds are buffered in advance and looped, so generating them isn't
+ * part of the measurement.
+ *
+ * With --threads the sounds are read in parallel, the printed checksum has to
+ * be the same for any number of threads.
+ *
+ * Usage: audaspace-benchmark [handles] [seconds] [--quality] [--threads n]
+ */
+
+#include "AUD_ReadDevice.h"
+#include "AUD_SinusFactory.h"
+#include "AUD_LimiterFactory.h"
+#include "AUD_StreamBufferFactory.h"
+#include "AUD_IHandle.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/time.h>
+#endif
+
+#define BUFFER_FRAMES 1024
+
+static double seconds_timer()
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency, counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	int handles = 64;
+	float seconds = 10;
+	bool quality = false;
+	int threads = 1;
+	int arg = 0;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "--quality"))
+			quality = true;
+		else if(!strcmp(argv[i], "--threads") && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else if(arg++ == 0)
+			handles = atoi(argv[i]);
+		else
+			seconds = atof(argv[i]);
+	}
+
+	if(handles < 1 || seconds <= 0 || threads < 1)
+	{
+		fprintf(stderr, "Usage: %s [handles] [seconds] [--quality] [--threads n]\n", argv[0]);
+		return 1;
+	}
+
+	AUD_DeviceSpecs specs;
+	specs.format = AUD_FORMAT_FLOAT32;
+	specs.channels = AUD_CHANNELS_STEREO;
+	specs.rate = AUD_RATE_48000;
+
+	AUD_ReadDevice device(specs);
+	device.setQuality(quality);
+	device.setThreads(threads);
+
+	std::vector<boost::shared_ptr<AUD_IHandle> > playing;
+
+	for(int i = 0; i < handles; i++)
+	{
+		boost::shared_ptr<AUD_IFactory> sinus(new AUD_SinusFactory(110.0f + i, AUD_RATE_44100));
+		boost::shared_ptr<AUD_IFactory> limited(new AUD_LimiterFactory(sinus, 0, 1));
+		boost::shared_ptr<AUD_IFactory> buffered(new AUD_StreamBufferFactory(limited));
+
+		boost::shared_ptr<AUD_IHandle> handle = device.play(buffered);
+		handle->setLoopCount(-1);
+		playing.push_back(handle);
+	}
+
+	std::vector<float> buffer(BUFFER_FRAMES * specs.channels);
+	int total = seconds * specs.rate;
+
+	unsigned int checksum = 0;
+
+	double start = seconds_timer();
+
+	for(int frames = 0; frames < total; frames += BUFFER_FRAMES)
+	{
+		int length = AUD_MIN(BUFFER_FRAMES, total - frames);
+		device.read(reinterpret_cast<data_t*>(&buffer[0]), length);
+
+		for(int i = 0; i < length * specs.channels; i++)
+		{
+			unsigned int sample;
+			memcpy(&sample, &buffer[i], sizeof(sample));
+			checksum = checksum * 31 + sample;
+		}
+	}
+
+	double time = seconds_timer() - start;
+	double realtime = seconds / AUD_MAX(time, 1e-6);
+
+	printf("%d handles, %s resampling, %d threads: %.2f s of audio mixed in %.3f s\n",
+	       handles, quality ? "high quality" : "linear", threads, seconds, time);
+	printf("%.1f seconds of audio per second, %.0f voices per core, checksum %08x\n",
+	       realtime, realtime * handles / threads, checksum);
+
+	return 0;
+}
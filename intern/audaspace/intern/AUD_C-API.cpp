@@ -1199,13 +1199,13 @@ void *AUD_getSet(void *set)
 	return NULL;
 }
 
-const char *AUD_mixdown(AUD_Sound *sound, unsigned int start, unsigned int length, unsigned int buffersize, const char *filename, AUD_DeviceSpecs specs, AUD_Container format, AUD_Codec codec, unsigned int bitrate)
+const char *AUD_mixdown(AUD_Sound *sound, unsigned int start, unsigned int length, unsigned int buffersize, const char *filename, AUD_DeviceSpecs specs, AUD_Container format, AUD_Codec codec, unsigned int bitrate, unsigned int threads)
 {
 	try {
 		AUD_SequencerFactory *f = dynamic_cast<AUD_SequencerFactory *>(sound->get());
 
 		f->setSpecs(specs.specs);
-		boost::shared_ptr<AUD_IReader> reader = f->createQualityReader();
+		boost::shared_ptr<AUD_IReader> reader = f->createQualityReader(threads);
 		reader->seek(start);
 		boost::shared_ptr<AUD_IWriter> writer = AUD_FileWriter::createWriter(filename, specs, format, codec, bitrate);
 		AUD_FileWriter::writeReader(reader, writer, length, buffersize);
@@ -1218,7 +1218,7 @@ const char *AUD_mixdown(AUD_Sound *sound, unsigned int start, unsigned int lengt
 	}
 }
 
-const char *AUD_mixdown_per_channel(AUD_Sound *sound, unsigned int start, unsigned int length, unsigned int buffersize, const char *filename, AUD_DeviceSpecs specs, AUD_Container format, AUD_Codec codec, unsigned int bitrate)
+const char *AUD_mixdown_per_channel(AUD_Sound *sound, unsigned int start, unsigned int length, unsigned int buffersize, const char *filename, AUD_DeviceSpecs specs, AUD_Container format, AUD_Codec codec, unsigned int bitrate, unsigned int threads)
 {
 	try {
 		AUD_SequencerFactory *f = dynamic_cast<AUD_SequencerFactory *>(sound->get());
@@ -1249,7 +1249,7 @@ const char *AUD_mixdown_per_channel(AUD_Sound *sound, unsigned int start, unsign
 			writers.push_back(AUD_FileWriter::createWriter(stream.str(), specs, format, codec, bitrate));
 		}
 
-		boost::shared_ptr<AUD_IReader> reader = f->createQualityReader();
+		boost::shared_ptr<AUD_IReader> reader = f->createQualityReader(threads);
 		reader->seek(start);
 		AUD_FileWriter::writeReader(reader, writers, length, buffersize);
 
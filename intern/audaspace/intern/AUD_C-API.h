@@ -706,12 +706,14 @@ extern void *AUD_getSet(void *set);
  * \param format The file's container format.
  * \param codec The codec used for encoding the audio data.
  * \param bitrate The bitrate for encoding.
+ * \param threads The number of threads reading the sounds of the scene in parallel.
  * \return An error message or NULL in case of success.
  */
 extern const char *AUD_mixdown(AUD_Sound *sound, unsigned int start, unsigned int length,
                                unsigned int buffersize, const char *filename,
                                AUD_DeviceSpecs specs, AUD_Container format,
-                               AUD_Codec codec, unsigned int bitrate);
+                               AUD_Codec codec, unsigned int bitrate,
+                               unsigned int threads);
 
 /**
  * Mixes a sound down into multiple files.
@@ -724,12 +726,14 @@ extern const char *AUD_mixdown(AUD_Sound *sound, unsigned int start, unsigned in
  * \param format The file's container format.
  * \param codec The codec used for encoding the audio data.
  * \param bitrate The bitrate for encoding.
+ * \param threads The number of threads reading the sounds of the scene in parallel.
  * \return An error message or NULL in case of success.
  */
 extern const char *AUD_mixdown_per_channel(AUD_Sound *sound, unsigned int start, unsigned int length,
                                            unsigned int buffersize, const char *filename,
                                            AUD_DeviceSpecs specs, AUD_Container format,
-                                           AUD_Codec codec, unsigned int bitrate);
+                                           AUD_Codec codec, unsigned int bitrate,
+                                           unsigned int threads);
 
 /**
  * Opens a read device and prepares it for mixdown of the sound scene.
@@ -38,6 +38,10 @@
 
 #include "AUD_ChannelMapperReader.h"
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 AUD_ChannelMapperReader::AUD_ChannelMapperReader(boost::shared_ptr<AUD_IReader> reader,
 												 AUD_Channels channels) :
 		AUD_EffectReader(reader), m_target_channels(channels),
@@ -204,8 +208,24 @@ void AUD_ChannelMapperReader::read(int& length, bool& eos, sample_t* buffer)
 	m_reader->read(length, eos, in);
 
 	sample_t sum;
+	int i = 0;
+
+#ifdef __SSE2__
+	// mono sounds played on a stereo device are the most common case
+	if(m_source_channels == AUD_CHANNELS_MONO && m_target_channels == AUD_CHANNELS_STEREO)
+	{
+		__m128 mapping = _mm_setr_ps(m_mapping[0], m_mapping[1], m_mapping[0], m_mapping[1]);
+
+		for(; i + 4 <= length; i += 4)
+		{
+			__m128 samples = _mm_loadu_ps(in + i);
+			_mm_storeu_ps(buffer + i * 2, _mm_mul_ps(_mm_unpacklo_ps(samples, samples), mapping));
+			_mm_storeu_ps(buffer + i * 2 + 4, _mm_mul_ps(_mm_unpackhi_ps(samples, samples), mapping));
+		}
+	}
+#endif
 
-	for(int i = 0; i < length; i++)
+	for(; i < length; i++)
 	{
 		for(int j = 0; j < m_target_channels; j++)
 		{
@@ -34,6 +34,10 @@
 #include <cstring>
 #include <iostream>
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 /* MSVC does not have lrint */
 #ifdef _MSC_VER
 #if _MSC_VER < 1800  
@@ -268,6 +272,22 @@ RESAMPLE_METHOD(resample_mono, {
 				data--;
 })
 
+#ifdef __SSE2__
+// both channels of a frame are accumulated at once, in double precision like the other methods
+#define STEREO_ACCUMULATE(frame) \
+				_mm_storeu_pd(sums, _mm_add_pd(_mm_loadu_pd(sums), _mm_mul_pd(_mm_cvtps_pd(_mm_castsi128_ps( \
+				              _mm_loadl_epi64(reinterpret_cast<const __m128i*>(frame)))), _mm_set1_pd(v))));
+
+RESAMPLE_METHOD(resample_stereo, {
+				STEREO_ACCUMULATE(data)
+				data+=2;
+}, {
+				data-=2;
+				STEREO_ACCUMULATE(data + 1)
+})
+
+#undef STEREO_ACCUMULATE
+#else
 RESAMPLE_METHOD(resample_stereo, {
 				sums[0] += data[0] * v;
 				sums[1] += data[1] * v;
@@ -277,6 +297,7 @@ RESAMPLE_METHOD(resample_stereo, {
 				sums[0] += data[1] * v;
 				sums[1] += data[2] * v;
 })
+#endif
 
 void AUD_JOSResampleReader::seek(int position)
 {
@@ -32,6 +32,10 @@
 
 #include <cstring>
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 AUD_Mixer::AUD_Mixer(AUD_DeviceSpecs specs) :
 	m_specs(specs)
 {
@@ -86,21 +90,53 @@ void AUD_Mixer::clear(int length)
 
 void AUD_Mixer::mix(sample_t* buffer, int start, int length, float volume)
 {
+	// silent sounds don't change the mix
+	if(volume == 0)
+		return;
+
 	sample_t* out = m_buffer.getBuffer();
 
 	length = (AUD_MIN(m_length, length + start) - start) * m_specs.channels;
 	start *= m_specs.channels;
+	out += start;
+
+	int i = 0;
 
-	for(int i = 0; i < length; i++)
-		out[i + start] += buffer[i] * volume;
+#ifdef __SSE2__
+	__m128 vol = _mm_set1_ps(volume);
+
+	for(; i + 8 <= length; i += 8)
+	{
+		__m128 a = _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_loadu_ps(buffer + i), vol));
+		__m128 b = _mm_add_ps(_mm_loadu_ps(out + i + 4), _mm_mul_ps(_mm_loadu_ps(buffer + i + 4), vol));
+		_mm_storeu_ps(out + i, a);
+		_mm_storeu_ps(out + i + 4, b);
+	}
+#endif
+
+	for(; i < length; i++)
+		out[i] += buffer[i] * volume;
 }
 
 void AUD_Mixer::read(data_t* buffer, float volume)
 {
 	sample_t* out = m_buffer.getBuffer();
+	int length = m_length * m_specs.channels;
+
+	if(volume != 1)
+	{
+		int i = 0;
+
+#ifdef __SSE2__
+		__m128 vol = _mm_set1_ps(volume);
 
-	for(int i = 0; i < m_length * m_specs.channels; i++)
-		out[i] *= volume;
+		for(; i + 4 <= length; i += 4)
+			_mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(out + i), vol));
+#endif
+
+		for(; i < length; i++)
+			out[i] *= volume;
+	}
 
-	m_convert(buffer, (data_t*) out, m_length * m_specs.channels);
+	m_convert(buffer, (data_t*) out, length);
 }
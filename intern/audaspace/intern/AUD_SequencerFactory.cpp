@@ -112,9 +112,9 @@ void AUD_SequencerFactory::remove(boost::shared_ptr<AUD_SequencerEntry> entry)
 	m_sequence->remove(entry);
 }
 
-boost::shared_ptr<AUD_IReader> AUD_SequencerFactory::createQualityReader()
+boost::shared_ptr<AUD_IReader> AUD_SequencerFactory::createQualityReader(int threads)
 {
-	return boost::shared_ptr<AUD_IReader>(new AUD_SequencerReader(m_sequence, true));
+	return boost::shared_ptr<AUD_IReader>(new AUD_SequencerReader(m_sequence, true, threads));
 }
 
 boost::shared_ptr<AUD_IReader> AUD_SequencerFactory::createReader()
@@ -167,9 +167,10 @@ public:
 
 	/**
 	 * Creates a new reader with high quality resampling.
+	 * \param threads The number of threads reading the entries in parallel.
 	 * \return The new reader.
 	 */
-	boost::shared_ptr<AUD_IReader> createQualityReader();
+	boost::shared_ptr<AUD_IReader> createQualityReader(int threads = 1);
 
 	virtual boost::shared_ptr<AUD_IReader> createReader();
 };
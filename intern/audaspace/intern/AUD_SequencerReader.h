@@ -80,8 +80,9 @@ public:
 	 * Creates a resampling reader.
 	 * \param reader The reader to mix.
 	 * \param specs The target specification.
+	 * \param threads The number of threads reading the entries in parallel.
 	 */
-	AUD_SequencerReader(boost::shared_ptr<AUD_Sequencer> sequence, bool quality = false);
+	AUD_SequencerReader(boost::shared_ptr<AUD_Sequencer> sequence, bool quality = false, int threads = 1);
 
 	/**
 	 * Destroys the reader.
@@ -92,7 +92,8 @@ AUD_SoftwareDevice::AUD_SoftwareHandle::AUD_SoftwareHandle(AUD_SoftwareDevice* d
 	m_reader(reader), m_pitch(pitch), m_resampler(resampler), m_mapper(mapper), m_keep(keep), m_user_pitch(1.0f), m_user_volume(1.0f), m_user_pan(0.0f), m_volume(1.0f), m_loopcount(0),
 	m_relative(true), m_volume_max(1.0f), m_volume_min(0), m_distance_max(std::numeric_limits<float>::max()),
 	m_distance_reference(1.0f), m_attenuation(1.0f), m_cone_angle_outer(M_PI), m_cone_angle_inner(M_PI), m_cone_volume_outer(0),
-	m_flags(AUD_RENDER_CONE), m_stop(NULL), m_stop_data(NULL), m_status(AUD_STATUS_PLAYING), m_device(device)
+	m_flags(AUD_RENDER_CONE), m_stop(NULL), m_stop_data(NULL), m_status(AUD_STATUS_PLAYING), m_device(device),
+	m_mix_length(0), m_mix_eos(false)
 {
 }
 
@@ -710,6 +711,7 @@ void AUD_SoftwareDevice::create()
 	m_distance_model = AUD_DISTANCE_MODEL_INVERSE_CLAMPED;
 	m_flags = 0;
 	m_quality = false;
+	m_mix_length = 0;
 
 	pthread_mutexattr_t attr;
 	pthread_mutexattr_init(&attr);
@@ -731,9 +733,49 @@ void AUD_SoftwareDevice::destroy()
 	while(!m_pausedSounds.empty())
 		m_pausedSounds.front()->stop();
 
+	m_pool.reset();
+
 	pthread_mutex_destroy(&m_mutex);
 }
 
+int AUD_SoftwareDevice::readSound(AUD_SoftwareHandle* sound, sample_t* buffer, int length, bool& eos)
+{
+	int channels = sound->m_device->m_specs.channels;
+	int pos = 0;
+	int len = length;
+
+	sound->m_reader->read(len, eos, buffer);
+
+	// in case of looping
+	while(pos + len < length && sound->m_loopcount && eos)
+	{
+		pos += len;
+
+		if(sound->m_loopcount > 0)
+			sound->m_loopcount--;
+
+		sound->m_reader->seek(0);
+
+		len = length - pos;
+		sound->m_reader->read(len, eos, buffer + pos * channels);
+
+		// prevent endless loop
+		if(!len)
+			break;
+	}
+
+	return pos + len;
+}
+
+void AUD_SoftwareDevice::readMixSound(int index, void* device)
+{
+	AUD_SoftwareDevice* self = reinterpret_cast<AUD_SoftwareDevice*>(device);
+	AUD_SoftwareHandle* sound = self->m_mix_sounds[index].get();
+
+	sound->m_mix_buffer.assureSize(self->m_mix_length * AUD_SAMPLE_SIZE(self->m_specs));
+	sound->m_mix_length = readSound(sound, sound->m_mix_buffer.getBuffer(), self->m_mix_length, sound->m_mix_eos);
+}
+
 void AUD_SoftwareDevice::mix(data_t* buffer, int length)
 {
 	m_buffer.assureSize(length * AUD_SAMPLE_SIZE(m_specs));
@@ -743,53 +785,50 @@ void AUD_SoftwareDevice::mix(data_t* buffer, int length)
 	{
 		boost::shared_ptr<AUD_SoftwareDevice::AUD_SoftwareHandle> sound;
 		int len;
-		int pos;
 		bool eos;
 		std::list<boost::shared_ptr<AUD_SoftwareDevice::AUD_SoftwareHandle> > stopSounds;
 		std::list<boost::shared_ptr<AUD_SoftwareDevice::AUD_SoftwareHandle> > pauseSounds;
-		sample_t* buf = m_buffer.getBuffer();
+		sample_t* buf;
 
 		m_mixer->clear(length);
 
-		// for all sounds
-		AUD_HandleIterator it = m_playingSounds.begin();
-		while(it != m_playingSounds.end())
-		{
-			sound = *it;
-			// increment the iterator to make sure it's valid,
-			// in case the sound gets deleted after stopping
-			++it;
-
-			// get the buffer from the source
-			pos = 0;
-			len = length;
+		// the sounds are copied in case they get deleted after stopping
+		m_mix_sounds.assign(m_playingSounds.begin(), m_playingSounds.end());
+		m_mix_length = length;
 
-			// update 3D Info
-			sound->update();
+		bool parallel = m_pool && m_mix_sounds.size() > 1;
 
-			sound->m_reader->read(len, eos, buf);
-
-			// in case of looping
-			while(pos + len < length && sound->m_loopcount && eos)
-			{
-				m_mixer->mix(buf, pos, len, sound->m_volume);
-
-				pos += len;
+		// read all sounds in parallel, they are superposed in order afterwards
+		if(parallel)
+		{
+			for(unsigned int i = 0; i < m_mix_sounds.size(); i++)
+				m_mix_sounds[i]->update();
 
-				if(sound->m_loopcount > 0)
-					sound->m_loopcount--;
+			m_pool->run(m_mix_sounds.size(), readMixSound, this);
+		}
 
-				sound->m_reader->seek(0);
+		// for all sounds
+		for(unsigned int i = 0; i < m_mix_sounds.size(); i++)
+		{
+			sound = m_mix_sounds[i];
 
-				len = length - pos;
-				sound->m_reader->read(len, eos, buf);
+			if(parallel)
+			{
+				buf = sound->m_mix_buffer.getBuffer();
+				len = sound->m_mix_length;
+				eos = sound->m_mix_eos;
+			}
+			else
+			{
+				// update 3D Info
+				sound->update();
 
-				// prevent endless loop
-				if(!len)
-					break;
+				// get the buffer from the source
+				buf = m_buffer.getBuffer();
+				len = readSound(sound.get(), buf, length, eos);
 			}
 
-			m_mixer->mix(buf, pos, len, sound->m_volume);
+			m_mixer->mix(buf, 0, len, sound->m_volume);
 
 			// in case the end of the sound is reached
 			if(eos && !sound->m_loopcount)
@@ -804,10 +843,14 @@ void AUD_SoftwareDevice::mix(data_t* buffer, int length)
 			}
 		}
 
+		m_mix_sounds.clear();
+
 		// superpose
 		m_mixer->read(buffer, m_volume);
 
 		// cleanup
+		AUD_HandleIterator it;
+
 		for(it = pauseSounds.begin(); it != pauseSounds.end(); it++)
 			(*it)->pause(true);
 
@@ -830,6 +873,19 @@ void AUD_SoftwareDevice::setQuality(bool quality)
 	m_quality = quality;
 }
 
+void AUD_SoftwareDevice::setThreads(int threads)
+{
+	AUD_MutexLock lock(*this);
+
+	if(threads > 1)
+	{
+		if(!m_pool || m_pool->getThreads() != threads)
+			m_pool = boost::shared_ptr<AUD_ThreadPool>(new AUD_ThreadPool(threads));
+	}
+	else
+		m_pool.reset();
+}
+
 void AUD_SoftwareDevice::setSpecs(AUD_Specs specs)
 {
 	m_specs.specs = specs;
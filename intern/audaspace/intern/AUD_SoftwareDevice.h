@@ -39,8 +39,10 @@
 #include "AUD_PitchReader.h"
 #include "AUD_ResampleReader.h"
 #include "AUD_ChannelMapperReader.h"
+#include "AUD_ThreadPool.h"
 
 #include <list>
+#include <vector>
 #include <pthread.h>
 
 /**
@@ -139,6 +141,15 @@ protected:
 		/// Own device.
 		AUD_SoftwareDevice* m_device;
 
+		/// The buffer the source is read into when mixing with multiple threads.
+		AUD_Buffer m_mix_buffer;
+
+		/// The number of samples read into the mix buffer.
+		int m_mix_length;
+
+		/// Whether the end of the source was reached while reading the mix buffer.
+		bool m_mix_eos;
+
 		bool pause(bool keep);
 
 	public:
@@ -242,6 +253,16 @@ protected:
 	 */
 	void mix(data_t* buffer, int length);
 
+	/**
+	 * Reads the next samples of a sound, restarting it in case it loops.
+	 * \param sound The sound to read.
+	 * \param buffer The target buffer.
+	 * \param length The length in samples to be read.
+	 * \param[out] eos Whether the end of the sound was reached.
+	 * \return The number of samples read.
+	 */
+	static int readSound(AUD_SoftwareHandle* sound, sample_t* buffer, int length, bool& eos);
+
 	/**
 	 * This function tells the device, to start or pause playback.
 	 * \param playing True if device should playback.
@@ -260,6 +281,29 @@ private:
 	 */
 	AUD_Buffer m_buffer;
 
+	/**
+	 * The thread pool reading the sounds while mixing, NULL when mixing with a
+	 * single thread.
+	 */
+	boost::shared_ptr<AUD_ThreadPool> m_pool;
+
+	/**
+	 * The sounds mixed in the current call of mix().
+	 */
+	std::vector<boost::shared_ptr<AUD_SoftwareHandle> > m_mix_sounds;
+
+	/**
+	 * The length in samples of the current call of mix().
+	 */
+	int m_mix_length;
+
+	/**
+	 * Reads one sound of the current mix into its mix buffer.
+	 * \param index The index of the sound in m_mix_sounds.
+	 * \param device The device.
+	 */
+	static void readMixSound(int index, void* device);
+
 	/**
 	 * The list of sounds that are currently playing.
 	 */
@@ -321,6 +365,14 @@ public:
 	 */
 	void setQuality(bool quality);
 
+	/**
+	 * Sets the number of threads used for mixing. With more than one thread
+	 * the sounds are read in parallel, the result is identical to mixing with
+	 * a single thread as the sounds are still superposed in playback order.
+	 * \param threads The number of threads.
+	 */
+	void setThreads(int threads);
+
 	virtual AUD_DeviceSpecs getSpecs() const;
 	virtual boost::shared_ptr<AUD_IHandle> play(boost::shared_ptr<AUD_IReader> reader, bool keep = false);
 	virtual boost::shared_ptr<AUD_IHandle> play(boost::shared_ptr<AUD_IFactory> factory, bool keep = false);
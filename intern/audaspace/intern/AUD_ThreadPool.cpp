@@ -0,0 +1,145 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * Copyright 2009-2011 Jörg Hermann Müller
+ *
+ * This file is part of AudaSpace.
+ *
+ * Audaspace is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * AudaSpace is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Audaspace; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file audaspace/intern/AUD_ThreadPool.cpp
+ *  \ingroup audaspaceintern
+ */
+
+
+#include "AUD_ThreadPool.h"
+
+AUD_ThreadPool::AUD_ThreadPool(int threads) :
+	m_function(NULL), m_data(NULL), m_count(0), m_next(0), m_pending(0), m_job(0), m_exit(false)
+{
+	pthread_mutex_init(&m_mutex, NULL);
+	pthread_cond_init(&m_start, NULL);
+	pthread_cond_init(&m_done, NULL);
+
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+
+	for(int i = 1; i < threads; i++)
+	{
+		pthread_t thread;
+
+		if(pthread_create(&thread, &attr, AUD_ThreadPool::thread, this))
+			break;
+
+		m_threads.push_back(thread);
+	}
+
+	pthread_attr_destroy(&attr);
+}
+
+AUD_ThreadPool::~AUD_ThreadPool()
+{
+	pthread_mutex_lock(&m_mutex);
+	m_exit = true;
+	pthread_cond_broadcast(&m_start);
+	pthread_mutex_unlock(&m_mutex);
+
+	for(unsigned int i = 0; i < m_threads.size(); i++)
+		pthread_join(m_threads[i], NULL);
+
+	pthread_cond_destroy(&m_done);
+	pthread_cond_destroy(&m_start);
+	pthread_mutex_destroy(&m_mutex);
+}
+
+int AUD_ThreadPool::getThreads() const
+{
+	return m_threads.size() + 1;
+}
+
+void AUD_ThreadPool::work()
+{
+	while(m_next < m_count)
+	{
+		int index = m_next++;
+
+		pthread_mutex_unlock(&m_mutex);
+		m_function(index, m_data);
+		pthread_mutex_lock(&m_mutex);
+
+		if(--m_pending == 0)
+			pthread_cond_signal(&m_done);
+	}
+}
+
+void* AUD_ThreadPool::thread(void* pool)
+{
+	AUD_ThreadPool* self = reinterpret_cast<AUD_ThreadPool*>(pool);
+	unsigned int job = 0;
+
+	pthread_mutex_lock(&self->m_mutex);
+
+	for(;;)
+	{
+		while(!self->m_exit && job == self->m_job)
+			pthread_cond_wait(&self->m_start, &self->m_mutex);
+
+		if(self->m_exit)
+			break;
+
+		job = self->m_job;
+		self->work();
+	}
+
+	pthread_mutex_unlock(&self->m_mutex);
+
+	return NULL;
+}
+
+void AUD_ThreadPool::run(int count, AUD_ThreadPoolFunction function, void* data)
+{
+	if(count <= 0)
+		return;
+
+	// not worth waking up other threads
+	if(count == 1 || m_threads.empty())
+	{
+		for(int i = 0; i < count; i++)
+			function(i, data);
+		return;
+	}
+
+	pthread_mutex_lock(&m_mutex);
+
+	m_function = function;
+	m_data = data;
+	m_count = count;
+	m_next = 0;
+	m_pending = count;
+	m_job++;
+
+	pthread_cond_broadcast(&m_start);
+
+	work();
+
+	while(m_pending > 0)
+		pthread_cond_wait(&m_done, &m_mutex);
+
+	pthread_mutex_unlock(&m_mutex);
+}
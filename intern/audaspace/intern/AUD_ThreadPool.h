@@ -0,0 +1,150 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * Copyright 2009-2011 Jörg Hermann Müller
+ *
+ * This file is part of AudaSpace.
+ *
+ * Audaspace is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * AudaSpace is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Audaspace; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file audaspace/intern/AUD_ThreadPool.h
+ *  \ingroup audaspaceintern
+ */
+
+
+#ifndef __AUD_THREADPOOL_H__
+#define __AUD_THREADPOOL_H__
+
+#include <vector>
+#include <pthread.h>
+
+/**
+ * This class runs a number of independent work items on a fixed set of
+ * threads. The calling thread takes part in the work, so a pool for n threads
+ * only starts n - 1 additional threads.
+ */
+class AUD_ThreadPool
+{
+public:
+	/**
+	 * The function executing a single work item.
+	 * \param index The index of the work item.
+	 * \param data The user data passed to run().
+	 */
+	typedef void (*AUD_ThreadPoolFunction)(int index, void* data);
+
+private:
+	/**
+	 * The additional threads.
+	 */
+	std::vector<pthread_t> m_threads;
+
+	/**
+	 * The mutex protecting the job state.
+	 */
+	pthread_mutex_t m_mutex;
+
+	/**
+	 * Signalled when a new job is started or the pool is destroyed.
+	 */
+	pthread_cond_t m_start;
+
+	/**
+	 * Signalled when the last work item of a job is done.
+	 */
+	pthread_cond_t m_done;
+
+	/**
+	 * The function of the current job.
+	 */
+	AUD_ThreadPoolFunction m_function;
+
+	/**
+	 * The user data of the current job.
+	 */
+	void* m_data;
+
+	/**
+	 * The number of work items of the current job.
+	 */
+	int m_count;
+
+	/**
+	 * The next work item to be processed.
+	 */
+	int m_next;
+
+	/**
+	 * The number of work items not finished yet.
+	 */
+	int m_pending;
+
+	/**
+	 * Increased for every job so that waiting threads notice a new one.
+	 */
+	unsigned int m_job;
+
+	/**
+	 * Whether the threads should exit.
+	 */
+	bool m_exit;
+
+	/**
+	 * Processes work items of the current job until none are left.
+	 * Has to be called with the mutex locked.
+	 */
+	void work();
+
+	/**
+	 * The main function of the additional threads.
+	 * \param pool The thread pool.
+	 */
+	static void* thread(void* pool);
+
+	// hide copy constructor and operator=
+	AUD_ThreadPool(const AUD_ThreadPool&);
+	AUD_ThreadPool& operator=(const AUD_ThreadPool&);
+
+public:
+	/**
+	 * Creates a new thread pool.
+	 * \param threads The number of threads including the calling one.
+	 */
+	AUD_ThreadPool(int threads);
+
+	/**
+	 * Stops and joins all threads.
+	 */
+	~AUD_ThreadPool();
+
+	/**
+	 * Returns the number of threads including the calling one.
+	 */
+	int getThreads() const;
+
+	/**
+	 * Executes function for the indices 0 to count - 1 and waits until all of
+	 * them are done. The order in which the items are executed is undefined.
+	 * \param count The number of work items.
+	 * \param function The function to execute.
+	 * \param data The user data passed to the function.
+	 */
+	void run(int count, AUD_ThreadPoolFunction function, void* data);
+};
+
+#endif //__AUD_THREADPOOL_H__
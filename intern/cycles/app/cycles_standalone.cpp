@@ -15,19 +15,27 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "buffers.h"
+#include "bvh.h"
 #include "camera.h"
 #include "device.h"
+#include "mesh.h"
+#include "object.h"
 #include "scene.h"
 #include "session.h"
 
 #include "util_args.h"
 #include "util_foreach.h"
 #include "util_function.h"
+#include "util_hash.h"
+#include "util_logging.h"
 #include "util_path.h"
 #include "util_progress.h"
 #include "util_string.h"
+#include "util_system.h"
+#include "util_task.h"
 #include "util_time.h"
 #include "util_transform.h"
 
@@ -48,6 +56,7 @@ struct Options {
 	SessionParams session_params;
 	bool quiet;
 	bool show_help, interactive, pause;
+	bool bvh_benchmark;
 } options;
 
 static void session_print(const string& str)
@@ -115,25 +124,32 @@ static void session_init()
 	options.scene = NULL;
 }
 
-static void scene_init()
+static Scene *scene_read(const SceneParams& scene_params)
 {
-	options.scene = new Scene(options.scene_params, options.session_params.device);
+	Scene *scene = new Scene(scene_params, options.session_params.device);
 
 	/* Read XML */
-	xml_read_file(options.scene, options.filepath.c_str());
+	xml_read_file(scene, options.filepath.c_str());
 
 	/* Camera width/height override? */
 	if (!(options.width == 0 || options.height == 0)) {
-		options.scene->camera->width = options.width;
-		options.scene->camera->height = options.height;
+		scene->camera->width = options.width;
+		scene->camera->height = options.height;
 	}
 	else {
-		options.width = options.scene->camera->width;
-		options.height = options.scene->camera->height;
+		options.width = scene->camera->width;
+		options.height = scene->camera->height;
 	}
 
 	/* Calculate Viewplane */
-	options.scene->camera->compute_auto_viewplane();
+	scene->camera->compute_auto_viewplane();
+
+	return scene;
+}
+
+static void scene_init()
+{
+	options.scene = scene_read(options.scene_params);
 }
 
 static void session_exit()
@@ -153,6 +169,315 @@ static void session_exit()
 	}
 }
 
+/* BVH Benchmark
+ *
+ * Builds the BVH of every mesh in the scene without rendering, once for each
+ * thread count from 1 to the number of render threads, with and without
+ * spatial splits.
+ *
+ * Then the scene is synced to the device once for each set of BVH parameters
+ * below, and a fixed set of camera rays and random rays is traced through
+ * the scene intersection kernel, to compare build time, SAH cost, node counts
+ * and traversal performance. */
+
+static double bvh_benchmark_build(Scene *scene, const BVHParams& params, size_t *num_prims)
+{
+	Progress progress;
+	double total_time = 0.0;
+
+	*num_prims = 0;
+
+	foreach(Mesh *mesh, scene->meshes) {
+		Object object;
+		object.mesh = mesh;
+
+		vector<Object*> objects;
+		objects.push_back(&object);
+
+		BVH *bvh = BVH::create(params, objects);
+
+		double start_time = time_dt();
+		bvh->build(progress);
+		total_time += time_dt() - start_time;
+
+		*num_prims += bvh->pack.prim_index.size();
+		delete bvh;
+	}
+
+	return total_time;
+}
+
+static void bvh_benchmark_run()
+{
+	Scene *scene = options.scene;
+	int max_threads = (options.session_params.threads)? options.session_params.threads: system_cpu_thread_count();
+
+	vector<int> thread_counts;
+	for(int threads = 1; threads < max_threads; threads *= 2)
+		thread_counts.push_back(threads);
+	thread_counts.push_back(max_threads);
+
+	printf("BVH build benchmark: %s, %d meshes\n",
+		path_filename(options.filepath).c_str(), (int)scene->meshes.size());
+	printf("%-16s %8s %12s %12s %10s\n", "split", "threads", "time (s)", "primitives", "speedup");
+
+	for(int spatial = 0; spatial < 2; spatial++) {
+		BVHParams params;
+		params.use_spatial_split = spatial;
+
+		double base_time = 0.0;
+
+		foreach(int threads, thread_counts) {
+			size_t num_prims;
+
+			TaskScheduler::init(threads);
+			double build_time = bvh_benchmark_build(scene, params, &num_prims);
+			TaskScheduler::exit();
+
+			if(threads == 1)
+				base_time = build_time;
+
+			printf("%-16s %8d %12.4f %12lu %9.2fx\n",
+				(spatial)? "spatial": "binning",
+				threads,
+				build_time,
+				(unsigned long)num_prims,
+				(build_time > 0.0)? base_time / build_time: 0.0);
+		}
+	}
+}
+
+typedef struct BVHBenchmarkParams {
+	const char *name;
+	bool use_qbvh;
+	bool use_spatial_split;
+	float spatial_split_alpha;
+	int min_leaf_size;
+	int max_leaf_size;
+} BVHBenchmarkParams;
+
+static const BVHBenchmarkParams bvh_benchmark_params[] = {
+	{"binning",         false, false, 1e-5f, 1, 8},
+	{"spatial",         false, true,  1e-5f, 1, 8},
+	{"spatial a=1e-3",  false, true,  1e-3f, 1, 8},
+	{"spatial leaf 4",  false, true,  1e-5f, 1, 4},
+	{"spatial leaf 16", false, true,  1e-5f, 4, 16},
+#ifdef __QBVH__
+	{"qbvh binning",    true,  false, 1e-5f, 1, 8},
+	{"qbvh spatial",    true,  true,  1e-5f, 1, 8},
+	{"qbvh a=1e-3",     true,  true,  1e-3f, 1, 8},
+	{"qbvh leaf 4",     true,  true,  1e-5f, 1, 4},
+	{"qbvh leaf 16",    true,  true,  1e-5f, 4, 16},
+#endif
+};
+
+/* a ray is stored as two inputs, the origin with the maximum distance and the direction */
+static uint4 bvh_benchmark_pack_origin(float3 P, float t)
+{
+	return make_uint4(__float_as_uint(P.x), __float_as_uint(P.y), __float_as_uint(P.z), __float_as_uint(t));
+}
+
+static uint4 bvh_benchmark_pack_direction(float3 D)
+{
+	return make_uint4(__float_as_uint(D.x), __float_as_uint(D.y), __float_as_uint(D.z), 0);
+}
+
+static float bvh_benchmark_random(uint i, uint dimension)
+{
+	return hash_int_2d(i, dimension) * (1.0f/(float)0xFFFFFFFF);
+}
+
+/* one ray through the center of every pixel, two inputs per ray */
+static void bvh_benchmark_camera_rays(Camera *cam, vector<uint4>& rays)
+{
+	rays.clear();
+	rays.reserve(cam->width*cam->height*2);
+
+	for(int y = 0; y < cam->height; y++) {
+		for(int x = 0; x < cam->width; x++) {
+			float3 Pcamera = transform_perspective(&cam->rastertocamera, make_float3(x + 0.5f, y + 0.5f, 0.0f));
+			float3 P, D;
+
+			if(cam->type == CAMERA_ORTHOGRAPHIC) {
+				P = transform_point(&cam->cameratoworld, Pcamera);
+				D = normalize(transform_direction(&cam->cameratoworld, make_float3(0.0f, 0.0f, 1.0f)));
+			}
+			else {
+				/* panoramic cameras are traced as perspective */
+				P = transform_point(&cam->cameratoworld, make_float3(0.0f, 0.0f, 0.0f));
+				D = normalize(transform_direction(&cam->cameratoworld, Pcamera));
+			}
+
+			rays.push_back(bvh_benchmark_pack_origin(P, FLT_MAX));
+			rays.push_back(bvh_benchmark_pack_direction(D));
+		}
+	}
+}
+
+/* incoherent rays with origins in the scene bounds and uniform directions */
+static void bvh_benchmark_random_rays(Scene *scene, size_t num_rays, vector<uint4>& rays)
+{
+	BoundBox bounds = BoundBox::empty;
+
+	foreach(Object *object, scene->objects)
+		bounds.grow(object->bounds);
+
+	rays.clear();
+
+	if(!bounds.valid())
+		return;
+
+	rays.reserve(num_rays*2);
+
+	for(uint i = 0; i < num_rays; i++) {
+		float3 P = bounds.min + bounds.size()*make_float3(bvh_benchmark_random(i, 0),
+		                                                  bvh_benchmark_random(i, 1),
+		                                                  bvh_benchmark_random(i, 2));
+
+		float z = 1.0f - 2.0f*bvh_benchmark_random(i, 3);
+		float r = sqrtf(max(0.0f, 1.0f - z*z));
+		float phi = M_2PI_F*bvh_benchmark_random(i, 4);
+		float3 D = make_float3(r*cosf(phi), r*sinf(phi), z);
+
+		rays.push_back(bvh_benchmark_pack_origin(P, FLT_MAX));
+		rays.push_back(bvh_benchmark_pack_direction(D));
+	}
+}
+
+/* trace the rays with the scene intersection kernel, returns rays per second */
+static double bvh_benchmark_trace(Device *device, const vector<uint4>& rays, size_t *num_hits)
+{
+	size_t num_rays = rays.size()/2;
+
+	*num_hits = 0;
+
+	if(num_rays == 0)
+		return 0.0;
+
+	device_vector<uint4> d_input;
+	uint4 *input = d_input.resize(rays.size());
+	memcpy(input, &rays[0], sizeof(uint4)*rays.size());
+
+	device_vector<float4> d_output;
+	d_output.resize(num_rays);
+
+	device->mem_alloc(d_input, MEM_READ_ONLY);
+	device->mem_copy_to(d_input);
+	device->mem_alloc(d_output, MEM_WRITE_ONLY);
+
+	DeviceTask task(DeviceTask::SHADER);
+	task.shader_input = d_input.device_pointer;
+	task.shader_output = d_output.device_pointer;
+	task.shader_eval_type = SHADER_EVAL_INTERSECT;
+	task.shader_x = 0;
+	task.shader_w = num_rays;
+	task.num_samples = 1;
+
+	double start_time = time_dt();
+	device->task_add(task);
+	device->task_wait();
+	double trace_time = time_dt() - start_time;
+
+	device->mem_copy_from(d_output, 0, 1, num_rays, sizeof(float4));
+
+	float4 *output = (float4*)d_output.data_pointer;
+	for(size_t i = 0; i < num_rays; i++)
+		if(output[i].x >= 0.0f)
+			(*num_hits)++;
+
+	device->mem_free(d_input);
+	device->mem_free(d_output);
+
+	return (trace_time > 0.0)? num_rays/trace_time: 0.0;
+}
+
+static void bvh_benchmark_params_run()
+{
+	Stats stats;
+	Progress progress;
+
+	TaskScheduler::init(options.session_params.threads);
+	Device *device = Device::create(options.session_params.device, stats, true);
+
+	if(!device->load_kernels(false)) {
+		fprintf(stderr, "Failed loading kernels: %s\n", device->error_message().c_str());
+		delete device;
+		TaskScheduler::exit();
+		return;
+	}
+
+	printf("\nBVH parameters benchmark: %s, %s device\n",
+		path_filename(options.filepath).c_str(), device->info.description.c_str());
+	printf("%-16s %10s %10s %10s %10s %12s %12s\n",
+		"params", "build ms", "SAH", "nodes", "leaves", "camera Mr/s", "random Mr/s");
+
+	vector<uint4> camera_rays, random_rays;
+
+	for(size_t i = 0; i < sizeof(bvh_benchmark_params)/sizeof(*bvh_benchmark_params); i++) {
+		const BVHBenchmarkParams& bench = bvh_benchmark_params[i];
+
+		/* static BVH like final renders, so all geometry is in the scene BVH */
+		SceneParams scene_params = options.scene_params;
+		scene_params.bvh_type = SceneParams::BVH_STATIC;
+		scene_params.use_bvh_cache = false;
+		scene_params.use_qbvh = bench.use_qbvh;
+		scene_params.use_bvh_spatial_split = bench.use_spatial_split;
+		scene_params.bvh_spatial_split_alpha = bench.spatial_split_alpha;
+		scene_params.bvh_min_leaf_size = bench.min_leaf_size;
+		scene_params.bvh_max_leaf_size = bench.max_leaf_size;
+
+		Scene *scene = scene_read(scene_params);
+		scene->device_update(device, progress);
+
+		if(device->have_error() || !scene->mesh_manager->bvh) {
+			fprintf(stderr, "%s: failed updating scene %s\n", bench.name, device->error_message().c_str());
+			delete scene;
+			continue;
+		}
+
+		MeshManager *mesh_manager = scene->mesh_manager;
+		double build_time = mesh_manager->mesh_bvh_times.build_time + mesh_manager->scene_bvh_times.build_time;
+
+		/* node counts include the nodes of instanced meshes merged into the scene BVH */
+		const PackedBVH& pack = mesh_manager->bvh->pack;
+		size_t num_nodes = pack.is_leaf.size();
+		size_t num_leaves = 0;
+
+		for(size_t j = 0; j < pack.is_leaf.size(); j++)
+			if(pack.is_leaf[j])
+				num_leaves++;
+
+		/* same rays for every parameter set */
+		if(i == 0) {
+			bvh_benchmark_camera_rays(scene->camera, camera_rays);
+			bvh_benchmark_random_rays(scene, camera_rays.size()/2, random_rays);
+		}
+
+		size_t camera_hits, random_hits;
+		double camera_rate = bvh_benchmark_trace(device, camera_rays, &camera_hits);
+		double random_rate = bvh_benchmark_trace(device, random_rays, &random_hits);
+
+		printf("%-16s %10.2f %10.2f %10lu %10lu %12.3f %12.3f\n",
+			bench.name,
+			build_time*1000.0,
+			pack.SAH,
+			(unsigned long)num_nodes,
+			(unsigned long)num_leaves,
+			camera_rate*1e-6,
+			random_rate*1e-6);
+
+		/* hit counts should match between parameter sets */
+		VLOG(1) << bench.name << ": " << camera_hits << "/" << camera_rays.size()/2
+		        << " camera rays and " << random_hits << "/" << random_rays.size()/2
+		        << " random rays hit.";
+
+		delete scene;
+	}
+
+	delete device;
+	TaskScheduler::exit();
+}
+
 #ifdef WITH_CYCLES_STANDALONE_GUI
 static void display_info(Progress& progress)
 {
@@ -311,6 +636,7 @@ static void options_parse(int argc, const char **argv)
 	options.filepath = "";
 	options.session = NULL;
 	options.quiet = false;
+	options.bvh_benchmark = false;
 
 	/* device names */
 	string device_names = "";
@@ -344,9 +670,11 @@ static void options_parse(int argc, const char **argv)
 		"--samples %d", &options.session_params.samples, "Number of samples to render",
 		"--output %s", &options.session_params.output_path, "File path to write output image",
 		"--threads %d", &options.session_params.threads, "CPU Rendering Threads",
+		"--texture-cache-size %d", &options.scene_params.texture_cache_size, "Image texture cache size in MB, 0 to load images fully (CPU only)",
 		"--width  %d", &options.width, "Window width in pixel",
 		"--height %d", &options.height, "Window height in pixel",
 		"--list-devices", &list, "List information about all available devices",
+		"--bvh-benchmark", &options.bvh_benchmark, "Benchmark BVH building and ray traversal with various BVH parameters instead of rendering",
 		"--help", &help, "Print help message",
 		NULL);
 
@@ -438,6 +766,15 @@ int main(int argc, const char **argv)
 	path_init();
 	options_parse(argc, argv);
 
+	if(options.bvh_benchmark) {
+		bvh_benchmark_run();
+		delete options.scene;
+		options.scene = NULL;
+
+		bvh_benchmark_params_run();
+		return 0;
+	}
+
 #ifdef WITH_CYCLES_STANDALONE_GUI
 	if(options.session_params.background) {
 #endif
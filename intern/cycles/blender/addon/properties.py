@@ -411,6 +411,27 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 default=0.0,
                 )
 
+        cls.use_adaptive_sampling = BoolProperty(
+                name="Adaptive Sampling",
+                description="Stop sampling pixels once their noise drops below the threshold "
+                            "(CPU only, not used with progressive refine)",
+                default=False,
+                )
+        cls.adaptive_threshold = FloatProperty(
+                name="Noise Threshold",
+                description="Noise level at which a pixel stops sampling, lower values give less noise "
+                            "at the cost of render time",
+                min=0.0001, max=1.0, soft_max=0.1,
+                default=0.01,
+                precision=4,
+                )
+        cls.adaptive_min_samples = IntProperty(
+                name="Min Samples",
+                description="Number of samples to render for each pixel before it can stop sampling",
+                min=4, max=10000,
+                default=16,
+                )
+
         cls.debug_tile_size = IntProperty(
                 name="Tile Size",
                 description="",
@@ -461,6 +482,20 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 description="Cache last built BVH to disk for faster re-render if no geometry changed",
                 default=False,
                 )
+        cls.cache_size = IntProperty(
+                name="Cache Size",
+                description="Maximum size of the BVH disk cache in megabytes, least recently used files "
+                            "are removed beyond it (0 keeps only the BVH of the last render)",
+                min=0, max=1024 * 1024,
+                default=0,
+                )
+        cls.texture_cache_size = IntProperty(
+                name="Texture Cache",
+                description="Load image textures on demand in tiles, keeping at most this many megabytes "
+                            "in memory (CPU only, 0 loads all images fully)",
+                min=0, max=1024 * 64,
+                default=0,
+                )
         cls.tile_order = EnumProperty(
                 name="Tile Order",
                 description="Tile order for rendering",
@@ -157,6 +157,14 @@ class CyclesRender_PT_sampling(CyclesButtonsPanel, Panel):
         if use_cpu(context) or cscene.feature_set == 'EXPERIMENTAL':
             layout.row().prop(cscene, "sampling_pattern", text="Pattern")
 
+        if use_cpu(context):
+            row = layout.row(align=True)
+            row.prop(cscene, "use_adaptive_sampling", text="Adaptive")
+            sub = row.row(align=True)
+            sub.active = cscene.use_adaptive_sampling
+            sub.prop(cscene, "adaptive_threshold", text="Threshold")
+            sub.prop(cscene, "adaptive_min_samples", text="Min")
+
         for rl in scene.render.layers:
             if rl.samples > 0:
                 layout.separator()
@@ -314,7 +322,11 @@ class CyclesRender_PT_performance(CyclesButtonsPanel, Panel):
 
         col.label(text="Final Render:")
         col.prop(cscene, "use_cache")
+        sub = col.column()
+        sub.active = cscene.use_cache
+        sub.prop(cscene, "cache_size")
         col.prop(rd, "use_persistent_data", text="Persistent Images")
+        col.prop(cscene, "texture_cache_size")
 
         col.separator()
 
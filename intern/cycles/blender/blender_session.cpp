@@ -435,6 +435,11 @@ void BlenderSession::render()
 		Pass::add(PASS_BVH_TRAVERSAL_STEPS, passes);
 #endif
 
+		if(session_params.adaptive_sampling) {
+			Pass::add(PASS_ADAPTIVE_AUX_BUFFER, passes);
+			Pass::add(PASS_SAMPLE_COUNT, passes);
+		}
+
 		if(session_params.device.advanced_shading) {
 
 			/* loop over passes */
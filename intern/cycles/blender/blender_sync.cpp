@@ -191,6 +191,13 @@ void BlenderSync::sync_integrator()
 
 	integrator->sample_clamp_direct = get_float(cscene, "sample_clamp_direct");
 	integrator->sample_clamp_indirect = get_float(cscene, "sample_clamp_indirect");
+
+	if(get_boolean(cscene, "use_adaptive_sampling")) {
+		integrator->adaptive_threshold = get_float(cscene, "adaptive_threshold");
+		integrator->adaptive_min_samples = get_int(cscene, "adaptive_min_samples");
+	}
+	else
+		integrator->adaptive_threshold = 0.0f;
 #ifdef __CAMERA_MOTION__
 	if(!preview) {
 		if(integrator->motion_blur != r.use_motion_blur()) {
@@ -372,12 +379,15 @@ SceneParams BlenderSync::get_scene_params(BL::Scene b_scene, bool background)
 
 	params.use_bvh_spatial_split = RNA_boolean_get(&cscene, "debug_use_spatial_splits");
 	params.use_bvh_cache = (background)? RNA_boolean_get(&cscene, "use_cache"): false;
+	params.bvh_cache_size = RNA_int_get(&cscene, "cache_size");
 
 	if(background && params.shadingsystem != SHADINGSYSTEM_OSL)
 		params.persistent_data = r.use_persistent_data();
 	else
 		params.persistent_data = false;
 
+	params.texture_cache_size = RNA_int_get(&cscene, "texture_cache_size");
+
 	return params;
 }
 
@@ -506,6 +516,9 @@ SessionParams BlenderSync::get_session_params(BL::RenderEngine b_engine, BL::Use
 	else
 		params.progressive = true;
 
+	/* adaptive sampling needs to know the final sample count of a tile */
+	params.adaptive_sampling = !params.progressive && get_boolean(cscene, "use_adaptive_sampling");
+
 	/* shading system - scene level needs full refresh */
 	const bool shadingsystem = RNA_boolean_get(&cscene, "shading_system");
 
@@ -59,6 +59,15 @@ struct BVHStackEntry
 BVH::BVH(const BVHParams& params_, const vector<Object*>& objects_)
 : params(params_), objects(objects_)
 {
+	cache_map = NULL;
+	build_node_cost = 0.0f;
+	top_level_prims = 0;
+	top_level_nodes = 0;
+}
+
+BVH::~BVH()
+{
+	delete cache_map;
 }
 
 BVH *BVH::create(const BVHParams& params, const vector<Object*>& objects)
@@ -127,6 +136,11 @@ bool BVH::cache_read(CacheData& key)
 			pack.is_leaf.clear();
 			return false;
 		}
+
+		/* keep file mapped for as long as the pack references it */
+		delete cache_map;
+		cache_map = value.release_map();
+
 		return true;
 	}
 
@@ -169,7 +183,7 @@ void BVH::clear_cache_except()
 			except.insert(bvh->cache_filename);
 	}
 
-	Cache::global.clear_except("bvh", except);
+	Cache::global.evict("bvh", except);
 }
 
 /* Building */
@@ -184,8 +198,10 @@ void BVH::build(Progress& progress)
 	if(params.use_cache) {
 		progress.set_substatus("Looking in BVH cache");
 
-		if(cache_read(key))
+		if(cache_read(key)) {
+			build_node_cost = compute_node_cost();
 			return;
+		}
 	}
 
 	/* build nodes */
@@ -206,9 +222,8 @@ void BVH::build(Progress& progress)
 	pack.prim_index = prim_index;
 	pack.prim_object = prim_object;
 
-	/* compute SAH */
-	if(!params.top_level)
-		pack.SAH = root->computeSubtreeSAHCost(params);
+	/* compute SAH, also for the top level for statistics */
+	pack.SAH = root->computeSubtreeSAHCost(params);
 
 	if(progress.get_cancel()) {
 		root->deleteSubtree();
@@ -234,6 +249,8 @@ void BVH::build(Progress& progress)
 
 	if(progress.get_cancel()) return;
 
+	build_node_cost = compute_node_cost();
+
 	/* cache write */
 	if(params.use_cache) {
 		progress.set_substatus("Writing BVH cache");
@@ -249,15 +266,141 @@ void BVH::build(Progress& progress)
 
 void BVH::refit(Progress& progress)
 {
+	if(params.top_level) {
+		/* strip merged instances and global primitive offsets, to get back
+		 * the top level BVH as it was before pack_instances */
+		pack.prim_index.resize(top_level_prims);
+		pack.prim_type.resize(top_level_prims);
+		pack.prim_object.resize(top_level_prims);
+
+		for(size_t i = 0; i < top_level_prims; i++) {
+			if(pack.prim_index[i] != -1) {
+				const Mesh *mesh = objects[pack.prim_object[i]]->mesh;
+
+				if(pack.prim_type[i] & PRIMITIVE_ALL_CURVE)
+					pack.prim_index[i] -= mesh->curve_offset;
+				else
+					pack.prim_index[i] -= mesh->tri_offset;
+			}
+		}
+	}
+
 	progress.set_substatus("Packing BVH primitives");
 	pack_primitives();
 
+	/* merge instance BVH's again, they may have been refitted or rebuilt */
+	if(params.top_level) {
+		progress.set_substatus("Packing BVH instances");
+		pack_instances(top_level_nodes);
+	}
+
 	if(progress.get_cancel()) return;
 
 	progress.set_substatus("Refitting BVH nodes");
 	refit_nodes();
 }
 
+bool BVH::can_refit(const vector<Object*>& objects_)
+{
+	if(!params.top_level)
+		return true;
+
+	/* not known for BVH's read from the cache */
+	if(top_level_nodes == 0)
+		return false;
+
+	if(objects_ != objects || object_meshes.size() != objects.size())
+		return false;
+
+	for(size_t i = 0; i < objects.size(); i++) {
+		Mesh *mesh = objects[i]->mesh;
+
+		if(mesh != object_meshes[i])
+			return false;
+
+		/* object switched between instanced and transform applied */
+		if((pack.object_node[i] == 0) != mesh->transform_applied)
+			return false;
+	}
+
+	return true;
+}
+
+float BVH::refit_quality()
+{
+	if(build_node_cost == 0.0f)
+		return 1.0f;
+
+	return compute_node_cost()/build_node_cost;
+}
+
+void BVH::refit_primitives(int start, int end, BoundBox& bbox, uint& visibility)
+{
+	for(int prim = start; prim < end; prim++) {
+		int pidx = pack.prim_index[prim];
+		int tob = pack.prim_object[prim];
+		Object *ob = objects[tob];
+
+		if(pidx == -1) {
+			/* object instance */
+			bbox.grow(ob->bounds);
+		}
+		else {
+			/* primitives */
+			const Mesh *mesh = ob->mesh;
+
+			if(pack.prim_type[prim] & PRIMITIVE_ALL_CURVE) {
+				/* curves */
+				int str_offset = (params.top_level)? mesh->curve_offset: 0;
+				const Mesh::Curve& curve = mesh->curves[pidx - str_offset];
+				int k = PRIMITIVE_UNPACK_SEGMENT(pack.prim_type[prim]);
+
+				curve.bounds_grow(k, &mesh->curve_keys[0], bbox);
+
+				visibility |= PATH_RAY_CURVE;
+
+				/* motion curves */
+				if(mesh->use_motion_blur) {
+					Attribute *attr = mesh->curve_attributes.find(ATTR_STD_MOTION_VERTEX_POSITION);
+
+					if(attr) {
+						size_t mesh_size = mesh->curve_keys.size();
+						size_t steps = mesh->motion_steps - 1;
+						float4 *key_steps = attr->data_float4();
+
+						for (size_t i = 0; i < steps; i++)
+							curve.bounds_grow(k, key_steps + i*mesh_size, bbox);
+					}
+				}
+			}
+			else {
+				/* triangles */
+				int tri_offset = (params.top_level)? mesh->tri_offset: 0;
+				const Mesh::Triangle& triangle = mesh->triangles[pidx - tri_offset];
+				const float3 *vpos = &mesh->verts[0];
+
+				triangle.bounds_grow(vpos, bbox);
+
+				/* motion triangles */
+				if(mesh->use_motion_blur) {
+					Attribute *attr = mesh->attributes.find(ATTR_STD_MOTION_VERTEX_POSITION);
+
+					if(attr) {
+						size_t mesh_size = mesh->verts.size();
+						size_t steps = mesh->motion_steps - 1;
+						float3 *vert_steps = attr->data_float3();
+
+						for (size_t i = 0; i < steps; i++)
+							triangle.bounds_grow(vert_steps + i*mesh_size, bbox);
+					}
+				}
+			}
+		}
+
+		visibility |= ob->visibility;
+	}
+}
+
 /* Triangles */
 
 void BVH::pack_triangle(int idx, float4 woop[3])
@@ -382,6 +525,14 @@ void BVH::pack_instances(size_t nodes_size)
 	bool use_qbvh = params.use_qbvh;
 	size_t nsize = (use_qbvh)? BVH_QNODE_SIZE: BVH_NODE_SIZE;
 
+	/* remember the top level part and meshes, for refitting */
+	top_level_prims = pack.prim_index.size();
+	top_level_nodes = nodes_size;
+
+	object_meshes.clear();
+	foreach(Object *ob, objects)
+		object_meshes.push_back(ob->mesh);
+
 	/* adjust primitive index to point to the triangle in the global array, for
 	 * meshes with transform applied and already in the top level BVH */
 	for(size_t i = 0; i < pack.prim_index.size(); i++)
@@ -627,8 +778,6 @@ void RegularBVH::pack_nodes(const array<int>& prims, const BVHNode *root)
 
 void RegularBVH::refit_nodes()
 {
-	assert(!params.top_level);
-
 	BoundBox bbox = BoundBox::empty;
 	uint visibility = 0;
 	refit_node(0, (pack.is_leaf[0])? true: false, bbox, visibility);
@@ -642,70 +791,11 @@ void RegularBVH::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility
 	int c1 = data[3].y;
 
 	if(leaf) {
-		/* refit leaf node */
-		for(int prim = c0; prim < c1; prim++) {
-			int pidx = pack.prim_index[prim];
-			int tob = pack.prim_object[prim];
-			Object *ob = objects[tob];
-
-			if(pidx == -1) {
-				/* object instance */
-				bbox.grow(ob->bounds);
-			}
-			else {
-				/* primitives */
-				const Mesh *mesh = ob->mesh;
-
-				if(pack.prim_type[prim] & PRIMITIVE_ALL_CURVE) {
-					/* curves */
-					int str_offset = (params.top_level)? mesh->curve_offset: 0;
-					const Mesh::Curve& curve = mesh->curves[pidx - str_offset];
-					int k = PRIMITIVE_UNPACK_SEGMENT(pack.prim_type[prim]);
-
-					curve.bounds_grow(k, &mesh->curve_keys[0], bbox);
-
-					visibility |= PATH_RAY_CURVE;
-
-					/* motion curves */
-					if(mesh->use_motion_blur) {
-						Attribute *attr = mesh->curve_attributes.find(ATTR_STD_MOTION_VERTEX_POSITION);
-
-						if(attr) {
-							size_t mesh_size = mesh->curve_keys.size();
-							size_t steps = mesh->motion_steps - 1;
-							float4 *key_steps = attr->data_float4();
-
-							for (size_t i = 0; i < steps; i++)
-								curve.bounds_grow(k, key_steps + i*mesh_size, bbox);
-						}
-					}
-				}
-				else {
-					/* triangles */
-					int tri_offset = (params.top_level)? mesh->tri_offset: 0;
-					const Mesh::Triangle& triangle = mesh->triangles[pidx - tri_offset];
-					const float3 *vpos = &mesh->verts[0];
-
-					triangle.bounds_grow(vpos, bbox);
-
-					/* motion triangles */
-					if(mesh->use_motion_blur) {
-						Attribute *attr = mesh->attributes.find(ATTR_STD_MOTION_VERTEX_POSITION);
-
-						if(attr) {
-							size_t mesh_size = mesh->verts.size();
-							size_t steps = mesh->motion_steps - 1;
-							float3 *vert_steps = attr->data_float3();
-
-							for (size_t i = 0; i < steps; i++)
-								triangle.bounds_grow(vert_steps + i*mesh_size, bbox);
-						}
-					}
-				}
-			}
-
-			visibility |= ob->visibility;
-		}
+		/* refit leaf node, object instances are stored as ~index */
+		if(c0 < 0)
+			refit_primitives(~c0, ~c0 + 1, bbox, visibility);
+		else
+			refit_primitives(c0, c1, bbox, visibility);
 
 		pack_node(idx, bbox, bbox, c0, c1, visibility, visibility);
 	}
@@ -725,6 +815,48 @@ void RegularBVH::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility
 	}
 }
 
+float RegularBVH::compute_node_cost()
+{
+	/* sum of child bounds areas of inner nodes, relative to the root area,
+	 * nodes of merged instances are not included */
+	if(pack.nodes.size() == 0 || pack.root_index == -1)
+		return 0.0f;
+
+	float cost = 0.0f;
+	BoundBox root_bbox = BoundBox::empty;
+
+	vector<int> stack;
+	stack.reserve(BVHParams::MAX_DEPTH*2);
+	stack.push_back(0);
+
+	while(stack.size()) {
+		int idx = stack.back();
+		stack.pop_back();
+
+		const int4 *data = &pack.nodes[idx*BVH_NODE_SIZE];
+
+		BoundBox bbox0(make_float3(__int_as_float(data[0].x), __int_as_float(data[1].x), __int_as_float(data[2].x)),
+		               make_float3(__int_as_float(data[0].z), __int_as_float(data[1].z), __int_as_float(data[2].z)));
+		BoundBox bbox1(make_float3(__int_as_float(data[0].y), __int_as_float(data[1].y), __int_as_float(data[2].y)),
+		               make_float3(__int_as_float(data[0].w), __int_as_float(data[1].w), __int_as_float(data[2].w)));
+
+		cost += bbox0.safe_area() + bbox1.safe_area();
+
+		if(idx == 0) {
+			root_bbox.grow(bbox0);
+			root_bbox.grow(bbox1);
+		}
+
+		if(data[3].x >= 0)
+			stack.push_back(data[3].x);
+		if(data[3].y >= 0)
+			stack.push_back(data[3].y);
+	}
+
+	float root_area = root_bbox.safe_area();
+	return (root_area > 0.0f)? cost/root_area: 0.0f;
+}
+
 /* QBVH */
 
 QBVH::QBVH(const BVHParams& params_, const vector<Object*>& objects_)
@@ -865,7 +997,88 @@ void QBVH::pack_nodes(const array<int>& prims, const BVHNode *root)
 
 void QBVH::refit_nodes()
 {
-	assert(0); /* todo */
+	BoundBox bbox = BoundBox::empty;
+	refit_node(0, (pack.is_leaf[0])? true: false, bbox);
+}
+
+void QBVH::refit_node(int idx, bool leaf, BoundBox& bbox)
+{
+	float4 *data = (float4*)&pack.nodes[idx*BVH_QNODE_SIZE];
+	uint visibility = 0;
+
+	if(leaf) {
+		/* refit leaf node, bounds are stored in the parent and object
+		 * instances as ~index */
+		int c0 = __float_as_int(data[6].x);
+		int c1 = __float_as_int(data[6].y);
+
+		if(c0 < 0)
+			refit_primitives(~c0, ~c0 + 1, bbox, visibility);
+		else
+			refit_primitives(c0, c1, bbox, visibility);
+	}
+	else {
+		/* refit inner node, set child bounds, unused slots have index 0 */
+		for(int i = 0; i < 4; i++) {
+			int c = __float_as_int(data[6][i]);
+
+			if(c == 0)
+				continue;
+
+			BoundBox child_bbox = BoundBox::empty;
+			refit_node((c < 0)? -c-1: c, (c < 0), child_bbox);
+
+			data[0][i] = child_bbox.min.x;
+			data[1][i] = child_bbox.max.x;
+			data[2][i] = child_bbox.min.y;
+			data[3][i] = child_bbox.max.y;
+			data[4][i] = child_bbox.min.z;
+			data[5][i] = child_bbox.max.z;
+
+			bbox.grow(child_bbox);
+		}
+	}
+}
+
+float QBVH::compute_node_cost()
+{
+	if(pack.nodes.size() == 0 || pack.root_index == -1)
+		return 0.0f;
+
+	float cost = 0.0f;
+	BoundBox root_bbox = BoundBox::empty;
+
+	vector<int> stack;
+	stack.reserve(BVHParams::MAX_DEPTH*4);
+	stack.push_back(0);
+
+	while(stack.size()) {
+		int idx = stack.back();
+		stack.pop_back();
+
+		const float4 *data = (const float4*)&pack.nodes[idx*BVH_QNODE_SIZE];
+
+		for(int i = 0; i < 4; i++) {
+			int c = __float_as_int(data[6][i]);
+
+			if(c == 0)
+				continue;
+
+			BoundBox child_bbox(make_float3(data[0][i], data[2][i], data[4][i]),
+			                    make_float3(data[1][i], data[3][i], data[5][i]));
+
+			cost += child_bbox.safe_area();
+
+			if(idx == 0)
+				root_bbox.grow(child_bbox);
+
+			if(c > 0)
+				stack.push_back(c);
+		}
+	}
+
+	float root_area = root_bbox.safe_area();
+	return (root_area > 0.0f)? cost/root_area: 0.0f;
 }
 
 CCL_NAMESPACE_END
@@ -31,7 +31,9 @@ struct BVHStackEntry;
 class BVHParams;
 class BoundBox;
 class CacheData;
+class CacheMap;
 class LeafNode;
+class Mesh;
 class Object;
 class Progress;
 
@@ -68,7 +70,7 @@ struct PackedBVH {
 	/* index of the root node. */
 	int root_index;
 
-	/* surface area heuristic, for building top level BVH */
+	/* surface area heuristic, for building top level BVH and statistics */
 	float SAH;
 
 	PackedBVH()
@@ -89,17 +91,36 @@ public:
 	string cache_filename;
 
 	static BVH *create(const BVHParams& params, const vector<Object*>& objects);
-	virtual ~BVH() {}
+	virtual ~BVH();
 
 	void build(Progress& progress);
 	void refit(Progress& progress);
 
+	/* top level BVH can be refitted when the objects and their meshes are the
+	 * same as when it was built, and mesh topology did not change */
+	bool can_refit(const vector<Object*>& objects);
+
+	/* SAH node cost after refitting relative to the cost after building, the
+	 * BVH should be rebuilt when this exceeds params.refit_threshold */
+	float refit_quality();
+
 	void clear_cache_except();
 
 protected:
 	BVH(const BVHParams& params, const vector<Object*>& objects);
 
-	/* cache */
+	/* SAH node cost when built, to measure degradation by refitting */
+	float build_node_cost;
+
+	/* top level part of the pack before instances were merged into it, and
+	 * the meshes of the objects, used for refitting */
+	size_t top_level_prims;
+	size_t top_level_nodes;
+	vector<Mesh*> object_meshes;
+
+	/* cache, pack arrays read from the cache reference the mapped file */
+	CacheMap *cache_map;
+
 	bool cache_read(CacheData& key);
 	void cache_write(CacheData& key);
 
@@ -111,9 +132,13 @@ protected:
 	/* merge instance BVH's */
 	void pack_instances(size_t nodes_size);
 
+	/* refit bounds of primitives in a leaf */
+	void refit_primitives(int start, int end, BoundBox& bbox, uint& visibility);
+
 	/* for subclasses to implement */
 	virtual void pack_nodes(const array<int>& prims, const BVHNode *root) = 0;
 	virtual void refit_nodes() = 0;
+	virtual float compute_node_cost() = 0;
 };
 
 /* Regular BVH
@@ -135,6 +160,8 @@ protected:
 	/* refit */
 	void refit_nodes();
 	void refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility);
+
+	float compute_node_cost();
 };
 
 /* QBVH
@@ -154,6 +181,9 @@ protected:
 
 	/* refit */
 	void refit_nodes();
+	void refit_node(int idx, bool leaf, BoundBox& bbox);
+
+	float compute_node_cost();
 };
 
 CCL_NAMESPACE_END
@@ -26,6 +26,7 @@
 #include "scene.h"
 #include "curves.h"
 
+#include "util_atomic.h"
 #include "util_debug.h"
 #include "util_foreach.h"
 #include "util_logging.h"
@@ -47,6 +48,26 @@ public:
 	BVHObjectBinning range;
 };
 
+/* BVH Spatial Split Build Task
+ *
+ * Spatial splits may duplicate references, so every task works on its own
+ * copy of the references in its range instead of the shared array. */
+
+class BVHSpatialSplitBuildTask : public Task {
+public:
+	BVHSpatialSplitBuildTask(BVHBuild *build, InnerNode *node, int child, const BVHRange& range_,
+	                         const vector<BVHReference>& references_, int level)
+	: range(range_),
+	  references(references_.begin() + range_.start(), references_.begin() + range_.end())
+	{
+		range.set_start(0);
+		run = function_bind(&BVHBuild::thread_build_spatial_split_node, build, node, child, &range, &references, level);
+	}
+
+	BVHRange range;
+	vector<BVHReference> references;
+};
+
 /* Constructor / Destructor */
 
 BVHBuild::BVHBuild(const vector<Object*>& objects_,
@@ -61,6 +82,7 @@ BVHBuild::BVHBuild(const vector<Object*>& objects_,
   progress_start_time(0.0)
 {
 	spatial_min_overlap = 0.0f;
+	spatial_free_index = 0;
 }
 
 BVHBuild::~BVHBuild()
@@ -220,8 +242,7 @@ BVHNode* BVHBuild::run()
 		params.use_spatial_split = false;
 
 	spatial_min_overlap = root.bounds().safe_area() * params.spatial_split_alpha;
-	spatial_right_bounds.clear();
-	spatial_right_bounds.resize(max(root.size(), (int)BVHParams::NUM_SPATIAL_BINS) - 1);
+	spatial_free_index = 0;
 
 	/* init progress updates */
 	double build_start_time;
@@ -238,8 +259,29 @@ BVHNode* BVHBuild::run()
 	BVHNode *rootnode;
 
 	if(params.use_spatial_split) {
-		/* singlethreaded spatial split build */
-		rootnode = build_node(root, 0);
+		/* multithreaded spatial split build */
+		BVHSpatialStorage storage;
+		storage.right_bounds.resize(max(root.size(), (int)BVHParams::NUM_SPATIAL_BINS) - 1);
+
+		rootnode = build_node(root, &references, &storage, 0);
+		task_pool.wait_work();
+
+		/* leaves were appended in the order threads finished them, store them
+		 * in tree order instead so every build of a scene has the same layout */
+		if(rootnode && !progress.get_cancel()) {
+			vector<int> leaf_prim_type, leaf_prim_index, leaf_prim_object;
+
+			leaf_prim_type.swap(prim_type);
+			leaf_prim_index.swap(prim_index);
+			leaf_prim_object.swap(prim_object);
+
+			prim_type.resize(spatial_free_index);
+			prim_index.resize(spatial_free_index);
+			prim_object.resize(spatial_free_index);
+
+			int offset = 0;
+			order_leaf_nodes(rootnode, leaf_prim_type, leaf_prim_index, leaf_prim_object, offset);
+		}
 	}
 	else {
 		/* multithreaded binning build */
@@ -254,7 +296,7 @@ BVHNode* BVHBuild::run()
 			rootnode->deleteSubtree();
 			rootnode = NULL;
 		}
-		else if(!params.use_spatial_split) {
+		else {
 			/*rotate(rootnode, 4, 5);*/
 			rootnode->update_visibility();
 		}
@@ -304,7 +346,30 @@ void BVHBuild::thread_build_node(InnerNode *inner, int child, BVHObjectBinning *
 	}
 }
 
-bool BVHBuild::range_within_max_leaf_size(const BVHRange& range)
+void BVHBuild::thread_build_spatial_split_node(InnerNode *inner, int child, BVHRange *range,
+                                               vector<BVHReference> *references, int level)
+{
+	if(progress.get_cancel())
+		return;
+
+	/* split storage is local to the task, subtrees are built depth first */
+	BVHSpatialStorage storage;
+	storage.right_bounds.resize(max(range->size(), (int)BVHParams::NUM_SPATIAL_BINS) - 1);
+
+	/* build nodes */
+	BVHNode *node = build_node(*range, references, &storage, level);
+
+	/* set child in inner node */
+	inner->children[child] = node;
+
+	/* update progress */
+	if(range->size() < THREAD_TASK_SIZE) {
+		thread_scoped_lock lock(build_mutex);
+		progress_update();
+	}
+}
+
+bool BVHBuild::range_within_max_leaf_size(const BVHRange& range, const vector<BVHReference>& references)
 {
 	size_t size = range.size();
 	size_t max_leaf_size = max(params.max_triangle_leaf_size, params.max_curve_leaf_size);
@@ -316,7 +381,7 @@ bool BVHBuild::range_within_max_leaf_size(const BVHRange& range)
 	size_t num_curves = 0;
 
 	for(int i = 0; i < size; i++) {
-		BVHReference& ref = references[range.start() + i];
+		const BVHReference& ref = references[range.start() + i];
 
 		if(ref.prim_type() & PRIMITIVE_ALL_CURVE)
 			num_curves++;
@@ -338,8 +403,8 @@ BVHNode* BVHBuild::build_node(const BVHObjectBinning& range, int level)
 	 * visibility tests, since object instances do not check visibility flag */
 	if(!(range.size() > 0 && params.top_level && level == 0)) {
 		/* make leaf node when threshold reached or SAH tells us */
-		if(params.small_enough_for_leaf(size, level) || (range_within_max_leaf_size(range) && leafSAH < splitSAH))
-			return create_leaf_node(range);
+		if(params.small_enough_for_leaf(size, level) || (range_within_max_leaf_size(range, references) && leafSAH < splitSAH))
+			return create_leaf_node(range, references);
 	}
 
 	/* perform split */
@@ -367,29 +432,28 @@ BVHNode* BVHBuild::build_node(const BVHObjectBinning& range, int level)
 	return inner;
 }
 
-/* single threaded spatial split builder */
-BVHNode* BVHBuild::build_node(const BVHRange& range, int level)
+/* multithreaded spatial split builder */
+BVHNode* BVHBuild::build_node(const BVHRange& range, vector<BVHReference> *references,
+                              BVHSpatialStorage *storage, int level)
 {
-	/* progress update */
-	progress_update();
 	if(progress.get_cancel())
 		return NULL;
 
 	/* small enough or too deep => create leaf. */
 	if(!(range.size() > 0 && params.top_level && level == 0)) {
 		if(params.small_enough_for_leaf(range.size(), level)) {
-			progress_count += range.size();
-			return create_leaf_node(range);
+			atomic_add_z(&progress_count, range.size());
+			return create_leaf_node(range, *references);
 		}
 	}
 
 	/* splitting test */
-	BVHMixedSplit split(this, range, level);
+	BVHMixedSplit split(this, storage, range, references, level);
 
 	if(!(range.size() > 0 && params.top_level && level == 0)) {
 		if(split.no_split) {
-			progress_count += range.size();
-			return create_leaf_node(range);
+			atomic_add_z(&progress_count, range.size());
+			return create_leaf_node(range, *references);
 		}
 	}
 	
@@ -397,18 +461,33 @@ BVHNode* BVHBuild::build_node(const BVHRange& range, int level)
 	BVHRange left, right;
 	split.split(this, left, right, range);
 
-	progress_total += left.size() + right.size() - range.size();
-	size_t total = progress_total;
+	atomic_add_z(&progress_total, left.size() + right.size() - range.size());
 
-	/* leaft node */
-	BVHNode *leftnode = build_node(left, level + 1);
+	/* create inner node. */
+	InnerNode *inner;
 
-	/* right node (modify start for splits) */
-	right.set_start(right.start() + progress_total - total);
-	BVHNode *rightnode = build_node(right, level + 1);
+	if(range.size() < THREAD_TASK_SIZE) {
+		/* local build */
+		size_t num_references = references->size();
+
+		/* left node */
+		BVHNode *leftnode = build_node(left, references, storage, level + 1);
+
+		/* right node (modify start for references duplicated on the left) */
+		right.set_start(right.start() + (int)(references->size() - num_references));
+		BVHNode *rightnode = build_node(right, references, storage, level + 1);
+
+		inner = new InnerNode(range.bounds(), leftnode, rightnode);
+	}
+	else {
+		/* threaded build */
+		inner = new InnerNode(range.bounds());
+
+		task_pool.push(new BVHSpatialSplitBuildTask(this, inner, 0, left, *references, level + 1), true);
+		task_pool.push(new BVHSpatialSplitBuildTask(this, inner, 1, right, *references, level + 1), true);
+	}
 
-	/* inner node */
-	return new InnerNode(range.bounds(), leftnode, rightnode);
+	return inner;
 }
 
 /* Create Nodes */
@@ -420,18 +499,9 @@ BVHNode *BVHBuild::create_object_leaf_nodes(const BVHReference *ref, int start,
 		return new LeafNode(bounds, 0, 0, 0);
 	}
 	else if(num == 1) {
-		if(start == prim_index.size()) {
-			assert(params.use_spatial_split);
-
-			prim_type.push_back(ref->prim_type());
-			prim_index.push_back(ref->prim_index());
-			prim_object.push_back(ref->prim_object());
-		}
-		else {
-			prim_type[start] = ref->prim_type();
-			prim_index[start] = ref->prim_index();
-			prim_object[start] = ref->prim_object();
-		}
+		prim_type[start] = ref->prim_type();
+		prim_index[start] = ref->prim_index();
+		prim_object[start] = ref->prim_object();
 
 		uint visibility = objects[ref->prim_object()]->visibility;
 		return new LeafNode(ref->bounds(), visibility, start, start+1);
@@ -449,11 +519,61 @@ BVHNode *BVHBuild::create_object_leaf_nodes(const BVHReference *ref, int start,
 	}
 }
 
-BVHNode* BVHBuild::create_leaf_node(const BVHRange& range)
+BVHNode* BVHBuild::create_leaf_node(const BVHRange& range, vector<BVHReference>& references)
+{
+	if(!params.use_spatial_split)
+		return create_leaf_node(range, references, range.start());
+
+	/* spatial split leaves are created from multiple threads and the number
+	 * of references grows with duplicates, so primitives are appended at the
+	 * end of the arrays instead of being stored at the range start, and put in
+	 * tree order by order_leaf_nodes() once the build is done */
+	thread_scoped_lock lock(spatial_mutex);
+
+	size_t start = spatial_free_index;
+	spatial_free_index += range.size();
+
+	if(prim_index.size() < spatial_free_index) {
+		prim_type.resize(spatial_free_index);
+		prim_index.resize(spatial_free_index);
+		prim_object.resize(spatial_free_index);
+	}
+
+	return create_leaf_node(range, references, (int)start);
+}
+
+void BVHBuild::order_leaf_nodes(BVHNode *node, const vector<int>& leaf_prim_type,
+                                const vector<int>& leaf_prim_index, const vector<int>& leaf_prim_object,
+                                int& offset)
+{
+	if(node->is_leaf()) {
+		LeafNode *leaf = (LeafNode*)node;
+		int num = leaf->num_triangles();
+
+		/* empty leaves don't reference any primitives */
+		if(num == 0)
+			return;
+
+		for(int i = 0; i < num; i++) {
+			prim_type[offset + i] = leaf_prim_type[leaf->m_lo + i];
+			prim_index[offset + i] = leaf_prim_index[leaf->m_lo + i];
+			prim_object[offset + i] = leaf_prim_object[leaf->m_lo + i];
+		}
+
+		leaf->m_lo = offset;
+		leaf->m_hi = offset + num;
+		offset += num;
+	}
+	else {
+		InnerNode *inner = (InnerNode*)node;
+
+		for(int c = 0; c < 2; c++)
+			order_leaf_nodes(inner->children[c], leaf_prim_type, leaf_prim_index, leaf_prim_object, offset);
+	}
+}
+
+BVHNode* BVHBuild::create_leaf_node(const BVHRange& range, vector<BVHReference>& references, int start)
 {
-	vector<int>& p_type = prim_type;
-	vector<int>& p_index = prim_index;
-	vector<int>& p_object = prim_object;
 	BoundBox bounds = BoundBox::empty;
 	int num = 0, ob_num = 0;
 	uint visibility = 0;
@@ -462,18 +582,9 @@ BVHNode* BVHBuild::create_leaf_node(const BVHRange& range)
 		BVHReference& ref = references[range.start() + i];
 
 		if(ref.prim_index() != -1) {
-			if(range.start() + num == prim_index.size()) {
-				assert(params.use_spatial_split);
-
-				p_type.push_back(ref.prim_type());
-				p_index.push_back(ref.prim_index());
-				p_object.push_back(ref.prim_object());
-			}
-			else {
-				p_type[range.start() + num] = ref.prim_type();
-				p_index[range.start() + num] = ref.prim_index();
-				p_object[range.start() + num] = ref.prim_object();
-			}
+			prim_type[start + num] = ref.prim_type();
+			prim_index[start + num] = ref.prim_index();
+			prim_object[start + num] = ref.prim_object();
 
 			bounds.grow(ref.bounds());
 			visibility |= objects[ref.prim_object()]->visibility;
@@ -489,7 +600,7 @@ BVHNode* BVHBuild::create_leaf_node(const BVHRange& range)
 	BVHNode *leaf = NULL;
 	
 	if(num > 0) {
-		leaf = new LeafNode(bounds, visibility, range.start(), range.start() + num);
+		leaf = new LeafNode(bounds, visibility, start, start + num);
 
 		if(num == range.size())
 			return leaf;
@@ -498,7 +609,7 @@ BVHNode* BVHBuild::create_leaf_node(const BVHRange& range)
 	/* while there may be multiple triangles in a leaf, for object primitives
 	 * we want there to be the only one, so we keep splitting */
 	const BVHReference *ref = (ob_num)? &references[range.start()]: NULL;
-	BVHNode *oleaf = create_object_leaf_nodes(ref, range.start() + num, ob_num);
+	BVHNode *oleaf = create_object_leaf_nodes(ref, start + num, ob_num);
 	
 	if(leaf)
 		return new InnerNode(range.bounds(), leaf, oleaf);
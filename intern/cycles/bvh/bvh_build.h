@@ -30,11 +30,13 @@
 CCL_NAMESPACE_BEGIN
 
 class BVHBuildTask;
+class BVHSpatialSplitBuildTask;
 class BVHParams;
 class InnerNode;
 class Mesh;
 class Object;
 class Progress;
+struct BVHSpatialStorage;
 
 /* BVH Builder */
 
@@ -58,6 +60,7 @@ protected:
 	friend class BVHObjectSplit;
 	friend class BVHSpatialSplit;
 	friend class BVHBuildTask;
+	friend class BVHSpatialSplitBuildTask;
 
 	/* adding references */
 	void add_reference_mesh(BoundBox& root, BoundBox& center, Mesh *mesh, int i);
@@ -65,16 +68,21 @@ protected:
 	void add_references(BVHRange& root);
 
 	/* building */
-	BVHNode *build_node(const BVHRange& range, int level);
+	BVHNode *build_node(const BVHRange& range, vector<BVHReference> *references, BVHSpatialStorage *storage, int level);
 	BVHNode *build_node(const BVHObjectBinning& range, int level);
-	BVHNode *create_leaf_node(const BVHRange& range);
+	BVHNode *create_leaf_node(const BVHRange& range, vector<BVHReference>& references);
+	BVHNode *create_leaf_node(const BVHRange& range, vector<BVHReference>& references, int start);
 	BVHNode *create_object_leaf_nodes(const BVHReference *ref, int start, int num);
+	void order_leaf_nodes(BVHNode *node, const vector<int>& leaf_prim_type,
+	                      const vector<int>& leaf_prim_index, const vector<int>& leaf_prim_object,
+	                      int& offset);
 
-	bool range_within_max_leaf_size(const BVHRange& range);
+	bool range_within_max_leaf_size(const BVHRange& range, const vector<BVHReference>& references);
 
 	/* threads */
 	enum { THREAD_TASK_SIZE = 4096 };
 	void thread_build_node(InnerNode *node, int child, BVHObjectBinning *range, int level);
+	void thread_build_spatial_split_node(InnerNode *node, int child, BVHRange *range, vector<BVHReference> *references, int level);
 	thread_mutex build_mutex;
 
 	/* progress */
@@ -106,8 +114,8 @@ protected:
 
 	/* spatial splitting */
 	float spatial_min_overlap;
-	vector<BoundBox> spatial_right_bounds;
-	BVHSpatialBin spatial_bins[3][BVHParams::NUM_SPATIAL_BINS];
+	thread_mutex spatial_mutex;
+	size_t spatial_free_index;
 
 	/* threads */
 	TaskPool task_pool;
@@ -49,6 +49,9 @@ public:
 	/* QBVH */
 	int use_qbvh;
 
+	/* refitting, rebuild when the SAH node cost grew by more than this factor */
+	float refit_threshold;
+
 	int pad;
 
 	/* fixed parameters */
@@ -75,6 +78,7 @@ public:
 		top_level = false;
 		use_cache = false;
 		use_qbvh = false;
+		refit_threshold = 1.5f;
 		pad = false;
 	}
 
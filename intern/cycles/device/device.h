@@ -31,6 +31,7 @@
 
 CCL_NAMESPACE_BEGIN
 
+class ImageCache;
 class Progress;
 class RenderTile;
 
@@ -110,6 +111,13 @@ public:
 		InterpolationType interpolation = INTERPOLATION_NONE, bool periodic = false) {};
 	virtual void tex_free(device_memory& mem) {};
 
+	/* out of core texture cache, images are read from the cache on demand
+	 * instead of being copied to the device. returns false if the device
+	 * does not support this, the image must then be loaded fully */
+	virtual bool tex_cache_alloc(const char *name, ImageCache *cache, int slot,
+		int width, int height, InterpolationType interpolation = INTERPOLATION_NONE) { return false; }
+	virtual void tex_cache_free(const char *name) {};
+
 	/* pixel memory */
 	virtual void pixels_alloc(device_memory& mem);
 	virtual void pixels_copy_from(device_memory& mem, int y, int w, int h);
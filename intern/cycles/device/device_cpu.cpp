@@ -29,6 +29,7 @@
 #include "kernel_compat_cpu.h"
 #include "kernel_types.h"
 #include "kernel_globals.h"
+#include "kernel_adaptive_sampling.h"
 
 #include "osl_shader.h"
 #include "osl_globals.h"
@@ -38,10 +39,12 @@
 #include "util_debug.h"
 #include "util_foreach.h"
 #include "util_function.h"
+#include "util_logging.h"
 #include "util_opengl.h"
 #include "util_progress.h"
 #include "util_system.h"
 #include "util_thread.h"
+#include "util_vector.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -128,6 +131,18 @@ public:
 		}
 	}
 
+	bool tex_cache_alloc(const char *name, ImageCache *cache, int slot,
+		int width, int height, InterpolationType interpolation)
+	{
+		kernel_tex_cache_copy(&kernel_globals, name, cache, slot, width, height, interpolation);
+		return true;
+	}
+
+	void tex_cache_free(const char *name)
+	{
+		kernel_tex_cache_copy(&kernel_globals, name, NULL, -1, 0, 0);
+	}
+
 	void *osl_memory()
 	{
 #ifdef WITH_OSL
@@ -199,6 +214,10 @@ public:
 		else
 #endif
 			path_trace_kernel = kernel_cpu_path_trace;
+
+		bool use_adaptive_sampling = (kg.__data.film.pass_flag & PASS_ADAPTIVE_AUX_BUFFER) &&
+		                             (kg.__data.film.pass_flag & PASS_SAMPLE_COUNT) &&
+		                             kg.__data.integrator.adaptive_threshold > 0.0f;
 		
 		while(task.acquire_tile(this, tile)) {
 			float *render_buffer = (float*)tile.buffer;
@@ -221,9 +240,25 @@ public:
 
 					tile.sample = sample + 1;
 
+					if(use_adaptive_sampling && adaptive_sampling_converged(&kg, tile, sample + 1)) {
+						/* count the samples that are no longer needed as done */
+						for(int i = sample + 1; i < end_sample; i++)
+							task.update_progress_sample();
+
+						VLOG(2) << "Tile at " << tile.x << ", " << tile.y
+						        << " converged after " << tile.sample << " samples.";
+
+						tile.sample = end_sample;
+						task.update_progress(&tile);
+						break;
+					}
+
 					task.update_progress(&tile);
 				}
 
+				if(use_adaptive_sampling)
+					adaptive_sampling_post(&kg, tile);
+
 
 			task.release_tile(tile);
 
@@ -238,6 +273,78 @@ public:
 #endif
 	}
 
+	/* Test the pixels of the tile that are still sampled for convergence,
+	 * returns true when all pixels of the tile converged. A pixel is only
+	 * marked as converged when its neighbors converged as well, so noise at
+	 * the edge of converged regions keeps being sampled. */
+	bool adaptive_sampling_converged(KernelGlobals *kg, RenderTile& tile, int num_samples)
+	{
+		KernelIntegrator *kintegrator = &kg->__data.integrator;
+		int pass_stride = kg->__data.film.pass_stride;
+
+		/* only test every few samples, the noise estimate of the half
+		 * buffer needs an even number of samples */
+		if(num_samples < kintegrator->adaptive_min_samples || (num_samples & 3) != 0)
+			return false;
+
+		float *render_buffer = (float*)tile.buffer;
+		vector<char> converged(tile.w*tile.h);
+
+		for(int y = 0; y < tile.h; y++) {
+			for(int x = 0; x < tile.w; x++) {
+				int index = tile.offset + (tile.x + x) + (tile.y + y)*tile.stride;
+				float *buffer = render_buffer + index*pass_stride;
+
+				converged[x + y*tile.w] = kernel_adaptive_pixel_converged(kg, buffer) ||
+					kernel_adaptive_pixel_error(kg, buffer, num_samples) < kintegrator->adaptive_threshold;
+			}
+		}
+
+		bool tile_converged = true;
+
+		for(int y = 0; y < tile.h; y++) {
+			for(int x = 0; x < tile.w; x++) {
+				int index = tile.offset + (tile.x + x) + (tile.y + y)*tile.stride;
+				float *buffer = render_buffer + index*pass_stride;
+
+				if(kernel_adaptive_pixel_converged(kg, buffer))
+					continue;
+
+				bool pixel_converged = true;
+
+				for(int ny = max(y - 1, 0); ny <= min(y + 1, tile.h - 1) && pixel_converged; ny++)
+					for(int nx = max(x - 1, 0); nx <= min(x + 1, tile.w - 1) && pixel_converged; nx++)
+						pixel_converged = converged[nx + ny*tile.w] != 0;
+
+				if(pixel_converged)
+					kernel_adaptive_mark_converged(kg, buffer);
+				else
+					tile_converged = false;
+			}
+		}
+
+		return tile_converged;
+	}
+
+	/* Rescale pixels that stopped early to the sample count of the tile. */
+	void adaptive_sampling_post(KernelGlobals *kg, RenderTile& tile)
+	{
+		int pass_stride = kg->__data.film.pass_stride;
+		int pass_sample_count = kg->__data.film.pass_sample_count;
+		float *render_buffer = (float*)tile.buffer;
+
+		for(int y = tile.y; y < tile.y + tile.h; y++) {
+			for(int x = tile.x; x < tile.x + tile.w; x++) {
+				int index = tile.offset + x + y*tile.stride;
+				float *buffer = render_buffer + index*pass_stride;
+				float num_samples = buffer[pass_sample_count];
+
+				if(num_samples > 0.0f && num_samples < (float)tile.sample)
+					kernel_adaptive_post_adjust(kg, buffer, (float)tile.sample/num_samples);
+			}
+		}
+	}
+
 	void thread_film_convert(DeviceTask& task)
 	{
 		float sample_scale = 1.0f/(task.sample + 1);
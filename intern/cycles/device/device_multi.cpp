@@ -192,6 +192,26 @@ public:
 		mem.device_pointer = 0;
 	}
 
+	bool tex_cache_alloc(const char *name, ImageCache *cache, int slot,
+		int width, int height, InterpolationType interpolation)
+	{
+		foreach(SubDevice& sub, devices) {
+			if(!sub.device->tex_cache_alloc(name, cache, slot, width, height, interpolation)) {
+				/* all devices must support the cache, otherwise load fully */
+				tex_cache_free(name);
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void tex_cache_free(const char *name)
+	{
+		foreach(SubDevice& sub, devices)
+			sub.device->tex_cache_free(name);
+	}
+
 	void pixels_alloc(device_memory& mem)
 	{
 		foreach(SubDevice& sub, devices) {
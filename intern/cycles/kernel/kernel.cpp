@@ -61,6 +61,7 @@ void kernel_tex_copy(KernelGlobals *kg, const char *name, device_ptr mem, size_t
 
 		if(tex) {
 			tex->data = (float4*)mem;
+			tex->cache = NULL;
 			tex->dimensions_set(width, height, depth);
 			tex->interpolation = interpolation;
 		}
@@ -76,6 +77,7 @@ void kernel_tex_copy(KernelGlobals *kg, const char *name, device_ptr mem, size_t
 
 		if(tex) {
 			tex->data = (uchar4*)mem;
+			tex->cache = NULL;
 			tex->dimensions_set(width, height, depth);
 			tex->interpolation = interpolation;
 		}
@@ -84,6 +86,38 @@ void kernel_tex_copy(KernelGlobals *kg, const char *name, device_ptr mem, size_t
 		assert(0);
 }
 
+void kernel_tex_cache_copy(KernelGlobals *kg, const char *name, ImageCache *cache, int slot, size_t width, size_t height, InterpolationType interpolation)
+{
+	if(strstr(name, "__tex_image_float")) {
+		int array_index = atoi(name + strlen("__tex_image_float_"));
+
+		if(array_index >= 0 && array_index < MAX_FLOAT_IMAGES) {
+			texture_image_float4 *tex = &kg->texture_float_images[array_index];
+
+			tex->data = NULL;
+			tex->cache = cache;
+			tex->cache_slot = slot;
+			tex->dimensions_set(width, height, 1);
+			tex->interpolation = interpolation;
+		}
+	}
+	else if(strstr(name, "__tex_image")) {
+		int array_index = atoi(name + strlen("__tex_image_")) - MAX_FLOAT_IMAGES;
+
+		if(array_index >= 0 && array_index < MAX_BYTE_IMAGES) {
+			texture_image_uchar4 *tex = &kg->texture_byte_images[array_index];
+
+			tex->data = NULL;
+			tex->cache = cache;
+			tex->cache_slot = slot;
+			tex->dimensions_set(width, height, 1);
+			tex->interpolation = interpolation;
+		}
+	}
+	else
+		assert(0);
+}
+
 /* On x86-64, we can assume SSE2, so avoid the extra kernel and compile this one with SSE2 intrinsics */
 #if defined(__x86_64__) || defined(_M_X64)
 #define __KERNEL_SSE2__
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2011-2015 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+CCL_NAMESPACE_BEGIN
+
+/* Adaptive Sampling
+ *
+ * Besides the combined pass, every odd sample is accumulated into the
+ * auxiliary buffer. The difference between the full estimate and twice the
+ * half estimate tells how noisy a pixel still is, once it drops below the
+ * threshold the pixel is marked as converged in the fourth component of the
+ * auxiliary buffer and no further samples are taken for it. Pixels that
+ * stopped early are rescaled at the end of the tile, so the buffer can be
+ * normalized with the sample count of the tile like without adaptive
+ * sampling.
+ *
+ * The passes are written in kernel_passes.h, convergence tests and rescaling
+ * are done per tile by the device. */
+
+ccl_device_inline bool kernel_adaptive_pixel_converged(KernelGlobals *kg, ccl_global float *buffer)
+{
+	if(!(kernel_data.film.pass_flag & PASS_ADAPTIVE_AUX_BUFFER))
+		return false;
+
+	return buffer[kernel_data.film.pass_adaptive_aux_buffer + 3] != 0.0f;
+}
+
+/* Error estimate of the pixel after num_samples samples, relative to the
+ * square root of its brightness so dark regions aren't oversampled. */
+ccl_device float kernel_adaptive_pixel_error(KernelGlobals *kg, ccl_global float *buffer, int num_samples)
+{
+	ccl_global float *combined = buffer + kernel_data.film.pass_combined;
+	ccl_global float *aux = buffer + kernel_data.film.pass_adaptive_aux_buffer;
+
+	float3 I = make_float3(combined[0], combined[1], combined[2]);
+	float3 A = 2.0f*make_float3(aux[0], aux[1], aux[2]);
+
+	float inv_samples = 1.0f/(float)num_samples;
+	float difference = (fabsf(I.x - A.x) + fabsf(I.y - A.y) + fabsf(I.z - A.z))*inv_samples;
+	float normalize = sqrtf(max(I.x + I.y + I.z, 0.0f)*inv_samples);
+
+	return difference/(0.0001f + normalize);
+}
+
+ccl_device_inline void kernel_adaptive_mark_converged(KernelGlobals *kg, ccl_global float *buffer)
+{
+	buffer[kernel_data.film.pass_adaptive_aux_buffer + 3] = 1.0f;
+}
+
+/* Scale the accumulated passes of a pixel that stopped early, passes that
+ * are only written for the first sample are left untouched. */
+ccl_device void kernel_adaptive_post_adjust(KernelGlobals *kg, ccl_global float *buffer, float sample_multiplier)
+{
+	int flag = kernel_data.film.pass_flag;
+	int pass_stride = kernel_data.film.pass_stride;
+
+	for(int i = 0; i < pass_stride; i++) {
+		if((flag & PASS_DEPTH) && i == kernel_data.film.pass_depth)
+			continue;
+		if((flag & PASS_OBJECT_ID) && i == kernel_data.film.pass_object_id)
+			continue;
+		if((flag & PASS_MATERIAL_ID) && i == kernel_data.film.pass_material_id)
+			continue;
+		if((flag & PASS_SAMPLE_COUNT) && i == kernel_data.film.pass_sample_count)
+			continue;
+		if((flag & PASS_ADAPTIVE_AUX_BUFFER) &&
+		   i >= kernel_data.film.pass_adaptive_aux_buffer &&
+		   i < kernel_data.film.pass_adaptive_aux_buffer + 4)
+		{
+			continue;
+		}
+
+		buffer[i] *= sample_multiplier;
+	}
+}
+
+CCL_NAMESPACE_END
+
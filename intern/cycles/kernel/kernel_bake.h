@@ -433,6 +433,27 @@ ccl_device void kernel_shader_evaluate(KernelGlobals *kg, ccl_global uint4 *inpu
 		shader_eval_displacement(kg, &sd, SHADER_CONTEXT_MAIN);
 		out = sd.P - P;
 	}
+	else if(type == SHADER_EVAL_INTERSECT) {
+		/* ray origin and distance, and direction in two consecutive inputs */
+		uint4 in_D = input[i*2 + 1];
+		in = input[i*2];
+
+		Ray ray;
+		ray.P = make_float3(__uint_as_float(in.x), __uint_as_float(in.y), __uint_as_float(in.z));
+		ray.D = make_float3(__uint_as_float(in_D.x), __uint_as_float(in_D.y), __uint_as_float(in_D.z));
+		ray.t = __uint_as_float(in.w);
+#ifdef __CAMERA_MOTION__
+		ray.time = 0.5f;
+#endif
+
+		/* trace, output is distance and primitive or -1 when nothing was hit */
+		Intersection isect;
+
+		if(scene_intersect(kg, &ray, PATH_RAY_ALL_VISIBILITY, &isect, NULL, 0.0f, 0.0f))
+			out = make_float3(isect.t, __int_as_float(isect.prim), __int_as_float(isect.object));
+		else
+			out = make_float3(-1.0f, __int_as_float(PRIM_NONE), __int_as_float(OBJECT_NONE));
+	}
 	else { // SHADER_EVAL_BACKGROUND
 		/* setup ray */
 		Ray ray;
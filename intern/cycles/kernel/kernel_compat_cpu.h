@@ -20,6 +20,7 @@
 #define __KERNEL_CPU__
 
 #include "util_debug.h"
+#include "util_image_cache.h"
 #include "util_math.h"
 #include "util_simd.h"
 #include "util_half.h"
@@ -71,6 +72,12 @@ template<typename T> struct texture  {
 };
 
 template<typename T> struct texture_image  {
+	texture_image()
+	: data(NULL), cache(NULL), cache_slot(-1),
+	  interpolation(INTERPOLATION_LINEAR), width(0), height(0), depth(0)
+	{
+	}
+
 	ccl_always_inline float4 read(float4 r)
 	{
 		return r;
@@ -104,8 +111,12 @@ template<typename T> struct texture_image  {
 
 	ccl_always_inline float4 interp(float x, float y, bool periodic = true)
 	{
-		if(UNLIKELY(!data))
+		if(UNLIKELY(!data)) {
+			if(cache)
+				return cache->lookup(cache_slot, x, y, 0.0f, interpolation, periodic);
+
 			return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+		}
 
 		int ix, iy, nix, niy;
 
@@ -151,6 +162,16 @@ template<typename T> struct texture_image  {
 		}
 	}
 
+	/* lookup with a filter width in texture space, used to pick MIP levels
+	 * for images in the out of core image cache */
+	ccl_always_inline float4 interp_filtered(float x, float y, float filter_width, bool periodic = true)
+	{
+		if(UNLIKELY(cache != NULL))
+			return cache->lookup(cache_slot, x, y, filter_width, interpolation, periodic);
+
+		return interp(x, y, periodic);
+	}
+
 	ccl_always_inline float4 interp_3d(float x, float y, float z, bool periodic = false)
 	{
 		return interp_3d_ex(x, y, z, interpolation, periodic);
@@ -318,6 +339,8 @@ template<typename T> struct texture_image  {
 	}
 
 	T *data;
+	ImageCache *cache;
+	int cache_slot;
 	int interpolation;
 	int width, height, depth;
 };
@@ -339,6 +362,8 @@ typedef texture_image<uchar4> texture_image_uchar4;
 #define kernel_tex_fetch_ssei(tex, index) (kg->tex.fetch_ssei(index))
 #define kernel_tex_lookup(tex, t, offset, size) (kg->tex.lookup(t, offset, size))
 #define kernel_tex_image_interp(tex, x, y) ((tex < MAX_FLOAT_IMAGES) ? kg->texture_float_images[tex].interp(x, y) : kg->texture_byte_images[tex - MAX_FLOAT_IMAGES].interp(x, y))
+#define kernel_tex_image_interp_filtered(tex, x, y, width) ((tex < MAX_FLOAT_IMAGES) ? kg->texture_float_images[tex].interp_filtered(x, y, width) : kg->texture_byte_images[tex - MAX_FLOAT_IMAGES].interp_filtered(x, y, width))
+#define kernel_tex_image_is_cached(tex) ((tex < MAX_FLOAT_IMAGES) ? kg->texture_float_images[tex].cache != NULL : kg->texture_byte_images[tex - MAX_FLOAT_IMAGES].cache != NULL)
 #define kernel_tex_image_interp_3d(tex, x, y, z) ((tex < MAX_FLOAT_IMAGES) ? kg->texture_float_images[tex].interp_3d(x, y, z) : kg->texture_byte_images[tex - MAX_FLOAT_IMAGES].interp_3d(x, y, z))
 #define kernel_tex_image_interp_3d_ex(tex, x, y, z, interpolation) ((tex < MAX_FLOAT_IMAGES) ? kg->texture_float_images[tex].interp_3d_ex(x, y, z, interpolation) : kg->texture_byte_images[tex - MAX_FLOAT_IMAGES].interp_3d_ex(x, y, z, interpolation))
 
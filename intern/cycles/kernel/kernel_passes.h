@@ -34,6 +34,24 @@ ccl_device_inline void kernel_write_pass_float4(ccl_global float *buffer, int sa
 	*buf = (sample == 0)? value: *buf + value;
 }
 
+ccl_device_inline void kernel_write_adaptive_passes(KernelGlobals *kg, ccl_global float *buffer, int sample, float4 L)
+{
+	int flag = kernel_data.film.pass_flag;
+
+	/* odd samples only, written per component since a float3 store would
+	 * overwrite the converged flag in the fourth component */
+	if((flag & PASS_ADAPTIVE_AUX_BUFFER) && (sample & 1)) {
+		ccl_global float *aux = buffer + kernel_data.film.pass_adaptive_aux_buffer;
+
+		kernel_write_pass_float(aux + 0, sample - 1, L.x);
+		kernel_write_pass_float(aux + 1, sample - 1, L.y);
+		kernel_write_pass_float(aux + 2, sample - 1, L.z);
+	}
+
+	if(flag & PASS_SAMPLE_COUNT)
+		kernel_write_pass_float(buffer + kernel_data.film.pass_sample_count, sample, 1.0f);
+}
+
 ccl_device_inline void kernel_write_data_passes(KernelGlobals *kg, ccl_global float *buffer, PathRadiance *L,
 	ShaderData *sd, int sample, PathState *state, float3 throughput)
 {
@@ -30,6 +30,7 @@
 #include "kernel_shader.h"
 #include "kernel_light.h"
 #include "kernel_passes.h"
+#include "kernel_adaptive_sampling.h"
 
 #ifdef __SUBSURFACE__
 #include "kernel_subsurface.h"
@@ -1210,6 +1211,10 @@ ccl_device void kernel_path_trace(KernelGlobals *kg,
 	rng_state += index;
 	buffer += index*pass_stride;
 
+	/* pixel reached the adaptive sampling noise threshold */
+	if(kernel_adaptive_pixel_converged(kg, buffer))
+		return;
+
 	/* initialize random numbers and ray */
 	RNG rng;
 	Ray ray;
@@ -1226,6 +1231,7 @@ ccl_device void kernel_path_trace(KernelGlobals *kg,
 
 	/* accumulate result in output buffer */
 	kernel_write_pass_float4(buffer, sample, L);
+	kernel_write_adaptive_passes(kg, buffer, sample, L);
 
 	path_rng_end(kg, rng_state, rng);
 }
@@ -1242,6 +1248,10 @@ ccl_device void kernel_branched_path_trace(KernelGlobals *kg,
 	rng_state += index;
 	buffer += index*pass_stride;
 
+	/* pixel reached the adaptive sampling noise threshold */
+	if(kernel_adaptive_pixel_converged(kg, buffer))
+		return;
+
 	/* initialize random numbers and ray */
 	RNG rng;
 	Ray ray;
@@ -1258,6 +1268,7 @@ ccl_device void kernel_branched_path_trace(KernelGlobals *kg,
 
 	/* accumulate result in output buffer */
 	kernel_write_pass_float4(buffer, sample, L);
+	kernel_write_adaptive_passes(kg, buffer, sample, L);
 
 	path_rng_end(kg, rng_state, rng);
 }
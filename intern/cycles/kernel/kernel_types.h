@@ -170,6 +170,7 @@ typedef uint RNG;
 typedef enum ShaderEvalType {
 	SHADER_EVAL_DISPLACE,
 	SHADER_EVAL_BACKGROUND,
+	SHADER_EVAL_INTERSECT, /* scene intersection only, for benchmarking */
 	/* bake types */
 	SHADER_EVAL_BAKE, /* no real shade, it's used in the code to
 	                   * differentiate the type of shader eval from the above
@@ -320,6 +321,8 @@ typedef enum PassType {
 #ifdef __KERNEL_DEBUG__
 	PASS_BVH_TRAVERSAL_STEPS = (1 << 26),
 #endif
+	PASS_ADAPTIVE_AUX_BUFFER = (1 << 27),
+	PASS_SAMPLE_COUNT = (1 << 28),
 } PassType;
 
 #define PASS_ALL (~0)
@@ -856,6 +859,10 @@ typedef struct KernelFilm {
 	float mist_inv_depth;
 	float mist_falloff;
 
+	int pass_adaptive_aux_buffer;
+	int pass_sample_count;
+	int pass_pad6, pass_pad7;
+
 #ifdef __KERNEL_DEBUG__
 	int pass_bvh_traversal_steps;
 	int pass_pad3, pass_pad4, pass_pad5;
@@ -938,6 +945,11 @@ typedef struct KernelIntegrator {
 	int volume_max_steps;
 	float volume_step_size;
 	int volume_samples;
+
+	/* adaptive sampling */
+	float adaptive_threshold;
+	int adaptive_min_samples;
+	int pad1, pad2;
 } KernelIntegrator;
 
 typedef struct KernelBVH {
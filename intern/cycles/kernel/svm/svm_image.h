@@ -48,7 +48,7 @@ ccl_device_inline float svm_image_texture_frac(float x, int *ix)
 	return x - (float)i;
 }
 
-ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, uint srgb, uint use_alpha)
+ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, float filter_width, uint srgb, uint use_alpha)
 {
 	/* first slots are used by float textures, which are not supported here */
 	if(id < TEX_NUM_FLOAT_IMAGES)
@@ -130,15 +130,15 @@ ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y,
 
 #else
 
-ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, uint srgb, uint use_alpha)
+ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, float filter_width, uint srgb, uint use_alpha)
 {
 #ifdef __KERNEL_CPU__
 #ifdef __KERNEL_SSE2__
 	ssef r_ssef;
 	float4 &r = (float4 &)r_ssef;
-	r = kernel_tex_image_interp(id, x, y);
+	r = kernel_tex_image_interp_filtered(id, x, y, filter_width);
 #else
-	float4 r = kernel_tex_image_interp(id, x, y);
+	float4 r = kernel_tex_image_interp_filtered(id, x, y, filter_width);
 #endif
 #else
 	float4 r;
@@ -354,6 +354,34 @@ ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y,
 
 #endif
 
+#ifdef __KERNEL_CPU__
+
+/* Texture space filter width for MIP level selection of cached images, from
+ * the ray differentials of the default UV map. Only known when the texture
+ * coordinate is that UV map, otherwise the full resolution is used. */
+
+ccl_device float svm_image_texture_filter_width(KernelGlobals *kg, ShaderData *sd, int id, float3 co)
+{
+	if(!kernel_tex_image_is_cached(id))
+		return 0.0f;
+
+	AttributeElement elem;
+	int offset = find_attribute(kg, sd, ATTR_STD_UV, &elem);
+
+	if(offset == ATTR_STD_NOT_FOUND)
+		return 0.0f;
+
+	float3 dx, dy;
+	float3 uv = primitive_attribute_float3(kg, sd, elem, offset, &dx, &dy);
+
+	if(fabsf(uv.x - co.x) > 1e-5f || fabsf(uv.y - co.y) > 1e-5f)
+		return 0.0f;
+
+	return max(max(fabsf(dx.x), fabsf(dx.y)), max(fabsf(dy.x), fabsf(dy.y)));
+}
+
+#endif
+
 ccl_device void svm_node_tex_image(KernelGlobals *kg, ShaderData *sd, float *stack, uint4 node)
 {
 	uint id = node.y;
@@ -363,7 +391,12 @@ ccl_device void svm_node_tex_image(KernelGlobals *kg, ShaderData *sd, float *sta
 
 	float3 co = stack_load_float3(stack, co_offset);
 	uint use_alpha = stack_valid(alpha_offset);
-	float4 f = svm_image_texture(kg, id, co.x, co.y, srgb, use_alpha);
+#ifdef __KERNEL_CPU__
+	float filter_width = svm_image_texture_filter_width(kg, sd, id, co);
+#else
+	float filter_width = 0.0f;
+#endif
+	float4 f = svm_image_texture(kg, id, co.x, co.y, filter_width, srgb, use_alpha);
 
 	if(stack_valid(out_offset))
 		stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -451,11 +484,11 @@ ccl_device void svm_node_tex_image_box(KernelGlobals *kg, ShaderData *sd, float
 	uint use_alpha = stack_valid(alpha_offset);
 
 	if(weight.x > 0.0f)
-		f += weight.x*svm_image_texture(kg, id, co.y, co.z, srgb, use_alpha);
+		f += weight.x*svm_image_texture(kg, id, co.y, co.z, 0.0f, srgb, use_alpha);
 	if(weight.y > 0.0f)
-		f += weight.y*svm_image_texture(kg, id, co.x, co.z, srgb, use_alpha);
+		f += weight.y*svm_image_texture(kg, id, co.x, co.z, 0.0f, srgb, use_alpha);
 	if(weight.z > 0.0f)
-		f += weight.z*svm_image_texture(kg, id, co.y, co.x, srgb, use_alpha);
+		f += weight.z*svm_image_texture(kg, id, co.y, co.x, 0.0f, srgb, use_alpha);
 
 	if(stack_valid(out_offset))
 		stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -483,7 +516,7 @@ ccl_device void svm_node_tex_environment(KernelGlobals *kg, ShaderData *sd, floa
 		uv = direction_to_mirrorball(co);
 
 	uint use_alpha = stack_valid(alpha_offset);
-	float4 f = svm_image_texture(kg, id, uv.x, uv.y, srgb, use_alpha);
+	float4 f = svm_image_texture(kg, id, uv.x, uv.y, 0.0f, srgb, use_alpha);
 
 	if(stack_valid(out_offset))
 		stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
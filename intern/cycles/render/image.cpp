@@ -20,6 +20,7 @@
 
 #include "util_foreach.h"
 #include "util_image.h"
+#include "util_image_cache.h"
 #include "util_path.h"
 #include "util_progress.h"
 
@@ -35,6 +36,8 @@ ImageManager::ImageManager()
 	pack_images = false;
 	osl_texture_system = NULL;
 	animation_frame = 0;
+	image_cache = NULL;
+	texture_cache_size = 0;
 
 	tex_num_images = TEX_NUM_IMAGES;
 	tex_num_float_images = TEX_NUM_FLOAT_IMAGES;
@@ -47,6 +50,8 @@ ImageManager::~ImageManager()
 		assert(!images[slot]);
 	for(size_t slot = 0; slot < float_images.size(); slot++)
 		assert(!float_images[slot]);
+
+	delete image_cache;
 }
 
 void ImageManager::set_pack_images(bool pack_images_)
@@ -88,6 +93,31 @@ bool ImageManager::set_animation_frame_update(int frame)
 	return false;
 }
 
+void ImageManager::set_texture_cache_size(size_t size)
+{
+	if(size == texture_cache_size)
+		return;
+
+	bool toggled = (size == 0) != (texture_cache_size == 0);
+	texture_cache_size = size;
+
+	if(image_cache && size)
+		image_cache->set_memory_limit(size);
+
+	if(toggled) {
+		/* reload images to switch between cached and fully loaded */
+		for(size_t slot = 0; slot < images.size(); slot++)
+			if(images[slot])
+				images[slot]->need_load = true;
+
+		for(size_t slot = 0; slot < float_images.size(); slot++)
+			if(float_images[slot])
+				float_images[slot]->need_load = true;
+
+		need_update = true;
+	}
+}
+
 bool ImageManager::is_float_image(const string& filename, void *builtin_data, bool& is_linear)
 {
 	bool is_float = false;
@@ -212,6 +242,7 @@ int ImageManager::add_image(const string& filename, void *builtin_data, bool ani
 		img->interpolation = interpolation;
 		img->users = 1;
 		img->use_alpha = use_alpha;
+		img->cache_slot = -1;
 
 		float_images[slot] = img;
 	}
@@ -259,6 +290,7 @@ int ImageManager::add_image(const string& filename, void *builtin_data, bool ani
 		img->interpolation = interpolation;
 		img->users = 1;
 		img->use_alpha = use_alpha;
+		img->cache_slot = -1;
 
 		images[slot] = img;
 
@@ -612,6 +644,64 @@ bool ImageManager::file_load_float_image(Image *img, device_vector<float4>& tex_
 	return true;
 }
 
+string ImageManager::device_image_name(int slot, bool is_float)
+{
+	const char *prefix = (is_float)? "__tex_image_float": "__tex_image";
+
+	if(slot >= 100) return string_printf("%s_%d", prefix, slot);
+	else if(slot >= 10) return string_printf("%s_0%d", prefix, slot);
+	else return string_printf("%s_00%d", prefix, slot);
+}
+
+bool ImageManager::device_load_cached_image(Device *device, Image *img, const string& name, bool is_float)
+{
+	/* only image files are cached, packed and generated images are
+	 * already in memory and OpenCL needs all images in one texture */
+	if(texture_cache_size == 0 || pack_images || img->builtin_data)
+		return false;
+
+	{
+		thread_scoped_lock cache_lock(cache_mutex);
+
+		if(!image_cache)
+			image_cache = new ImageCache(texture_cache_size, &device->stats);
+	}
+
+	int width, height;
+	bool is_linear;
+	is_float_image(img->filename, NULL, is_linear);
+
+	int cache_slot = image_cache->add_image(img->filename, is_float, is_linear, img->use_alpha, &width, &height);
+
+	if(cache_slot == -1)
+		return false;
+
+	thread_scoped_lock device_lock(device_mutex);
+
+	if(!device->tex_cache_alloc(name.c_str(), image_cache, cache_slot, width, height, img->interpolation)) {
+		image_cache->remove_image(cache_slot);
+		return false;
+	}
+
+	img->cache_slot = cache_slot;
+
+	return true;
+}
+
+void ImageManager::device_free_cached_image(Device *device, Image *img, const string& name)
+{
+	if(img->cache_slot == -1)
+		return;
+
+	{
+		thread_scoped_lock device_lock(device_mutex);
+		device->tex_cache_free(name.c_str());
+	}
+
+	image_cache->remove_image(img->cache_slot);
+	img->cache_slot = -1;
+}
+
 void ImageManager::device_load_image(Device *device, DeviceScene *dscene, int slot, Progress *progress)
 {
 	if(progress->get_cancel())
@@ -632,6 +722,10 @@ void ImageManager::device_load_image(Device *device, DeviceScene *dscene, int sl
 	if(osl_texture_system && !img->builtin_data)
 		return;
 
+	string name = device_image_name(slot, is_float);
+
+	device_free_cached_image(device, img, name);
+
 	if(is_float) {
 		string filename = path_filename(float_images[slot]->filename);
 		progress->set_status("Updating Images", "Loading " + filename);
@@ -643,6 +737,12 @@ void ImageManager::device_load_image(Device *device, DeviceScene *dscene, int sl
 			device->tex_free(tex_img);
 		}
 
+		if(device_load_cached_image(device, img, name, is_float)) {
+			tex_img.clear();
+			img->need_load = false;
+			return;
+		}
+
 		if(!file_load_float_image(img, tex_img)) {
 			/* on failure to load, we set a 1x1 pixels pink image */
 			float *pixels = (float*)tex_img.resize(1, 1);
@@ -653,12 +753,6 @@ void ImageManager::device_load_image(Device *device, DeviceScene *dscene, int sl
 			pixels[3] = TEX_IMAGE_MISSING_A;
 		}
 
-		string name;
-
-		if(slot >= 100) name = string_printf("__tex_image_float_%d", slot);
-		else if(slot >= 10) name = string_printf("__tex_image_float_0%d", slot);
-		else name = string_printf("__tex_image_float_00%d", slot);
-
 		if(!pack_images) {
 			thread_scoped_lock device_lock(device_mutex);
 			device->tex_alloc(name.c_str(), tex_img, img->interpolation, true);
@@ -675,6 +769,12 @@ void ImageManager::device_load_image(Device *device, DeviceScene *dscene, int sl
 			device->tex_free(tex_img);
 		}
 
+		if(device_load_cached_image(device, img, name, is_float)) {
+			tex_img.clear();
+			img->need_load = false;
+			return;
+		}
+
 		if(!file_load_image(img, tex_img)) {
 			/* on failure to load, we set a 1x1 pixels pink image */
 			uchar *pixels = (uchar*)tex_img.resize(1, 1);
@@ -685,12 +785,6 @@ void ImageManager::device_load_image(Device *device, DeviceScene *dscene, int sl
 			pixels[3] = (TEX_IMAGE_MISSING_A * 255);
 		}
 
-		string name;
-
-		if(slot >= 100) name = string_printf("__tex_image_%d", slot);
-		else if(slot >= 10) name = string_printf("__tex_image_0%d", slot);
-		else name = string_printf("__tex_image_00%d", slot);
-
 		if(!pack_images) {
 			thread_scoped_lock device_lock(device_mutex);
 			device->tex_alloc(name.c_str(), tex_img, img->interpolation, true);
@@ -724,6 +818,8 @@ void ImageManager::device_free_image(Device *device, DeviceScene *dscene, int sl
 		else if(is_float) {
 			device_vector<float4>& tex_img = dscene->tex_float_image[slot];
 
+			device_free_cached_image(device, img, device_image_name(slot, is_float));
+
 			if(tex_img.device_pointer) {
 				thread_scoped_lock device_lock(device_mutex);
 				device->tex_free(tex_img);
@@ -737,6 +833,8 @@ void ImageManager::device_free_image(Device *device, DeviceScene *dscene, int sl
 		else {
 			device_vector<uchar4>& tex_img = dscene->tex_image[slot - tex_image_byte_start];
 
+			device_free_cached_image(device, img, device_image_name(slot, is_float));
+
 			if(tex_img.device_pointer) {
 				thread_scoped_lock device_lock(device_mutex);
 				device->tex_free(tex_img);
@@ -870,6 +968,10 @@ void ImageManager::device_free(Device *device, DeviceScene *dscene)
 
 	images.clear();
 	float_images.clear();
+
+	/* cache holds a pointer to the device stats */
+	delete image_cache;
+	image_cache = NULL;
 }
 
 CCL_NAMESPACE_END
@@ -48,6 +48,7 @@ CCL_NAMESPACE_BEGIN
 
 class Device;
 class DeviceScene;
+class ImageCache;
 class Progress;
 
 class ImageManager {
@@ -70,6 +71,10 @@ public:
 	void set_pack_images(bool pack_images_);
 	void set_extended_image_limits(const DeviceInfo& info);
 	bool set_animation_frame_update(int frame);
+	void set_texture_cache_size(size_t size);
+
+	/* out of core image cache, NULL when not in use */
+	ImageCache *get_image_cache() { return image_cache; }
 
 	bool need_update;
 
@@ -88,6 +93,7 @@ public:
 		InterpolationType interpolation;
 
 		int users;
+		int cache_slot;
 	};
 
 private:
@@ -102,10 +108,17 @@ private:
 	void *osl_texture_system;
 	bool pack_images;
 
+	ImageCache *image_cache;
+	size_t texture_cache_size;
+	thread_mutex cache_mutex;
+
 	bool file_load_image(Image *img, device_vector<uchar4>& tex_img);
 	bool file_load_float_image(Image *img, device_vector<float4>& tex_img);
 
 	void device_load_image(Device *device, DeviceScene *dscene, int slot, Progress *progess);
+	bool device_load_cached_image(Device *device, Image *img, const string& name, bool is_float);
+	void device_free_cached_image(Device *device, Image *img, const string& name);
+	string device_image_name(int slot, bool is_float);
 	void device_free_image(Device *device, DeviceScene *dscene, int slot);
 
 	void device_pack_images(Device *device, DeviceScene *dscene, Progress& progess);
@@ -63,6 +63,9 @@ Integrator::Integrator()
 
 	sampling_pattern = SAMPLING_PATTERN_SOBOL;
 
+	adaptive_threshold = 0.0f;
+	adaptive_min_samples = 16;
+
 	need_update = true;
 }
 
@@ -145,6 +148,9 @@ void Integrator::device_update(Device *device, DeviceScene *dscene, Scene *scene
 	kintegrator->sampling_pattern = sampling_pattern;
 	kintegrator->aa_samples = aa_samples;
 
+	kintegrator->adaptive_threshold = adaptive_threshold;
+	kintegrator->adaptive_min_samples = max(adaptive_min_samples, 1);
+
 	/* sobol directions table */
 	int max_samples = 1;
 
@@ -209,7 +215,9 @@ bool Integrator::modified(const Integrator& integrator)
 		motion_blur == integrator.motion_blur &&
 		sampling_pattern == integrator.sampling_pattern &&
 		sample_all_lights_direct == integrator.sample_all_lights_direct &&
-		sample_all_lights_indirect == integrator.sample_all_lights_indirect);
+		sample_all_lights_indirect == integrator.sample_all_lights_indirect &&
+		adaptive_threshold == integrator.adaptive_threshold &&
+		adaptive_min_samples == integrator.adaptive_min_samples);
 }
 
 void Integrator::tag_update(Scene *scene)
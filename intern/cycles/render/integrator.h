@@ -73,6 +73,11 @@ public:
 
 	SamplingPattern sampling_pattern;
 
+	/* adaptive sampling, pixels stop sampling once their noise estimate
+	 * drops below the threshold, 0 disables it */
+	float adaptive_threshold;
+	int adaptive_min_samples;
+
 	bool need_update;
 
 	Integrator();
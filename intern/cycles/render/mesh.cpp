@@ -30,8 +30,10 @@
 
 #include "util_cache.h"
 #include "util_foreach.h"
+#include "util_logging.h"
 #include "util_progress.h"
 #include "util_set.h"
+#include "util_time.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -481,7 +483,7 @@ void Mesh::pack_curves(Scene *scene, float4 *curve_key_co, float4 *curve_data, s
 	}
 }
 
-void Mesh::compute_bvh(SceneParams *params, Progress *progress, int n, int total)
+void Mesh::compute_bvh(SceneParams *params, Progress *progress, BVHTimes *times, int n, int total)
 {
 	if(progress->get_cancel())
 		return;
@@ -501,22 +503,37 @@ void Mesh::compute_bvh(SceneParams *params, Progress *progress, int n, int total
 		vector<Object*> objects;
 		objects.push_back(&object);
 
-		if(bvh && !need_update_rebuild) {
+		bool rebuild = (bvh == NULL || need_update_rebuild);
+
+		if(!rebuild) {
 			progress->set_status(msg, "Refitting BVH");
+
+			double time_start = time_dt();
 			bvh->objects = objects;
 			bvh->refit(*progress);
+			times->add_refit(time_dt() - time_start);
+
+			/* rebuild if deformation degraded the tree too much */
+			if(bvh->refit_quality() > bvh->params.refit_threshold)
+				rebuild = true;
 		}
-		else {
+
+		if(rebuild) {
 			progress->set_status(msg, "Building BVH");
 
 			BVHParams bparams;
 			bparams.use_cache = params->use_bvh_cache;
 			bparams.use_spatial_split = params->use_bvh_spatial_split;
 			bparams.use_qbvh = params->use_qbvh;
+			bparams.spatial_split_alpha = params->bvh_spatial_split_alpha;
+			bparams.min_leaf_size = params->bvh_min_leaf_size;
+			bparams.max_triangle_leaf_size = params->bvh_max_leaf_size;
 
+			double time_start = time_dt();
 			delete bvh;
 			bvh = BVH::create(bparams, objects);
 			bvh->build(*progress);
+			times->add_build(time_dt() - time_start);
 		}
 	}
 
@@ -549,6 +566,35 @@ bool Mesh::has_motion_blur() const
 	         curve_attributes.find(ATTR_STD_MOTION_VERTEX_POSITION)));
 }
 
+/* BVH Times */
+
+BVHTimes::BVHTimes()
+{
+	reset();
+}
+
+void BVHTimes::reset()
+{
+	build_time = 0.0;
+	refit_time = 0.0;
+	num_builds = 0;
+	num_refits = 0;
+}
+
+void BVHTimes::add_build(double time)
+{
+	thread_scoped_lock lock(mutex);
+	build_time += time;
+	num_builds++;
+}
+
+void BVHTimes::add_refit(double time)
+{
+	thread_scoped_lock lock(mutex);
+	refit_time += time;
+	num_refits++;
+}
+
 /* Mesh Manager */
 
 MeshManager::MeshManager()
@@ -975,23 +1021,66 @@ void MeshManager::device_update_mesh(Device *device, DeviceScene *dscene, Scene
 	}
 }
 
-void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
+void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *scene, bool can_refit, Progress& progress)
 {
-	/* bvh build */
-	progress.set_status("Updating Scene BVH", "Building");
-
 	BVHParams bparams;
 	bparams.top_level = true;
 	bparams.use_qbvh = scene->params.use_qbvh;
 	bparams.use_spatial_split = scene->params.use_bvh_spatial_split;
 	bparams.use_cache = scene->params.use_bvh_cache;
+	bparams.spatial_split_alpha = scene->params.bvh_spatial_split_alpha;
+	bparams.min_leaf_size = scene->params.bvh_min_leaf_size;
+	bparams.max_triangle_leaf_size = scene->params.bvh_max_leaf_size;
+
+	/* refit when only object transforms and vertex positions changed */
+	bool rebuild = !(bvh && can_refit &&
+	                 bvh->params.use_qbvh == bparams.use_qbvh &&
+	                 bvh->params.use_spatial_split == bparams.use_spatial_split &&
+	                 bvh->params.use_cache == bparams.use_cache &&
+	                 bvh->params.spatial_split_alpha == bparams.spatial_split_alpha &&
+	                 bvh->params.min_leaf_size == bparams.min_leaf_size &&
+	                 bvh->params.max_triangle_leaf_size == bparams.max_triangle_leaf_size &&
+	                 bvh->can_refit(scene->objects));
+
+	if(!rebuild) {
+		progress.set_status("Updating Scene BVH", "Refitting");
+
+		double time_start = time_dt();
+		bvh->refit(progress);
+		scene_bvh_times.add_refit(time_dt() - time_start);
 
-	delete bvh;
-	bvh = BVH::create(bparams, scene->objects);
-	bvh->build(progress);
+		if(progress.get_cancel()) return;
+
+		/* rebuild if moving objects degraded the tree too much */
+		if(bvh->refit_quality() > bvh->params.refit_threshold)
+			rebuild = true;
+	}
+
+	if(rebuild) {
+		/* bvh build */
+		progress.set_status("Updating Scene BVH", "Building");
+
+		double time_start = time_dt();
+		delete bvh;
+		bvh = BVH::create(bparams, scene->objects);
+		bvh->build(progress);
+		scene_bvh_times.add_build(time_dt() - time_start);
+	}
 
 	if(progress.get_cancel()) return;
 
+	VLOG(1) << "Mesh BVH: " << mesh_bvh_times.num_builds << " built in "
+	        << mesh_bvh_times.build_time << "s, " << mesh_bvh_times.num_refits
+	        << " refitted in " << mesh_bvh_times.refit_time << "s.";
+	VLOG(1) << "Scene BVH: " << scene_bvh_times.num_builds << " built in "
+	        << scene_bvh_times.build_time << "s, " << scene_bvh_times.num_refits
+	        << " refitted in " << scene_bvh_times.refit_time << "s.";
+
+	if(bparams.use_cache) {
+		VLOG(1) << "BVH cache: " << Cache::global.hits << " hits, "
+		        << Cache::global.misses << " misses.";
+	}
+
 	/* copy to device */
 	progress.set_status("Updating Scene BVH", "Copying BVH to device");
 
@@ -1086,15 +1175,27 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 	/* update bvh */
 	size_t i = 0, num_bvh = 0;
 
-	foreach(Mesh *mesh, scene->meshes)
+	if(scene->params.use_bvh_cache)
+		Cache::global.max_size = (size_t)scene->params.bvh_cache_size * 1024 * 1024;
+
+	/* the scene BVH can only be refitted when no mesh topology changed */
+	bool can_refit = true;
+
+	foreach(Mesh *mesh, scene->meshes) {
 		if(mesh->need_update && !mesh->transform_applied)
 			num_bvh++;
+		if(mesh->need_update && mesh->need_update_rebuild)
+			can_refit = false;
+	}
+
+	mesh_bvh_times.reset();
+	scene_bvh_times.reset();
 
 	TaskPool pool;
 
 	foreach(Mesh *mesh, scene->meshes) {
 		if(mesh->need_update) {
-			pool.push(function_bind(&Mesh::compute_bvh, mesh, &scene->params, &progress, i, num_bvh));
+			pool.push(function_bind(&Mesh::compute_bvh, mesh, &scene->params, &progress, &mesh_bvh_times, i, num_bvh));
 			i++;
 		}
 	}
@@ -1118,7 +1219,7 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 
 	if(progress.get_cancel()) return;
 
-	device_update_bvh(device, dscene, scene, progress);
+	device_update_bvh(device, dscene, scene, can_refit, progress);
 
 	need_update = false;
 }
@@ -24,6 +24,7 @@
 #include "util_list.h"
 #include "util_map.h"
 #include "util_param.h"
+#include "util_thread.h"
 #include "util_transform.h"
 #include "util_types.h"
 #include "util_vector.h"
@@ -31,6 +32,7 @@
 CCL_NAMESPACE_BEGIN
 
 class BVH;
+class BVHTimes;
 class Device;
 class DeviceScene;
 class Mesh;
@@ -128,7 +130,7 @@ public:
 	void pack_normals(Scene *scene, uint *shader, float4 *vnormal);
 	void pack_verts(float4 *tri_verts, float4 *tri_vindex, size_t vert_offset);
 	void pack_curves(Scene *scene, float4 *curve_key_co, float4 *curve_data, size_t curvekey_offset);
-	void compute_bvh(SceneParams *params, Progress *progress, int n, int total);
+	void compute_bvh(SceneParams *params, Progress *progress, BVHTimes *times, int n, int total);
 
 	bool need_attribute(Scene *scene, AttributeStandard std);
 	bool need_attribute(Scene *scene, ustring name);
@@ -138,12 +140,38 @@ public:
 	bool has_motion_blur() const;
 };
 
+/* BVH Times
+ *
+ * Time spent building and refitting BVHs during a scene update, BVHs for
+ * different meshes are updated from multiple threads. */
+
+class BVHTimes {
+public:
+	double build_time;
+	double refit_time;
+	int num_builds;
+	int num_refits;
+
+	BVHTimes();
+
+	void reset();
+	void add_build(double time);
+	void add_refit(double time);
+
+protected:
+	thread_mutex mutex;
+};
+
 /* Mesh Manager */
 
 class MeshManager {
 public:
 	BVH *bvh;
 
+	/* timing of the last update */
+	BVHTimes mesh_bvh_times;
+	BVHTimes scene_bvh_times;
+
 	bool need_update;
 
 	MeshManager();
@@ -159,7 +187,7 @@ public:
 	void device_update_object(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress);
 	void device_update_mesh(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress);
 	void device_update_attributes(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress);
-	void device_update_bvh(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress);
+	void device_update_bvh(Device *device, DeviceScene *dscene, Scene *scene, bool can_refit, Progress& progress);
 	void device_free(Device *device, DeviceScene *dscene);
 
 	void tag_update(Scene *scene);
@@ -149,6 +149,7 @@ void Scene::device_update(Device *device_, Progress& progress)
 	 */
 	
 	image_manager->set_pack_images(device->info.pack_images);
+	image_manager->set_texture_cache_size((size_t)params.texture_cache_size * 1024 * 1024);
 
 	progress.set_status("Updating Shaders");
 	shader_manager->device_update(device, &dscene, this, progress);
@@ -125,31 +125,46 @@ public:
 	ShadingSystem shadingsystem;
 	enum BVHType { BVH_DYNAMIC, BVH_STATIC } bvh_type;
 	bool use_bvh_cache;
+	int bvh_cache_size;
 	bool use_bvh_spatial_split;
 	bool use_qbvh;
+	float bvh_spatial_split_alpha;
+	int bvh_min_leaf_size;
+	int bvh_max_leaf_size;
 	bool persistent_data;
+	int texture_cache_size;
 
 	SceneParams()
 	{
 		shadingsystem = SHADINGSYSTEM_SVM;
 		bvh_type = BVH_DYNAMIC;
 		use_bvh_cache = false;
+		bvh_cache_size = 0;
 		use_bvh_spatial_split = false;
 #ifdef __QBVH__
 		use_qbvh = true;
 #else
 		use_qbvh = false;
 #endif
+		bvh_spatial_split_alpha = 1e-5f;
+		bvh_min_leaf_size = 1;
+		bvh_max_leaf_size = 8;
 		persistent_data = false;
+		texture_cache_size = 0;
 	}
 
 	bool modified(const SceneParams& params)
 	{ return !(shadingsystem == params.shadingsystem
 		&& bvh_type == params.bvh_type
 		&& use_bvh_cache == params.use_bvh_cache
+		&& bvh_cache_size == params.bvh_cache_size
 		&& use_bvh_spatial_split == params.use_bvh_spatial_split
 		&& use_qbvh == params.use_qbvh
-		&& persistent_data == params.persistent_data); }
+		&& bvh_spatial_split_alpha == params.bvh_spatial_split_alpha
+		&& bvh_min_leaf_size == params.bvh_min_leaf_size
+		&& bvh_max_leaf_size == params.bvh_max_leaf_size
+		&& persistent_data == params.persistent_data
+		&& texture_cache_size == params.texture_cache_size); }
 };
 
 /* Scene */
@@ -20,6 +20,7 @@
 #include "buffers.h"
 #include "camera.h"
 #include "device.h"
+#include "image.h"
 #include "integrator.h"
 #include "scene.h"
 #include "session.h"
@@ -27,6 +28,7 @@
 
 #include "util_foreach.h"
 #include "util_function.h"
+#include "util_image_cache.h"
 #include "util_math.h"
 #include "util_opengl.h"
 #include "util_task.h"
@@ -807,6 +809,20 @@ void Session::update_status_time(bool show_pause, bool show_done)
 		substatus = string_printf("Path Tracing Sample %d", sample+1);
 	else
 		substatus = string_printf("Path Tracing Sample %d/%d", sample+1, tile_manager.num_samples);
+
+	/* texture cache statistics */
+	ImageCache *image_cache = scene->image_manager->get_image_cache();
+
+	if(image_cache) {
+		size_t hits = image_cache->num_hits();
+		size_t lookups = hits + image_cache->num_misses();
+
+		if(lookups) {
+			substatus += string_printf(", Texture Cache %.1fM (%.1f%% hits)",
+				(double)image_cache->memory_used() / (1024.0*1024.0),
+				100.0 * (double)hits / (double)lookups);
+		}
+	}
 	
 	if(show_pause) {
 		status = "Paused";
@@ -48,6 +48,7 @@ public:
 
 	bool progressive;
 	bool experimental;
+	bool adaptive_sampling;
 	int samples;
 	int2 tile_size;
 	TileOrder tile_order;
@@ -70,6 +71,7 @@ public:
 
 		progressive = false;
 		experimental = false;
+		adaptive_sampling = false;
 		samples = USHRT_MAX;
 		tile_size = make_int2(64, 64);
 		start_resolution = INT_MAX;
@@ -94,6 +96,7 @@ public:
 		/* && samples == params.samples */
 		&& progressive == params.progressive
 		&& experimental == params.experimental
+		&& adaptive_sampling == params.adaptive_sampling
 		&& tile_size == params.tile_size
 		&& start_resolution == params.start_resolution
 		&& threads == params.threads
@@ -16,6 +16,8 @@
 
 #include <stdio.h>
 
+#include "util_algorithm.h"
+#include "util_atomic.h"
 #include "util_cache.h"
 #include "util_debug.h"
 #include "util_foreach.h"
@@ -33,21 +35,130 @@
 #include <boost/filesystem.hpp> 
 #include <boost/algorithm/string.hpp>
 
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
 CCL_NAMESPACE_BEGIN
 
+/* CacheMap */
+
+CacheMap::CacheMap()
+{
+	data = NULL;
+	size = 0;
+#ifdef _WIN32
+	map_handle = NULL;
+#endif
+}
+
+CacheMap::~CacheMap()
+{
+	close();
+}
+
+bool CacheMap::open(const string& filename)
+{
+	close();
+
+#ifdef _WIN32
+	/* allow other processes to replace or remove the file while mapped */
+	HANDLE file_handle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_DELETE,
+	                                 NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if(file_handle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER file_size;
+
+	if(!GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0) {
+		CloseHandle(file_handle);
+		return false;
+	}
+
+	map_handle = CreateFileMapping(file_handle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+
+	/* the mapping stays valid after closing the file, same as on other
+	 * platforms, so the file handle doesn't block renaming or removing */
+	CloseHandle(file_handle);
+
+	if(!map_handle) {
+		close();
+		return false;
+	}
+
+	data = (uint8_t*)MapViewOfFile(map_handle, FILE_MAP_COPY, 0, 0, 0);
+	size = (size_t)file_size.QuadPart;
+#else
+	int fd = ::open(filename.c_str(), O_RDONLY);
+
+	if(fd == -1)
+		return false;
+
+	struct stat st;
+
+	if(fstat(fd, &st) != 0 || st.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+
+	/* private mapping, writes to the pages are copy-on-write */
+	void *ptr = mmap(NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+	/* the mapping stays valid after closing the file */
+	::close(fd);
+
+	if(ptr == MAP_FAILED)
+		return false;
+
+	data = (uint8_t*)ptr;
+	size = (size_t)st.st_size;
+#endif
+
+	if(!data) {
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void CacheMap::close()
+{
+#ifdef _WIN32
+	if(data)
+		UnmapViewOfFile(data);
+	if(map_handle)
+		CloseHandle(map_handle);
+
+	map_handle = NULL;
+#else
+	if(data)
+		munmap(data, size);
+#endif
+
+	data = NULL;
+	size = 0;
+}
+
 /* CacheData */
 
 CacheData::CacheData(const string& name_)
 {
 	name = name_;
-	f = NULL;
+	map = NULL;
+	offset = 0;
 	have_filename = false;
 }
 
 CacheData::~CacheData()
 {
-	if(f)
-		fclose(f);
+	delete map;
 }
 
 const string& CacheData::get_filename()
@@ -66,47 +177,140 @@ const string& CacheData::get_filename()
 	return filename;
 }
 
+static size_t cache_align(size_t offset)
+{
+	return (offset + CACHE_FILE_ALIGN - 1) & ~(size_t)(CACHE_FILE_ALIGN - 1);
+}
+
+bool CacheData::read_buffer(void **data, size_t *size)
+{
+	if(!map || offset + sizeof(uint64_t) > map->size)
+		return false;
+
+	uint64_t buffer_size;
+	memcpy(&buffer_size, map->data + offset, sizeof(buffer_size));
+
+	size_t data_offset = cache_align(offset + sizeof(uint64_t));
+
+	if(buffer_size > map->size || data_offset + buffer_size > map->size)
+		return false;
+
+	*data = map->data + data_offset;
+	*size = (size_t)buffer_size;
+	offset = cache_align(data_offset + (size_t)buffer_size);
+
+	return true;
+}
+
 /* Cache */
 
 Cache Cache::global;
 
+Cache::Cache()
+{
+	max_size = 0;
+	hits = 0;
+	misses = 0;
+}
+
 string Cache::data_filename(CacheData& key)
 {
 	return path_user_get(path_join("cache", key.get_filename()));
 }
 
+static int cache_process_id()
+{
+#ifdef _WIN32
+	return (int)GetCurrentProcessId();
+#else
+	return (int)getpid();
+#endif
+}
+
+static bool cache_write_padded(FILE *f, const void *data, size_t size, size_t *offset)
+{
+	static const uint8_t zero[CACHE_FILE_ALIGN] = {0};
+	size_t padding = cache_align(*offset + size) - (*offset + size);
+
+	if(size && !fwrite(data, size, 1, f))
+		return false;
+	if(padding && !fwrite(zero, padding, 1, f))
+		return false;
+
+	*offset += size + padding;
+	return true;
+}
+
 void Cache::insert(CacheData& key, CacheData& value)
 {
 	string filename = data_filename(key);
 	path_create_directories(filename);
-	FILE *f = path_fopen(filename, "wb");
+
+	/* write to a temporary file first, so that other processes sharing the
+	 * cache directory never map a partially written file */
+	string tmp_filename = string_printf("%s.%d.%p.tmp", filename.c_str(), cache_process_id(), (void*)&value);
+	FILE *f = path_fopen(tmp_filename, "wb");
 
 	if(!f) {
-		fprintf(stderr, "Failed to open file %s for writing.\n", filename.c_str());
+		fprintf(stderr, "Failed to open file %s for writing.\n", tmp_filename.c_str());
 		return;
 	}
 
+	size_t offset = 0;
+	bool ok = cache_write_padded(f, CACHE_FILE_MAGIC, strlen(CACHE_FILE_MAGIC), &offset);
+
 	foreach(CacheBuffer& buffer, value.buffers) {
-		if(!fwrite(&buffer.size, sizeof(buffer.size), 1, f))
-			fprintf(stderr, "Failed to write to file %s.\n", filename.c_str());
-		if(buffer.size)
-			if(!fwrite(buffer.data, buffer.size, 1, f))
-				fprintf(stderr, "Failed to write to file %s.\n", filename.c_str());
+		uint64_t size = buffer.size;
+
+		ok = ok && cache_write_padded(f, &size, sizeof(size), &offset);
+		ok = ok && cache_write_padded(f, buffer.data, buffer.size, &offset);
 	}
 	
 	fclose(f);
+
+	boost::system::error_code ec;
+
+	if(ok) {
+		boost::filesystem::rename(boost::filesystem::path(tmp_filename), boost::filesystem::path(filename), ec);
+
+		/* on Windows a file that is still mapped can't be replaced, since
+		 * files are named by the hash of their key it has the same contents */
+		if(ec && boost::filesystem::exists(boost::filesystem::path(filename))) {
+			boost::filesystem::remove(boost::filesystem::path(tmp_filename), ec);
+			return;
+		}
+	}
+
+	if(!ok || ec) {
+		fprintf(stderr, "Failed to write to file %s.\n", filename.c_str());
+		boost::filesystem::remove(boost::filesystem::path(tmp_filename), ec);
+	}
 }
 
 bool Cache::lookup(CacheData& key, CacheData& value)
 {
 	string filename = data_filename(key);
-	FILE *f = path_fopen(filename, "rb");
+	CacheMap *map = new CacheMap();
 
-	if(!f)
+	if(!map->open(filename) ||
+	   map->size < cache_align(strlen(CACHE_FILE_MAGIC)) ||
+	   memcmp(map->data, CACHE_FILE_MAGIC, strlen(CACHE_FILE_MAGIC)) != 0)
+	{
+		delete map;
+		atomic_add_z(&misses, 1);
 		return false;
-	
+	}
+
+	/* mark as recently used for eviction */
+	boost::system::error_code ec;
+	boost::filesystem::last_write_time(boost::filesystem::path(filename), time(NULL), ec);
+
+	delete value.map;
 	value.name = key.name;
-	value.f = f;
+	value.map = map;
+	value.offset = cache_align(strlen(CACHE_FILE_MAGIC));
+
+	atomic_add_z(&hits, 1);
 
 	return true;
 }
@@ -116,5 +320,67 @@ void Cache::clear_except(const string& name, const set<string>& except)
 	path_cache_clear_except(name, except);
 }
 
-CCL_NAMESPACE_END
+/* age in seconds after which temporary files are considered left over */
+#define CACHE_TMP_FILE_EXPIRE (60*60)
+
+struct CacheFileInfo {
+	boost::filesystem::path path;
+	uintmax_t size;
+	time_t time;
+};
+
+static bool cache_file_info_older(const CacheFileInfo& a, const CacheFileInfo& b)
+{
+	return a.time < b.time;
+}
+
+void Cache::evict(const string& name, const set<string>& except)
+{
+	string dir = path_user_get("cache");
+	boost::system::error_code ec;
+
+	if(!boost::filesystem::exists(boost::filesystem::path(dir), ec))
+		return;
 
+	vector<CacheFileInfo> files;
+	uintmax_t total_size = 0;
+
+	boost::filesystem::directory_iterator it(boost::filesystem::path(dir), ec), it_end;
+
+	for(; !ec && it != it_end; it.increment(ec)) {
+#if (BOOST_FILESYSTEM_VERSION == 2)
+		string filename = it->path().filename();
+#else
+		string filename = it->path().filename().string();
+#endif
+
+		if(!boost::starts_with(filename, name) || except.find(filename) != except.end())
+			continue;
+
+		CacheFileInfo info;
+		info.path = it->path();
+		info.size = boost::filesystem::file_size(info.path, ec);
+		info.time = boost::filesystem::last_write_time(info.path, ec);
+
+		/* temporary files may still be written by this or other processes,
+		 * only remove them once they're clearly left over from a crash */
+		if(!ec && boost::ends_with(filename, ".tmp") && time(NULL) - info.time < CACHE_TMP_FILE_EXPIRE)
+			continue;
+
+		if(!ec) {
+			files.push_back(info);
+			total_size += info.size;
+		}
+	}
+
+	sort(files.begin(), files.end(), cache_file_info_older);
+
+	/* files in use don't count towards the limit, they can't be removed */
+	for(size_t i = 0; i < files.size() && total_size > max_size; i++) {
+		if(boost::filesystem::remove(files[i].path, ec)) {
+			total_size -= files[i].size;
+		}
+	}
+}
+
+CCL_NAMESPACE_END
@@ -28,10 +28,16 @@
  * invalidate cache entries, at the cost of extra computation. If everything
  * is stored in a global cache, computations can perhaps even be shared between
  * different scenes where it may be hard to detect duplicate work.
+ *
+ * Files are memory mapped on lookup, so large arrays can be used directly
+ * from the file without reading and copying them.
  */
 
+#include <stdio.h>
+
 #include "util_set.h"
 #include "util_string.h"
+#include "util_types.h"
 #include "util_vector.h"
 
 CCL_NAMESPACE_BEGIN
@@ -45,19 +51,52 @@ public:
 	{ data = data_; size = size_; }
 };
 
+/* Read-only memory mapping of a cache file. Pages are mapped copy-on-write,
+ * so data referenced from the map may be modified in memory without
+ * touching the file. */
+
+class CacheMap {
+public:
+	CacheMap();
+	~CacheMap();
+
+	bool open(const string& filename);
+	void close();
+
+	uint8_t *data;
+	size_t size;
+
+protected:
+#ifdef _WIN32
+	void *map_handle;
+#endif
+};
+
 class CacheData {
 public:
 	vector<CacheBuffer> buffers;
 	string name;
 	string filename;
 	bool have_filename;
-	FILE *f;
+
+	/* mapped file for reading values, and read position in it */
+	CacheMap *map;
+	size_t offset;
 
 	CacheData(const string& name = "");
 	~CacheData();
 
 	const string& get_filename();
 
+	/* take ownership of the mapped file, data referenced by arrays that were
+	 * read stays valid until the map is deleted */
+	CacheMap *release_map()
+	{
+		CacheMap *result = map;
+		map = NULL;
+		return result;
+	}
+
 	template<typename T> void add(const vector<T>& data)
 	{
 		CacheBuffer buffer(data.size()? &data[0]: NULL, data.size()*sizeof(T));
@@ -96,82 +135,71 @@ public:
 		buffers.push_back(buffer);
 	}
 
+	/* arrays reference the mapped file without copying */
 	template<typename T> bool read(array<T>& data)
 	{
+		void *ptr;
 		size_t size;
 
-		if(!fread(&size, sizeof(size), 1, f)) {
-			fprintf(stderr, "Failed to read vector size from cache.\n");
+		if(!read_buffer(&ptr, &size) || size % sizeof(T) != 0) {
+			fprintf(stderr, "Failed to read array from cache.\n");
 			return false;
 		}
 
-		if(!size)
-			return false;
-
-		data.resize(size/sizeof(T));
-
-		if(!fread(&data[0], size, 1, f)) {
-			fprintf(stderr, "Failed to read vector data from cache (%lu).\n", (unsigned long)size);
-			return false;
-		}
+		data.reference((T*)ptr, size/sizeof(T));
 		return true;
 	}
 
-	bool read(int& data)
+	template<typename T> bool read(T& data)
 	{
+		void *ptr;
 		size_t size;
 
-		if(!fread(&size, sizeof(size), 1, f)) {
-			fprintf(stderr, "Failed to read int size from cache.\n");
-			return false;
-		}
-		if(!fread(&data, sizeof(data), 1, f)) {
-			fprintf(stderr, "Failed to read int from cache.\n");
+		if(!read_buffer(&ptr, &size) || size != sizeof(T)) {
+			fprintf(stderr, "Failed to read value from cache.\n");
 			return false;
 		}
-		return true;
-	}
 
-	bool read(float& data)
-	{
-		size_t size;
-
-		if(!fread(&size, sizeof(size), 1, f)) {
-			fprintf(stderr, "Failed to read float size from cache.\n");
-			return false;
-		}
-		if(!fread(&data, sizeof(data), 1, f)) {
-			fprintf(stderr, "Failed to read float from cache.\n");
-			return false;
-		}
+		memcpy(&data, ptr, sizeof(T));
 		return true;
 	}
 
-	bool read(size_t& data)
-	{
-		size_t size;
-
-		if(!fread(&size, sizeof(size), 1, f)) {
-			fprintf(stderr, "Failed to read size_t size from cache.\n");
-			return false;
-		}
-		if(!fread(&data, sizeof(data), 1, f)) {
-			fprintf(stderr, "Failed to read size_t from cache.\n");
-			return false;
-		}
-		return true;
-	}
+protected:
+	bool read_buffer(void **data, size_t *size);
 };
 
+/* Cache file format:
+ *
+ * header: CACHE_FILE_MAGIC, then for each buffer its size as uint64_t,
+ * followed by the data. Header, sizes and data all start at multiples of
+ * CACHE_FILE_ALIGN bytes so that mapped buffers are aligned for SSE types. */
+
+#define CACHE_FILE_MAGIC "CYCACHE1"
+#define CACHE_FILE_ALIGN 16
+
 class Cache {
 public:
 	static Cache global;
 
+	Cache();
+
 	void insert(CacheData& key, CacheData& value);
 	bool lookup(CacheData& key, CacheData& value);
 
 	void clear_except(const string& name, const set<string>& except);
 
+	/* remove least recently used files starting with name, until the total
+	 * size of the remaining ones is below max_size. files in except are
+	 * kept, with max_size zero only those remain */
+	void evict(const string& name, const set<string>& except);
+
+	/* maximum size in bytes used by evict */
+	size_t max_size;
+
+	/* statistics */
+	size_t hits;
+	size_t misses;
+
 protected:
 	string data_filename(CacheData& key);
 };
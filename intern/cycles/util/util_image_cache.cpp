@@ -0,0 +1,705 @@
+/*
+ * Copyright 2011-2015 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "util_algorithm.h"
+#include "util_atomic.h"
+#include "util_color.h"
+#include "util_image.h"
+#include "util_image_cache.h"
+#include "util_logging.h"
+#include "util_math.h"
+#include "util_stats.h"
+
+CCL_NAMESPACE_BEGIN
+
+ImageCache::ImageCache(size_t memory_limit_, Stats *stats_)
+: images(MAX_IMAGES, NULL), memory_limit(memory_limit_), mem_used(0), time_stamp(0), stats(stats_)
+{
+}
+
+ImageCache::~ImageCache()
+{
+	for(size_t slot = 0; slot < images.size(); slot++)
+		if(images[slot])
+			remove_image(slot);
+}
+
+/* Images */
+
+int ImageCache::add_image(const string& filename, bool is_float, bool is_linear, bool use_alpha, int *width, int *height)
+{
+	ImageInput *in = ImageInput::create(filename);
+
+	if(!in)
+		return -1;
+
+	ImageSpec spec = ImageSpec();
+	ImageSpec config = ImageSpec();
+
+	if(use_alpha == false)
+		config.attribute("oiio:UnassociatedAlpha", 1);
+
+	if(!in->open(filename, spec, config)) {
+		delete in;
+		return -1;
+	}
+
+	/* 3D textures and images with unusual data windows are not tiled,
+	 * those are loaded fully by the image manager */
+	if(spec.depth > 1 || spec.nchannels < 1 || spec.width < 1 || spec.height < 1 ||
+	   spec.x != 0 || spec.y != 0)
+	{
+		in->close();
+		delete in;
+		return -1;
+	}
+
+	/* same as the image manager, byte images with more than 4 channels are
+	 * not supported, float images only use the first 4 */
+	if(spec.nchannels > 4 && !is_float) {
+		in->close();
+		delete in;
+		return -1;
+	}
+
+	Image *img = new Image();
+	img->filename = filename;
+	img->is_float = is_float;
+	img->is_linear = is_linear;
+	img->use_alpha = use_alpha;
+	img->file_components = spec.nchannels;
+	img->components = min(spec.nchannels, 4);
+	img->cmyk = strcmp(in->format_name(), "jpeg") == 0 && spec.nchannels == 4;
+	img->input = in;
+
+	/* MIP levels down to a single pixel, using the levels stored in the
+	 * file where available */
+	int w = spec.width, h = spec.height;
+
+	for(int level = 0; ; level++) {
+		Level lvl;
+		ImageSpec level_spec;
+
+		lvl.in_file = (level == 0) ||
+		              (in->seek_subimage(0, level, level_spec) &&
+		               level_spec.nchannels == spec.nchannels &&
+		               level_spec.width <= w && level_spec.height <= h);
+
+		if(level > 0 && lvl.in_file) {
+			w = level_spec.width;
+			h = level_spec.height;
+		}
+
+		lvl.width = w;
+		lvl.height = h;
+		lvl.tiles_x = (w + TILE_SIZE - 1) / TILE_SIZE;
+		lvl.tiles_y = (h + TILE_SIZE - 1) / TILE_SIZE;
+		img->levels.push_back(lvl);
+
+		if(w == 1 && h == 1)
+			break;
+
+		w = max(w / 2, 1);
+		h = max(h / 2, 1);
+	}
+
+	in->seek_subimage(0, 0, spec);
+
+	*width = img->levels[0].width;
+	*height = img->levels[0].height;
+
+	/* find free slot */
+	thread_scoped_lock images_lock(images_mutex);
+	size_t slot;
+
+	for(slot = 0; slot < images.size(); slot++)
+		if(!images[slot])
+			break;
+
+	if(slot == images.size()) {
+		in->close();
+		delete in;
+		delete img;
+		return -1;
+	}
+
+	images[slot] = img;
+
+	VLOG(1) << "Image cache: added " << filename << " with "
+	        << img->levels.size() << " MIP levels.";
+
+	return slot;
+}
+
+void ImageCache::remove_image(int slot)
+{
+	thread_scoped_lock images_lock(images_mutex);
+	Image *img = images[slot];
+
+	if(!img)
+		return;
+
+	/* free tiles of this image */
+	for(int i = 0; i < NUM_SHARDS; i++) {
+		Shard& shard = shards[i];
+		thread_scoped_lock shard_lock(shard.mutex);
+		unordered_map<uint64_t, Tile*>::iterator it = shard.tiles.begin();
+
+		while(it != shard.tiles.end()) {
+			if((int)(it->first >> 48) == slot) {
+				Tile *tile = it->second;
+				assert(tile->users == 0);
+
+				atomic_sub_z(&mem_used, tile->size);
+				if(stats)
+					stats->mem_free(tile->size);
+
+				free(tile->pixels);
+				delete tile;
+
+				shard.tiles.erase(it++);
+			}
+			else
+				it++;
+		}
+	}
+
+	if(img->input) {
+		ImageInput *in = (ImageInput*)img->input;
+		in->close();
+		delete in;
+	}
+
+	delete img;
+	images[slot] = NULL;
+}
+
+void ImageCache::clear_tiles()
+{
+	for(int i = 0; i < NUM_SHARDS; i++) {
+		Shard& shard = shards[i];
+		thread_scoped_lock shard_lock(shard.mutex);
+		unordered_map<uint64_t, Tile*>::iterator it;
+
+		for(it = shard.tiles.begin(); it != shard.tiles.end(); it++) {
+			Tile *tile = it->second;
+
+			atomic_sub_z(&mem_used, tile->size);
+			if(stats)
+				stats->mem_free(tile->size);
+
+			free(tile->pixels);
+			delete tile;
+		}
+
+		shard.tiles.clear();
+	}
+}
+
+void ImageCache::set_memory_limit(size_t memory_limit_)
+{
+	memory_limit = memory_limit_;
+	evict();
+}
+
+size_t ImageCache::num_hits()
+{
+	size_t hits = 0;
+
+	for(int i = 0; i < NUM_SHARDS; i++)
+		hits += shards[i].hits;
+
+	return hits;
+}
+
+size_t ImageCache::num_misses()
+{
+	size_t misses = 0;
+
+	for(int i = 0; i < NUM_SHARDS; i++)
+		misses += shards[i].misses;
+
+	return misses;
+}
+
+/* Tiles */
+
+uint64_t ImageCache::tile_key(int slot, int level, int tx, int ty)
+{
+	return ((uint64_t)slot << 48) | ((uint64_t)level << 40) | ((uint64_t)tx << 20) | (uint64_t)ty;
+}
+
+static int tile_shard(uint64_t key)
+{
+	/* fibonacci hashing, to spread neighbouring tiles over shards */
+	return (int)((key * 0x9E3779B97F4A7C15ULL) >> 58);
+}
+
+ImageCache::Tile *ImageCache::tile_alloc(const Image *img)
+{
+	Tile *tile = new Tile();
+
+	tile->size = TILE_SIZE*TILE_SIZE*((img->is_float)? sizeof(float4): sizeof(uchar4));
+	tile->pixels = malloc(tile->size);
+	tile->last_used = time_stamp;
+	tile->users = 0;
+
+	return tile;
+}
+
+ImageCache::Tile *ImageCache::tile_insert(uint64_t key, Tile *tile)
+{
+	Shard& shard = shards[tile_shard(key)];
+	thread_scoped_lock shard_lock(shard.mutex);
+	Tile *&entry = shard.tiles[key];
+
+	if(entry) {
+		/* another thread loaded the same tile in the meantime */
+		free(tile->pixels);
+		delete tile;
+	}
+	else {
+		entry = tile;
+
+		atomic_add_z(&mem_used, tile->size);
+		if(stats)
+			stats->mem_alloc(tile->size);
+	}
+
+	atomic_add_uint32(&entry->users, 1);
+	return entry;
+}
+
+ImageCache::Tile *ImageCache::tile_acquire(int slot, int level, int tx, int ty)
+{
+	uint64_t key = tile_key(slot, level, tx, ty);
+	Shard& shard = shards[tile_shard(key)];
+
+	{
+		thread_scoped_lock shard_lock(shard.mutex);
+		unordered_map<uint64_t, Tile*>::iterator it = shard.tiles.find(key);
+
+		if(it != shard.tiles.end()) {
+			Tile *tile = it->second;
+			atomic_add_uint32(&tile->users, 1);
+			tile->last_used = time_stamp;
+			shard.hits++;
+			return tile;
+		}
+
+		shard.misses++;
+	}
+
+	/* time only advances on misses, which is enough to order tiles for
+	 * eviction without touching shared memory on every lookup */
+	atomic_add_z(&time_stamp, 1);
+
+	Image *img = images[slot];
+	Tile *tile = NULL;
+
+	if(img->levels[level].in_file) {
+		tile = load_file_tiles(slot, level, tx, ty);
+	}
+
+	if(!tile) {
+		tile = tile_alloc(img);
+		generate_tile(slot, level, tx, ty, tile);
+		tile = tile_insert(key, tile);
+	}
+
+	if(mem_used > memory_limit)
+		evict();
+
+	return tile;
+}
+
+void ImageCache::tile_release(Tile *tile)
+{
+	atomic_sub_uint32(&tile->users, 1);
+}
+
+static void image_cache_convert_pixel(float *in, int components, bool cmyk, float one, float out[4])
+{
+	if(cmyk) {
+		out[0] = (in[0]*in[3])/one;
+		out[1] = (in[1]*in[3])/one;
+		out[2] = (in[2]*in[3])/one;
+		out[3] = one;
+	}
+	else if(components == 1) {
+		/* grayscale */
+		out[0] = out[1] = out[2] = in[0];
+		out[3] = one;
+	}
+	else if(components == 2) {
+		/* grayscale + alpha */
+		out[0] = out[1] = out[2] = in[0];
+		out[3] = in[1];
+	}
+	else if(components == 3) {
+		/* RGB */
+		out[0] = in[0];
+		out[1] = in[1];
+		out[2] = in[2];
+		out[3] = one;
+	}
+	else {
+		out[0] = in[0];
+		out[1] = in[1];
+		out[2] = in[2];
+		out[3] = in[3];
+	}
+}
+
+ImageCache::Tile *ImageCache::load_file_tiles(int slot, int level, int tx, int ty)
+{
+	Image *img = images[slot];
+	const Level& lvl = img->levels[level];
+	ImageInput *in = (ImageInput*)img->input;
+
+	/* decoding happens in bands of full scanlines, so all tiles in the band
+	 * are added to the cache, neighbouring lookups are likely to need them */
+	thread_scoped_lock image_lock(img->mutex);
+
+	/* another thread may have loaded the band while we were waiting */
+	uint64_t key = tile_key(slot, level, tx, ty);
+	{
+		Shard& shard = shards[tile_shard(key)];
+		thread_scoped_lock shard_lock(shard.mutex);
+		unordered_map<uint64_t, Tile*>::iterator it = shard.tiles.find(key);
+
+		if(it != shard.tiles.end()) {
+			atomic_add_uint32(&it->second->users, 1);
+			return it->second;
+		}
+	}
+
+	ImageSpec spec;
+
+	if(!in || !in->seek_subimage(0, level, spec))
+		return NULL;
+
+	/* images are stored flipped vertically, same as the image manager */
+	int y0 = ty*TILE_SIZE;
+	int y1 = min(y0 + TILE_SIZE, lvl.height);
+	int file_ybegin = lvl.height - y1;
+	int file_yend = lvl.height - y0;
+	int components = img->file_components;
+
+	vector<float> band(lvl.width*(y1 - y0)*components);
+
+	if(!in->read_scanlines(file_ybegin, file_yend, 0, TypeDesc::FLOAT, &band[0])) {
+		VLOG(1) << "Image cache: failed to read " << img->filename
+		        << ": " << in->geterror();
+		return NULL;
+	}
+
+	Tile *result = NULL;
+
+	for(int i = 0; i < lvl.tiles_x; i++) {
+		Tile *tile = tile_alloc(img);
+		int x0 = i*TILE_SIZE;
+		int x1 = min(x0 + TILE_SIZE, lvl.width);
+
+		for(int y = 0; y < TILE_SIZE; y++) {
+			/* pad partial tiles by repeating the last row and column */
+			int by = (y1 - 1 - min(y0 + y, y1 - 1));
+
+			for(int x = 0; x < TILE_SIZE; x++) {
+				int bx = min(x0 + x, x1 - 1);
+				float *in_pixel = &band[(by*lvl.width + bx)*components];
+				float pixel[4];
+
+				image_cache_convert_pixel(in_pixel, img->components, img->cmyk, 1.0f, pixel);
+
+				if(img->use_alpha == false)
+					pixel[3] = 1.0f;
+
+				if(img->is_float) {
+					float4 *pixels = (float4*)tile->pixels;
+					pixels[y*TILE_SIZE + x] = make_float4(pixel[0], pixel[1], pixel[2], pixel[3]);
+				}
+				else {
+					uchar4 *pixels = (uchar4*)tile->pixels;
+					pixels[y*TILE_SIZE + x] = make_uchar4(
+						(uchar)(clamp(pixel[0], 0.0f, 1.0f)*255.0f + 0.5f),
+						(uchar)(clamp(pixel[1], 0.0f, 1.0f)*255.0f + 0.5f),
+						(uchar)(clamp(pixel[2], 0.0f, 1.0f)*255.0f + 0.5f),
+						(uchar)(clamp(pixel[3], 0.0f, 1.0f)*255.0f + 0.5f));
+				}
+			}
+		}
+
+		tile = tile_insert(tile_key(slot, level, i, ty), tile);
+
+		if(i == tx)
+			result = tile;
+		else
+			tile_release(tile);
+	}
+
+	return result;
+}
+
+static float4 image_cache_decode(float4 c, bool is_linear)
+{
+	if(is_linear)
+		return c;
+
+	/* alpha is always linear */
+	return make_float4(color_srgb_to_scene_linear(c.x),
+	                   color_srgb_to_scene_linear(c.y),
+	                   color_srgb_to_scene_linear(c.z),
+	                   c.w);
+}
+
+static float4 image_cache_encode(float4 c, bool is_linear)
+{
+	if(is_linear)
+		return c;
+
+	return make_float4(color_scene_linear_to_srgb(c.x),
+	                   color_scene_linear_to_srgb(c.y),
+	                   color_scene_linear_to_srgb(c.z),
+	                   c.w);
+}
+
+void ImageCache::generate_tile(int slot, int level, int tx, int ty, Tile *tile)
+{
+	if(level == 0) {
+		/* reading from file failed, fill with pink like missing images */
+		for(int i = 0; i < TILE_SIZE*TILE_SIZE; i++) {
+			if(images[slot]->is_float)
+				((float4*)tile->pixels)[i] = make_float4(1.0f, 0.0f, 1.0f, 1.0f);
+			else
+				((uchar4*)tile->pixels)[i] = make_uchar4(255, 0, 255, 255);
+		}
+
+		return;
+	}
+
+	/* box filter the level above, reusing the source tile between pixels.
+	 * sRGB encoded pixels are averaged in linear space, so that lower levels
+	 * don't get darker around high contrast details */
+	const Image *img = images[slot];
+	const Level& src = img->levels[level - 1];
+	const Level& lvl = img->levels[level];
+	Tile *src_tile = NULL;
+	uint64_t src_key = 0;
+
+	for(int y = 0; y < TILE_SIZE; y++) {
+		int py = min(ty*TILE_SIZE + y, lvl.height - 1);
+		int sy0 = min(py*2, src.height - 1);
+		int sy1 = min(py*2 + 1, src.height - 1);
+
+		for(int x = 0; x < TILE_SIZE; x++) {
+			int px = min(tx*TILE_SIZE + x, lvl.width - 1);
+			int sx0 = min(px*2, src.width - 1);
+			int sx1 = min(px*2 + 1, src.width - 1);
+
+			float4 r = image_cache_decode(texel(slot, level - 1, sx0, sy0, &src_tile, &src_key), img->is_linear);
+			r += image_cache_decode(texel(slot, level - 1, sx1, sy0, &src_tile, &src_key), img->is_linear);
+			r += image_cache_decode(texel(slot, level - 1, sx0, sy1, &src_tile, &src_key), img->is_linear);
+			r += image_cache_decode(texel(slot, level - 1, sx1, sy1, &src_tile, &src_key), img->is_linear);
+			r = image_cache_encode(r * 0.25f, img->is_linear);
+
+			if(img->is_float) {
+				float4 *pixels = (float4*)tile->pixels;
+				pixels[y*TILE_SIZE + x] = r;
+			}
+			else {
+				uchar4 *pixels = (uchar4*)tile->pixels;
+				pixels[y*TILE_SIZE + x] = make_uchar4(
+					(uchar)(clamp(r.x, 0.0f, 1.0f)*255.0f + 0.5f),
+					(uchar)(clamp(r.y, 0.0f, 1.0f)*255.0f + 0.5f),
+					(uchar)(clamp(r.z, 0.0f, 1.0f)*255.0f + 0.5f),
+					(uchar)(clamp(r.w, 0.0f, 1.0f)*255.0f + 0.5f));
+			}
+		}
+	}
+
+	if(src_tile)
+		tile_release(src_tile);
+}
+
+void ImageCache::evict()
+{
+	/* only one thread evicts at a time, others continue rendering */
+	if(!evict_mutex.try_lock())
+		return;
+
+	/* free least recently used tiles until we are below 90% of the budget,
+	 * so that eviction doesn't run again on the next miss */
+	size_t target = memory_limit - memory_limit/10;
+
+	if(mem_used > target) {
+		vector<std::pair<size_t, uint64_t> > candidates;
+
+		for(int i = 0; i < NUM_SHARDS; i++) {
+			Shard& shard = shards[i];
+			thread_scoped_lock shard_lock(shard.mutex);
+			unordered_map<uint64_t, Tile*>::iterator it;
+
+			for(it = shard.tiles.begin(); it != shard.tiles.end(); it++)
+				if(it->second->users == 0)
+					candidates.push_back(std::make_pair(it->second->last_used, it->first));
+		}
+
+		sort(candidates.begin(), candidates.end());
+
+		for(size_t i = 0; i < candidates.size() && mem_used > target; i++) {
+			uint64_t key = candidates[i].second;
+			Shard& shard = shards[tile_shard(key)];
+			thread_scoped_lock shard_lock(shard.mutex);
+			unordered_map<uint64_t, Tile*>::iterator it = shard.tiles.find(key);
+
+			/* tile may have been picked up again after collecting */
+			if(it == shard.tiles.end() || it->second->users != 0)
+				continue;
+
+			Tile *tile = it->second;
+
+			atomic_sub_z(&mem_used, tile->size);
+			if(stats)
+				stats->mem_free(tile->size);
+
+			free(tile->pixels);
+			delete tile;
+
+			shard.tiles.erase(it);
+		}
+	}
+
+	evict_mutex.unlock();
+}
+
+/* Lookup */
+
+float4 ImageCache::texel(int slot, int level, int x, int y, Tile **tile, uint64_t *key)
+{
+	int tx = x / TILE_SIZE;
+	int ty = y / TILE_SIZE;
+	uint64_t new_key = tile_key(slot, level, tx, ty);
+
+	if(*tile == NULL || *key != new_key) {
+		if(*tile)
+			tile_release(*tile);
+
+		*tile = tile_acquire(slot, level, tx, ty);
+		*key = new_key;
+	}
+
+	int index = (y - ty*TILE_SIZE)*TILE_SIZE + (x - tx*TILE_SIZE);
+
+	if(images[slot]->is_float)
+		return ((float4*)(*tile)->pixels)[index];
+
+	uchar4 r = ((uchar4*)(*tile)->pixels)[index];
+	float f = 1.0f/255.0f;
+	return make_float4(r.x*f, r.y*f, r.z*f, r.w*f);
+}
+
+static int image_cache_wrap(int x, int width, bool periodic)
+{
+	if(periodic) {
+		x %= width;
+		if(x < 0)
+			x += width;
+		return x;
+	}
+
+	return clamp(x, 0, width-1);
+}
+
+static float image_cache_frac(float x, int *ix)
+{
+	int i = float_to_int(x) - ((x < 0.0f)? 1: 0);
+	*ix = i;
+	return x - (float)i;
+}
+
+float4 ImageCache::lookup_level(int slot, int level, float x, float y, int interpolation, bool periodic)
+{
+	const Level& lvl = images[slot]->levels[level];
+	Tile *tile = NULL;
+	uint64_t key = 0;
+	float4 r;
+	int ix, iy;
+
+	if(interpolation == INTERPOLATION_CLOSEST) {
+		image_cache_frac(x*(float)lvl.width, &ix);
+		image_cache_frac(y*(float)lvl.height, &iy);
+
+		ix = image_cache_wrap(ix, lvl.width, periodic);
+		iy = image_cache_wrap(iy, lvl.height, periodic);
+
+		r = texel(slot, level, ix, iy, &tile, &key);
+	}
+	else {
+		/* cubic and smart interpolation fall back to linear */
+		float tx = image_cache_frac(x*(float)lvl.width - 0.5f, &ix);
+		float ty = image_cache_frac(y*(float)lvl.height - 0.5f, &iy);
+
+		int nix = image_cache_wrap(ix+1, lvl.width, periodic);
+		int niy = image_cache_wrap(iy+1, lvl.height, periodic);
+		ix = image_cache_wrap(ix, lvl.width, periodic);
+		iy = image_cache_wrap(iy, lvl.height, periodic);
+
+		r = (1.0f - ty)*(1.0f - tx)*texel(slot, level, ix, iy, &tile, &key);
+		r += (1.0f - ty)*tx*texel(slot, level, nix, iy, &tile, &key);
+		r += ty*(1.0f - tx)*texel(slot, level, ix, niy, &tile, &key);
+		r += ty*tx*texel(slot, level, nix, niy, &tile, &key);
+	}
+
+	if(tile)
+		tile_release(tile);
+
+	return r;
+}
+
+float4 ImageCache::lookup(int slot, float x, float y, float filter_width, int interpolation, bool periodic)
+{
+	Image *img = images[slot];
+	int num_levels = (int)img->levels.size();
+
+	/* trilinear filtering between the two MIP levels closest to the filter
+	 * width, closest interpolation always uses the full resolution */
+	if(filter_width > 0.0f && num_levels > 1 && interpolation != INTERPOLATION_CLOSEST) {
+		const Level& lvl = img->levels[0];
+		float lod = log2f(filter_width * (float)max(lvl.width, lvl.height));
+
+		if(lod > 0.0f) {
+			lod = min(lod, (float)(num_levels - 1));
+
+			int level = (int)lod;
+			float t = lod - (float)level;
+			float4 r = lookup_level(slot, level, x, y, interpolation, periodic);
+
+			if(t > 0.0f && level + 1 < num_levels)
+				r = (1.0f - t)*r + t*lookup_level(slot, level + 1, x, y, interpolation, periodic);
+
+			return r;
+		}
+	}
+
+	return lookup_level(slot, 0, x, y, interpolation, periodic);
+}
+
+CCL_NAMESPACE_END
+
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2011-2015 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+#ifndef __UTIL_IMAGE_CACHE_H__
+#define __UTIL_IMAGE_CACHE_H__
+
+/* Out of Core Image Cache
+ *
+ * Image textures for the CPU device, loaded lazily in tiles on first lookup
+ * instead of fully decoding every image at scene sync. Tiles of all images
+ * share a memory budget, when it is exceeded the least recently used tiles
+ * are freed again. Lower resolution MIP levels are read from the file when
+ * it contains them, or otherwise generated on demand from the level above,
+ * and are selected by the texture space filter width of the lookup. */
+
+#include "util_map.h"
+#include "util_string.h"
+#include "util_thread.h"
+#include "util_types.h"
+#include "util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+class Stats;
+
+class ImageCache {
+public:
+	/* size of the square tiles in pixels */
+	enum { TILE_SIZE = 64 };
+	/* enough slots for all float and byte CPU images of the image manager */
+	enum { MAX_IMAGES = 2048 };
+
+	ImageCache(size_t memory_limit, Stats *stats = NULL);
+	~ImageCache();
+
+	/* add image from file, returns slot or -1 if the image can't be cached,
+	 * for example because it is a 3D texture. is_linear tells if the pixels
+	 * are stored linear or sRGB encoded, for filtering MIP levels */
+	int add_image(const string& filename, bool is_float, bool is_linear, bool use_alpha, int *width, int *height);
+	void remove_image(int slot);
+
+	/* lookup, coordinates and filter width are in 0..1 texture space */
+	float4 lookup(int slot, float x, float y, float filter_width, int interpolation, bool periodic);
+
+	/* free all tiles, images stay registered */
+	void clear_tiles();
+
+	void set_memory_limit(size_t memory_limit);
+
+	/* statistics */
+	size_t num_hits();
+	size_t num_misses();
+	size_t memory_used() { return mem_used; }
+
+protected:
+	struct Tile {
+		/* float4 or uchar4 pixels, TILE_SIZE*TILE_SIZE */
+		void *pixels;
+		size_t size;
+		/* lookup time stamp for least recently used eviction */
+		size_t last_used;
+		/* number of threads currently reading pixels */
+		uint32_t users;
+	};
+
+	struct Level {
+		int width, height;
+		int tiles_x, tiles_y;
+		/* level is stored in the file, otherwise generated */
+		bool in_file;
+	};
+
+	struct Image {
+		string filename;
+		bool is_float;
+		bool is_linear;
+		bool use_alpha;
+		bool cmyk;
+		/* channels in the file and channels used, at most 4 */
+		int file_components;
+		int components;
+		vector<Level> levels;
+
+		/* file is kept open for reading tiles, guarded by mutex */
+		void *input;
+		thread_mutex mutex;
+	};
+
+	/* tiles are spread over multiple hash maps to reduce lock contention */
+	enum { NUM_SHARDS = 64 };
+
+	struct Shard {
+		unordered_map<uint64_t, Tile*> tiles;
+		thread_mutex mutex;
+		size_t hits;
+		size_t misses;
+
+		Shard() : hits(0), misses(0) {}
+	};
+
+	static uint64_t tile_key(int slot, int level, int tx, int ty);
+
+	Tile *tile_acquire(int slot, int level, int tx, int ty);
+	void tile_release(Tile *tile);
+	Tile *tile_insert(uint64_t key, Tile *tile);
+	Tile *tile_alloc(const Image *img);
+
+	Tile *load_file_tiles(int slot, int level, int tx, int ty);
+	void generate_tile(int slot, int level, int tx, int ty, Tile *tile);
+
+	float4 texel(int slot, int level, int x, int y, Tile **tile, uint64_t *tile_key);
+	float4 lookup_level(int slot, int level, float x, float y, int interpolation, bool periodic);
+
+	void evict();
+
+	/* allocated once with MAX_IMAGES slots and never resized, so lookups can
+	 * read slots without locking, images_mutex only guards finding free slots */
+	vector<Image*> images;
+	thread_mutex images_mutex;
+
+	Shard shards[NUM_SHARDS];
+
+	size_t memory_limit;
+	size_t mem_used;
+	size_t time_stamp;
+	thread_mutex evict_mutex;
+
+	Stats *stats;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __UTIL_IMAGE_CACHE_H__ */
+
@@ -55,7 +55,9 @@ static inline void free_aligned(void *ptr)
  *   this was actually showing up in profiles quite significantly. it
  *   also does not run any constructors/destructors
  * - if this is used, we are not tempted to use inefficient operations
- * - aligned allocation for SSE data types */
+ * - aligned allocation for SSE data types
+ * - can reference external memory without copying, for example from a memory
+ *   mapped file, which is copied on the first resize */
 
 template<typename T, size_t alignment = 16>
 class array
@@ -65,10 +67,13 @@ public:
 	{
 		data = NULL;
 		datasize = 0;
+		owned = true;
 	}
 
 	array(size_t newsize)
 	{
+		owned = true;
+
 		if(newsize == 0) {
 			data = NULL;
 			datasize = 0;
@@ -86,6 +91,8 @@ public:
 
 	array& operator=(const array& from)
 	{
+		owned = true;
+
 		if(from.datasize == 0) {
 			data = NULL;
 			datasize = 0;
@@ -101,6 +108,7 @@ public:
 
 	array& operator=(const vector<T>& from)
 	{
+		owned = true;
 		datasize = from.size();
 		data = NULL;
 
@@ -114,7 +122,8 @@ public:
 
 	~array()
 	{
-		free_aligned(data);
+		if(owned)
+			free_aligned(data);
 	}
 
 	void resize(size_t newsize)
@@ -126,19 +135,36 @@ public:
 			T *newdata = (T*)malloc_aligned(sizeof(T)*newsize, alignment);
 			if(data) {
 				memcpy(newdata, data, ((datasize < newsize)? datasize: newsize)*sizeof(T));
-				free_aligned(data);
+				if(owned)
+					free_aligned(data);
 			}
 
 			data = newdata;
 			datasize = newsize;
+			owned = true;
 		}
 	}
 
 	void clear()
 	{
-		free_aligned(data);
+		if(owned)
+			free_aligned(data);
 		data = NULL;
 		datasize = 0;
+		owned = true;
+	}
+
+	/* use memory owned by someone else, it must stay valid for as long as
+	 * the array uses it and be aligned the same */
+	void reference(T *ptr, size_t newsize)
+	{
+		clear();
+
+		if(newsize) {
+			data = ptr;
+			datasize = newsize;
+			owned = false;
+		}
 	}
 
 	size_t size() const
@@ -154,6 +180,7 @@ public:
 protected:
 	T *data;
 	size_t datasize;
+	bool owned;
 };
 
 CCL_NAMESPACE_END
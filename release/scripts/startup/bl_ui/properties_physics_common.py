@@ -170,6 +170,11 @@ def point_cache_ui(self, context, cache, enabled, cachetype):
             row.label(text="Compression:")
             row.prop(cache, "compression", expand=True)
 
+            row = layout.row()
+            row.enabled = enabled and bpy.data.is_saved
+            row.active = cache.use_disk_cache
+            row.prop(cache, "use_disk_archive")
+
             layout.separator()
 
             if cache.id_data.library and not cache.use_disk_cache:
@@ -178,6 +183,11 @@ def point_cache_ui(self, context, cache, enabled, cachetype):
                 col = layout.column(align=True)
                 col.label(text="Linked object baking requires Disk Cache to be enabled", icon='INFO')
         else:
+            if cachetype in {'SMOKE', 'DYNAMIC_PAINT'}:
+                row = layout.row()
+                row.enabled = enabled and bpy.data.is_saved
+                row.prop(cache, "use_disk_archive")
+
             layout.separator()
 
         split = layout.split()
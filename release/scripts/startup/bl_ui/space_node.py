@@ -421,6 +421,13 @@ class NODE_PT_quality(bpy.types.Panel):
         col.prop(tree, "use_viewer_border")
         col.prop(snode, "show_highlight")
 
+        col = layout.column()
+        col.prop(tree, "use_buffer_cache")
+        sub = col.column()
+        sub.active = tree.use_buffer_cache
+        sub.prop(tree, "buffer_cache_size")
+        sub.prop(tree, "use_buffer_cache_disk")
+
 
 class NODE_UL_interface_sockets(bpy.types.UIList):
     def draw_item(self, context, layout, data, item, icon, active_data, active_propname, index):
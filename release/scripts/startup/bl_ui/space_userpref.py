@@ -274,6 +274,7 @@ class USERPREF_PT_edit(Panel):
         col.prop(edit, "use_global_undo")
         col.prop(edit, "undo_steps", text="Steps")
         col.prop(edit, "undo_memory_limit", text="Memory Limit")
+        col.prop(edit, "use_global_undo_compress")
 
         row.separator()
         row.separator()
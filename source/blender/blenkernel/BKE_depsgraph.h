@@ -44,6 +44,7 @@
 extern "C" {
 #endif
 
+struct GSet;
 struct ID;
 struct Main;
 struct Object;
@@ -57,6 +58,7 @@ struct ListBase;
  */
 typedef struct EvaluationContext {
 	int mode;               /* evaluation mode */
+	struct GSet *objects;   /* when set, only these objects of the scene are updated (used by baking) */
 } EvaluationContext;
 
 typedef enum eEvaluationMode {
@@ -155,6 +157,9 @@ void DAG_threaded_update_handle_node_updated(void *node_v,
                                              void (*func)(void *node, void *user_data),
                                              void *user_data);
 
+/* Add all objects the objects in the set depend on to the set. */
+void DAG_scene_objects_add_ancestors(struct Scene *scene, struct GSet *objects);
+
 /* Debugging: print dependency graph for scene or armature object to console */
 
 void DAG_print_dependencies(struct Main *bmain, struct Scene *scene, struct Object *ob);
@@ -109,6 +109,11 @@ typedef struct PTCacheData {
 typedef struct PTCacheFile {
 	FILE *fp;
 
+	/* frames of stream caches in an archive are read from and written to memory, fp is NULL then */
+	struct PTCacheArchive *archive;
+	unsigned char *mem;
+	size_t mem_len, mem_pos;
+
 	int frame, old_format;
 	unsigned int totpoint, type;
 	unsigned int data_types, flag;
@@ -316,6 +321,8 @@ void BKE_ptcache_bake(struct PTCacheBaker *baker);
 
 /* Convert disk cache to memory cache. */
 void BKE_ptcache_disk_to_mem(struct PTCacheID *pid);
+/* Only reads the given BPHYS_DATA_ types when the cache is an archive, extra data is only read with all types. */
+void BKE_ptcache_disk_to_mem_ex(struct PTCacheID *pid, unsigned int data_types);
 
 /* Convert memory cache to disk cache. */
 void BKE_ptcache_mem_to_disk(struct PTCacheID *pid);
@@ -323,6 +330,9 @@ void BKE_ptcache_mem_to_disk(struct PTCacheID *pid);
 /* Convert disk cache to memory cache and vice versa. Clears the cache that was converted. */
 void BKE_ptcache_toggle_disk_cache(struct PTCacheID *pid);
 
+/* Called after PTCACHE_DISK_ARCHIVE was toggled, clears the disk cache written in the previous format. */
+void BKE_ptcache_toggle_disk_archive(struct PTCacheID *pid);
+
 /* Rename all disk cache files with a new name. Doesn't touch the actual content of the files. */
 void BKE_ptcache_disk_cache_rename(struct PTCacheID *pid, const char *name_src, const char *name_dst);
 
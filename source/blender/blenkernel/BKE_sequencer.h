@@ -174,10 +174,27 @@ struct SeqEffectHandle {
  * ********************************************************************** */
 
 struct ImBuf *BKE_sequencer_give_ibuf(const SeqRenderData *context, float cfra, int chanshown);
-struct ImBuf *BKE_sequencer_give_ibuf_threaded(const SeqRenderData *context, float cfra, int chanshown);
+struct ImBuf *BKE_sequencer_give_ibuf_threaded(const SeqRenderData *context, float cfra, int chanshown, int num_frames);
 struct ImBuf *BKE_sequencer_give_ibuf_direct(const SeqRenderData *context, float cfra, struct Sequence *seq);
 struct ImBuf *BKE_sequencer_give_ibuf_seqbase(const SeqRenderData *context, float cfra, int chan_shown, struct ListBase *seqbasep);
-void BKE_sequencer_give_ibuf_prefetch_request(const SeqRenderData *context, float cfra, int chan_shown);
+
+/* **********************************************************************
+ * sequencer.c
+ *
+ * prefetching frames during playback
+ * ********************************************************************** */
+
+typedef struct SeqPrefetchStats {
+	int requested;         /* frames asked for with BKE_sequencer_give_ibuf_threaded */
+	int hits;              /* requested frames that were in the cache */
+	int prefetched;        /* frames rendered by the prefetch job */
+	double miss_time;      /* seconds spent waiting for frames that were not in the cache */
+	double prefetch_time;  /* seconds spent by the prefetch job rendering */
+} SeqPrefetchStats;
+
+void BKE_sequencer_prefetch_stop(void);
+void BKE_sequencer_prefetch_stats_get(SeqPrefetchStats *r_stats);
+void BKE_sequencer_prefetch_stats_reset(void);
 
 /* **********************************************************************
  * sequencer.c
@@ -43,6 +43,7 @@
 #include "BLI_alloca.h"
 #include "BLI_dynstr.h"
 #include "BLI_listbase.h"
+#include "BLI_threads.h"
 
 #include "BLF_translation.h"
 
@@ -71,6 +72,8 @@
 
 #include "RNA_access.h"
 
+#include "atomic_ops.h"
+
 #include "nla_private.h"
 
 /* ***************************************** */
@@ -215,6 +218,8 @@ bool BKE_animdata_set_action(ReportList *reports, ID *id, bAction *act)
 
 /* Freeing -------------------------------------------- */
 
+static void animsys_eval_plan_free(AnimData *adt);
+
 /* Free AnimData used by the nominated ID-block, and clear ID-block's AnimData pointer */
 void BKE_free_animdata(ID *id)
 {
@@ -243,6 +248,9 @@ void BKE_free_animdata(ID *id)
 			/* free overrides */
 			/* TODO... */
 			
+			/* free runtime evaluation data */
+			animsys_eval_plan_free(adt);
+			
 			/* free animdata now */
 			MEM_freeN(adt);
 			iat->adt = NULL;
@@ -281,6 +289,9 @@ AnimData *BKE_copy_animdata(AnimData *adt, const bool do_action)
 	/* don't copy overrides */
 	BLI_listbase_clear(&dadt->overrides);
 	
+	/* bindings are resolved again for the new owner */
+	dadt->eval_plan = NULL;
+	
 	/* return */
 	return dadt;
 }
@@ -804,6 +815,9 @@ void BKE_action_fix_paths_rename(ID *owner_id, bAction *act, const char *prefix,
 	if (ELEM(NULL, owner_id, act))
 		return;
 	
+	/* paths get reallocated, so bindings resolved from them can't be trusted anymore */
+	BKE_animsys_eval_plans_invalidate();
+	
 	/* Name sanitation logic - copied from BKE_animdata_fix_paths_rename() */
 	if ((oldName != NULL) && (newName != NULL)) {
 		/* pad the names with [" "] so that only exact matches are made */
@@ -844,6 +858,9 @@ void BKE_animdata_fix_paths_rename(ID *owner_id, AnimData *adt, ID *ref_id, cons
 	if (ELEM(NULL, owner_id, adt))
 		return;
 	
+	/* paths get reallocated, so bindings resolved from them can't be trusted anymore */
+	BKE_animsys_eval_plans_invalidate();
+	
 	/* Name sanitation logic - shared with BKE_action_fix_paths_rename() */
 	if ((oldName != NULL) && (newName != NULL)) {
 		/* pad the names with [" "] so that only exact matches are made */
@@ -1360,132 +1377,147 @@ static bool animsys_remap_path(AnimMapper *UNUSED(remap), char *path, char **dst
 /* less than 1.0 evaluates to false, use epsilon to avoid float error */
 #define ANIMSYS_FLOAT_AS_BOOL(value) ((value) > ((1.0f - FLT_EPSILON)))
 
-/* Write the given value to a setting using RNA, and return success */
-static bool animsys_write_rna_setting(PointerRNA *ptr, char *path, int array_index, float value)
+/* Write the given value to an already resolved RNA property, and return success */
+static bool animsys_write_rna_property(PointerRNA *ptr, PointerRNA *prop_ptr, PropertyRNA *prop,
+                                       const char *path, int array_index, float value)
 {
-	PropertyRNA *prop;
-	PointerRNA new_ptr;
-	
-	//printf("%p %s %i %f\n", ptr, path, array_index, value);
+	PointerRNA new_ptr = *prop_ptr;
 	
-	/* get property to write to */
-	if (RNA_path_resolve_property(ptr, path, &new_ptr, &prop)) {
-		/* set value - only for animatable numerical values */
-		if (RNA_property_animateable(&new_ptr, prop)) {
-			int array_len = RNA_property_array_length(&new_ptr, prop);
-			bool written = false;
-			
-			if (array_len && array_index >= array_len) {
-				if (G.debug & G_DEBUG) {
-					printf("Animato: Invalid array index. ID = '%s',  '%s[%d]', array length is %d\n",
-					       (ptr && ptr->id.data) ? (((ID *)ptr->id.data)->name + 2) : "<No ID>",
-					       path, array_index, array_len - 1);
-				}
-				
-				return false;
+	/* set value - only for animatable numerical values */
+	if (RNA_property_animateable(&new_ptr, prop)) {
+		int array_len = RNA_property_array_length(&new_ptr, prop);
+		bool written = false;
+		
+		if (array_len && array_index >= array_len) {
+			if (G.debug & G_DEBUG) {
+				printf("Animato: Invalid array index. ID = '%s',  '%s[%d]', array length is %d\n",
+				       (ptr && ptr->id.data) ? (((ID *)ptr->id.data)->name + 2) : "<No ID>",
+				       path, array_index, array_len - 1);
 			}
 			
-			switch (RNA_property_type(prop)) {
-				case PROP_BOOLEAN:
-					if (array_len) {
-						if (RNA_property_boolean_get_index(&new_ptr, prop, array_index) != ANIMSYS_FLOAT_AS_BOOL(value)) {
-							RNA_property_boolean_set_index(&new_ptr, prop, array_index, ANIMSYS_FLOAT_AS_BOOL(value));
-							written = true;
-						}
-					}
-					else {
-						if (RNA_property_boolean_get(&new_ptr, prop) != ANIMSYS_FLOAT_AS_BOOL(value)) {
-							RNA_property_boolean_set(&new_ptr, prop, ANIMSYS_FLOAT_AS_BOOL(value));
-							written = true;
-						}
+			return false;
+		}
+		
+		switch (RNA_property_type(prop)) {
+			case PROP_BOOLEAN:
+				if (array_len) {
+					if (RNA_property_boolean_get_index(&new_ptr, prop, array_index) != ANIMSYS_FLOAT_AS_BOOL(value)) {
+						RNA_property_boolean_set_index(&new_ptr, prop, array_index, ANIMSYS_FLOAT_AS_BOOL(value));
+						written = true;
 					}
-					break;
-				case PROP_INT:
-					if (array_len) {
-						if (RNA_property_int_get_index(&new_ptr, prop, array_index) != (int)value) {
-							RNA_property_int_set_index(&new_ptr, prop, array_index, (int)value);
-							written = true;
-						}
+				}
+				else {
+					if (RNA_property_boolean_get(&new_ptr, prop) != ANIMSYS_FLOAT_AS_BOOL(value)) {
+						RNA_property_boolean_set(&new_ptr, prop, ANIMSYS_FLOAT_AS_BOOL(value));
+						written = true;
 					}
-					else {
-						if (RNA_property_int_get(&new_ptr, prop) != (int)value) {
-							RNA_property_int_set(&new_ptr, prop, (int)value);
-							written = true;
-						}
+				}
+				break;
+			case PROP_INT:
+				if (array_len) {
+					if (RNA_property_int_get_index(&new_ptr, prop, array_index) != (int)value) {
+						RNA_property_int_set_index(&new_ptr, prop, array_index, (int)value);
+						written = true;
 					}
-					break;
-				case PROP_FLOAT:
-					if (array_len) {
-						if (RNA_property_float_get_index(&new_ptr, prop, array_index) != value) {
-							RNA_property_float_set_index(&new_ptr, prop, array_index, value);
-							written = true;
-						}
+				}
+				else {
+					if (RNA_property_int_get(&new_ptr, prop) != (int)value) {
+						RNA_property_int_set(&new_ptr, prop, (int)value);
+						written = true;
 					}
-					else {
-						if (RNA_property_float_get(&new_ptr, prop) != value) {
-							RNA_property_float_set(&new_ptr, prop, value);
-							written = true;
-						}
+				}
+				break;
+			case PROP_FLOAT:
+				if (array_len) {
+					if (RNA_property_float_get_index(&new_ptr, prop, array_index) != value) {
+						RNA_property_float_set_index(&new_ptr, prop, array_index, value);
+						written = true;
 					}
-					break;
-				case PROP_ENUM:
-					if (RNA_property_enum_get(&new_ptr, prop) != (int)value) {
-						RNA_property_enum_set(&new_ptr, prop, (int)value);
+				}
+				else {
+					if (RNA_property_float_get(&new_ptr, prop) != value) {
+						RNA_property_float_set(&new_ptr, prop, value);
 						written = true;
 					}
-					break;
-				default:
-					/* nothing can be done here... so it is unsuccessful? */
-					return false;
-			}
-			
-			/* RNA property update disabled for now - [#28525] [#28690] [#28774] [#28777] */
-#if 0
-			/* buffer property update for later flushing */
-			if (written && RNA_property_update_check(prop)) {
-				short skip_updates_hack = 0;
-				
-				/* optimization hacks: skip property updates for those properties
-				 * for we know that which the updates in RNA were really just for
-				 * flushing property editing via UI/Py
-				 */
-				if (new_ptr.type == &RNA_PoseBone) {
-					/* bone transforms - update pose (i.e. tag depsgraph) */
-					skip_updates_hack = 1;
 				}
-				
-				if (skip_updates_hack == 0)
-					RNA_property_update_cache_add(&new_ptr, prop);
+				break;
+			case PROP_ENUM:
+				if (RNA_property_enum_get(&new_ptr, prop) != (int)value) {
+					RNA_property_enum_set(&new_ptr, prop, (int)value);
+					written = true;
+				}
+				break;
+			default:
+				/* nothing can be done here... so it is unsuccessful? */
+				return false;
+		}
+		
+		/* RNA property update disabled for now - [#28525] [#28690] [#28774] [#28777] */
+#if 0
+		/* buffer property update for later flushing */
+		if (written && RNA_property_update_check(prop)) {
+			short skip_updates_hack = 0;
+			
+			/* optimization hacks: skip property updates for those properties
+			 * for we know that which the updates in RNA were really just for
+			 * flushing property editing via UI/Py
+			 */
+			if (new_ptr.type == &RNA_PoseBone) {
+				/* bone transforms - update pose (i.e. tag depsgraph) */
+				skip_updates_hack = 1;
 			}
+			
+			if (skip_updates_hack == 0)
+				RNA_property_update_cache_add(&new_ptr, prop);
+		}
 #endif
 
-			/* as long as we don't do property update, we still tag datablock
-			 * as having been updated. this flag does not cause any updates to
-			 * be run, it's for e.g. render engines to synchronize data */
-			if (written && new_ptr.id.data) {
-				ID *id = new_ptr.id.data;
-
-				/* for cases like duplifarmes it's only a temporary so don't
-				 * notify anyone of updates */
-				if (!(id->flag & LIB_ANIM_NO_RECALC)) {
-					id->flag |= LIB_ID_RECALC;
-					DAG_id_type_tag(G.main, GS(id->name));
-				}
+		/* as long as we don't do property update, we still tag datablock
+		 * as having been updated. this flag does not cause any updates to
+		 * be run, it's for e.g. render engines to synchronize data */
+		if (written && new_ptr.id.data) {
+			ID *id = new_ptr.id.data;
+
+			/* for cases like duplifarmes it's only a temporary so don't
+			 * notify anyone of updates */
+			if (!(id->flag & LIB_ANIM_NO_RECALC)) {
+				id->flag |= LIB_ID_RECALC;
+				DAG_id_type_tag(G.main, GS(id->name));
 			}
 		}
-		
-		/* successful */
-		return true;
+	}
+	
+	/* successful */
+	return true;
+}
+
+/* Report a path which could not be resolved, only in debug mode */
+static void animsys_report_invalid_path(PointerRNA *ptr, const char *path, int array_index)
+{
+	/* XXX don't tag as failed yet though, as there are some legit situations (Action Constraint)
+	 * where some channels will not exist, but shouldn't lock up Action */
+	if (G.debug & G_DEBUG) {
+		printf("Animato: Invalid path. ID = '%s',  '%s[%d]'\n",
+		       (ptr->id.data) ? (((ID *)ptr->id.data)->name + 2) : "<No ID>",
+		       path, array_index);
+	}
+}
+
+/* Write the given value to a setting using RNA, and return success */
+static bool animsys_write_rna_setting(PointerRNA *ptr, char *path, int array_index, float value)
+{
+	PropertyRNA *prop;
+	PointerRNA new_ptr;
+	
+	//printf("%p %s %i %f\n", ptr, path, array_index, value);
+	
+	/* get property to write to */
+	if (RNA_path_resolve_property(ptr, path, &new_ptr, &prop)) {
+		return animsys_write_rna_property(ptr, &new_ptr, prop, path, array_index, value);
 	}
 	else {
 		/* failed to get path */
-		/* XXX don't tag as failed yet though, as there are some legit situations (Action Constraint)
-		 * where some channels will not exist, but shouldn't lock up Action */
-		if (G.debug & G_DEBUG) {
-			printf("Animato: Invalid path. ID = '%s',  '%s[%d]'\n",
-			       (ptr->id.data) ? (((ID *)ptr->id.data)->name + 2) : "<No ID>",
-			       path, array_index);
-		}
+		animsys_report_invalid_path(ptr, path, array_index);
 		return false;
 	}
 }
@@ -1532,18 +1564,202 @@ static void animsys_evaluate_fcurves(PointerRNA *ptr, ListBase *list, AnimMapper
 	}
 }
 
+/* ***************************************** */
+/* Evaluation Plans */
+
+/* Resolving an RNA path means parsing the string and looking up every struct and
+ * collection item along the way, which for rigs with thousands of channels costs
+ * far more than the F-Curve math itself. Each AnimData therefore keeps a plan with
+ * the PointerRNA/PropertyRNA binding of every channel of its active action and its
+ * drivers, resolved the first time they are evaluated.
+ *
+ * A channel binding is only valid as long as its F-Curve and the path string it was
+ * resolved from are unchanged, this is checked for every evaluation. Changes to the
+ * data the bindings point to (freeing datablocks, removing bones, modifiers,
+ * constraints, ...) are not visible from here, so all plans are invalidated at once
+ * through BKE_animsys_eval_plans_invalidate(). It is called from the functions
+ * that free what paths can resolve into (datablocks, pose channels, nodes and
+ * sockets, sequence strips, modifiers, constraints, NLA strips, key blocks, mesh
+ * layers), so removing data from scripts without an undo push is safe too, as well
+ * as when paths are changed, relations change or an undo step is pushed.
+ *
+ * The same datablock can be evaluated from several threads at once, so the channel
+ * arrays are reference counted: an evaluation keeps using the array it got even when
+ * another thread resolves the plan again in the meantime.
+ */
+
+typedef struct AnimEvalChannel {
+	FCurve *fcu;
+	const char *rna_path;   /* path string the binding was resolved from */
+	PointerRNA ptr;
+	PropertyRNA *prop;      /* NULL when the path could not be resolved */
+} AnimEvalChannel;
+
+typedef struct AnimEvalChannels {
+	unsigned int users;         /* the plan and every evaluation using the array */
+	int totchannel;
+	AnimEvalChannel *channels;
+} AnimEvalChannels;
+
+typedef struct AnimEvalPlan {
+	ID *id;                     /* ID-block the bindings were resolved for */
+	unsigned int generation;    /* value of animsys_eval_plan_generation when resolved */
+	
+	AnimEvalChannels *channels; /* channels of the active action */
+	AnimEvalChannels *drivers;  /* channels of the drivers */
+} AnimEvalPlan;
+
+/* incremented to invalidate the bindings of all plans */
+static unsigned int animsys_eval_plan_generation = 0;
+
+/* datablocks shared by several objects can be evaluated from multiple threads at once */
+static ThreadMutex animsys_eval_plan_lock = BLI_MUTEX_INITIALIZER;
+
+void BKE_animsys_eval_plans_invalidate(void)
+{
+	atomic_add_uint32(&animsys_eval_plan_generation, 1);
+}
+
+/* Drop a user of the channel array, freeing it when it was the last one */
+static void animsys_eval_channels_release(AnimEvalChannels *chans)
+{
+	if (chans && atomic_sub_uint32(&chans->users, 1) == 0) {
+		if (chans->channels)
+			MEM_freeN(chans->channels);
+		MEM_freeN(chans);
+	}
+}
+
+static void animsys_eval_plan_clear(AnimEvalPlan *plan)
+{
+	animsys_eval_channels_release(plan->channels);
+	animsys_eval_channels_release(plan->drivers);
+	plan->channels = NULL;
+	plan->drivers = NULL;
+}
+
+static void animsys_eval_plan_free(AnimData *adt)
+{
+	if (adt->eval_plan) {
+		animsys_eval_plan_clear(adt->eval_plan);
+		MEM_freeN(adt->eval_plan);
+		adt->eval_plan = NULL;
+	}
+}
+
+/* Get the plan of the given AnimData, dropping all bindings if they may be stale */
+static AnimEvalPlan *animsys_eval_plan_ensure(ID *id, AnimData *adt)
+{
+	AnimEvalPlan *plan = adt->eval_plan;
+	unsigned int generation = animsys_eval_plan_generation;
+	
+	if (plan == NULL) {
+		plan = adt->eval_plan = MEM_callocN(sizeof(AnimEvalPlan), "AnimEvalPlan");
+	}
+	else if ((plan->id == id) && (plan->generation == generation)) {
+		return plan;
+	}
+	else {
+		animsys_eval_plan_clear(plan);
+	}
+	
+	plan->id = id;
+	plan->generation = generation;
+	
+	return plan;
+}
+
+/* Make sure the bindings of the plan's array match the F-Curves of the given list, resolving
+ * them again if not. Returns the array with a user added for the caller, which releases it
+ * with animsys_eval_channels_release() once done. Called with animsys_eval_plan_lock held.
+ */
+static AnimEvalChannels *animsys_eval_channels_ensure(PointerRNA *ptr, ListBase *list, AnimEvalChannels **r_chans)
+{
+	AnimEvalChannels *chans = *r_chans;
+	AnimEvalChannel *channels;
+	FCurve *fcu;
+	int i = 0;
+	
+	if (chans) {
+		for (fcu = list->first; fcu; fcu = fcu->next, i++) {
+			if ((i >= chans->totchannel) || (chans->channels[i].fcu != fcu) ||
+			    (chans->channels[i].rna_path != fcu->rna_path))
+			{
+				break;
+			}
+		}
+		
+		if ((fcu == NULL) && (i == chans->totchannel)) {
+			atomic_add_uint32(&chans->users, 1);
+			return chans;
+		}
+		
+		/* list changed, evaluations still using the old array keep it alive */
+		animsys_eval_channels_release(chans);
+	}
+	
+	/* resolve all paths again */
+	chans = *r_chans = MEM_callocN(sizeof(AnimEvalChannels), "AnimEvalChannels");
+	chans->users = 2;
+	chans->totchannel = BLI_listbase_count(list);
+	
+	if (chans->totchannel == 0)
+		return chans;
+	
+	channels = chans->channels = MEM_mallocN(sizeof(AnimEvalChannel) * chans->totchannel, "AnimEvalChannel");
+	
+	for (fcu = list->first, i = 0; fcu; fcu = fcu->next, i++) {
+		AnimEvalChannel *ch = &channels[i];
+		
+		ch->fcu = fcu;
+		ch->rna_path = fcu->rna_path;
+		
+		if ((fcu->rna_path == NULL) || !RNA_path_resolve_property(ptr, fcu->rna_path, &ch->ptr, &ch->prop)) {
+			ch->prop = NULL;
+		}
+	}
+	
+	return chans;
+}
+
+/* Write the value of the channel's F-Curve to its bound property */
+static bool animsys_execute_channel(PointerRNA *ptr, AnimEvalChannel *ch)
+{
+	FCurve *fcu = ch->fcu;
+	
+	if (fcu->rna_path == NULL)
+		return false;
+	
+	/* paths that didn't resolve are tried again every time, the data they point to
+	 * may have been added since, which doesn't invalidate the plans */
+	if (ch->prop == NULL)
+		return animsys_write_rna_setting(ptr, fcu->rna_path, fcu->array_index, fcu->curval);
+	
+	return animsys_write_rna_property(ptr, &ch->ptr, ch->prop, fcu->rna_path, fcu->array_index, fcu->curval);
+}
+
 /* ***************************************** */
 /* Driver Evaluation */
 
 /* Evaluate Drivers */
 static void animsys_evaluate_drivers(PointerRNA *ptr, AnimData *adt, float ctime)
 {
-	FCurve *fcu;
+	AnimEvalPlan *plan;
+	AnimEvalChannels *drivers;
+	int i;
+	
+	BLI_mutex_lock(&animsys_eval_plan_lock);
+	plan = animsys_eval_plan_ensure(ptr->id.data, adt);
+	drivers = animsys_eval_channels_ensure(ptr, &adt->drivers, &plan->drivers);
+	BLI_mutex_unlock(&animsys_eval_plan_lock);
 	
 	/* drivers are stored as F-Curves, but we cannot use the standard code, as we need to check if
 	 * the depsgraph requested that this driver be evaluated...
+	 * NOTE: drivers may read values written by the ones before them, so unlike actions,
+	 *       each one is calculated and written before moving on to the next
 	 */
-	for (fcu = adt->drivers.first; fcu; fcu = fcu->next) {
+	for (i = 0; i < drivers->totchannel; i++) {
+		FCurve *fcu = drivers->channels[i].fcu;
 		ChannelDriver *driver = fcu->driver;
 		bool ok = false;
 		
@@ -1556,7 +1772,7 @@ static void animsys_evaluate_drivers(PointerRNA *ptr, AnimData *adt, float ctime
 				 * NOTE: for 'layering' option later on, we should check if we should remove old value before adding
 				 *       new to only be done when drivers only changed */
 				calculate_fcurve(fcu, ctime);
-				ok = animsys_execute_fcurve(ptr, NULL, fcu);
+				ok = animsys_execute_channel(ptr, &drivers->channels[i]);
 				
 				/* clear recalc flag */
 				driver->flag &= ~DRIVER_FLAG_RECALC;
@@ -1567,6 +1783,8 @@ static void animsys_evaluate_drivers(PointerRNA *ptr, AnimData *adt, float ctime
 			}
 		}
 	}
+	
+	animsys_eval_channels_release(drivers);
 }
 
 /* ***************************************** */
@@ -1643,6 +1861,51 @@ void animsys_evaluate_action(PointerRNA *ptr, bAction *act, AnimMapper *remap, f
 	animsys_evaluate_fcurves(ptr, &act->curves, remap, ctime);
 }
 
+/* Check if the F-Curve of an action channel should be evaluated */
+BLI_INLINE bool animsys_fcurve_is_evaluated(FCurve *fcu)
+{
+	/* check if this F-Curve doesn't belong to a muted group and shouldn't be skipped */
+	return (((fcu->grp == NULL) || (fcu->grp->flag & AGRP_MUTED) == 0) &&
+	        ((fcu->flag & (FCURVE_MUTED | FCURVE_DISABLED)) == 0));
+}
+
+/* Evaluate the active action of the AnimData through its plan
+ * The F-Curves are calculated for the whole batch of channels first, and only then are their
+ * values flushed to the bound properties, so the curve math runs in one tight loop.
+ */
+static void animsys_evaluate_action_plan(PointerRNA *ptr, AnimData *adt, float ctime)
+{
+	bAction *act = adt->action;
+	AnimEvalPlan *plan;
+	AnimEvalChannels *channels;
+	int i;
+	
+	action_idcode_patch_check(ptr->id.data, act);
+	
+	BLI_mutex_lock(&animsys_eval_plan_lock);
+	plan = animsys_eval_plan_ensure(ptr->id.data, adt);
+	channels = animsys_eval_channels_ensure(ptr, &act->curves, &plan->channels);
+	BLI_mutex_unlock(&animsys_eval_plan_lock);
+	
+	/* calculate all curves */
+	for (i = 0; i < channels->totchannel; i++) {
+		FCurve *fcu = channels->channels[i].fcu;
+		
+		if (animsys_fcurve_is_evaluated(fcu))
+			calculate_fcurve(fcu, ctime);
+	}
+	
+	/* then write their values */
+	for (i = 0; i < channels->totchannel; i++) {
+		AnimEvalChannel *ch = &channels->channels[i];
+		
+		if (animsys_fcurve_is_evaluated(ch->fcu))
+			animsys_execute_channel(ptr, ch);
+	}
+	
+	animsys_eval_channels_release(channels);
+}
+
 /* ***************************************** */
 /* NLA System - Evaluation */
 
@@ -2543,8 +2806,13 @@ void BKE_animsys_evaluate_animdata(Scene *scene, ID *id, AnimData *adt, float ct
 			animsys_calculate_nla(&id_ptr, adt, ctime);
 		}
 		/* evaluate Active Action only */
-		else if (adt->action)
-			animsys_evaluate_action(&id_ptr, adt->action, adt->remap, ctime);
+		else if (adt->action) {
+			/* remapped paths are not resolved by the plan */
+			if (adt->remap && (adt->remap->target == adt->action))
+				animsys_evaluate_action(&id_ptr, adt->action, adt->remap, ctime);
+			else
+				animsys_evaluate_action_plan(&id_ptr, adt, ctime);
+		}
 		
 		/* reset tag */
 		adt->recalc &= ~ADT_RECALC_ANIM;
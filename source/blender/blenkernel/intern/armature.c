@@ -1795,6 +1795,7 @@ void BKE_pose_rebuild(Object *ob, bArmature *arm)
 			BKE_pose_channel_free(pchan);
 			BKE_pose_channels_hash_free(pose);
 			BLI_freelinkN(&pose->chanbase, pchan);
+			BKE_animsys_eval_plans_invalidate();
 		}
 	}
 	/* printf("rebuild pose %s, %d bones\n", ob->id.name, counter); */
@@ -589,6 +589,9 @@ int blender_test_break(void)
 
 #define UNDO_DISK   0
 
+/* steps that stay uncompressed with USER_UNDO_COMPRESS, the current one and the one before it */
+#define UNDO_COMPRESS_SKIP  2
+
 typedef struct UndoElem {
 	struct UndoElem *next, *prev;
 	char str[FILE_MAX];
@@ -704,6 +707,16 @@ void BKE_write_undo(bContext *C, const char *name)
 		memused = MEM_get_memory_in_use();
 		/* success = */ /* UNUSED */ BLO_write_file_mem(CTX_data_main(C), prevfile, &curundo->memfile, G.fileflags);
 		curundo->undosize = MEM_get_memory_in_use() - memused;
+
+		if (U.uiflag2 & USER_UNDO_COMPRESS) {
+			/* older steps are rarely read, compress them in the background */
+			for (uel = curundo, nr = 0; uel && nr < UNDO_COMPRESS_SKIP; uel = uel->prev, nr++) {
+				/* pass */
+			}
+			if (uel) {
+				BLO_memfile_compress(&uel->memfile);
+			}
+		}
 	}
 
 	if (U.undomemory != 0) {
@@ -770,6 +783,8 @@ void BKE_reset_undo(void)
 {
 	UndoElem *uel;
 	
+	BLO_memfile_compress_finish();
+
 	uel = undobase.first;
 	while (uel) {
 		BLO_free_memfile(&uel->memfile);
@@ -825,6 +840,27 @@ const char *BKE_undo_get_name(int nr, int *active)
 	return NULL;
 }
 
+/**
+ * Memory used by an undo step, data shared with other steps is divided over them.
+ *
+ * \param nr Index of the undo step, -1 for the whole undo stack.
+ */
+size_t BKE_undo_get_memory(int nr)
+{
+	UndoElem *uel;
+	size_t memory = 0;
+
+	if (nr != -1) {
+		uel = BLI_findlink(&undobase, nr);
+		return (uel) ? BLO_memfile_memory(&uel->memfile) : 0;
+	}
+
+	for (uel = undobase.first; uel; uel = uel->next) {
+		memory += BLO_memfile_memory(&uel->memfile);
+	}
+	return memory;
+}
+
 /**
  * Saves .blend using undo buffer.
  *
@@ -869,7 +905,7 @@ bool BKE_undo_save_file(const char *filename)
 	}
 
 	for (chunk = uel->memfile.chunks.first; chunk; chunk = chunk->next) {
-		if (write(file, chunk->buf, chunk->size) != chunk->size) {
+		if (write(file, BLO_memfile_chunk_data(chunk), chunk->size) != chunk->size) {
 			break;
 		}
 	}
@@ -61,6 +61,7 @@
 
 #include "BKE_action.h"
 #include "BKE_anim.h" /* for the curve calculation part */
+#include "BKE_animsys.h"
 #include "BKE_armature.h"
 #include "BKE_bvhutils.h"
 #include "BKE_camera.h"
@@ -4357,6 +4358,9 @@ static void con_unlink_refs_cb(bConstraint *UNUSED(con), ID **idpoin, bool is_re
  */
 void BKE_constraint_free_data(bConstraint *con)
 {
+	/* animation may have resolved paths to the constraint settings */
+	BKE_animsys_eval_plans_invalidate();
+
 	if (con->data) {
 		bConstraintTypeInfo *cti = BKE_constraint_typeinfo_get(con);
 		
@@ -1621,6 +1621,9 @@ void DAG_relations_tag_update(Main *bmain)
 
 	for (sce = bmain->scene.first; sce; sce = sce->id.next)
 		dag_scene_free(sce);
+
+	/* data animation paths resolve to may have been added or removed */
+	BKE_animsys_eval_plans_invalidate();
 }
 
 /* rebuild dependency graph only for a given scene */
@@ -3100,6 +3103,50 @@ void DAG_threaded_update_handle_node_updated(void *node_v,
 	}
 }
 
+/* Add all objects the objects in the set depend on to the set, so it contains
+ * everything that has to be evaluated for them. Only the DAG of the scene itself
+ * is used, objects of set scenes are not added.
+ */
+void DAG_scene_objects_add_ancestors(Scene *scene, GSet *objects)
+{
+	DagNode **stack;
+	DagNode *node;
+	int tot = 0;
+
+	if (scene->theDag == NULL || scene->theDag->numNodes == 0)
+		return;
+
+	stack = MEM_mallocN(sizeof(DagNode *) * scene->theDag->numNodes, "DAG ancestors stack");
+
+	for (node = scene->theDag->DagNode.first; node; node = node->next) {
+		if (node->type == ID_OB && BLI_gset_haskey(objects, node->ob)) {
+			node->color = DAG_BLACK;
+			stack[tot++] = node;
+		}
+		else {
+			node->color = DAG_WHITE;
+		}
+	}
+
+	while (tot) {
+		DagAdjList *itA;
+
+		node = stack[--tot];
+
+		for (itA = node->parent; itA; itA = itA->next) {
+			if (itA->node->color == DAG_WHITE) {
+				itA->node->color = DAG_BLACK;
+				stack[tot++] = itA->node;
+
+				if (itA->node->type == ID_OB)
+					BLI_gset_add(objects, itA->node->ob);
+			}
+		}
+	}
+
+	MEM_freeN(stack);
+}
+
 /* ************************ DAG DEBUGGING ********************* */
 
 void DAG_print_dependencies(Main *bmain, Scene *scene, Object *ob)
@@ -93,6 +93,9 @@ void free_fcurve(FCurve *fcu)
 	
 	/* free f-curve itself */
 	MEM_freeN(fcu);
+	
+	/* evaluation plans may still reference it */
+	BKE_animsys_eval_plans_invalidate();
 }
 
 /* Frees a list of F-Curves */
@@ -920,6 +920,9 @@ void BKE_libblock_free_ex(Main *bmain, void *idv, bool do_id_user)
 
 	DAG_id_type_tag(bmain, type);
 
+	/* animation of other datablocks may have paths resolved into this one */
+	BKE_animsys_eval_plans_invalidate();
+
 #ifdef WITH_PYTHON
 	BPY_id_release(id);
 #endif
@@ -395,6 +395,9 @@ static void mesh_update_linked_customdata(Mesh *me, const bool do_ensure_tess_cd
 
 void BKE_mesh_update_customdata_pointers(Mesh *me, const bool do_ensure_tess_cd)
 {
+	/* the layers animation may have resolved paths into can have been reallocated */
+	BKE_animsys_eval_plans_invalidate();
+
 	mesh_update_linked_customdata(me, do_ensure_tess_cd);
 
 	me->mvert = CustomData_get_layer(&me->vdata, CD_MVERT);
@@ -56,6 +56,7 @@
 
 #include "BLF_translation.h"
 
+#include "BKE_animsys.h"
 #include "BKE_appdir.h"
 #include "BKE_key.h"
 #include "BKE_multires.h"
@@ -137,6 +138,9 @@ void modifier_free(ModifierData *md)
 {
 	ModifierTypeInfo *mti = modifierType_getInfo(md->type);
 
+	/* animation may have resolved paths to the modifier settings */
+	BKE_animsys_eval_plans_invalidate();
+
 	if (mti->freeData) mti->freeData(md);
 	if (md->error) MEM_freeN(md->error);
 
@@ -53,6 +53,7 @@
 #include "DNA_speaker_types.h"
 
 #include "BKE_action.h"
+#include "BKE_animsys.h"
 #include "BKE_fcurve.h"
 #include "BKE_nla.h"
 #include "BKE_global.h"
@@ -82,6 +83,9 @@ void free_nlastrip(ListBase *strips, NlaStrip *strip)
 	/* sanity checks */
 	if (strip == NULL)
 		return;
+	
+	/* animation may have resolved paths to the strip */
+	BKE_animsys_eval_plans_invalidate();
 		
 	/* free child-strips */
 	for (cs = strip->strips.first; cs; cs = csn) {
@@ -120,6 +124,9 @@ void free_nlatrack(ListBase *tracks, NlaTrack *nlt)
 	/* sanity checks */
 	if (nlt == NULL)
 		return;
+	
+	/* animation may have resolved paths to the track */
+	BKE_animsys_eval_plans_invalidate();
 		
 	/* free strips */
 	for (strip = nlt->strips.first; strip; strip = stripn) {
@@ -683,6 +683,9 @@ bNodeSocket *nodeInsertStaticSocket(bNodeTree *ntree, bNode *node, int in_out, i
 
 static void node_socket_free(bNodeTree *UNUSED(ntree), bNodeSocket *sock, bNode *UNUSED(node))
 {
+	/* animation may have resolved paths to the socket value */
+	BKE_animsys_eval_plans_invalidate();
+
 	if (sock->prop) {
 		IDP_FreeProperty(sock->prop);
 		MEM_freeN(sock->prop);
@@ -1595,6 +1598,9 @@ static void node_free_node_ex(bNodeTree *ntree, bNode *node, bool remove_animdat
 	 */
 	remove_animdata &= ntree && !(ntree->flag & NTREE_IS_LOCALIZED);
 	
+	/* animation may have resolved paths to the node */
+	BKE_animsys_eval_plans_invalidate();
+	
 	/* extra free callback */
 	if (use_api_free_cb && node->typeinfo->freefunc_api) {
 		PointerRNA ptr;
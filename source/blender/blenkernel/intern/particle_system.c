@@ -2201,7 +2201,9 @@ void psys_make_temp_pointcache(Object *ob, ParticleSystem *psys)
 		PTCacheID pid;
 		BKE_ptcache_id_from_particles(&pid, ob, psys);
 		cache->flag &= ~PTCACHE_DISK_CACHE;
-		BKE_ptcache_disk_to_mem(&pid);
+		/* only what's needed for paths and trails, other channels are skipped when the cache is an archive */
+		BKE_ptcache_disk_to_mem_ex(&pid, (1 << BPHYS_DATA_INDEX) | (1 << BPHYS_DATA_LOCATION) | (1 << BPHYS_DATA_VELOCITY) |
+		                                 (1 << BPHYS_DATA_ROTATION) | (1 << BPHYS_DATA_AVELOCITY));
 		cache->flag |= PTCACHE_DISK_CACHE;
 	}
 }
@@ -47,6 +47,7 @@
 #include "DNA_smoke_types.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_ghash.h"
 #include "BLI_threads.h"
 #include "BLI_math.h"
 #include "BLI_utildefines.h"
@@ -61,6 +62,7 @@
 #include "BKE_anim.h"
 #include "BKE_blender.h"
 #include "BKE_cloth.h"
+#include "BKE_depsgraph.h"
 #include "BKE_dynamicpaint.h"
 #include "BKE_global.h"
 #include "BKE_main.h"
@@ -98,6 +100,7 @@
 /* needed for directory lookup */
 #ifndef WIN32
 #  include <dirent.h>
+#  include <sys/mman.h>
 #else
 #  include "BLI_winstuff.h"
 #endif
@@ -136,6 +139,11 @@ static int ptcache_file_compressed_read(PTCacheFile *pf, unsigned char *result,
 static int ptcache_file_compressed_write(PTCacheFile *pf, unsigned char *in, unsigned int in_len, unsigned char *out, int mode);
 static int ptcache_file_write(PTCacheFile *pf, const void *f, unsigned int tot, unsigned int size);
 static int ptcache_file_read(PTCacheFile *pf, void *f, unsigned int tot, unsigned int size);
+static void ptcache_file_seek(PTCacheFile *pf, long offset, int origin);
+static bool ptcache_use_archive(PTCacheID *pid);
+static PTCacheFile *ptcache_archive_file_open(PTCacheID *pid, int mode, int cfra);
+static bool ptcache_archive_file_write(PTCacheID *pid, PTCacheFile *pf);
+static void ptcache_archive_release(PointCache *cache, bool compact);
 
 /* Common functions */
 static int ptcache_basic_header_read(PTCacheFile *pf)
@@ -143,10 +151,10 @@ static int ptcache_basic_header_read(PTCacheFile *pf)
 	int error=0;
 
 	/* Custom functions should read these basic elements too! */
-	if (!error && !fread(&pf->totpoint, sizeof(unsigned int), 1, pf->fp))
+	if (!error && !ptcache_file_read(pf, &pf->totpoint, 1, sizeof(unsigned int)))
 		error = 1;
 	
-	if (!error && !fread(&pf->data_types, sizeof(unsigned int), 1, pf->fp))
+	if (!error && !ptcache_file_read(pf, &pf->data_types, 1, sizeof(unsigned int)))
 		error = 1;
 
 	return !error;
@@ -154,10 +162,10 @@ static int ptcache_basic_header_read(PTCacheFile *pf)
 static int ptcache_basic_header_write(PTCacheFile *pf)
 {
 	/* Custom functions should write these basic elements too! */
-	if (!fwrite(&pf->totpoint, sizeof(unsigned int), 1, pf->fp))
+	if (!ptcache_file_write(pf, &pf->totpoint, 1, sizeof(unsigned int)))
 		return 0;
 	
-	if (!fwrite(&pf->data_types, sizeof(unsigned int), 1, pf->fp))
+	if (!ptcache_file_write(pf, &pf->data_types, 1, sizeof(unsigned int)))
 		return 0;
 
 	return 1;
@@ -775,7 +783,7 @@ static int ptcache_smoke_read(PTCacheFile *pf, void *smoke_v)
 	if (strncmp(version, SMOKE_CACHE_VERSION, 4))
 	{
 		/* reset file pointer */
-		fseek(pf->fp, -4, SEEK_CUR);
+		ptcache_file_seek(pf, -4, SEEK_CUR);
 		return ptcache_smoke_read_old(pf, smoke_v);
 	}
 
@@ -1538,6 +1546,9 @@ static PTCacheFile *ptcache_file_open(PTCacheID *pid, int mode, int cfra)
 		return NULL;
 #endif
 	if (!G.relbase_valid && (pid->cache->flag & PTCACHE_EXTERNAL)==0) return NULL; /* save blend file before using disk pointcache */
+
+	if (ptcache_use_archive(pid))
+		return ptcache_archive_file_open(pid, mode, cfra);
 	
 	ptcache_filename(pid, filename, cfra, 1, 1);
 
@@ -1559,7 +1570,7 @@ static PTCacheFile *ptcache_file_open(PTCacheID *pid, int mode, int cfra)
 	if (!fp)
 		return NULL;
 
-	pf= MEM_mallocN(sizeof(PTCacheFile), "PTCacheFile");
+	pf= MEM_callocN(sizeof(PTCacheFile), "PTCacheFile");
 	pf->fp= fp;
 	pf->old_format = 0;
 	pf->frame = cfra;
@@ -1569,7 +1580,10 @@ static PTCacheFile *ptcache_file_open(PTCacheID *pid, int mode, int cfra)
 static void ptcache_file_close(PTCacheFile *pf)
 {
 	if (pf) {
-		fclose(pf->fp);
+		if (pf->fp)
+			fclose(pf->fp);
+		else if (pf->archive == NULL)
+			MEM_freeN(pf->mem);
 		MEM_freeN(pf);
 	}
 }
@@ -1677,12 +1691,48 @@ static int ptcache_file_compressed_write(PTCacheFile *pf, unsigned char *in, uns
 }
 static int ptcache_file_read(PTCacheFile *pf, void *f, unsigned int tot, unsigned int size)
 {
+	if (pf->fp == NULL) {
+		size_t len = (size_t)tot * size;
+
+		if (pf->mem_pos + len > pf->mem_len)
+			return 0;
+
+		memcpy(f, pf->mem + pf->mem_pos, len);
+		pf->mem_pos += len;
+		return 1;
+	}
+
 	return (fread(f, size, tot, pf->fp) == tot);
 }
 static int ptcache_file_write(PTCacheFile *pf, const void *f, unsigned int tot, unsigned int size)
 {
+	if (pf->fp == NULL) {
+		size_t len = (size_t)tot * size;
+		size_t alloc_len = MEM_allocN_len(pf->mem);
+
+		if (pf->mem_pos + len > alloc_len)
+			pf->mem = MEM_reallocN(pf->mem, MAX2(alloc_len * 2, pf->mem_pos + len));
+
+		memcpy(pf->mem + pf->mem_pos, f, len);
+		pf->mem_pos += len;
+		pf->mem_len = MAX2(pf->mem_len, pf->mem_pos);
+		return 1;
+	}
+
 	return (fwrite(f, size, tot, pf->fp) == tot);
 }
+/* only SEEK_SET and SEEK_CUR are supported */
+static void ptcache_file_seek(PTCacheFile *pf, long offset, int origin)
+{
+	if (pf->fp == NULL) {
+		long pos = (origin == SEEK_CUR) ? (long)pf->mem_pos + offset : offset;
+
+		pf->mem_pos = (size_t)CLAMPIS(pos, 0, (long)pf->mem_len);
+	}
+	else {
+		fseek(pf->fp, offset, origin);
+	}
+}
 static int ptcache_file_data_read(PTCacheFile *pf)
 {
 	int i;
@@ -1713,13 +1763,13 @@ static int ptcache_file_header_begin_read(PTCacheFile *pf)
 	
 	pf->data_types = 0;
 	
-	if (fread(bphysics, sizeof(char), 8, pf->fp) != 8)
+	if (!ptcache_file_read(pf, bphysics, 8, sizeof(char)))
 		error = 1;
 	
 	if (!error && strncmp(bphysics, "BPHYSICS", 8))
 		error = 1;
 
-	if (!error && !fread(&typeflag, sizeof(unsigned int), 1, pf->fp))
+	if (!error && !ptcache_file_read(pf, &typeflag, 1, sizeof(unsigned int)))
 		error = 1;
 
 	pf->type = (typeflag & PTCACHE_TYPEFLAG_TYPEMASK);
@@ -1727,7 +1777,7 @@ static int ptcache_file_header_begin_read(PTCacheFile *pf)
 	
 	/* if there was an error set file as it was */
 	if (error)
-		fseek(pf->fp, 0, SEEK_SET);
+		ptcache_file_seek(pf, 0, SEEK_SET);
 
 	return !error;
 }
@@ -1736,10 +1786,10 @@ static int ptcache_file_header_begin_write(PTCacheFile *pf)
 	const char *bphysics = "BPHYSICS";
 	unsigned int typeflag = pf->type + pf->flag;
 	
-	if (fwrite(bphysics, sizeof(char), 8, pf->fp) != 8)
+	if (!ptcache_file_write(pf, bphysics, 8, sizeof(char)))
 		return 0;
 
-	if (!fwrite(&typeflag, sizeof(unsigned int), 1, pf->fp))
+	if (!ptcache_file_write(pf, &typeflag, 1, sizeof(unsigned int)))
 		return 0;
 	
 	return 1;
@@ -1944,12 +1994,935 @@ static void ptcache_find_frames_around(PTCacheID *pid, unsigned int frame, int *
 	}
 }
 
+/* Cache archive
+ *
+ * Instead of one file per frame, all frames of a disk cache can be stored in a
+ * single file. Every data channel of a frame is a separate block that is
+ * compressed on its own, so only the channels that are needed get decompressed,
+ * and the file is mapped into memory instead of being read. Stream caches
+ * (smoke, dynamic paint) store the whole frame as one block.
+ *
+ * Frames are appended to the file, each as its index entry followed by its
+ * blocks, so writing a frame doesn't touch the rest of the file. The index is
+ * built by walking the entries when the archive is opened, a later entry of a
+ * frame replaces an earlier one. Cleared frames get an entry without blocks
+ * that removes them from the index. The archive is kept open in the PointCache,
+ * the space of replaced and cleared frames is reclaimed by rewriting the file
+ * when baking ends and when frames are cleared.
+ */
+
+#define PTCACHE_ARCHIVE_ID "BPHYSARC"
+#define PTCACHE_ARCHIVE_VERSION 2
+/* block of the extra data, or of the whole frame for stream caches */
+#define PTCACHE_ARCHIVE_BLOCK_EXTRA BPHYS_TOT_DATA
+#define PTCACHE_ARCHIVE_TOT_BLOCK (BPHYS_TOT_DATA + 1)
+/* flag of the index entry of a cleared frame, not used by the cache type flags */
+#define PTCACHE_ARCHIVE_FRAME_CLEARED (1u << 31)
+
+typedef struct PTCacheArchiveBlock {
+	uint64_t offset;
+	unsigned int size;      /* size in the file */
+	unsigned int len;       /* size of the uncompressed data */
+	int compression;
+	int pad;
+} PTCacheArchiveBlock;
+
+/* index entry, written in front of the blocks of the frame */
+typedef struct PTCacheArchiveFrame {
+	int frame;
+	unsigned int totpoint, data_types, flag;
+	PTCacheArchiveBlock blocks[PTCACHE_ARCHIVE_TOT_BLOCK];
+} PTCacheArchiveFrame;
+
+typedef struct PTCacheArchiveHeader {
+	char id[8];
+	unsigned int version, type;
+} PTCacheArchiveHeader;
+
+typedef struct PTCacheArchive {
+	FILE *fp;
+	char filename[MAX_PTCACHE_FILE];
+	bool writable;
+	PTCacheArchiveHeader header;
+	size_t file_len;
+	size_t dead_len;                /* size of replaced and cleared frames */
+
+	PTCacheArchiveFrame *frames;    /* sorted by frame number */
+	int totframe, maxframe;
+
+	/* the file mapped into memory for reading */
+	unsigned char *map;
+	size_t map_len;
+	bool map_failed;
+	/* block read from the file when it can't be mapped */
+	unsigned char *buffer;
+} PTCacheArchive;
+
+/* all frames of the cache are stored in one archive file */
+static bool ptcache_use_archive(PTCacheID *pid)
+{
+	return (pid->cache->flag & PTCACHE_DISK_ARCHIVE) && (pid->cache->flag & PTCACHE_EXTERNAL) == 0;
+}
+
+static void ptcache_archive_filename(PTCacheID *pid, char *filename)
+{
+	int len = ptcache_filename(pid, filename, 0, 1, 0);
+
+	if (pid->cache->index < 0)
+		pid->cache->index = pid->stack_index = BKE_object_insert_ptcache(pid->ob);
+
+	/* doesn't match the frame files of the cache, but is removed with them */
+	BLI_snprintf(filename + len, MAX_PTCACHE_FILE - len, "_%02u_archive"PTCACHE_EXT, pid->stack_index);
+}
+
+/* size of a frame in the file, its index entry and blocks */
+static size_t ptcache_archive_frame_len(const PTCacheArchiveFrame *frame)
+{
+	size_t len = sizeof(PTCacheArchiveFrame);
+	int i;
+
+	for (i = 0; i < PTCACHE_ARCHIVE_TOT_BLOCK; i++)
+		len += frame->blocks[i].size;
+
+	return len;
+}
+
+/* index of the first frame at or after cfra */
+static int ptcache_archive_frame_search(PTCacheArchive *archive, int cfra)
+{
+	int low = 0, high = archive->totframe;
+
+	while (low < high) {
+		int mid = (low + high) / 2;
+
+		if (archive->frames[mid].frame < cfra)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+static PTCacheArchiveFrame *ptcache_archive_frame_find(PTCacheArchive *archive, int cfra)
+{
+	int index = ptcache_archive_frame_search(archive, cfra);
+
+	if (index < archive->totframe && archive->frames[index].frame == cfra)
+		return &archive->frames[index];
+
+	return NULL;
+}
+
+/* add a frame to the index, replacing an earlier version of it */
+static void ptcache_archive_frame_add(PTCacheArchive *archive, const PTCacheArchiveFrame *frame)
+{
+	int index = ptcache_archive_frame_search(archive, frame->frame);
+
+	if (index < archive->totframe && archive->frames[index].frame == frame->frame) {
+		archive->dead_len += ptcache_archive_frame_len(&archive->frames[index]);
+	}
+	else {
+		if (archive->totframe == archive->maxframe) {
+			archive->maxframe = max_ii(archive->maxframe * 2, 64);
+
+			if (archive->frames)
+				archive->frames = MEM_reallocN(archive->frames, sizeof(PTCacheArchiveFrame) * archive->maxframe);
+			else
+				archive->frames = MEM_mallocN(sizeof(PTCacheArchiveFrame) * archive->maxframe, "PTCacheArchive frames");
+		}
+
+		memmove(&archive->frames[index + 1], &archive->frames[index],
+		        sizeof(PTCacheArchiveFrame) * (archive->totframe - index));
+		archive->totframe++;
+	}
+
+	archive->frames[index] = *frame;
+}
+
+/* remove a frame from the index */
+static void ptcache_archive_frame_remove(PTCacheArchive *archive, int cfra)
+{
+	int index = ptcache_archive_frame_search(archive, cfra);
+
+	if (index < archive->totframe && archive->frames[index].frame == cfra) {
+		archive->dead_len += ptcache_archive_frame_len(&archive->frames[index]);
+
+		memmove(&archive->frames[index], &archive->frames[index + 1],
+		        sizeof(PTCacheArchiveFrame) * (archive->totframe - index - 1));
+		archive->totframe--;
+	}
+}
+
+static bool ptcache_archive_header_write(PTCacheArchive *archive, PTCacheID *pid)
+{
+	memset(&archive->header, 0, sizeof(PTCacheArchiveHeader));
+	memcpy(archive->header.id, PTCACHE_ARCHIVE_ID, sizeof(archive->header.id));
+	archive->header.version = PTCACHE_ARCHIVE_VERSION;
+	archive->header.type = pid->type;
+	archive->file_len = sizeof(PTCacheArchiveHeader);
+
+	return (fwrite(&archive->header, sizeof(PTCacheArchiveHeader), 1, archive->fp) == 1 &&
+	        fflush(archive->fp) == 0);
+}
+
+/* read the header and walk the index entries of the frames */
+static bool ptcache_archive_index_read(PTCacheArchive *archive, PTCacheID *pid)
+{
+	PTCacheArchiveHeader *header = &archive->header;
+	FILE *fp = archive->fp;
+	size_t offset = sizeof(PTCacheArchiveHeader);
+	size_t file_len;
+
+	if (fseek(fp, 0, SEEK_END) != 0)
+		return false;
+
+	file_len = (size_t)ftell(fp);
+
+	if (fseek(fp, 0, SEEK_SET) != 0 || fread(header, sizeof(PTCacheArchiveHeader), 1, fp) != 1)
+		return false;
+
+	if (strncmp(header->id, PTCACHE_ARCHIVE_ID, sizeof(header->id)) != 0 ||
+	    header->version != PTCACHE_ARCHIVE_VERSION || header->type != pid->type)
+	{
+		return false;
+	}
+
+	while (offset + sizeof(PTCacheArchiveFrame) <= file_len) {
+		PTCacheArchiveFrame frame;
+		size_t end = offset + sizeof(PTCacheArchiveFrame);
+		bool valid = true;
+		int i;
+
+		if (fseek(fp, offset, SEEK_SET) != 0 || fread(&frame, sizeof(PTCacheArchiveFrame), 1, fp) != 1)
+			break;
+
+		for (i = 0; i < PTCACHE_ARCHIVE_TOT_BLOCK && valid; i++) {
+			valid = (frame.blocks[i].offset == end);
+			end += frame.blocks[i].size;
+		}
+
+		/* a frame that wasn't written completely is written over by the next frame */
+		if (!valid || end > file_len)
+			break;
+
+		if (frame.flag & PTCACHE_ARCHIVE_FRAME_CLEARED) {
+			ptcache_archive_frame_remove(archive, frame.frame);
+			archive->dead_len += sizeof(PTCacheArchiveFrame);
+		}
+		else {
+			ptcache_archive_frame_add(archive, &frame);
+		}
+		offset = end;
+	}
+
+	archive->file_len = offset;
+
+	return true;
+}
+
+static void ptcache_archive_unmap(PTCacheArchive *archive)
+{
+#ifndef WIN32
+	if (archive->map)
+		munmap(archive->map, archive->map_len);
+#endif
+
+	archive->map = NULL;
+	archive->map_len = 0;
+	archive->map_failed = false;
+}
+
+static void ptcache_archive_close(PTCacheArchive *archive)
+{
+	ptcache_archive_unmap(archive);
+
+	MEM_SAFE_FREE(archive->buffer);
+	MEM_SAFE_FREE(archive->frames);
+	fclose(archive->fp);
+	MEM_freeN(archive);
+}
+
+/* data of a block as stored in the file, valid until the archive is closed or the next block is read */
+static const unsigned char *ptcache_archive_block_data(PTCacheArchive *archive, const PTCacheArchiveBlock *block)
+{
+	if (block->offset + block->size > archive->file_len)
+		return NULL;
+
+#ifndef WIN32
+	/* map again when frames were written after the file was mapped */
+	if (archive->map && block->offset + block->size > archive->map_len)
+		ptcache_archive_unmap(archive);
+
+	if (archive->map == NULL && !archive->map_failed) {
+		void *map = mmap(NULL, archive->file_len, PROT_READ, MAP_PRIVATE, fileno(archive->fp), 0);
+
+		if (map == MAP_FAILED) {
+			archive->map_failed = true;
+		}
+		else {
+			archive->map = map;
+			archive->map_len = archive->file_len;
+		}
+	}
+
+	if (archive->map)
+		return archive->map + block->offset;
+#endif
+
+	if (archive->buffer == NULL || MEM_allocN_len(archive->buffer) < block->size) {
+		MEM_SAFE_FREE(archive->buffer);
+		archive->buffer = MEM_mallocN(MAX2(block->size, 1), "PTCacheArchive buffer");
+	}
+
+	if (fseek(archive->fp, block->offset, SEEK_SET) != 0 ||
+	    fread(archive->buffer, 1, block->size, archive->fp) != block->size)
+	{
+		return NULL;
+	}
+
+	return archive->buffer;
+}
+
+/* decompress a block into result, which has room for block->len bytes */
+static bool ptcache_archive_block_read(PTCacheArchive *archive, const PTCacheArchiveBlock *block, void *result)
+{
+	const unsigned char *in = ptcache_archive_block_data(archive, block);
+
+	if (in == NULL)
+		return false;
+
+	switch (block->compression) {
+		case PTCACHE_COMPRESS_NO:
+			if (block->size != block->len)
+				return false;
+			memcpy(result, in, block->len);
+			return true;
+#ifdef WITH_LZO
+		case PTCACHE_COMPRESS_LZO:
+		{
+			lzo_uint out_len = block->len;
+
+			return (lzo1x_decompress_safe(in, (lzo_uint)block->size, result, &out_len, NULL) == LZO_E_OK &&
+			        out_len == block->len);
+		}
+#endif
+#ifdef WITH_LZMA
+		case PTCACHE_COMPRESS_LZMA:
+		{
+			size_t out_len = block->len;
+			size_t in_len;
+
+			/* the properties are stored in front of the data */
+			if (block->size < LZMA_PROPS_SIZE)
+				return false;
+
+			in_len = block->size - LZMA_PROPS_SIZE;
+
+			return (LzmaUncompress(result, &out_len, in + LZMA_PROPS_SIZE, &in_len, in, LZMA_PROPS_SIZE) == SZ_OK &&
+			        out_len == block->len);
+		}
+#endif
+	}
+
+	return false;
+}
+
+/* returns the compression that was used, out has room for LZO_OUT_LEN(in_len) bytes */
+static int ptcache_archive_compress(const unsigned char *in, unsigned int in_len, unsigned char *out,
+                                    unsigned int *r_out_len, int mode)
+{
+	int compressed = PTCACHE_COMPRESS_NO;
+
+	(void)in; (void)out; (void)r_out_len; (void)mode; /* unused when building w/o compression */
+
+#ifdef WITH_LZO
+	if (mode == PTCACHE_COMPRESS_LZO) {
+		lzo_uint out_len = LZO_OUT_LEN(in_len);
+		LZO_HEAP_ALLOC(wrkmem, LZO1X_MEM_COMPRESS);
+
+		if (lzo1x_1_compress(in, (lzo_uint)in_len, out, &out_len, wrkmem) == LZO_E_OK && out_len < in_len) {
+			*r_out_len = (unsigned int)out_len;
+			compressed = PTCACHE_COMPRESS_LZO;
+		}
+	}
+#endif
+#ifdef WITH_LZMA
+	if (mode == PTCACHE_COMPRESS_LZMA) {
+		size_t out_len = LZO_OUT_LEN(in_len) - LZMA_PROPS_SIZE;
+		size_t props_len = LZMA_PROPS_SIZE;
+
+		if (LzmaCompress(out + LZMA_PROPS_SIZE, &out_len, in, in_len,
+		                 out, &props_len, 5, 1 << 24, 3, 0, 2, 32, 2) == SZ_OK &&
+		    out_len + LZMA_PROPS_SIZE < in_len)
+		{
+			*r_out_len = (unsigned int)(out_len + LZMA_PROPS_SIZE);
+			compressed = PTCACHE_COMPRESS_LZMA;
+		}
+	}
+#endif
+
+	return compressed;
+}
+
+/* append the blocks of a frame, data has the uncompressed data of the blocks
+ * with their length in frame->blocks, an existing frame is replaced */
+static bool ptcache_archive_frame_write(PTCacheArchive *archive, PTCacheArchiveFrame *frame,
+                                        const unsigned char *data[PTCACHE_ARCHIVE_TOT_BLOCK], int compression)
+{
+	unsigned char *out[PTCACHE_ARCHIVE_TOT_BLOCK] = {NULL};
+	const unsigned char *write_data[PTCACHE_ARCHIVE_TOT_BLOCK] = {NULL};
+	size_t offset = archive->file_len + sizeof(PTCacheArchiveFrame);
+	bool ok;
+	int i;
+
+	/* compress first, the index entry in front of the blocks has their sizes */
+	for (i = 0; i < PTCACHE_ARCHIVE_TOT_BLOCK; i++) {
+		PTCacheArchiveBlock *block = &frame->blocks[i];
+		const unsigned char *in = data[i];
+
+		block->offset = offset;
+		block->size = 0;
+		block->compression = PTCACHE_COMPRESS_NO;
+
+		if (in == NULL || block->len == 0) {
+			block->len = 0;
+			continue;
+		}
+
+		if (compression) {
+			out[i] = MEM_mallocN(LZO_OUT_LEN(block->len), "pointcache archive block");
+			block->compression = ptcache_archive_compress(in, block->len, out[i], &block->size, compression);
+		}
+
+		if (block->compression == PTCACHE_COMPRESS_NO) {
+			block->size = block->len;
+			write_data[i] = in;
+		}
+		else {
+			write_data[i] = out[i];
+		}
+
+		offset += block->size;
+	}
+
+	ok = (fseek(archive->fp, archive->file_len, SEEK_SET) == 0 &&
+	      fwrite(frame, sizeof(PTCacheArchiveFrame), 1, archive->fp) == 1);
+
+	for (i = 0; i < PTCACHE_ARCHIVE_TOT_BLOCK && ok; i++) {
+		if (frame->blocks[i].size)
+			ok = (fwrite(write_data[i], 1, frame->blocks[i].size, archive->fp) == frame->blocks[i].size);
+	}
+
+	if (ok)
+		ok = (fflush(archive->fp) == 0);
+
+	for (i = 0; i < PTCACHE_ARCHIVE_TOT_BLOCK; i++) {
+		if (out[i])
+			MEM_freeN(out[i]);
+	}
+
+	/* a frame that wasn't written completely is written over by the next one */
+	if (!ok)
+		return false;
+
+	ptcache_archive_frame_add(archive, frame);
+	archive->file_len = offset;
+
+	return true;
+}
+
+/* append the entry of a cleared frame, so the frame stays cleared when the
+ * file isn't rewritten */
+static bool ptcache_archive_frame_clear_write(PTCacheArchive *archive, int cfra)
+{
+	PTCacheArchiveFrame frame = {0};
+	size_t offset = archive->file_len + sizeof(PTCacheArchiveFrame);
+	int i;
+
+	frame.frame = cfra;
+	frame.flag = PTCACHE_ARCHIVE_FRAME_CLEARED;
+
+	for (i = 0; i < PTCACHE_ARCHIVE_TOT_BLOCK; i++)
+		frame.blocks[i].offset = offset;
+
+	if (fseek(archive->fp, archive->file_len, SEEK_SET) != 0 ||
+	    fwrite(&frame, sizeof(PTCacheArchiveFrame), 1, archive->fp) != 1 ||
+	    fflush(archive->fp) != 0)
+	{
+		return false;
+	}
+
+	archive->file_len = offset;
+	archive->dead_len += sizeof(PTCacheArchiveFrame);
+
+	return true;
+}
+
+/* copy the live frames of the archive to a new file */
+static bool ptcache_archive_rewrite(PTCacheArchive *archive, const char *filename)
+{
+	PTCacheArchiveFrame *frames;
+	size_t offset = sizeof(PTCacheArchiveHeader);
+	FILE *fp = BLI_fopen(filename, "wb");
+	bool ok;
+	int i, j;
+
+	if (fp == NULL)
+		return false;
+
+	frames = MEM_mallocN(sizeof(PTCacheArchiveFrame) * max_ii(archive->totframe, 1), "PTCacheArchive frames");
+
+	ok = (fwrite(&archive->header, sizeof(PTCacheArchiveHeader), 1, fp) == 1);
+
+	for (i = 0; i < archive->totframe && ok; i++) {
+		PTCacheArchiveFrame *frame = &frames[i];
+
+		*frame = archive->frames[i];
+		offset += sizeof(PTCacheArchiveFrame);
+
+		for (j = 0; j < PTCACHE_ARCHIVE_TOT_BLOCK; j++) {
+			frame->blocks[j].offset = offset;
+			offset += frame->blocks[j].size;
+		}
+
+		ok = (fwrite(frame, sizeof(PTCacheArchiveFrame), 1, fp) == 1);
+
+		/* blocks are copied as stored, without decompressing them */
+		for (j = 0; j < PTCACHE_ARCHIVE_TOT_BLOCK && ok; j++) {
+			const PTCacheArchiveBlock *block = &archive->frames[i].blocks[j];
+
+			if (block->size) {
+				const unsigned char *data = ptcache_archive_block_data(archive, block);
+				ok = (data && fwrite(data, 1, block->size, fp) == block->size);
+			}
+		}
+	}
+
+	if (fclose(fp) != 0)
+		ok = false;
+
+	if (ok) {
+		MEM_freeN(archive->frames);
+		archive->frames = frames;
+		archive->maxframe = max_ii(archive->totframe, 1);
+		archive->file_len = offset;
+		archive->dead_len = 0;
+	}
+	else {
+		MEM_freeN(frames);
+		BLI_delete(filename, false, false);
+	}
+
+	return ok;
+}
+
+/* close the archive of the cache, compact reclaims the space of replaced and
+ * cleared frames first, which happens when baking ends and when frames are cleared */
+static void ptcache_archive_release(PointCache *cache, bool compact)
+{
+	PTCacheArchive *archive = cache->archive;
+	char filename[MAX_PTCACHE_FILE];
+	char tmp_filename[MAX_PTCACHE_FILE + 4];
+	bool rewritten = false;
+
+	if (archive == NULL)
+		return;
+
+	BLI_strncpy(filename, archive->filename, sizeof(filename));
+
+	if (compact && archive->writable && archive->dead_len) {
+		BLI_snprintf(tmp_filename, sizeof(tmp_filename), "%s.tmp", filename);
+		rewritten = ptcache_archive_rewrite(archive, tmp_filename);
+	}
+
+	/* the file can't be replaced while it's open on Windows */
+	cache->archive = NULL;
+	ptcache_archive_close(archive);
+
+	if (rewritten && BLI_rename(tmp_filename, filename) != 0) {
+		if (G.debug & G_DEBUG)
+			printf("Error compacting point cache archive %s\n", filename);
+		BLI_delete(tmp_filename, false, false);
+	}
+}
+
+/* the archive of the cache, which is kept open until released. When it is
+ * opened only the index is read, the file is mapped when the first block is read */
+static PTCacheArchive *ptcache_archive_get(PTCacheID *pid, int mode)
+{
+	PointCache *cache = pid->cache;
+	PTCacheArchive *archive = cache->archive;
+	char filename[MAX_PTCACHE_FILE];
+	FILE *fp;
+
+	if (!G.relbase_valid)
+		return NULL;
+
+	ptcache_archive_filename(pid, filename);
+
+	if (archive) {
+		/* reopen after the blend file or the cache was renamed, and for writing */
+		if (STREQ(archive->filename, filename) && (archive->writable || mode == PTCACHE_FILE_READ))
+			return archive;
+
+		ptcache_archive_release(cache, false);
+	}
+
+	if (mode == PTCACHE_FILE_READ) {
+		fp = BLI_fopen(filename, "rb");
+	}
+	else {
+		BLI_make_existing_file(filename);
+		fp = BLI_fopen(filename, "rb+");
+		if (fp == NULL)
+			fp = BLI_fopen(filename, "wb+");
+	}
+
+	if (fp == NULL)
+		return NULL;
+
+	archive = MEM_callocN(sizeof(PTCacheArchive), "PTCacheArchive");
+	archive->fp = fp;
+	archive->writable = (mode != PTCACHE_FILE_READ);
+	BLI_strncpy(archive->filename, filename, sizeof(archive->filename));
+
+	if (!ptcache_archive_index_read(archive, pid)) {
+		MEM_SAFE_FREE(archive->frames);
+		archive->totframe = archive->maxframe = 0;
+		archive->dead_len = 0;
+
+		if (mode == PTCACHE_FILE_READ) {
+			if (G.debug & G_DEBUG)
+				printf("Invalid point cache archive %s\n", filename);
+			ptcache_archive_close(archive);
+			return NULL;
+		}
+
+		/* new, invalid or outdated archive, start over */
+		fclose(fp);
+		archive->fp = BLI_fopen(filename, "wb+");
+
+		if (archive->fp == NULL) {
+			MEM_freeN(archive);
+			return NULL;
+		}
+
+		if (!ptcache_archive_header_write(archive, pid)) {
+			ptcache_archive_close(archive);
+			return NULL;
+		}
+	}
+
+	cache->archive = archive;
+
+	return archive;
+}
+
+static PTCacheFile *ptcache_archive_file_open(PTCacheID *pid, int mode, int cfra)
+{
+	PTCacheFile *pf;
+	PTCacheArchive *archive = NULL;
+	const unsigned char *data = NULL;
+	unsigned int len = 0;
+
+	if (mode == PTCACHE_FILE_READ) {
+		PTCacheArchiveFrame *frame;
+
+		archive = ptcache_archive_get(pid, PTCACHE_FILE_READ);
+		if (archive == NULL)
+			return NULL;
+
+		frame = ptcache_archive_frame_find(archive, cfra);
+		if (frame) {
+			PTCacheArchiveBlock *block = &frame->blocks[PTCACHE_ARCHIVE_BLOCK_EXTRA];
+
+			/* stream frames are never compressed as a whole, the caches compress their own data */
+			if (block->compression == PTCACHE_COMPRESS_NO) {
+				data = ptcache_archive_block_data(archive, block);
+				len = block->len;
+			}
+		}
+
+		if (data == NULL)
+			return NULL;
+	}
+	else if (mode != PTCACHE_FILE_WRITE) {
+		return NULL;
+	}
+
+	pf = MEM_callocN(sizeof(PTCacheFile), "PTCacheFile");
+	pf->frame = cfra;
+	pf->archive = archive;
+
+	if (archive) {
+		pf->mem = (unsigned char *)data;
+		pf->mem_len = len;
+	}
+	else {
+		/* written to the archive by ptcache_archive_file_write */
+		pf->mem = MEM_mallocN(1024 * 64, "PTCacheFile mem");
+	}
+
+	return pf;
+}
+
+/* write a frame of a stream cache that was written to memory */
+static bool ptcache_archive_file_write(PTCacheID *pid, PTCacheFile *pf)
+{
+	PTCacheArchive *archive = ptcache_archive_get(pid, PTCACHE_FILE_WRITE);
+	PTCacheArchiveFrame frame = {0};
+	const unsigned char *data[PTCACHE_ARCHIVE_TOT_BLOCK] = {NULL};
+
+	if (archive == NULL)
+		return false;
+
+	frame.frame = pf->frame;
+	frame.totpoint = pf->totpoint;
+	frame.data_types = pf->data_types;
+	frame.flag = pf->flag;
+	frame.blocks[PTCACHE_ARCHIVE_BLOCK_EXTRA].len = (unsigned int)pf->mem_len;
+	data[PTCACHE_ARCHIVE_BLOCK_EXTRA] = pf->mem;
+
+	return ptcache_archive_frame_write(archive, &frame, data, PTCACHE_COMPRESS_NO);
+}
+
+static bool ptcache_archive_mem_frame_write(PTCacheID *pid, PTCacheMem *pm)
+{
+	PTCacheArchive *archive = ptcache_archive_get(pid, PTCACHE_FILE_WRITE);
+	PTCacheArchiveFrame frame = {0};
+	const unsigned char *data[PTCACHE_ARCHIVE_TOT_BLOCK] = {NULL};
+	unsigned char *extra_data = NULL;
+	PTCacheExtra *extra;
+	bool ok;
+	int i;
+
+	if (archive == NULL)
+		return false;
+
+	frame.frame = pm->frame;
+	frame.totpoint = pm->totpoint;
+	frame.data_types = pm->data_types;
+
+	if (pid->cache->compression)
+		frame.flag |= PTCACHE_TYPEFLAG_COMPRESS;
+
+	for (i = 0; i < BPHYS_TOT_DATA; i++) {
+		if (pm->data[i]) {
+			frame.blocks[i].len = pm->totpoint * ptcache_data_size[i];
+			data[i] = pm->data[i];
+		}
+	}
+
+	/* all extra data goes in one block, each with its type and length in front */
+	for (extra = pm->extradata.first; extra; extra = extra->next) {
+		if (extra->data && extra->totdata)
+			frame.blocks[PTCACHE_ARCHIVE_BLOCK_EXTRA].len += 2 * sizeof(unsigned int) +
+			        extra->totdata * ptcache_extra_datasize[extra->type];
+	}
+
+	if (frame.blocks[PTCACHE_ARCHIVE_BLOCK_EXTRA].len) {
+		unsigned char *poin = extra_data = MEM_mallocN(frame.blocks[PTCACHE_ARCHIVE_BLOCK_EXTRA].len,
+		                                               "pointcache archive extra");
+
+		for (extra = pm->extradata.first; extra; extra = extra->next) {
+			if (extra->data && extra->totdata) {
+				unsigned int len = extra->totdata * ptcache_extra_datasize[extra->type];
+
+				memcpy(poin, &extra->type, sizeof(unsigned int));
+				memcpy(poin + sizeof(unsigned int), &extra->totdata, sizeof(unsigned int));
+				memcpy(poin + 2 * sizeof(unsigned int), extra->data, len);
+				poin += 2 * sizeof(unsigned int) + len;
+			}
+		}
+
+		frame.flag |= PTCACHE_TYPEFLAG_EXTRADATA;
+		data[PTCACHE_ARCHIVE_BLOCK_EXTRA] = extra_data;
+	}
+
+	ok = ptcache_archive_frame_write(archive, &frame, data, pid->cache->compression);
+
+	if (extra_data)
+		MEM_freeN(extra_data);
+
+	if (!ok && G.debug & G_DEBUG)
+		printf("Error writing to disk cache archive\n");
+
+	return ok;
+}
+
+/* read the data types of a frame that are in data_types, extra data is only read when asked for */
+static PTCacheMem *ptcache_archive_frame_to_mem(PTCacheArchive *archive, const PTCacheArchiveFrame *frame,
+                                                unsigned int data_types, bool read_extra)
+{
+	const PTCacheArchiveBlock *extra_block = &frame->blocks[PTCACHE_ARCHIVE_BLOCK_EXTRA];
+	PTCacheMem *pm = MEM_callocN(sizeof(PTCacheMem), "Pointcache mem");
+	bool error = false;
+	int i;
+
+	pm->totpoint = frame->totpoint;
+	pm->data_types = frame->data_types & data_types;
+	pm->frame = frame->frame;
+
+	ptcache_data_alloc(pm);
+
+	for (i = 0; i < BPHYS_TOT_DATA && !error; i++) {
+		if (pm->data_types & (1 << i)) {
+			const PTCacheArchiveBlock *block = &frame->blocks[i];
+
+			if (block->len != pm->totpoint * ptcache_data_size[i] ||
+			    !ptcache_archive_block_read(archive, block, pm->data[i]))
+			{
+				error = true;
+			}
+		}
+	}
+
+	if (!error && read_extra && (frame->flag & PTCACHE_TYPEFLAG_EXTRADATA) && extra_block->len) {
+		unsigned char *extra_data = MEM_mallocN(extra_block->len, "pointcache archive extra");
+		unsigned int pos = 0;
+
+		error = !ptcache_archive_block_read(archive, extra_block, extra_data);
+
+		while (!error && pos + 2 * sizeof(unsigned int) <= extra_block->len) {
+			PTCacheExtra *extra;
+			unsigned int type, totdata, len;
+
+			memcpy(&type, extra_data + pos, sizeof(unsigned int));
+			memcpy(&totdata, extra_data + pos + sizeof(unsigned int), sizeof(unsigned int));
+			pos += 2 * sizeof(unsigned int);
+
+			if (type >= ARRAY_SIZE(ptcache_extra_datasize) ||
+			    (len = totdata * ptcache_extra_datasize[type]) > extra_block->len - pos)
+			{
+				error = true;
+				break;
+			}
+
+			extra = MEM_callocN(sizeof(PTCacheExtra), "Pointcache extradata");
+			extra->type = type;
+			extra->totdata = totdata;
+			extra->data = MEM_mallocN(len, "Pointcache extradata->data");
+			memcpy(extra->data, extra_data + pos, len);
+			BLI_addtail(&pm->extradata, extra);
+
+			pos += len;
+		}
+
+		MEM_freeN(extra_data);
+	}
+
+	if (error) {
+		ptcache_data_free(pm);
+		ptcache_extra_free(pm);
+		MEM_freeN(pm);
+
+		if (G.debug & G_DEBUG)
+			printf("Error reading from disk cache archive\n");
+
+		return NULL;
+	}
+
+	return pm;
+}
+
+static PTCacheMem *ptcache_archive_disk_frame_to_mem(PTCacheID *pid, int cfra)
+{
+	PTCacheArchive *archive = ptcache_archive_get(pid, PTCACHE_FILE_READ);
+	PTCacheArchiveFrame *frame;
+	PTCacheMem *pm = NULL;
+
+	if (archive == NULL)
+		return NULL;
+
+	frame = ptcache_archive_frame_find(archive, cfra);
+	if (frame)
+		pm = ptcache_archive_frame_to_mem(archive, frame, ~0u, true);
+
+	return pm;
+}
+
+static bool ptcache_archive_frame_exists(PTCacheID *pid, int cfra)
+{
+	PTCacheArchive *archive = ptcache_archive_get(pid, PTCACHE_FILE_READ);
+
+	return (archive && ptcache_archive_frame_find(archive, cfra) != NULL);
+}
+
+/* same modes as BKE_ptcache_id_clear */
+static void ptcache_archive_clear(PTCacheID *pid, int mode, int cfra)
+{
+	PointCache *cache = pid->cache;
+	PTCacheArchive *archive;
+	int sta = cache->startframe, end = cache->endframe;
+	int i, totframe = 0;
+	bool error = false;
+
+	if (mode == PTCACHE_CLEAR_ALL) {
+		char filename[MAX_PTCACHE_FILE];
+
+		ptcache_archive_release(cache, false);
+		ptcache_archive_filename(pid, filename);
+
+		if (BLI_exists(filename)) {
+			cache->last_exact = MIN2(cache->startframe, 0);
+			BLI_delete(filename, false, false);
+		}
+
+		if (cache->cached_frames)
+			memset(cache->cached_frames, 0, MEM_allocN_len(cache->cached_frames));
+
+		return;
+	}
+
+	archive = ptcache_archive_get(pid, PTCACHE_FILE_WRITE);
+
+	if (archive == NULL)
+		return;
+
+	for (i = 0; i < archive->totframe; i++) {
+		int frame = archive->frames[i].frame;
+
+		if (((mode == PTCACHE_CLEAR_FRAME && frame == cfra) ||
+		     (mode == PTCACHE_CLEAR_BEFORE && frame < cfra) ||
+		     (mode == PTCACHE_CLEAR_AFTER && frame > cfra)) &&
+		    !error)
+		{
+			/* a frame is only dropped from the index once it's cleared in the file too */
+			if (ptcache_archive_frame_clear_write(archive, frame)) {
+				if (cache->cached_frames && frame >= sta && frame <= end)
+					cache->cached_frames[frame - sta] = 0;
+
+				archive->dead_len += ptcache_archive_frame_len(&archive->frames[i]);
+				continue;
+			}
+
+			error = true;
+			printf("Error clearing frames of point cache archive %s\n", archive->filename);
+		}
+
+		archive->frames[totframe++] = archive->frames[i];
+	}
+
+	/* reclaim the space of the cleared frames by rewriting the file, when that
+	 * fails they are still cleared by their entries in the file */
+	if (totframe != archive->totframe) {
+		archive->totframe = totframe;
+		ptcache_archive_release(cache, true);
+	}
+}
+
 static PTCacheMem *ptcache_disk_frame_to_mem(PTCacheID *pid, int cfra)
 {
-	PTCacheFile *pf = ptcache_file_open(pid, PTCACHE_FILE_READ, cfra);
+	PTCacheFile *pf;
 	PTCacheMem *pm = NULL;
 	unsigned int i, error = 0;
 
+	if (ptcache_use_archive(pid))
+		return ptcache_archive_disk_frame_to_mem(pid, cfra);
+
+	pf = ptcache_file_open(pid, PTCACHE_FILE_READ, cfra);
+
 	if (pf == NULL)
 		return NULL;
 
@@ -2029,6 +3002,9 @@ static int ptcache_mem_frame_to_disk(PTCacheID *pid, PTCacheMem *pm)
 {
 	PTCacheFile *pf = NULL;
 	unsigned int i, error = 0;
+
+	if (ptcache_use_archive(pid))
+		return ptcache_archive_mem_frame_write(pid, pm);
 	
 	BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_FRAME, pm->frame);
 
@@ -2344,8 +3320,10 @@ static int ptcache_write_stream(PTCacheID *pid, int cfra, int totpoint)
 {
 	PTCacheFile *pf = NULL;
 	int error = 0;
-	
-	BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_FRAME, cfra);
+
+	/* frames in an archive are replaced when written */
+	if (!ptcache_use_archive(pid))
+		BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_FRAME, cfra);
 
 	pf = ptcache_file_open(pid, PTCACHE_FILE_WRITE, cfra);
 
@@ -2366,6 +3344,9 @@ static int ptcache_write_stream(PTCacheID *pid, int cfra, int totpoint)
 	if (!error && pid->write_stream)
 		pid->write_stream(pf, pid->calldata);
 
+	if (!error && pf->fp == NULL)
+		error = !ptcache_archive_file_write(pid, pf);
+
 	ptcache_file_close(pf);
 
 	if (error && G.debug & G_DEBUG)
@@ -2568,7 +3549,10 @@ void BKE_ptcache_id_clear(PTCacheID *pid, int mode, unsigned int cfra)
 	case PTCACHE_CLEAR_ALL:
 	case PTCACHE_CLEAR_BEFORE:
 	case PTCACHE_CLEAR_AFTER:
-		if (pid->cache->flag & PTCACHE_DISK_CACHE) {
+		if ((pid->cache->flag & PTCACHE_DISK_CACHE) && ptcache_use_archive(pid)) {
+			ptcache_archive_clear(pid, mode, cfra);
+		}
+		else if (pid->cache->flag & PTCACHE_DISK_CACHE) {
 			ptcache_path(pid, path);
 			
 			len = ptcache_filename(pid, filename, cfra, 0, 0); /* no path */
@@ -2652,7 +3636,11 @@ void BKE_ptcache_id_clear(PTCacheID *pid, int mode, unsigned int cfra)
 		break;
 		
 	case PTCACHE_CLEAR_FRAME:
-		if (pid->cache->flag & PTCACHE_DISK_CACHE) {
+		if ((pid->cache->flag & PTCACHE_DISK_CACHE) && ptcache_use_archive(pid)) {
+			if (BKE_ptcache_id_exist(pid, cfra))
+				ptcache_archive_clear(pid, mode, cfra);
+		}
+		else if (pid->cache->flag & PTCACHE_DISK_CACHE) {
 			if (BKE_ptcache_id_exist(pid, cfra)) {
 				ptcache_filename(pid, filename, cfra, 1, 1); /* no path */
 				BLI_delete(filename, false, false);
@@ -2688,7 +3676,14 @@ int  BKE_ptcache_id_exist(PTCacheID *pid, int cfra)
 	if (pid->cache->cached_frames &&	pid->cache->cached_frames[cfra-pid->cache->startframe]==0)
 		return 0;
 	
-	if (pid->cache->flag & PTCACHE_DISK_CACHE) {
+	if ((pid->cache->flag & PTCACHE_DISK_CACHE) && ptcache_use_archive(pid)) {
+		/* cached_frames is filled from the archive index, avoids reading it for every frame */
+		if (pid->cache->cached_frames)
+			return 1;
+
+		return ptcache_archive_frame_exists(pid, cfra);
+	}
+	else if (pid->cache->flag & PTCACHE_DISK_CACHE) {
 		char filename[MAX_PTCACHE_FILE];
 		
 		ptcache_filename(pid, filename, cfra, 1, 1);
@@ -2766,7 +3761,20 @@ void BKE_ptcache_id_time(PTCacheID *pid, Scene *scene, float cfra, int *startfra
 
 		cache->cached_frames = MEM_callocN(sizeof(char) * (cache->endframe-cache->startframe+1), "cached frames array");
 
-		if (pid->cache->flag & PTCACHE_DISK_CACHE) {
+		if ((pid->cache->flag & PTCACHE_DISK_CACHE) && ptcache_use_archive(pid)) {
+			PTCacheArchive *archive = ptcache_archive_get(pid, PTCACHE_FILE_READ);
+			int i;
+
+			if (archive) {
+				for (i = 0; i < archive->totframe; i++) {
+					unsigned int frame = archive->frames[i].frame;
+
+					if (frame >= sta && frame <= end)
+						cache->cached_frames[frame-sta] = 1;
+				}
+			}
+		}
+		else if (pid->cache->flag & PTCACHE_DISK_CACHE) {
 			/* mode is same as fopen's modes */
 			DIR *dir; 
 			struct dirent *de;
@@ -3023,6 +4031,7 @@ void BKE_ptcache_free_mem(ListBase *mem_cache)
 }
 void BKE_ptcache_free(PointCache *cache)
 {
+	ptcache_archive_release(cache, false);
 	BKE_ptcache_free_mem(&cache->mem_cache);
 	if (cache->edit && cache->free_edit)
 		cache->free_edit(cache->edit);
@@ -3046,12 +4055,13 @@ static PointCache *ptcache_copy(PointCache *cache, bool copy_data)
 	ncache= MEM_dupallocN(cache);
 
 	BLI_listbase_clear(&ncache->mem_cache);
+	ncache->archive = NULL;
 
 	if (copy_data == false) {
 		ncache->cached_frames = NULL;
 
 		/* flag is a mix of user settings and simulator/baking state */
-		ncache->flag= ncache->flag & (PTCACHE_DISK_CACHE|PTCACHE_EXTERNAL|PTCACHE_IGNORE_LIBPATH);
+		ncache->flag= ncache->flag & (PTCACHE_DISK_CACHE|PTCACHE_EXTERNAL|PTCACHE_IGNORE_LIBPATH|PTCACHE_DISK_ARCHIVE);
 		ncache->simframe= 0;
 	}
 	else {
@@ -3128,6 +4138,7 @@ typedef struct {
 	int *cfra_ptr;
 	Main *main;
 	Scene *scene;
+	EvaluationContext *eval_ctx;
 } ptcache_bake_data;
 
 static void ptcache_dt_to_str(char *str, double dtime)
@@ -3156,7 +4167,7 @@ static void *ptcache_bake_thread(void *ptr)
 	efra = data->endframe;
 
 	for (; (*data->cfra_ptr <= data->endframe) && !data->break_operation; *data->cfra_ptr+=data->step) {
-		BKE_scene_update_for_newframe(G.main->eval_ctx, data->main, data->scene, data->scene->lay);
+		BKE_scene_update_for_newframe(data->eval_ctx, data->main, data->scene, data->scene->lay);
 		if (G.background) {
 			printf("bake: frame %d :: %d\n", (int)*data->cfra_ptr, data->endframe);
 		}
@@ -3205,6 +4216,8 @@ void BKE_ptcache_bake(PTCacheBaker *baker)
 	int render = baker->render;
 	ListBase threads;
 	ptcache_bake_data thread_data;
+	EvaluationContext eval_ctx = *bmain->eval_ctx;
+	GSet *bake_objects = BLI_gset_ptr_new(__func__);
 	int progress, old_progress;
 	
 	thread_data.endframe = baker->anim_init ? scene->r.sfra : CFRA;
@@ -3212,6 +4225,7 @@ void BKE_ptcache_bake(PTCacheBaker *baker)
 	thread_data.cfra_ptr = &CFRA;
 	thread_data.scene = baker->scene;
 	thread_data.main = baker->main;
+	thread_data.eval_ctx = &eval_ctx;
 
 	G.is_break = false;
 
@@ -3255,6 +4269,7 @@ void BKE_ptcache_bake(PTCacheBaker *baker)
 			if (bake) {
 				thread_data.endframe = cache->endframe;
 				cache->flag |= PTCACHE_BAKING;
+				BLI_gset_add(bake_objects, pid->ob);
 			}
 			else {
 				thread_data.endframe = MIN2(thread_data.endframe, cache->endframe);
@@ -3291,8 +4306,10 @@ void BKE_ptcache_bake(PTCacheBaker *baker)
 					if (bake || render) {
 						cache->flag |= PTCACHE_BAKING;
 
-						if (bake)
+						if (bake) {
 							thread_data.endframe = MAX2(thread_data.endframe, cache->endframe);
+							BLI_gset_add(bake_objects, base->object);
+						}
 					}
 
 					cache->flag &= ~PTCACHE_BAKED;
@@ -3303,6 +4320,15 @@ void BKE_ptcache_bake(PTCacheBaker *baker)
 		}
 	}
 
+	/* When baking only the simulations and what they depend on are updated for every frame,
+	 * the depsgraph steps independent simulations in parallel. The whole scene is updated
+	 * once the bake is done. */
+	if (bake && BLI_gset_size(bake_objects)) {
+		DAG_scene_relations_update(bmain, scene);
+		DAG_scene_objects_add_ancestors(scene, bake_objects);
+		eval_ctx.objects = bake_objects;
+	}
+
 	CFRA = startframe;
 	scene->r.framelen = 1.0;
 	thread_data.break_operation = false;
@@ -3355,6 +4381,7 @@ void BKE_ptcache_bake(PTCacheBaker *baker)
 			if (cache->flag & PTCACHE_DISK_CACHE)
 				BKE_ptcache_write(pid, 0);
 		}
+		ptcache_archive_release(cache, true);
 	}
 	else {
 		for (SETLOOPER(scene, sce_iter, base)) {
@@ -3379,11 +4406,14 @@ void BKE_ptcache_bake(PTCacheBaker *baker)
 					if (cache->flag & PTCACHE_DISK_CACHE)
 						BKE_ptcache_write(pid, 0);
 				}
+				ptcache_archive_release(cache, true);
 			}
 			BLI_freelistN(&pidlist);
 		}
 	}
 
+	BLI_gset_free(bake_objects, NULL);
+
 	scene->r.framelen = frameleno;
 	CFRA = cfrao;
 	
@@ -3402,6 +4432,10 @@ void BKE_ptcache_bake(PTCacheBaker *baker)
 }
 /* Helpers */
 void BKE_ptcache_disk_to_mem(PTCacheID *pid)
+{
+	BKE_ptcache_disk_to_mem_ex(pid, ~0u);
+}
+void BKE_ptcache_disk_to_mem_ex(PTCacheID *pid, unsigned int data_types)
 {
 	PointCache *cache = pid->cache;
 	PTCacheMem *pm = NULL;
@@ -3417,6 +4451,30 @@ void BKE_ptcache_disk_to_mem(PTCacheID *pid)
 	/* restore possible bake flag */
 	cache->flag |= baked;
 
+	if (ptcache_use_archive(pid)) {
+		/* open the archive only once and decompress only the requested channels */
+		PTCacheArchive *archive = ptcache_archive_get(pid, PTCACHE_FILE_READ);
+		bool read_extra = (data_types & pid->data_types) == pid->data_types;
+		int i;
+
+		if (archive == NULL)
+			return;
+
+		for (i = 0; i < archive->totframe; i++) {
+			const PTCacheArchiveFrame *frame = &archive->frames[i];
+
+			if (frame->frame < sfra || frame->frame > efra)
+				continue;
+
+			pm = ptcache_archive_frame_to_mem(archive, frame, data_types, read_extra);
+
+			if (pm)
+				BLI_addtail(&pid->cache->mem_cache, pm);
+		}
+
+		return;
+	}
+
 	for (cfra=sfra; cfra <= efra; cfra++) {
 		pm = ptcache_disk_frame_to_mem(pid, cfra);
 
@@ -3490,6 +4548,24 @@ void BKE_ptcache_toggle_disk_cache(PTCacheID *pid)
 	}
 }
 
+void BKE_ptcache_toggle_disk_archive(PTCacheID *pid)
+{
+	PointCache *cache = pid->cache;
+
+	/* the disk cache is written again in the new format */
+	if (cache->flag & PTCACHE_DISK_CACHE) {
+		cache->flag ^= PTCACHE_DISK_ARCHIVE;
+		BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_ALL, 0);
+		cache->flag ^= PTCACHE_DISK_ARCHIVE;
+	}
+
+	cache->flag |= PTCACHE_OUTDATED;
+
+	BKE_ptcache_id_time(pid, NULL, 0.0f, NULL, NULL, NULL);
+
+	BKE_ptcache_update_info(pid);
+}
+
 void BKE_ptcache_disk_cache_rename(PTCacheID *pid, const char *name_src, const char *name_dst)
 {
 	char old_name[80];
@@ -3509,6 +4585,20 @@ void BKE_ptcache_disk_cache_rename(PTCacheID *pid, const char *name_src, const c
 	/* get "from" filename */
 	BLI_strncpy(pid->cache->name, name_src, sizeof(pid->cache->name));
 
+	if (ptcache_use_archive(pid)) {
+		/* all frames are in one file */
+		ptcache_archive_release(pid->cache, false);
+		ptcache_archive_filename(pid, old_path_full);
+		BLI_strncpy(pid->cache->name, name_dst, sizeof(pid->cache->name));
+		ptcache_archive_filename(pid, new_path_full);
+
+		if (BLI_exists(old_path_full))
+			BLI_rename(old_path_full, new_path_full);
+
+		BLI_strncpy(pid->cache->name, old_name, sizeof(pid->cache->name));
+		return;
+	}
+
 	len = ptcache_filename(pid, old_filename, 0, 0, 0); /* no path */
 
 	ptcache_path(pid, path);
@@ -54,6 +54,7 @@
 #include "BLI_blenlib.h"
 #include "BLI_utildefines.h"
 #include "BLI_callbacks.h"
+#include "BLI_ghash.h"
 #include "BLI_string.h"
 #include "BLI_threads.h"
 #include "BLI_task.h"
@@ -1347,6 +1348,12 @@ typedef struct ThreadedObjectUpdateState {
 
 static void scene_update_object_add_task(void *node, void *user_data);
 
+/* objects of set scenes are always updated, eval_ctx->objects only holds objects of the scene itself */
+static bool scene_update_object_needed(EvaluationContext *eval_ctx, Scene *scene, Scene *scene_parent, Object *object)
+{
+	return (eval_ctx->objects == NULL || scene != scene_parent || BLI_gset_haskey(eval_ctx->objects, object));
+}
+
 static void scene_update_all_bases(EvaluationContext *eval_ctx, Scene *scene, Scene *scene_parent)
 {
 	Base *base;
@@ -1354,6 +1361,9 @@ static void scene_update_all_bases(EvaluationContext *eval_ctx, Scene *scene, Sc
 	for (base = scene->base.first; base; base = base->next) {
 		Object *object = base->object;
 
+		if (!scene_update_object_needed(eval_ctx, scene, scene_parent, object))
+			continue;
+
 		BKE_object_handle_update_ex(eval_ctx, scene_parent, object, scene->rigidbody_world, true);
 
 		if (object->dup_group && (object->transflag & OB_DUPLIGROUP))
@@ -1378,6 +1388,11 @@ static void scene_update_object_func(TaskPool *pool, void *taskdata, int threadi
 	Scene *scene = state->scene;
 	Scene *scene_parent = state->scene_parent;
 
+	/* skipped objects keep their recalc flags, the node is still handled for its children */
+	if (object && !scene_update_object_needed(eval_ctx, scene, scene_parent, object)) {
+		object = NULL;
+	}
+
 #ifdef MBALL_SINGLETHREAD_HACK
 	if (object && object->type == OB_MBALL) {
 		state->has_mballs = true;
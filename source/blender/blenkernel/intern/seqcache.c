@@ -39,6 +39,7 @@
 #include "IMB_imbuf_types.h"
 
 #include "BLI_listbase.h"
+#include "BLI_threads.h"
 
 #include "BKE_sequencer.h"
 
@@ -67,6 +68,10 @@ typedef struct SeqPreprocessCache {
 static struct MovieCache *moviecache = NULL;
 static struct SeqPreprocessCache *preprocess_cache = NULL;
 
+/* strips are rendered from multiple threads, see seq_render_strip_stack and the prefetch job */
+static ThreadMutex cache_lock = BLI_MUTEX_INITIALIZER;
+
+static void preprocessed_cache_cleanup(void);
 static void preprocessed_cache_destruct(void);
 
 static bool seq_cmp_render_data(const SeqRenderData *a, const SeqRenderData *b)
@@ -118,6 +123,8 @@ static bool seqcache_hashcmp(const void *a_, const void *b_)
 
 void BKE_sequencer_cache_destruct(void)
 {
+	BKE_sequencer_prefetch_stop();
+
 	if (moviecache)
 		IMB_moviecache_free(moviecache);
 
@@ -126,12 +133,18 @@ void BKE_sequencer_cache_destruct(void)
 
 void BKE_sequencer_cache_cleanup(void)
 {
+	BKE_sequencer_prefetch_stop();
+
+	BLI_mutex_lock(&cache_lock);
+
 	if (moviecache) {
 		IMB_moviecache_free(moviecache);
 		moviecache = IMB_moviecache_create("seqcache", sizeof(SeqCacheKey), seqcache_hashhash, seqcache_hashcmp);
 	}
 
-	BKE_sequencer_preprocessed_cache_cleanup();
+	preprocessed_cache_cleanup();
+
+	BLI_mutex_unlock(&cache_lock);
 }
 
 static bool seqcache_key_check_seq(ImBuf *UNUSED(ibuf), void *userkey, void *userdata)
@@ -144,12 +157,20 @@ static bool seqcache_key_check_seq(ImBuf *UNUSED(ibuf), void *userkey, void *use
 
 void BKE_sequencer_cache_cleanup_sequence(Sequence *seq)
 {
+	BKE_sequencer_prefetch_stop();
+
+	BLI_mutex_lock(&cache_lock);
 	if (moviecache)
 		IMB_moviecache_cleanup(moviecache, seqcache_key_check_seq, seq);
+	BLI_mutex_unlock(&cache_lock);
 }
 
 struct ImBuf *BKE_sequencer_cache_get(const SeqRenderData *context, Sequence *seq, float cfra, seq_stripelem_ibuf_t type)
 {
+	ImBuf *ibuf = NULL;
+
+	BLI_mutex_lock(&cache_lock);
+
 	if (moviecache && seq) {
 		SeqCacheKey key;
 
@@ -158,10 +179,12 @@ struct ImBuf *BKE_sequencer_cache_get(const SeqRenderData *context, Sequence *se
 		key.cfra = cfra - seq->start;
 		key.type = type;
 
-		return IMB_moviecache_get(moviecache, &key);
+		ibuf = IMB_moviecache_get(moviecache, &key);
 	}
 
-	return NULL;
+	BLI_mutex_unlock(&cache_lock);
+
+	return ibuf;
 }
 
 void BKE_sequencer_cache_put(const SeqRenderData *context, Sequence *seq, float cfra, seq_stripelem_ibuf_t type, ImBuf *i)
@@ -172,6 +195,8 @@ void BKE_sequencer_cache_put(const SeqRenderData *context, Sequence *seq, float
 		return;
 	}
 
+	BLI_mutex_lock(&cache_lock);
+
 	if (!moviecache) {
 		moviecache = IMB_moviecache_create("seqcache", sizeof(SeqCacheKey), seqcache_hashhash, seqcache_hashcmp);
 	}
@@ -182,9 +207,18 @@ void BKE_sequencer_cache_put(const SeqRenderData *context, Sequence *seq, float
 	key.type = type;
 
 	IMB_moviecache_put(moviecache, &key, i);
+
+	BLI_mutex_unlock(&cache_lock);
 }
 
 void BKE_sequencer_preprocessed_cache_cleanup(void)
+{
+	BLI_mutex_lock(&cache_lock);
+	preprocessed_cache_cleanup();
+	BLI_mutex_unlock(&cache_lock);
+}
+
+static void preprocessed_cache_cleanup(void)
 {
 	SeqPreprocessCacheElem *elem;
 
@@ -204,7 +238,7 @@ static void preprocessed_cache_destruct(void)
 	if (!preprocess_cache)
 		return;
 
-	BKE_sequencer_preprocessed_cache_cleanup();
+	preprocessed_cache_cleanup();
 
 	MEM_freeN(preprocess_cache);
 	preprocess_cache = NULL;
@@ -213,40 +247,44 @@ static void preprocessed_cache_destruct(void)
 ImBuf *BKE_sequencer_preprocessed_cache_get(const SeqRenderData *context, Sequence *seq, float cfra, seq_stripelem_ibuf_t type)
 {
 	SeqPreprocessCacheElem *elem;
+	ImBuf *ibuf = NULL;
 
-	if (!preprocess_cache)
-		return NULL;
-
-	if (preprocess_cache->cfra != cfra)
-		return NULL;
+	BLI_mutex_lock(&cache_lock);
 
-	for (elem = preprocess_cache->elems.first; elem; elem = elem->next) {
-		if (elem->seq != seq)
-			continue;
+	if (preprocess_cache && preprocess_cache->cfra == cfra) {
+		for (elem = preprocess_cache->elems.first; elem; elem = elem->next) {
+			if (elem->seq != seq)
+				continue;
 
-		if (elem->type != type)
-			continue;
+			if (elem->type != type)
+				continue;
 
-		if (seq_cmp_render_data(&elem->context, context) != 0)
-			continue;
+			if (seq_cmp_render_data(&elem->context, context) != 0)
+				continue;
 
-		IMB_refImBuf(elem->ibuf);
-		return elem->ibuf;
+			IMB_refImBuf(elem->ibuf);
+			ibuf = elem->ibuf;
+			break;
+		}
 	}
 
-	return NULL;
+	BLI_mutex_unlock(&cache_lock);
+
+	return ibuf;
 }
 
 void BKE_sequencer_preprocessed_cache_put(const SeqRenderData *context, Sequence *seq, float cfra, seq_stripelem_ibuf_t type, ImBuf *ibuf)
 {
 	SeqPreprocessCacheElem *elem;
 
+	BLI_mutex_lock(&cache_lock);
+
 	if (!preprocess_cache) {
 		preprocess_cache = MEM_callocN(sizeof(SeqPreprocessCache), "sequencer preprocessed cache");
 	}
 	else {
 		if (preprocess_cache->cfra != cfra)
-			BKE_sequencer_preprocessed_cache_cleanup();
+			preprocessed_cache_cleanup();
 	}
 
 	elem = MEM_callocN(sizeof(SeqPreprocessCacheElem), "sequencer preprocessed cache element");
@@ -261,6 +299,8 @@ void BKE_sequencer_preprocessed_cache_put(const SeqRenderData *context, Sequence
 	IMB_refImBuf(ibuf);
 
 	BLI_addtail(&preprocess_cache->elems, elem);
+
+	BLI_mutex_unlock(&cache_lock);
 }
 
 void BKE_sequencer_preprocessed_cache_cleanup_sequence(Sequence *seq)
@@ -270,6 +310,8 @@ void BKE_sequencer_preprocessed_cache_cleanup_sequence(Sequence *seq)
 	if (!preprocess_cache)
 		return;
 
+	BLI_mutex_lock(&cache_lock);
+
 	for (elem = preprocess_cache->elems.first; elem; elem = elem_next) {
 		elem_next = elem->next;
 
@@ -279,4 +321,6 @@ void BKE_sequencer_preprocessed_cache_cleanup_sequence(Sequence *seq)
 			BLI_freelinkN(&preprocess_cache->elems, elem);
 		}
 	}
+
+	BLI_mutex_unlock(&cache_lock);
 }
@@ -43,6 +43,7 @@
 
 #include "DNA_sequence_types.h"
 
+#include "BKE_animsys.h"
 #include "BKE_colortools.h"
 #include "BKE_sequencer.h"
 
@@ -629,6 +630,9 @@ void BKE_sequence_modifier_free(SequenceModifierData *smd)
 {
 	SequenceModifierTypeInfo *smti = BKE_sequence_modifier_type_info_get(smd->type);
 
+	/* animation may have resolved paths to the modifier settings */
+	BKE_animsys_eval_plans_invalidate();
+
 	if (smti && smti->free_data) {
 		smti->free_data(smd);
 	}
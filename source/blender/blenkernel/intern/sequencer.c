@@ -50,6 +50,7 @@
 #include "BLI_path_util.h"
 #include "BLI_string.h"
 #include "BLI_string_utf8.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
@@ -71,6 +72,8 @@
 
 #include "RE_pipeline.h"
 
+#include "PIL_time.h"
+
 #include <pthread.h>
 
 #include "IMB_imbuf.h"
@@ -177,6 +180,12 @@ static void seq_free_strip(Strip *strip)
 /* only give option to skip cache locally (static func) */
 static void BKE_sequence_free_ex(Scene *scene, Sequence *seq, const bool do_cache)
 {
+	/* the prefetch job could be rendering this strip */
+	BKE_sequencer_prefetch_stop();
+
+	/* animation may have resolved paths to the strip */
+	BKE_animsys_eval_plans_invalidate();
+
 	if (seq->strip)
 		seq_free_strip(seq->strip);
 
@@ -2953,6 +2962,85 @@ static ImBuf *seq_render_strip_stack_apply_effect(const SeqRenderData *context,
 	return out;
 }
 
+typedef struct RenderStripsData {
+	const SeqRenderData *context;
+	Sequence **seq_arr;
+	float cfra;
+} RenderStripsData;
+
+static void seq_render_strips_task(void *userdata, int i)
+{
+	RenderStripsData *data = (RenderStripsData *)userdata;
+	ImBuf *ibuf = seq_render_strip(data->context, data->seq_arr[i], data->cfra);
+
+	IMB_freeImBuf(ibuf);
+}
+
+/* strips that don't render other strips or evaluate other data, so they can be rendered in parallel */
+static bool seq_render_strip_is_independent(Sequence *seq)
+{
+	SequenceModifierData *smd;
+
+	if (!ELEM(seq->type, SEQ_TYPE_IMAGE, SEQ_TYPE_MOVIE))
+		return false;
+
+	/* opening movies isn't thread safe, this is left to the first frame rendered */
+	if (seq->type == SEQ_TYPE_MOVIE && seq->anim == NULL)
+		return false;
+	if (seq->strip->proxy && seq->strip->proxy->anim == NULL && seq->type == SEQ_TYPE_MOVIE)
+		return false;
+
+	for (smd = seq->modifiers.first; smd; smd = smd->next) {
+		if (smd->mask_sequence || smd->mask_id)
+			return false;
+	}
+
+	return true;
+}
+
+/* Loading and decoding the image and movie strips of a stack takes most of the
+ * time, and they don't depend on each other. Render them into the cache on
+ * worker threads, blending the stack afterwards then finds them there. */
+static void seq_render_strip_stack_inputs_threaded(const SeqRenderData *context, Sequence **seq_arr, int count, float cfra)
+{
+	Sequence *inputs[MAXSEQ + 1];
+	int num_inputs = 0;
+	int i;
+
+	if (context->skip_cache)
+		return;
+
+	/* same strips as rendered by seq_render_strip_stack */
+	for (i = count - 1; i >= 0; i--) {
+		Sequence *seq = seq_arr[i];
+		ImBuf *ibuf = BKE_sequencer_cache_get(context, seq, cfra, SEQ_STRIPELEM_IBUF_COMP);
+
+		if (ibuf) {
+			IMB_freeImBuf(ibuf);
+			break;
+		}
+
+		if (seq_render_strip_is_independent(seq) &&
+		    (seq->blend_mode == SEQ_BLEND_REPLACE || seq_get_early_out_for_blend_mode(seq) != EARLY_USE_INPUT_1))
+		{
+			inputs[num_inputs++] = seq;
+		}
+
+		if (seq->blend_mode == SEQ_BLEND_REPLACE)
+			break;
+	}
+
+	if (num_inputs > 1) {
+		RenderStripsData data;
+
+		data.context = context;
+		data.seq_arr = inputs;
+		data.cfra = cfra;
+
+		BLI_task_parallel_range_ex(0, num_inputs, &data, seq_render_strips_task, 2, false);
+	}
+}
+
 static ImBuf *seq_render_strip_stack(const SeqRenderData *context, ListBase *seqbasep, float cfra, int chanshown)
 {
 	Sequence *seq_arr[MAXSEQ + 1];
@@ -2979,6 +3067,8 @@ static ImBuf *seq_render_strip_stack(const SeqRenderData *context, ListBase *seq
 	if (out) {
 		return out;
 	}
+
+	seq_render_strip_stack_inputs_threaded(context, seq_arr, count, cfra);
 	
 	if (count == 1) {
 		Sequence *seq = seq_arr[0];
@@ -3092,6 +3182,17 @@ static ImBuf *seq_render_strip_stack(const SeqRenderData *context, ListBase *seq
 	return out;
 }
 
+static ListBase *seq_render_seqbase_get(Editing *ed, int chanshown)
+{
+	if ((chanshown < 0) && !BLI_listbase_is_empty(&ed->metastack)) {
+		int count = BLI_listbase_count(&ed->metastack);
+		count = max_ii(count + chanshown, 0);
+		return ((MetaStack *)BLI_findlink(&ed->metastack, count))->oldbasep;
+	}
+
+	return ed->seqbasep;
+}
+
 /*
  * returned ImBuf is refed!
  * you have to free after usage!
@@ -3100,20 +3201,12 @@ static ImBuf *seq_render_strip_stack(const SeqRenderData *context, ListBase *seq
 ImBuf *BKE_sequencer_give_ibuf(const SeqRenderData *context, float cfra, int chanshown)
 {
 	Editing *ed = BKE_sequencer_editing_get(context->scene, false);
-	ListBase *seqbasep;
 	
 	if (ed == NULL) return NULL;
 
-	if ((chanshown < 0) && !BLI_listbase_is_empty(&ed->metastack)) {
-		int count = BLI_listbase_count(&ed->metastack);
-		count = max_ii(count + chanshown, 0);
-		seqbasep = ((MetaStack *)BLI_findlink(&ed->metastack, count))->oldbasep;
-	}
-	else {
-		seqbasep = ed->seqbasep;
-	}
+	BKE_sequencer_prefetch_stop();
 
-	return seq_render_strip_stack(context, seqbasep, cfra, chanshown);
+	return seq_render_strip_stack(context, seq_render_seqbase_get(ed, chanshown), cfra, chanshown);
 }
 
 ImBuf *BKE_sequencer_give_ibuf_seqbase(const SeqRenderData *context, float cfra, int chanshown, ListBase *seqbasep)
@@ -3124,159 +3217,338 @@ ImBuf *BKE_sequencer_give_ibuf_seqbase(const SeqRenderData *context, float cfra,
 
 ImBuf *BKE_sequencer_give_ibuf_direct(const SeqRenderData *context, float cfra, Sequence *seq)
 {
+	BKE_sequencer_prefetch_stop();
+
 	return seq_render_strip(context, seq, cfra);
 }
 
-/* *********************** threading api ******************* */
+/* *********************** prefetch ******************* */
 
-static ListBase running_threads;
-static ListBase prefetch_wait;
-static ListBase prefetch_done;
+/* During playback frames ahead of the playhead are rendered into the cache by
+ * a worker thread. Strips are not safe to render from multiple threads at once,
+ * so one frame is rendered at a time, either by the prefetch job or by the
+ * caller of BKE_sequencer_give_ibuf_threaded. The job only runs during playback
+ * and is stopped before strips are changed or freed. */
 
-static pthread_mutex_t queue_lock          = PTHREAD_MUTEX_INITIALIZER;
-static pthread_mutex_t wakeup_lock         = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t wakeup_cond          = PTHREAD_COND_INITIALIZER;
+typedef struct SeqPrefetchJob {
+	ListBase threads;
+	pthread_t thread;       /* set by the job thread when it starts */
+	bool running;
+	bool thread_started;
+	bool stop;
+	bool caller_rendering;  /* render_lock is held by BKE_sequencer_give_ibuf_threaded */
 
-//static pthread_mutex_t prefetch_ready_lock = PTHREAD_MUTEX_INITIALIZER;
-//static pthread_cond_t  prefetch_ready_cond = PTHREAD_COND_INITIALIZER;
+	SeqRenderData context;
+	int chanshown;
 
-static pthread_mutex_t frame_done_lock     = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t frame_done_cond      = PTHREAD_COND_INITIALIZER;
+	int cfra;        /* playhead */
+	int next_cfra;   /* next frame to render */
+	int num_frames;  /* frames to render ahead of the playhead */
+} SeqPrefetchJob;
 
-static volatile bool seq_thread_shutdown = true; 
-static volatile int seq_last_given_monoton_cfra = 0;
-static int monoton_cfra = 0;
+static SeqPrefetchJob prefetch_job;
+static SeqPrefetchStats prefetch_stats;
 
-typedef struct PrefetchThread {
-	struct PrefetchThread *next, *prev;
-	
-	Scene *scene;
-	struct PrefetchQueueElem *current;
-	pthread_t pthread;
-	int running;
-	
-} PrefetchThread;
+/* guards prefetch_job and prefetch_stats */
+static ThreadMutex prefetch_lock = BLI_MUTEX_INITIALIZER;
+static ThreadCondition prefetch_cond = PTHREAD_COND_INITIALIZER;
+/* serializes starting and stopping the job */
+static ThreadMutex prefetch_control_lock = BLI_MUTEX_INITIALIZER;
+/* held while a frame is rendered, taken before prefetch_lock */
+static ThreadMutex render_lock = BLI_MUTEX_INITIALIZER;
 
-typedef struct PrefetchQueueElem {
-	struct PrefetchQueueElem *next, *prev;
-	
-	int rectx;
-	int recty;
-	float cfra;
-	int chanshown;
-	int preview_render_size;
+static bool seq_render_strip_stack_is_cached(const SeqRenderData *context, ListBase *seqbasep, float cfra, int chanshown)
+{
+	Sequence *seq_arr[MAXSEQ + 1];
+	int count = get_shown_sequences(seqbasep, cfra, chanshown, (Sequence **)&seq_arr);
+	ImBuf *ibuf;
 
-	int monoton_cfra;
+	if (count == 0)
+		return true;
 
-	ImBuf *ibuf;
-} PrefetchQueueElem;
+	ibuf = BKE_sequencer_cache_get(context, seq_arr[count - 1], cfra, SEQ_STRIPELEM_IBUF_COMP);
+
+	if (ibuf) {
+		IMB_freeImBuf(ibuf);
+		return true;
+	}
 
-void BKE_sequencer_give_ibuf_prefetch_request(const SeqRenderData *context, float cfra, int chanshown)
+	return false;
+}
+
+static bool seq_prefetch_seqbase_supported(ListBase *seqbase)
 {
-	PrefetchQueueElem *e;
-	if (seq_thread_shutdown) {
-		return;
+	Sequence *seq;
+
+	for (seq = seqbase->first; seq; seq = seq->next) {
+		/* these evaluate other data at the frame they render */
+		if (ELEM(seq->type, SEQ_TYPE_SCENE, SEQ_TYPE_MASK))
+			return false;
+
+		if (!seq_prefetch_seqbase_supported(&seq->seqbase))
+			return false;
 	}
 
-	e = MEM_callocN(sizeof(PrefetchQueueElem), "prefetch_queue_elem");
-	e->rectx = context->rectx;
-	e->recty = context->recty;
-	e->cfra = cfra;
-	e->chanshown = chanshown;
-	e->preview_render_size = context->preview_render_size;
-	e->monoton_cfra = monoton_cfra++;
+	return true;
+}
 
-	pthread_mutex_lock(&queue_lock);
-	BLI_addtail(&prefetch_wait, e);
-	pthread_mutex_unlock(&queue_lock);
-	
-	pthread_mutex_lock(&wakeup_lock);
-	pthread_cond_signal(&wakeup_cond);
-	pthread_mutex_unlock(&wakeup_lock);
+static bool seq_prefetch_fcurves_supported(ListBase *fcurves)
+{
+	FCurve *fcu;
+
+	for (fcu = fcurves->first; fcu; fcu = fcu->next) {
+		if (fcu->rna_path && strncmp(fcu->rna_path, "sequence_editor", 15) == 0)
+			return false;
+	}
+
+	return true;
 }
 
-ImBuf *BKE_sequencer_give_ibuf_threaded(const SeqRenderData *context, float cfra, int chanshown)
+/* frames ahead of the playhead can only be rendered when strip settings don't change over time */
+static bool seq_prefetch_supported(Scene *scene)
 {
-	PrefetchQueueElem *e = NULL;
-	bool found_something = false;
+	AnimData *adt = scene->adt;
 
-	if (seq_thread_shutdown) {
-		return BKE_sequencer_give_ibuf(context, cfra, chanshown);
+	if (scene->ed == NULL || !seq_prefetch_seqbase_supported(&scene->ed->seqbase))
+		return false;
+
+	if (adt) {
+		if (adt->action && !seq_prefetch_fcurves_supported(&adt->action->curves))
+			return false;
+		if (!seq_prefetch_fcurves_supported(&adt->drivers))
+			return false;
 	}
 
-	while (!e) {
-		bool success = false;
-		pthread_mutex_lock(&queue_lock);
+	return true;
+}
 
-		for (e = prefetch_done.first; e; e = e->next) {
-			if (cfra == e->cfra &&
-			    chanshown == e->chanshown &&
-			    context->rectx == e->rectx &&
-			    context->recty == e->recty &&
-			    context->preview_render_size == e->preview_render_size)
-			{
-				success = true;
-				found_something = true;
-				break;
-			}
-		}
+static void *seq_prefetch_thread(void *UNUSED(data))
+{
+	BLI_mutex_lock(&prefetch_lock);
 
-		if (!e) {
-			for (e = prefetch_wait.first; e; e = e->next) {
-				if (cfra == e->cfra &&
-				    chanshown == e->chanshown &&
-				    context->rectx == e->rectx &&
-				    context->recty == e->recty &&
-				    context->preview_render_size == e->preview_render_size)
-				{
-					found_something = true;
-					break;
-				}
-			}
+	prefetch_job.thread = pthread_self();
+	prefetch_job.thread_started = true;
+
+	while (!prefetch_job.stop) {
+		SeqRenderData context;
+		int chanshown, cfra;
+		double start;
+		bool stop, rendered = false;
+
+		if (prefetch_job.next_cfra > prefetch_job.cfra + prefetch_job.num_frames) {
+			/* wait for the playhead to move on */
+			BLI_condition_wait(&prefetch_cond, &prefetch_lock);
+			continue;
 		}
 
-		if (!e) {
-			PrefetchThread *tslot;
+		context = prefetch_job.context;
+		chanshown = prefetch_job.chanshown;
+		cfra = prefetch_job.next_cfra++;
 
-			for (tslot = running_threads.first;
-			     tslot;
-			     tslot = tslot->next)
-			{
-				if (tslot->current &&
-				    cfra == tslot->current->cfra &&
-				    chanshown == tslot->current->chanshown &&
-				    context->rectx == tslot->current->rectx &&
-				    context->recty == tslot->current->recty &&
-				    context->preview_render_size == tslot->current->preview_render_size)
-				{
-					found_something = true;
-					break;
-				}
+		BLI_mutex_unlock(&prefetch_lock);
+
+		BLI_mutex_lock(&render_lock);
+		start = PIL_check_seconds_timer();
+
+		/* the job may have been stopped while waiting for the caller to finish its frame */
+		BLI_mutex_lock(&prefetch_lock);
+		stop = prefetch_job.stop;
+		BLI_mutex_unlock(&prefetch_lock);
+
+		if (!stop) {
+			Editing *ed = BKE_sequencer_editing_get(context.scene, false);
+			ListBase *seqbasep = (ed) ? seq_render_seqbase_get(ed, chanshown) : NULL;
+
+			if (seqbasep && !seq_render_strip_stack_is_cached(&context, seqbasep, cfra, chanshown)) {
+				ImBuf *ibuf = seq_render_strip_stack(&context, seqbasep, cfra, chanshown);
+
+				if (ibuf)
+					IMB_freeImBuf(ibuf);
+
+				rendered = true;
 			}
 		}
 
-		/* e->ibuf is unrefed by render thread on next round. */
+		BLI_mutex_lock(&prefetch_lock);
+		BLI_mutex_unlock(&render_lock);
 
-		if (e) {
-			seq_last_given_monoton_cfra = e->monoton_cfra;
+		if (rendered) {
+			prefetch_stats.prefetched++;
+			prefetch_stats.prefetch_time += PIL_check_seconds_timer() - start;
 		}
+	}
 
-		pthread_mutex_unlock(&queue_lock);
+	BLI_mutex_unlock(&prefetch_lock);
 
-		if (!success) {
-			e = NULL;
+	return NULL;
+}
 
-			if (!found_something) {
-				fprintf(stderr, "SEQ-THREAD: Requested frame not in queue ???\n");
-				break;
-			}
-			pthread_mutex_lock(&frame_done_lock);
-			pthread_cond_wait(&frame_done_cond, &frame_done_lock);
-			pthread_mutex_unlock(&frame_done_lock);
-		}
+/* stop the job, prefetch_control_lock must be held */
+static void seq_prefetch_stop_ex(void)
+{
+	ListBase threads;
+
+	BLI_mutex_lock(&prefetch_lock);
+
+	if (!prefetch_job.running) {
+		BLI_mutex_unlock(&prefetch_lock);
+		return;
 	}
-	
-	return e ? e->ibuf : NULL;
+
+	prefetch_job.stop = true;
+	BLI_condition_notify_one(&prefetch_cond);
+
+	/* the job can't finish its frame while the caller renders, it won't render
+	 * another frame once it has the render lock and will be joined on the next
+	 * stop or update */
+	if (prefetch_job.caller_rendering) {
+		BLI_mutex_unlock(&prefetch_lock);
+		return;
+	}
+
+	BLI_mutex_unlock(&prefetch_lock);
+
+	/* ends threaded malloc started with the job */
+	threads = prefetch_job.threads;
+	BLI_end_threads(&threads);
+
+	BLI_mutex_lock(&prefetch_lock);
+	BLI_listbase_clear(&prefetch_job.threads);
+	prefetch_job.running = false;
+	prefetch_job.thread_started = false;
+	BLI_mutex_unlock(&prefetch_lock);
+}
+
+/* move the playhead of the prefetch job, starting the job when needed */
+static void seq_prefetch_update(const SeqRenderData *context, int cfra, int chanshown, int num_frames)
+{
+	const SeqRenderData *job_context = &prefetch_job.context;
+
+	BLI_mutex_lock(&prefetch_control_lock);
+
+	if (prefetch_job.running &&
+	    (prefetch_job.stop ||
+	     job_context->scene != context->scene ||
+	     job_context->bmain != context->bmain ||
+	     job_context->rectx != context->rectx ||
+	     job_context->recty != context->recty ||
+	     job_context->preview_render_size != context->preview_render_size ||
+	     prefetch_job.chanshown != chanshown))
+	{
+		seq_prefetch_stop_ex();
+	}
+
+	if (num_frames <= 0 || context->skip_cache || !seq_prefetch_supported(context->scene)) {
+		seq_prefetch_stop_ex();
+		BLI_mutex_unlock(&prefetch_control_lock);
+		return;
+	}
+
+	BLI_mutex_lock(&prefetch_lock);
+
+	/* a job that couldn't be joined yet, see seq_prefetch_stop_ex */
+	if (prefetch_job.running && prefetch_job.stop) {
+		BLI_mutex_unlock(&prefetch_lock);
+		BLI_mutex_unlock(&prefetch_control_lock);
+		return;
+	}
+
+	/* restart after jumps and when playback loops */
+	if (!prefetch_job.running || cfra < prefetch_job.cfra || cfra >= prefetch_job.next_cfra)
+		prefetch_job.next_cfra = cfra + 1;
+
+	prefetch_job.cfra = cfra;
+	prefetch_job.num_frames = num_frames;
+
+	if (!prefetch_job.running) {
+		prefetch_job.context = *context;
+		prefetch_job.chanshown = chanshown;
+		prefetch_job.stop = false;
+		prefetch_job.running = true;
+
+		/* also makes guarded allocation thread safe until the job is stopped */
+		BLI_init_threads(&prefetch_job.threads, seq_prefetch_thread, 1);
+		BLI_insert_thread(&prefetch_job.threads, NULL);
+	}
+	else {
+		BLI_condition_notify_one(&prefetch_cond);
+	}
+
+	BLI_mutex_unlock(&prefetch_lock);
+	BLI_mutex_unlock(&prefetch_control_lock);
+}
+
+void BKE_sequencer_prefetch_stop(void)
+{
+	bool is_job_thread;
+
+	/* can be called while the job renders, e.g. when the cache is freed */
+	BLI_mutex_lock(&prefetch_lock);
+	is_job_thread = prefetch_job.thread_started && pthread_equal(prefetch_job.thread, pthread_self());
+	BLI_mutex_unlock(&prefetch_lock);
+
+	if (is_job_thread)
+		return;
+
+	BLI_mutex_lock(&prefetch_control_lock);
+	seq_prefetch_stop_ex();
+	BLI_mutex_unlock(&prefetch_control_lock);
+}
+
+void BKE_sequencer_prefetch_stats_get(SeqPrefetchStats *r_stats)
+{
+	BLI_mutex_lock(&prefetch_lock);
+	*r_stats = prefetch_stats;
+	BLI_mutex_unlock(&prefetch_lock);
+}
+
+void BKE_sequencer_prefetch_stats_reset(void)
+{
+	BLI_mutex_lock(&prefetch_lock);
+	memset(&prefetch_stats, 0, sizeof(prefetch_stats));
+	BLI_mutex_unlock(&prefetch_lock);
+}
+
+/* Get the frame during playback, and render num_frames frames ahead of it
+ * into the cache on a worker thread. */
+ImBuf *BKE_sequencer_give_ibuf_threaded(const SeqRenderData *context, float cfra, int chanshown, int num_frames)
+{
+	Editing *ed = BKE_sequencer_editing_get(context->scene, false);
+	ListBase *seqbasep;
+	ImBuf *ibuf;
+	double start;
+	bool hit;
+
+	if (ed == NULL)
+		return NULL;
+
+	seqbasep = seq_render_seqbase_get(ed, chanshown);
+
+	/* waits for the frame the prefetch job is rendering, often the one asked for */
+	BLI_mutex_lock(&render_lock);
+	BLI_mutex_lock(&prefetch_lock);
+	prefetch_job.caller_rendering = true;
+	BLI_mutex_unlock(&prefetch_lock);
+
+	start = PIL_check_seconds_timer();
+
+	hit = seq_render_strip_stack_is_cached(context, seqbasep, cfra, chanshown);
+	ibuf = seq_render_strip_stack(context, seqbasep, cfra, chanshown);
+
+	BLI_mutex_lock(&prefetch_lock);
+	prefetch_job.caller_rendering = false;
+	BLI_mutex_unlock(&render_lock);
+
+	prefetch_stats.requested++;
+	if (hit)
+		prefetch_stats.hits++;
+	else
+		prefetch_stats.miss_time += PIL_check_seconds_timer() - start;
+	BLI_mutex_unlock(&prefetch_lock);
+
+	seq_prefetch_update(context, (int)cfra, chanshown, num_frames);
+
+	return ibuf;
 }
 
 /* Functions to free imbuf and anim data on changes */
@@ -3338,6 +3610,9 @@ static void sequence_invalidate_cache(Scene *scene, Sequence *seq, bool invalida
 {
 	Editing *ed = scene->ed;
 
+	/* the prefetch job could be rendering this strip or the strips depending on it */
+	BKE_sequencer_prefetch_stop();
+
 	/* invalidate cache for current sequence */
 	if (invalidate_self) {
 		if (seq->anim) {
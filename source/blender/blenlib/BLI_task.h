@@ -34,8 +34,10 @@ extern "C" {
 
 /* Task Scheduler
  * 
- * Central scheduler that holds running threads ready to execute tasks. A single
- * queue holds the task from all pools.
+ * Central scheduler that holds running threads ready to execute tasks. Each
+ * worker thread has its own queue of tasks it pushed, idle threads steal tasks
+ * from the queues of busy ones. Tasks pushed from other threads go to a single
+ * shared queue.
  *
  * Init/exit must be called before/after any task pools are created/freed, and
  * must be called from the main threads. All other scheduler and pool functions
@@ -65,6 +67,9 @@ int BLI_task_scheduler_num_threads(TaskScheduler *scheduler);
  * pool with smaller tasks. When other threads are busy they will continue
  * working on their own tasks, if not they will join in, no new threads will
  * be launched.
+ *
+ * Priority only orders the shared queue, tasks spawned by running tasks are
+ * executed most recent first by the thread that pushed them.
  */
 
 typedef enum TaskPriority {
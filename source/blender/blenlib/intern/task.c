@@ -37,6 +37,13 @@
 
 /* Types */
 
+/* Size of the per thread task deques, tasks pushed when a deque is full go
+ * to the shared queue instead. */
+#define TASK_DEQUE_SIZE 1024
+
+/* Number of times an idle worker looks for tasks before parking. */
+#define TASK_SPIN_ROUNDS 64
+
 typedef struct Task {
 	struct Task *next, *prev;
 
@@ -55,6 +62,7 @@ struct TaskPool {
 	size_t currently_running_tasks;
 	ThreadMutex num_mutex;
 	ThreadCondition num_cond;
+	size_t num_waiters;
 
 	void *userdata;
 	ThreadMutex user_mutex;
@@ -62,14 +70,39 @@ struct TaskPool {
 	volatile bool do_cancel;
 };
 
+/* Work stealing deque (Chase-Lev), the owning thread pushes and pops at the
+ * bottom without locking, other threads steal from the top. The pool is
+ * stored next to the task so threads can check which pool a task belongs
+ * to without touching a task that may be run and freed concurrently.
+ * Indices only grow and start at 1 so bottom - 1 never wraps. */
+
+typedef struct TaskDequeSlot {
+	Task *task;
+	TaskPool *pool;
+} TaskDequeSlot;
+
+typedef struct TaskDeque {
+	volatile size_t top;
+	volatile size_t bottom;
+	TaskDequeSlot *slots;
+} TaskDeque;
+
 struct TaskScheduler {
 	pthread_t *threads;
 	struct TaskThread *task_threads;
 	int num_threads;
 
+	/* shared queue, for tasks pushed from threads that are not workers of
+	 * this scheduler, for pools with a thread limit and for deque overflow */
 	ListBase queue;
 	ThreadMutex queue_mutex;
+
+	/* idle workers park on this condition */
 	ThreadCondition queue_cond;
+	size_t num_parked;
+
+	/* identifies the TaskThread of the calling thread, if any */
+	pthread_key_t thread_key;
 
 	volatile bool do_exit;
 };
@@ -77,18 +110,161 @@ struct TaskScheduler {
 typedef struct TaskThread {
 	TaskScheduler *scheduler;
 	int id;
+	TaskDeque deque;
 } TaskThread;
 
+/* Task Deque */
+
+static void task_deque_init(TaskDeque *deque)
+{
+	deque->top = 1;
+	deque->bottom = 1;
+	deque->slots = MEM_mallocN(sizeof(TaskDequeSlot) * TASK_DEQUE_SIZE, "TaskDeque slots");
+}
+
+static void task_deque_free(TaskDeque *deque)
+{
+	MEM_freeN(deque->slots);
+}
+
+BLI_INLINE bool task_deque_is_empty(TaskDeque *deque)
+{
+	return deque->top >= deque->bottom;
+}
+
+/* only called by the owning thread, returns false when the deque is full */
+static bool task_deque_push(TaskDeque *deque, Task *task)
+{
+	size_t bottom = deque->bottom;
+	TaskDequeSlot *slot;
+
+	if (bottom - deque->top >= TASK_DEQUE_SIZE)
+		return false;
+
+	slot = &deque->slots[bottom % TASK_DEQUE_SIZE];
+	slot->task = task;
+	slot->pool = task->pool;
+
+	/* full barrier, slot must be visible before the new bottom */
+	atomic_add_z((size_t *)&deque->bottom, 1);
+
+	return true;
+}
+
+/* only called by the owning thread, when pool is not NULL only a task of
+ * that pool is returned */
+static Task *task_deque_pop(TaskDeque *deque, TaskPool *pool)
+{
+	size_t top, bottom;
+	Task *task;
+
+	if (task_deque_is_empty(deque))
+		return NULL;
+
+	if (pool && deque->slots[(deque->bottom - 1) % TASK_DEQUE_SIZE].pool != pool)
+		return NULL;
+
+	/* full barrier, thieves must see the new bottom before we read top */
+	bottom = atomic_sub_z((size_t *)&deque->bottom, 1);
+	top = deque->top;
+
+	if (top > bottom) {
+		/* deque was emptied by thieves meanwhile */
+		deque->bottom = top;
+		return NULL;
+	}
+
+	task = deque->slots[bottom % TASK_DEQUE_SIZE].task;
+
+	if (top == bottom) {
+		/* last task, race against thieves for it */
+		if (atomic_cas_z((size_t *)&deque->top, top, top + 1) != top)
+			task = NULL;
+
+		deque->bottom = top + 1;
+	}
+
+	return task;
+}
+
+/* called by any thread, when pool is not NULL only a task of that pool is
+ * returned */
+static Task *task_deque_steal(TaskDeque *deque, TaskPool *pool)
+{
+	/* full barrier, top must be read before bottom */
+	size_t top = atomic_add_z((size_t *)&deque->top, 0);
+	size_t bottom = deque->bottom;
+	TaskDequeSlot slot;
+
+	if (top >= bottom)
+		return NULL;
+
+	/* the slot can't be overwritten by the owner until top moves on, in
+	 * which case the compare and swap below fails */
+	slot = deque->slots[top % TASK_DEQUE_SIZE];
+
+	if (pool && slot.pool != pool)
+		return NULL;
+
+	if (atomic_cas_z((size_t *)&deque->top, top, top + 1) != top)
+		return NULL;
+
+	return slot.task;
+}
+
+/* racy check if any task of pool is in the deque, only used as a hint */
+static bool task_deque_has_pool(TaskDeque *deque, TaskPool *pool)
+{
+	size_t top = deque->top;
+	size_t bottom = deque->bottom;
+	size_t i;
+
+	for (i = top; i < bottom; i++) {
+		if (deque->slots[i % TASK_DEQUE_SIZE].pool == pool)
+			return true;
+	}
+
+	return false;
+}
+
 /* Task Scheduler */
 
+static void task_free(Task *task)
+{
+	if (task->free_taskdata)
+		MEM_freeN(task->taskdata);
+	MEM_freeN(task);
+}
+
+static TaskThread *task_scheduler_thread_get(TaskScheduler *scheduler)
+{
+	if (scheduler->num_threads == 0)
+		return NULL;
+
+	return pthread_getspecific(scheduler->thread_key);
+}
+
+static void task_scheduler_wake_one(TaskScheduler *scheduler)
+{
+	/* read after the task was made visible with a full barrier, parking
+	 * threads increase num_parked before checking for work once more */
+	if (scheduler->num_parked) {
+		BLI_mutex_lock(&scheduler->queue_mutex);
+		BLI_condition_notify_one(&scheduler->queue_cond);
+		BLI_mutex_unlock(&scheduler->queue_mutex);
+	}
+}
+
+/* the pool may be freed by a waiting thread as soon as num_mutex is unlocked,
+ * so callers must not access the pool after this */
 static void task_pool_num_decrease(TaskPool *pool, size_t done)
 {
 	BLI_mutex_lock(&pool->num_mutex);
 
 	BLI_assert(pool->num >= done);
 
-	pool->num -= done;
-	atomic_sub_z(&pool->currently_running_tasks, done);
+	/* still atomic, tasks may be pushed to the pool without the lock */
+	atomic_sub_z((size_t *)&pool->num, done);
 	pool->done += done;
 
 	if (pool->num == 0)
@@ -99,51 +275,268 @@ static void task_pool_num_decrease(TaskPool *pool, size_t done)
 
 static void task_pool_num_increase(TaskPool *pool)
 {
-	BLI_mutex_lock(&pool->num_mutex);
+	atomic_add_z((size_t *)&pool->num, 1);
+}
 
-	pool->num++;
-	BLI_condition_notify_all(&pool->num_cond);
+static void task_pool_notify_waiters(TaskPool *pool)
+{
+	/* wake up threads waiting in BLI_task_pool_work_and_wait, so they can
+	 * help out with the new task */
+	if (pool->num_waiters) {
+		BLI_mutex_lock(&pool->num_mutex);
+		BLI_condition_notify_all(&pool->num_cond);
+		BLI_mutex_unlock(&pool->num_mutex);
+	}
+}
 
-	BLI_mutex_unlock(&pool->num_mutex);
+BLI_INLINE bool task_pool_can_run(TaskPool *pool)
+{
+	return (pool->num_threads == 0 ||
+	        pool->currently_running_tasks < pool->num_threads);
 }
 
-static bool task_scheduler_thread_wait_pop(TaskScheduler *scheduler, Task **task)
+/* find task in the shared queue, must be called with queue_mutex locked */
+static Task *task_scheduler_queue_find(TaskScheduler *scheduler, TaskPool *pool)
 {
-	bool found_task = false;
+	Task *task;
+
+	for (task = scheduler->queue.first; task; task = task->next) {
+		if ((pool == NULL || task->pool == pool) && task_pool_can_run(task->pool))
+			return task;
+	}
+
+	return NULL;
+}
+
+static Task *task_scheduler_queue_pop(TaskScheduler *scheduler, TaskPool *pool)
+{
+	Task *task;
+
+	/* unlocked check to avoid contention on the common empty case */
+	if (scheduler->queue.first == NULL)
+		return NULL;
+
 	BLI_mutex_lock(&scheduler->queue_mutex);
 
-	while (!scheduler->queue.first && !scheduler->do_exit)
-		BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+	task = task_scheduler_queue_find(scheduler, pool);
+	if (task) {
+		BLI_remlink(&scheduler->queue, task);
 
-	do {
-		Task *current_task;
-		if (!scheduler->queue.first) {
-			BLI_mutex_unlock(&scheduler->queue_mutex);
-			BLI_assert(scheduler->do_exit);
-			return false;
+		/* the thread limit is checked and the running task counted under the
+		 * same lock, so other threads can't take a task past the limit */
+		atomic_add_z(&task->pool->currently_running_tasks, 1);
+	}
+
+	BLI_mutex_unlock(&scheduler->queue_mutex);
+
+	return task;
+}
+
+static Task *task_scheduler_steal(TaskScheduler *scheduler, TaskThread *thread, TaskPool *pool)
+{
+	int num_threads = scheduler->num_threads;
+	int start = (thread) ? thread->id : 0;
+	int i;
+
+	/* start at a different victim for each thread to spread contention */
+	for (i = 0; i < num_threads; i++) {
+		TaskThread *victim = &scheduler->task_threads[(start + i) % num_threads];
+
+		if (victim != thread) {
+			Task *task = task_deque_steal(&victim->deque, pool);
+			if (task)
+				return task;
 		}
-		for (current_task = scheduler->queue.first;
-		     current_task != NULL;
-		     current_task = current_task->next)
+	}
+
+	return NULL;
+}
+
+/* find a task from any of the queues, when pool is not NULL only a task of
+ * that pool is returned, to avoid deadlocks when waiting for a pool */
+static Task *task_scheduler_find(TaskScheduler *scheduler, TaskThread *thread, TaskPool *pool)
+{
+	Task *task = NULL;
+
+	/* tasks in deques belong to pools without a thread limit, queued tasks
+	 * are counted as running by task_scheduler_queue_pop already */
+	if (thread)
+		task = task_deque_pop(&thread->deque, pool);
+	if (task == NULL) {
+		task = task_scheduler_queue_pop(scheduler, pool);
+		if (task)
+			return task;
+
+		task = task_scheduler_steal(scheduler, thread, pool);
+	}
+
+	if (task)
+		atomic_add_z(&task->pool->currently_running_tasks, 1);
+
+	return task;
+}
+
+/* check if there is any work left for pool, or any pool if NULL. tasks of
+ * pool anywhere in a deque count, as they can be unburied. must be called
+ * with queue_mutex locked when pool is NULL */
+static bool task_scheduler_has_work(TaskScheduler *scheduler, TaskPool *pool)
+{
+	int i;
+
+	if (pool == NULL) {
+		if (task_scheduler_queue_find(scheduler, NULL))
+			return true;
+	}
+	else if (scheduler->queue.first) {
+		bool found;
+
+		BLI_mutex_lock(&scheduler->queue_mutex);
+		found = (task_scheduler_queue_find(scheduler, pool) != NULL);
+		BLI_mutex_unlock(&scheduler->queue_mutex);
+
+		if (found)
+			return true;
+	}
+
+	for (i = 0; i < scheduler->num_threads; i++) {
+		TaskDeque *deque = &scheduler->task_threads[i].deque;
+
+		if (task_deque_is_empty(deque))
+			continue;
+
+		if (pool == NULL)
+			return true;
+
+		/* tasks of the pool that can't be taken right away are moved out of
+		 * the way by task_scheduler_unbury */
+		if (task_deque_has_pool(deque, pool))
+			return true;
+	}
+
+	return false;
+}
+
+/* move a task taken from a deque to the shared queue, where it can be found
+ * by threads waiting for its pool */
+static void task_scheduler_requeue(TaskScheduler *scheduler, Task *task)
+{
+	TaskPool *pool = task->pool;
+
+	/* keep the pool alive until its waiters are notified, the task may be
+	 * run and freed by another thread as soon as it's in the queue */
+	task_pool_num_increase(pool);
+
+	BLI_mutex_lock(&scheduler->queue_mutex);
+	BLI_addhead(&scheduler->queue, task);
+	if (scheduler->num_parked)
+		BLI_condition_notify_one(&scheduler->queue_cond);
+	BLI_mutex_unlock(&scheduler->queue_mutex);
+
+	BLI_mutex_lock(&pool->num_mutex);
+	atomic_sub_z((size_t *)&pool->num, 1);
+	BLI_condition_notify_all(&pool->num_cond);
+	BLI_mutex_unlock(&pool->num_mutex);
+}
+
+/* Deques can only be taken from at one end, so tasks of a pool can end up
+ * below tasks of other pools, out of reach of the threads waiting for it. For
+ * example a worker waiting for one pool may have a task of another pool at
+ * the bottom of its deque, while the thread waiting for that other pool only
+ * sees the top. Move the tasks in the way to the shared queue, returns true
+ * when any task was moved. Must not be called with a pool mutex locked. */
+static bool task_scheduler_unbury(TaskScheduler *scheduler, TaskThread *thread, TaskPool *pool)
+{
+	bool moved = false;
+	int i;
+
+	/* own deque, from the bottom */
+	if (thread && task_deque_has_pool(&thread->deque, pool)) {
+		TaskDeque *deque = &thread->deque;
+
+		while (!task_deque_is_empty(deque) &&
+		       deque->slots[(deque->bottom - 1) % TASK_DEQUE_SIZE].pool != pool)
 		{
-			TaskPool *pool = current_task->pool;
-			if (pool->num_threads == 0 ||
-			    pool->currently_running_tasks < pool->num_threads)
-			{
-				*task = current_task;
-				found_task = true;
-				atomic_add_z(&pool->currently_running_tasks, 1);
-				BLI_remlink(&scheduler->queue, *task);
+			Task *task = task_deque_pop(deque, NULL);
+			if (task == NULL)
 				break;
-			}
+
+			task_scheduler_requeue(scheduler, task);
+			moved = true;
 		}
-		if (!found_task)
+	}
+
+	/* other deques, from the top */
+	for (i = 0; i < scheduler->num_threads; i++) {
+		TaskThread *victim = &scheduler->task_threads[i];
+		TaskDeque *deque = &victim->deque;
+
+		if (victim == thread)
+			continue;
+
+		while (task_deque_has_pool(deque, pool) &&
+		       deque->slots[deque->top % TASK_DEQUE_SIZE].pool != pool)
+		{
+			Task *task = task_deque_steal(deque, NULL);
+			if (task == NULL)
+				break;
+
+			task_scheduler_requeue(scheduler, task);
+			moved = true;
+		}
+	}
+
+	return moved;
+}
+
+static void task_scheduler_run(TaskScheduler *scheduler, Task *task, int thread_id)
+{
+	TaskPool *pool = task->pool;
+	bool has_thread_limit = (pool->num_threads != 0);
+
+	/* tasks of canceled pools are removed without running them */
+	if (!pool->do_cancel)
+		task->run(pool, task->taskdata, thread_id);
+
+	task_free(task);
+
+	atomic_sub_z(&pool->currently_running_tasks, 1);
+
+	/* a worker may be parked waiting for this pool to drop below its limit */
+	if (has_thread_limit)
+		task_scheduler_wake_one(scheduler);
+
+	/* notify pool task was done, the pool can't be accessed after this */
+	task_pool_num_decrease(pool, 1);
+}
+
+static bool task_scheduler_thread_wait_pop(TaskScheduler *scheduler, TaskThread *thread, Task **task)
+{
+	while (!scheduler->do_exit) {
+		int round;
+
+		/* look for work for a while, it's common for new tasks to be pushed
+		 * shortly after, and parking and waking threads is expensive */
+		for (round = 0; round < TASK_SPIN_ROUNDS; round++) {
+			*task = task_scheduler_find(scheduler, thread, NULL);
+			if (*task)
+				return true;
+
+			if (scheduler->do_exit)
+				return false;
+		}
+
+		/* park until a task is pushed */
+		BLI_mutex_lock(&scheduler->queue_mutex);
+		atomic_add_z(&scheduler->num_parked, 1);
+
+		while (!scheduler->do_exit && !task_scheduler_has_work(scheduler, NULL))
 			BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
-	} while (!found_task);
 
-	BLI_mutex_unlock(&scheduler->queue_mutex);
+		atomic_sub_z(&scheduler->num_parked, 1);
+		BLI_mutex_unlock(&scheduler->queue_mutex);
+	}
 
-	return true;
+	return false;
 }
 
 static void *task_scheduler_thread_run(void *thread_p)
@@ -153,21 +546,11 @@ static void *task_scheduler_thread_run(void *thread_p)
 	int thread_id = thread->id;
 	Task *task;
 
-	/* keep popping off tasks */
-	while (task_scheduler_thread_wait_pop(scheduler, &task)) {
-		TaskPool *pool = task->pool;
-
-		/* run task */
-		task->run(pool, task->taskdata, thread_id);
-
-		/* delete task */
-		if (task->free_taskdata)
-			MEM_freeN(task->taskdata);
-		MEM_freeN(task);
+	pthread_setspecific(scheduler->thread_key, thread);
 
-		/* notify pool task was done */
-		task_pool_num_decrease(pool, 1);
-	}
+	/* keep popping off tasks */
+	while (task_scheduler_thread_wait_pop(scheduler, thread, &task))
+		task_scheduler_run(scheduler, task, thread_id);
 
 	return NULL;
 }
@@ -183,6 +566,7 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
 	BLI_listbase_clear(&scheduler->queue);
 	BLI_mutex_init(&scheduler->queue_mutex);
 	BLI_condition_init(&scheduler->queue_cond);
+	pthread_key_create(&scheduler->thread_key, NULL);
 
 	if (num_threads == 0) {
 		/* automatic number of threads will be main thread + num cores */
@@ -200,14 +584,19 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
 		scheduler->threads = MEM_callocN(sizeof(pthread_t) * num_threads, "TaskScheduler threads");
 		scheduler->task_threads = MEM_callocN(sizeof(TaskThread) * num_threads, "TaskScheduler task threads");
 
+		/* deques must exist before any thread starts stealing */
 		for (i = 0; i < num_threads; i++) {
 			TaskThread *thread = &scheduler->task_threads[i];
 			thread->scheduler = scheduler;
 			thread->id = i + 1;
+			task_deque_init(&thread->deque);
+		}
+
+		for (i = 0; i < num_threads; i++) {
+			TaskThread *thread = &scheduler->task_threads[i];
 
 			if (pthread_create(&scheduler->threads[i], NULL, task_scheduler_thread_run, thread) != 0) {
 				fprintf(stderr, "TaskScheduler failed to launch thread %d/%d\n", i, num_threads);
-				MEM_freeN(thread);
 			}
 		}
 	}
@@ -237,8 +626,19 @@ void BLI_task_scheduler_free(TaskScheduler *scheduler)
 		MEM_freeN(scheduler->threads);
 	}
 
-	/* Delete task thread data */
+	/* Delete task thread data and leftover tasks in deques */
 	if (scheduler->task_threads) {
+		int i;
+
+		for (i = 0; i < scheduler->num_threads; i++) {
+			TaskDeque *deque = &scheduler->task_threads[i].deque;
+
+			while ((task = task_deque_steal(deque, NULL)))
+				task_free(task);
+
+			task_deque_free(deque);
+		}
+
 		MEM_freeN(scheduler->task_threads);
 	}
 
@@ -252,6 +652,7 @@ void BLI_task_scheduler_free(TaskScheduler *scheduler)
 	/* delete mutex/condition */
 	BLI_mutex_end(&scheduler->queue_mutex);
 	BLI_condition_end(&scheduler->queue_cond);
+	pthread_key_delete(scheduler->thread_key);
 
 	MEM_freeN(scheduler);
 }
@@ -263,18 +664,32 @@ int BLI_task_scheduler_num_threads(TaskScheduler *scheduler)
 
 static void task_scheduler_push(TaskScheduler *scheduler, Task *task, TaskPriority priority)
 {
-	task_pool_num_increase(task->pool);
+	TaskThread *thread = task_scheduler_thread_get(scheduler);
+	/* the task may be run and freed by another thread as soon as it's pushed */
+	TaskPool *pool = task->pool;
 
-	/* add task to queue */
-	BLI_mutex_lock(&scheduler->queue_mutex);
+	task_pool_num_increase(pool);
 
-	if (priority == TASK_PRIORITY_HIGH)
-		BLI_addhead(&scheduler->queue, task);
-	else
-		BLI_addtail(&scheduler->queue, task);
+	/* workers push to their own deque without locking, pools with a thread
+	 * limit always go through the shared queue where the limit is checked */
+	if (thread && pool->num_threads == 0 && task_deque_push(&thread->deque, task)) {
+		task_scheduler_wake_one(scheduler);
+	}
+	else {
+		/* add task to queue */
+		BLI_mutex_lock(&scheduler->queue_mutex);
 
-	BLI_condition_notify_one(&scheduler->queue_cond);
-	BLI_mutex_unlock(&scheduler->queue_mutex);
+		if (priority == TASK_PRIORITY_HIGH)
+			BLI_addhead(&scheduler->queue, task);
+		else
+			BLI_addtail(&scheduler->queue, task);
+
+		if (scheduler->num_parked)
+			BLI_condition_notify_one(&scheduler->queue_cond);
+		BLI_mutex_unlock(&scheduler->queue_mutex);
+	}
+
+	task_pool_notify_waiters(pool);
 }
 
 static void task_scheduler_clear(TaskScheduler *scheduler, TaskPool *pool)
@@ -300,7 +715,8 @@ static void task_scheduler_clear(TaskScheduler *scheduler, TaskPool *pool)
 	BLI_mutex_unlock(&scheduler->queue_mutex);
 
 	/* notify done */
-	task_pool_num_decrease(pool, done);
+	if (done)
+		task_pool_num_decrease(pool, done);
 }
 
 /* Task Pool */
@@ -313,6 +729,7 @@ TaskPool *BLI_task_pool_create(TaskScheduler *scheduler, void *userdata)
 	pool->num = 0;
 	pool->num_threads = 0;
 	pool->currently_running_tasks = 0;
+	pool->num_waiters = 0;
 	pool->do_cancel = false;
 
 	BLI_mutex_init(&pool->num_mutex);
@@ -362,56 +779,41 @@ void BLI_task_pool_push(TaskPool *pool, TaskRunFunction run,
 void BLI_task_pool_work_and_wait(TaskPool *pool)
 {
 	TaskScheduler *scheduler = pool->scheduler;
+	TaskThread *thread = task_scheduler_thread_get(scheduler);
+	int thread_id = (thread) ? thread->id : 0;
 
+	/* num is only checked under num_mutex, so we can't return while the
+	 * thread finishing the last task is still notifying through the pool */
 	BLI_mutex_lock(&pool->num_mutex);
 
 	while (pool->num != 0) {
-		Task *task, *work_task = NULL;
-		bool found_task = false;
+		Task *task;
 
 		BLI_mutex_unlock(&pool->num_mutex);
 
-		BLI_mutex_lock(&scheduler->queue_mutex);
-
 		/* find task from this pool. if we get a task from another pool,
 		 * we can get into deadlock */
+		task = task_scheduler_find(scheduler, thread, pool);
+		if (task == NULL && task_scheduler_unbury(scheduler, thread, pool))
+			task = task_scheduler_find(scheduler, thread, pool);
 
-		if (pool->num_threads == 0 ||
-		    pool->currently_running_tasks < pool->num_threads)
-		{
-			for (task = scheduler->queue.first; task; task = task->next) {
-				if (task->pool == pool) {
-					work_task = task;
-					found_task = true;
-					BLI_remlink(&scheduler->queue, task);
-					break;
-				}
-			}
-		}
-
-		BLI_mutex_unlock(&scheduler->queue_mutex);
-
-		/* if found task, do it, otherwise wait until other tasks are done */
-		if (found_task) {
-			/* run task */
-			atomic_add_z(&pool->currently_running_tasks, 1);
-			work_task->run(pool, work_task->taskdata, 0);
-
-			/* delete task */
-			if (work_task->free_taskdata)
-				MEM_freeN(work_task->taskdata);
-			MEM_freeN(work_task);
+		BLI_mutex_lock(&pool->num_mutex);
 
-			/* notify pool task was done */
-			task_pool_num_decrease(pool, 1);
+		/* if found task, do it, otherwise wait until other tasks are done
+		 * or new tasks are pushed */
+		if (task) {
+			BLI_mutex_unlock(&pool->num_mutex);
+			task_scheduler_run(scheduler, task, thread_id);
+			BLI_mutex_lock(&pool->num_mutex);
+			continue;
 		}
 
-		BLI_mutex_lock(&pool->num_mutex);
-		if (pool->num == 0)
-			break;
+		atomic_add_z(&pool->num_waiters, 1);
 
-		if (!found_task)
+		if (pool->num != 0 && !task_scheduler_has_work(scheduler, pool))
 			BLI_condition_wait(&pool->num_cond, &pool->num_mutex);
+
+		atomic_sub_z(&pool->num_waiters, 1);
 	}
 
 	BLI_mutex_unlock(&pool->num_mutex);
@@ -429,11 +831,9 @@ void BLI_task_pool_cancel(TaskPool *pool)
 
 	task_scheduler_clear(pool->scheduler, pool);
 
-	/* wait until all entries are cleared */
-	BLI_mutex_lock(&pool->num_mutex);
-	while (pool->num)
-		BLI_condition_wait(&pool->num_cond, &pool->num_mutex);
-	BLI_mutex_unlock(&pool->num_mutex);
+	/* wait until all entries are cleared, tasks still in deques are
+	 * removed without running */
+	BLI_task_pool_work_and_wait(pool);
 
 	pool->do_cancel = false;
 }
@@ -442,6 +842,10 @@ void BLI_task_pool_stop(TaskPool *pool)
 {
 	task_scheduler_clear(pool->scheduler, pool);
 
+	/* tasks in deques can't be cleared directly */
+	if (pool->num != 0)
+		BLI_task_pool_cancel(pool);
+
 	BLI_assert(pool->num == 0);
 }
 
@@ -478,9 +882,6 @@ size_t BLI_task_pool_tasks_done(TaskPool *pool)
  * - #BLI_task_parallel_foreach_ghash/gset (#GHash/#GSet - hash & set)
  * - #BLI_task_parallel_foreach_mempool (#BLI_mempool - iterate over mempools)
  *
- * Possible improvements:
- *
- * - Chunk iterations to reduce number of spin locks.
  */
 
 typedef struct ParallelRangeState {
@@ -488,27 +889,29 @@ typedef struct ParallelRangeState {
 	void *userdata;
 	TaskParallelRangeFunc func;
 
-	int iter;
+	volatile int iter;
 	int chunk_size;
-	SpinLock lock;
 } ParallelRangeState;
 
 BLI_INLINE bool parallel_range_next_iter_get(
         ParallelRangeState * __restrict state,
         int * __restrict iter, int * __restrict count)
 {
-	bool result = false;
-	if (state->iter < state->stop) {
-		BLI_spin_lock(&state->lock);
-		if (state->iter < state->stop) {
-			*count = min_ii(state->chunk_size, state->stop - state->iter);
-			*iter = state->iter;
-			state->iter += *count;
-			result = true;
-		}
-		BLI_spin_unlock(&state->lock);
-	}
-	return result;
+	int old_iter, new_iter;
+
+	/* lock-free, chunks are claimed by moving the iterator forward */
+	do {
+		old_iter = state->iter;
+		if (old_iter >= state->stop)
+			return false;
+
+		new_iter = old_iter + min_ii(state->chunk_size, state->stop - old_iter);
+	} while (atomic_cas_uint32((uint32_t *)&state->iter, (uint32_t)old_iter, (uint32_t)new_iter) != (uint32_t)old_iter);
+
+	*iter = old_iter;
+	*count = new_iter - old_iter;
+
+	return true;
 }
 
 static void parallel_range_func(
@@ -560,7 +963,6 @@ void BLI_task_parallel_range_ex(
 	 */
 	num_tasks = num_threads * 2;
 
-	BLI_spin_init(&state.lock);
 	state.start = start;
 	state.stop = stop;
 	state.userdata = userdata;
@@ -570,7 +972,7 @@ void BLI_task_parallel_range_ex(
 		state.chunk_size = 32;
 	}
 	else {
-		state.chunk_size = (stop - start) / (num_tasks);
+		state.chunk_size = max_ii(1, (stop - start) / (num_tasks));
 	}
 
 	for (i = 0; i < num_tasks; i++) {
@@ -582,8 +984,6 @@ void BLI_task_parallel_range_ex(
 
 	BLI_task_pool_work_and_wait(task_pool);
 	BLI_task_pool_free(task_pool);
-
-	BLI_spin_end(&state.lock);
 }
 
 void BLI_task_parallel_range(
@@ -33,23 +33,30 @@
  *  \ingroup blenloader
  */
 
+/* chunk data, shared by all chunks with the same content in the undo stack */
+struct MemFileBuffer;
+
 typedef struct {
 	void *next, *prev;
 	
-	char *buf;
-	unsigned int ident, size;
+	struct MemFileBuffer *buffer;
+	unsigned int size;
 	
 } MemFileChunk;
 
 typedef struct MemFile {
 	ListBase chunks;
-	unsigned int size;
+	unsigned int size;  /* size of the chunks that weren't in the undo stack yet */
 } MemFile;
 
 /* actually only used writefile.c */
 extern void add_memfilechunk(MemFile *compare, MemFile *current, const char *buf, unsigned int size);
 
 /* exports */
+extern const char *BLO_memfile_chunk_data(MemFileChunk *chunk);
+extern size_t BLO_memfile_memory(MemFile *memfile);
+extern void BLO_memfile_compress(MemFile *memfile);
+extern void BLO_memfile_compress_finish(void);
 extern void BLO_free_memfile(MemFile *memfile);
 extern void BLO_merge_memfile(MemFile *first, MemFile *second);
 
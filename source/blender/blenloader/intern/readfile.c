@@ -108,6 +108,7 @@
 #include "BLI_math.h"
 #include "BLI_threads.h"
 #include "BLI_mempool.h"
+#include "BLI_task.h"
 
 #include "BLF_translation.h"
 
@@ -212,10 +213,13 @@ typedef struct OldNew {
 	int nr;
 } OldNew;
 
+/* entries are kept in insertion order, map is an open addressing hash table
+ * of entry indices (-1 for empty slots) to look them up by old address */
 typedef struct OldNewMap {
 	OldNew *entries;
 	int nentries, entriessize;
-	int sorted;
+	int *map;
+	unsigned int mapsize;
 	int lasthit;
 } OldNewMap;
 
@@ -264,23 +268,45 @@ static OldNewMap *oldnewmap_new(void)
 	onm->entriessize = 1024;
 	onm->entries = MEM_mallocN(sizeof(*onm->entries)*onm->entriessize, "OldNewMap.entries");
 	
+	onm->mapsize = onm->entriessize * 2;
+	onm->map = MEM_mallocN(sizeof(*onm->map)*onm->mapsize, "OldNewMap.map");
+	memset(onm->map, 0xff, sizeof(*onm->map)*onm->mapsize);
+	
 	return onm;
 }
 
-static int verg_oldnewmap(const void *v1, const void *v2)
+/* index of the first slot to probe for addr, mapsize is a power of two */
+BLI_INLINE unsigned int oldnewmap_slot(const OldNewMap *onm, const void *addr)
 {
-	const struct OldNew *x1=v1, *x2=v2;
+	/* pointers are aligned, mix the high bits in so the low bits of the slot vary */
+	uintptr_t key = (uintptr_t)addr;
 	
-	if (x1->old > x2->old) return 1;
-	else if (x1->old < x2->old) return -1;
-	return 0;
+	key ^= key >> 16;
+	key *= 0x45d9f3bu;
+	key ^= key >> 16;
+	
+	return (unsigned int)key & (onm->mapsize - 1);
 }
 
+static void oldnewmap_map_insert(OldNewMap *onm, int index)
+{
+	unsigned int slot = oldnewmap_slot(onm, onm->entries[index].old);
+	
+	/* linear probing: entries with the same address stay in insertion order along the probe sequence */
+	while (onm->map[slot] != -1) {
+		slot = (slot + 1) & (onm->mapsize - 1);
+	}
+	onm->map[slot] = index;
+}
 
-static void oldnewmap_sort(FileData *fd) 
+static void oldnewmap_map_rebuild(OldNewMap *onm)
 {
-	qsort(fd->libmap->entries, fd->libmap->nentries, sizeof(OldNew), verg_oldnewmap);
-	fd->libmap->sorted = 1;
+	int i;
+	
+	memset(onm->map, 0xff, sizeof(*onm->map)*onm->mapsize);
+	for (i = 0; i < onm->nentries; i++) {
+		oldnewmap_map_insert(onm, i);
+	}
 }
 
 /* nr is zero for data, and ID code for libdata */
@@ -301,10 +327,22 @@ static void oldnewmap_insert(OldNewMap *onm, void *oldaddr, void *newaddr, int n
 		MEM_freeN(oentries);
 	}
 
-	entry = &onm->entries[onm->nentries++];
+	entry = &onm->entries[onm->nentries];
 	entry->old = oldaddr;
 	entry->newp = newaddr;
 	entry->nr = nr;
+	
+	/* keep the map at most half full so probe sequences stay short */
+	if ((unsigned int)(onm->nentries + 1) * 2 > onm->mapsize) {
+		MEM_freeN(onm->map);
+		onm->mapsize *= 2;
+		onm->map = MEM_mallocN(sizeof(*onm->map)*onm->mapsize, "OldNewMap.map");
+		onm->nentries++;
+		oldnewmap_map_rebuild(onm);
+	}
+	else {
+		oldnewmap_map_insert(onm, onm->nentries++);
+	}
 }
 
 void blo_do_versions_oldnewmap_insert(OldNewMap *onm, void *oldaddr, void *newaddr, int nr)
@@ -312,14 +350,32 @@ void blo_do_versions_oldnewmap_insert(OldNewMap *onm, void *oldaddr, void *newad
 	oldnewmap_insert(onm, oldaddr, newaddr, nr);
 }
 
+/* first entry for addr, in insertion order when the address was inserted more than once */
+static OldNew *oldnewmap_lookup_entry(OldNewMap *onm, const void *addr)
+{
+	unsigned int slot = oldnewmap_slot(onm, addr);
+	int index;
+	
+	while ((index = onm->map[slot]) != -1) {
+		if (onm->entries[index].old == addr) {
+			onm->lasthit = index;
+			return &onm->entries[index];
+		}
+		slot = (slot + 1) & (onm->mapsize - 1);
+	}
+	
+	return NULL;
+}
+
 static void *oldnewmap_lookup_and_inc(OldNewMap *onm, void *addr, bool increase_users) 
 {
-	int i;
+	OldNew *entry;
 	
 	if (addr == NULL) return NULL;
 	
+	/* data is mostly linked in the same order as it was written, try the entry after the last hit first */
 	if (onm->lasthit < onm->nentries-1) {
-		OldNew *entry = &onm->entries[++onm->lasthit];
+		entry = &onm->entries[++onm->lasthit];
 		
 		if (entry->old == addr) {
 			if (increase_users)
@@ -328,16 +384,11 @@ static void *oldnewmap_lookup_and_inc(OldNewMap *onm, void *addr, bool increase_
 		}
 	}
 	
-	for (i = 0; i < onm->nentries; i++) {
-		OldNew *entry = &onm->entries[i];
-		
-		if (entry->old == addr) {
-			onm->lasthit = i;
-			
-			if (increase_users)
-				entry->nr++;
-			return entry->newp;
-		}
+	entry = oldnewmap_lookup_entry(onm, addr);
+	if (entry) {
+		if (increase_users)
+			entry->nr++;
+		return entry->newp;
 	}
 	
 	return NULL;
@@ -346,39 +397,26 @@ static void *oldnewmap_lookup_and_inc(OldNewMap *onm, void *addr, bool increase_
 /* for libdata, nr has ID code, no increment */
 static void *oldnewmap_liblookup(OldNewMap *onm, void *addr, void *lib)
 {
+	unsigned int slot;
+	int index;
+	
 	if (addr == NULL) {
 		return NULL;
 	}
-
-	/* lasthit works fine for non-libdata, linking there is done in same sequence as writing */
-	if (onm->sorted) {
-		OldNew entry_s, *entry;
-
-		entry_s.old = addr;
-
-		entry = bsearch(&entry_s, onm->entries, onm->nentries, sizeof(OldNew), verg_oldnewmap);
-		if (entry) {
+	
+	/* all entries for addr are along its probe sequence, check them in insertion order */
+	slot = oldnewmap_slot(onm, addr);
+	while ((index = onm->map[slot]) != -1) {
+		OldNew *entry = &onm->entries[index];
+		
+		if (entry->old == addr) {
 			ID *id = entry->newp;
-
+			
 			if (id && (!lib || id->lib)) {
 				return id;
 			}
 		}
-	}
-	else {
-		/* note, this can be a bottle neck when loading some files */
-		unsigned int nentries = (unsigned int)onm->nentries;
-		unsigned int i;
-		OldNew *entry;
-
-		for (i = 0, entry = onm->entries; i < nentries; i++, entry++) {
-			if (entry->old == addr) {
-				ID *id = entry->newp;
-				if (id && (!lib || id->lib)) {
-					return id;
-				}
-			}
-		}
+		slot = (slot + 1) & (onm->mapsize - 1);
 	}
 
 	return NULL;
@@ -399,6 +437,23 @@ static void oldnewmap_free_unused(OldNewMap *onm)
 
 static void oldnewmap_clear(OldNewMap *onm) 
 {
+	/* the datamap is cleared after every ID, only reset the used slots when the map is mostly empty */
+	if ((unsigned int)onm->nentries * 8 < onm->mapsize) {
+		int i;
+		
+		for (i = 0; i < onm->nentries; i++) {
+			unsigned int slot = oldnewmap_slot(onm, onm->entries[i].old);
+			
+			while (onm->map[slot] != -1) {
+				onm->map[slot] = -1;
+				slot = (slot + 1) & (onm->mapsize - 1);
+			}
+		}
+	}
+	else {
+		memset(onm->map, 0xff, sizeof(*onm->map)*onm->mapsize);
+	}
+	
 	onm->nentries = 0;
 	onm->lasthit = 0;
 }
@@ -406,6 +461,7 @@ static void oldnewmap_clear(OldNewMap *onm)
 static void oldnewmap_free(OldNewMap *onm) 
 {
 	MEM_freeN(onm->entries);
+	MEM_freeN(onm->map);
 	MEM_freeN(onm);
 }
 
@@ -682,10 +738,29 @@ static BHeadN *get_bhead(FileData *fd)
 			/* bhead now contains the (converted) bhead structure. Now read
 			 * the associated data and put everything in a BHeadN (creative naming !)
 			 */
-			if (!fd->eof) {
+			if (!fd->eof && (fd->flags & FD_FLAGS_READ_ON_DEMAND) && bhead.code == DATA) {
+				/* only remember where the data is, most data of a library isn't needed */
+				new_bhead = MEM_mallocN(sizeof(BHeadN), "new_bhead");
+				new_bhead->next = new_bhead->prev = NULL;
+				new_bhead->file_offset = gztell(fd->gzfiledes);
+				new_bhead->has_data = false;
+				new_bhead->bhead = bhead;
+				
+				if (gzseek(fd->gzfiledes, bhead.len, SEEK_CUR) == -1) {
+					fd->eof = 1;
+					MEM_freeN(new_bhead);
+					new_bhead = NULL;
+				}
+				else {
+					fd->seek += bhead.len;
+				}
+			}
+			else if (!fd->eof) {
 				new_bhead = MEM_mallocN(sizeof(BHeadN) + bhead.len, "new_bhead");
 				if (new_bhead) {
 					new_bhead->next = new_bhead->prev = NULL;
+					new_bhead->file_offset = 0;
+					new_bhead->has_data = true;
 					new_bhead->bhead = bhead;
 					
 					readsize = fd->read(fd, new_bhead + 1, bhead.len);
@@ -767,6 +842,43 @@ BHead *blo_nextbhead(FileData *fd, BHead *thisblock)
 	return(bhead);
 }
 
+/* Read the data of a block read with FD_FLAGS_READ_ON_DEMAND, returns a new block
+ * that has to be freed with MEM_freeN, or NULL when the block already has its data
+ * or reading failed. */
+static BHead *blo_bhead_read_full(FileData *fd, BHead *thisblock)
+{
+	BHeadN *bheadn = (BHeadN *) (((char *) thisblock) - offsetof(BHeadN, bhead));
+	BHeadN *new_bheadn;
+	z_off_t offset;
+	bool ok;
+	
+	if (bheadn->has_data) {
+		return NULL;
+	}
+	
+	new_bheadn = MEM_mallocN(sizeof(BHeadN) + bheadn->bhead.len, "new_bhead");
+	new_bheadn->next = new_bheadn->prev = NULL;
+	new_bheadn->file_offset = bheadn->file_offset;
+	new_bheadn->has_data = true;
+	new_bheadn->bhead = bheadn->bhead;
+	
+	/* read the data and go back to where the blocks are being read */
+	offset = gztell(fd->gzfiledes);
+	ok = (gzseek(fd->gzfiledes, bheadn->file_offset, SEEK_SET) != -1 &&
+	      gzread(fd->gzfiledes, new_bheadn + 1, (unsigned int)bheadn->bhead.len) == bheadn->bhead.len);
+	if (gzseek(fd->gzfiledes, offset, SEEK_SET) == -1) {
+		fd->eof = 1;
+	}
+	
+	if (!ok) {
+		blo_reportf_wrap(fd->reports, RPT_ERROR, TIP_("Failed to read data block from '%s'"), fd->relabase);
+		MEM_freeN(new_bheadn);
+		return NULL;
+	}
+	
+	return &new_bheadn->bhead;
+}
+
 static void decode_blender_header(FileData *fd)
 {
 	char header[SIZEOFBLENDERHEADER], num[4];
@@ -919,7 +1031,7 @@ static int fd_read_from_memfile(FileData *filedata, void *buffer, unsigned int s
 			if (chunkoffset+readsize > chunk->size)
 				readsize= chunk->size-chunkoffset;
 			
-			memcpy((char *)buffer + totread, chunk->buf + chunkoffset, readsize);
+			memcpy((char *)buffer + totread, BLO_memfile_chunk_data(chunk) + chunkoffset, readsize);
 			totread += readsize;
 			filedata->seek += readsize;
 			seek += readsize;
@@ -973,7 +1085,9 @@ static FileData *blo_decode_and_check(FileData *fd, ReportList *reports)
 
 /* cannot be called with relative paths anymore! */
 /* on each new library added, it now checks for the current FileData and expands relativeness */
-FileData *blo_openblenderfile(const char *filepath, ReportList *reports)
+/* with read_on_demand, the data of DATA blocks is only read when it is needed,
+ * for uncompressed files, see FD_FLAGS_READ_ON_DEMAND */
+static FileData *blo_openblenderfile_ex(const char *filepath, ReportList *reports, bool read_on_demand)
 {
 	gzFile gzfile;
 	errno = 0;
@@ -989,6 +1103,11 @@ FileData *blo_openblenderfile(const char *filepath, ReportList *reports)
 		fd->gzfiledes = gzfile;
 		fd->read = fd_read_gzip_from_file;
 		
+		/* seeking is only cheap when the file isn't compressed */
+		if (read_on_demand && gzdirect(gzfile)) {
+			fd->flags |= FD_FLAGS_READ_ON_DEMAND;
+		}
+		
 		/* needed for library_append and read_libraries */
 		BLI_strncpy(fd->relabase, filepath, sizeof(fd->relabase));
 		
@@ -996,6 +1115,11 @@ FileData *blo_openblenderfile(const char *filepath, ReportList *reports)
 	}
 }
 
+FileData *blo_openblenderfile(const char *filepath, ReportList *reports)
+{
+	return blo_openblenderfile_ex(filepath, reports, false);
+}
+
 static int fd_read_gzip_from_memory(FileData *filedata, void *buffer, unsigned int size)
 {
 	int err;
@@ -1576,9 +1700,11 @@ static void switch_endian_structs(struct SDNA *filesdna, BHead *bhead)
 
 static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
 {
+	BHeadN *bhn = (BHeadN *) (((char *) bh) - offsetof(BHeadN, bhead));
 	void *temp = NULL;
 	
-	if (bh->len) {
+	/* blocks without data need blo_bhead_read_full first */
+	if (bh->len && bhn->has_data) {
 		/* switch is based on file dna */
 		if (bh->SDNAnr && (fd->flags & FD_FLAGS_SWITCH_ENDIAN))
 			switch_endian_structs(fd->filesdna, bh);
@@ -2384,6 +2510,9 @@ static void direct_link_animdata(FileData *fd, AnimData *adt)
 	// TODO: it's not really nice that anyone should be able to save the file in this
 	//		state, but it's going to be too hard to enforce this single case...
 	adt->actstrip = newdataadr(fd, adt->actstrip);
+	
+	/* runtime evaluation data is rebuilt on demand */
+	adt->eval_plan = NULL;
 }	
 
 /* ************ READ MOTION PATHS *************** */
@@ -3665,6 +3794,7 @@ static void direct_link_pointcache(FileData *fd, PointCache *cache)
 	cache->simframe = 0;
 	cache->edit = NULL;
 	cache->free_edit = NULL;
+	cache->archive = NULL;
 	cache->cached_frames = NULL;
 }
 
@@ -7357,30 +7487,93 @@ static const char *dataname(short id_code)
 	
 }
 
+/* below this many bytes of data the blocks of an ID are decoded without threads */
+#define READ_DATA_PARALLEL_MIN_SIZE (1 << 18)
+
+typedef struct ReadDataBlock {
+	BHead *bhead;
+	void *data;
+	bool free_bhead;  /* bhead is a copy with the data read on demand */
+} ReadDataBlock;
+
+typedef struct ReadDataState {
+	FileData *fd;
+	ReadDataBlock *blocks;
+	const char *allocname;
+} ReadDataState;
+
+static void read_data_block_func(void *userdata, int index)
+{
+	ReadDataState *state = userdata;
+	ReadDataBlock *block = &state->blocks[index];
+	
+	block->data = read_struct(state->fd, block->bhead, state->allocname);
+}
+
 static BHead *read_data_into_oldnewmap(FileData *fd, BHead *bhead, const char *allocname)
 {
+	ReadDataBlock blocks_static[64], *blocks = blocks_static;
+	int blocks_size = ARRAY_SIZE(blocks_static), totblock = 0, i;
+	size_t totsize = 0;
+	
+	/* read all blocks of the ID first, file access is sequential */
 	bhead = blo_nextbhead(fd, bhead);
 	
 	while (bhead && bhead->code==DATA) {
-		void *data;
-#if 0
-		/* XXX DUMB DEBUGGING OPTION TO GIVE NAMES for guarded malloc errors */
-		short *sp = fd->filesdna->structs[bhead->SDNAnr];
-		char *tmp = malloc(100);
-		allocname = fd->filesdna->types[ sp[0] ];
-		strcpy(tmp, allocname);
-		data = read_struct(fd, bhead, tmp);
-#else
-		data = read_struct(fd, bhead, allocname);
-#endif
+		if (totblock == blocks_size) {
+			ReadDataBlock *oblocks = blocks;
+			
+			blocks_size *= 2;
+			blocks = MEM_mallocN(sizeof(*blocks)*blocks_size, "ReadDataBlock");
+			memcpy(blocks, oblocks, sizeof(*blocks)*totblock);
+			if (oblocks != blocks_static) {
+				MEM_freeN(oblocks);
+			}
+		}
 		
-		if (data) {
-			oldnewmap_insert(fd->datamap, bhead->old, data, 0);
+		blocks[totblock].bhead = blo_bhead_read_full(fd, bhead);
+		blocks[totblock].free_bhead = (blocks[totblock].bhead != NULL);
+		if (blocks[totblock].bhead == NULL) {
+			blocks[totblock].bhead = bhead;
 		}
+		blocks[totblock].data = NULL;
+		totblock++;
+		totsize += bhead->len;
 		
 		bhead = blo_nextbhead(fd, bhead);
 	}
 	
+	/* endian switching and DNA reconstruction of the blocks are independent,
+	 * only the large IDs are worth the threading overhead (meshes, images, caches) */
+	if (totblock > 1 && totsize >= READ_DATA_PARALLEL_MIN_SIZE) {
+		ReadDataState state;
+		
+		state.fd = fd;
+		state.blocks = blocks;
+		state.allocname = allocname;
+		
+		BLI_task_parallel_range_ex(0, totblock, &state, read_data_block_func, 2, false);
+	}
+	else {
+		for (i = 0; i < totblock; i++) {
+			blocks[i].data = read_struct(fd, blocks[i].bhead, allocname);
+		}
+	}
+	
+	/* insert in file order, the map relies on it for duplicate addresses and the lasthit guess */
+	for (i = 0; i < totblock; i++) {
+		if (blocks[i].data) {
+			oldnewmap_insert(fd->datamap, blocks[i].bhead->old, blocks[i].data, 0);
+		}
+		if (blocks[i].free_bhead) {
+			MEM_freeN((char *)blocks[i].bhead - offsetof(BHeadN, bhead));
+		}
+	}
+	
+	if (blocks != blocks_static) {
+		MEM_freeN(blocks);
+	}
+	
 	return bhead;
 }
 
@@ -7697,8 +7890,6 @@ static void do_versions_after_linking(FileData *fd, Library *lib, Main *main)
 
 static void lib_link_all(FileData *fd, Main *main)
 {
-	oldnewmap_sort(fd);
-	
 	/* No load UI for undo memfiles */
 	if (fd->memfile == NULL) {
 		lib_link_windowmanager(fd, main);
@@ -9390,7 +9581,8 @@ static void read_libraries(FileData *basefd, ListBase *mainlist)
 						        mainptr->curlib->filepath,
 						        mainptr->curlib->name,
 						        library_parent_filepath(mainptr->curlib));
-						fd = blo_openblenderfile(mainptr->curlib->filepath, basefd->reports);
+						/* usually only a few of the blocks in a library are needed */
+						fd = blo_openblenderfile_ex(mainptr->curlib->filepath, basefd->reports, true);
 					}
 					/* allow typing in a new lib path */
 					if (G.debug_value == -666) {
@@ -9407,7 +9599,7 @@ static void read_libraries(FileData *basefd, ListBase *mainlist)
 								BLI_strncpy(mainptr->curlib->filepath, newlib_path, sizeof(mainptr->curlib->filepath));
 								BLI_cleanup_path(G.main->name, mainptr->curlib->filepath);
 								
-								fd = blo_openblenderfile(mainptr->curlib->filepath, basefd->reports);
+								fd = blo_openblenderfile_ex(mainptr->curlib->filepath, basefd->reports, true);
 
 								if (fd) {
 									fd->mainlist = mainlist;
@@ -105,6 +105,10 @@ typedef struct FileData {
 
 typedef struct BHeadN {
 	struct BHeadN *next, *prev;
+	/* with FD_FLAGS_READ_ON_DEMAND the data of DATA blocks isn't read with the block,
+	 * it's read from file_offset when the block is needed */
+	z_off_t file_offset;
+	bool has_data;
 	struct BHead bhead;
 } BHeadN;
 
@@ -115,6 +119,7 @@ typedef struct BHeadN {
 #define FD_FLAGS_FILE_OK                   (1 << 3)
 #define FD_FLAGS_NOT_MY_BUFFER             (1 << 4)
 #define FD_FLAGS_NOT_MY_LIBMAP             (1 << 5)
+#define FD_FLAGS_READ_ON_DEMAND            (1 << 6)
 
 #define SIZEOFBLENDERHEADER 12
 
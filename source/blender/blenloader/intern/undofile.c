@@ -35,26 +35,248 @@
 #include <stdio.h>
 #include <math.h>
 
+#include "zlib.h"
+
 #include "MEM_guardedalloc.h"
 
 #include "DNA_listBase.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_ghash.h"
+#include "BLI_hash_mm2a.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
 
 #include "BLO_undofile.h"
 
 /* **************** support for memory-write, for undo buffers *************** */
 
+/* Chunks with the same content share one buffer, over the whole undo stack,
+ * so data that moved in the file or came back after an undo isn't stored again.
+ *
+ * Buffers that weren't used by the last few undo pushes or reads can be compressed
+ * in the background, they are uncompressed again when they are needed. */
+
+/* number of memory writes (undo pushes) a buffer stays uncompressed after it was last used */
+#define MEMFILE_HOT_WRITES 2
+
+typedef struct MemFileBuffer {
+	char *buf;                /* uncompressed data, NULL when compressed */
+	char *zbuf;               /* zlib compressed data */
+	unsigned int size, zsize;
+	unsigned int hash;
+	int users;
+	unsigned int lastused;    /* memfile_write at the last use */
+	bool compressing;         /* a compression task is pending */
+	bool nocompress;          /* compression didn't save enough memory */
+} MemFileBuffer;
+
+/* all buffers in the undo stack, buffers are keys and values */
+static GHash *memfile_buffers = NULL;
+/* protects the buffers, they are accessed by the compression tasks */
+static ThreadMutex memfile_lock = PTHREAD_MUTEX_INITIALIZER;
+static TaskPool *memfile_compress_pool = NULL;
+static bool memfile_compress_stop = false;
+/* counts the memory writes, to tell which buffers were used recently */
+static unsigned int memfile_write = 0;
+
+static unsigned int memfile_buffer_hash(const void *key)
+{
+	const MemFileBuffer *buffer = key;
+	return buffer->hash;
+}
+
+/* uncompress the buffer, lock must be held */
+static void memfile_buffer_uncompress(MemFileBuffer *buffer)
+{
+	uLongf size = buffer->size;
+	
+	buffer->buf = MEM_mallocN(buffer->size, "Chunk buffer");
+	if (uncompress((Bytef *)buffer->buf, &size, (const Bytef *)buffer->zbuf, buffer->zsize) != Z_OK ||
+	    size != buffer->size)
+	{
+		/* should never happen */
+		printf("undo: failed to uncompress chunk\n");
+		memset(buffer->buf, 0, buffer->size);
+	}
+	
+	MEM_freeN(buffer->zbuf);
+	buffer->zbuf = NULL;
+	buffer->zsize = 0;
+}
+
+static bool memfile_buffer_cmp(const void *a, const void *b)
+{
+	const MemFileBuffer *buffer_a = a;
+	MemFileBuffer *buffer_b = (MemFileBuffer *)b;
+	
+	if (buffer_a->hash != buffer_b->hash || buffer_a->size != buffer_b->size) {
+		return true;
+	}
+	
+	/* a matching buffer gets used again, so it's fine to keep it uncompressed */
+	if (buffer_b->buf == NULL) {
+		memfile_buffer_uncompress(buffer_b);
+	}
+	
+	return (memcmp(buffer_a->buf, buffer_b->buf, buffer_a->size) != 0);
+}
+
+/* lock must be held */
+static void memfile_buffer_release(MemFileBuffer *buffer)
+{
+	if (--buffer->users > 0) {
+		return;
+	}
+	
+	BLI_ghash_remove(memfile_buffers, buffer, NULL, NULL);
+	if (BLI_ghash_size(memfile_buffers) == 0) {
+		BLI_ghash_free(memfile_buffers, NULL, NULL);
+		memfile_buffers = NULL;
+	}
+	
+	if (buffer->buf)
+		MEM_freeN(buffer->buf);
+	if (buffer->zbuf)
+		MEM_freeN(buffer->zbuf);
+	MEM_freeN(buffer);
+}
+
+const char *BLO_memfile_chunk_data(MemFileChunk *chunk)
+{
+	MemFileBuffer *buffer = chunk->buffer;
+	
+	BLI_mutex_lock(&memfile_lock);
+	if (buffer->buf == NULL) {
+		memfile_buffer_uncompress(buffer);
+	}
+	buffer->lastused = memfile_write;
+	BLI_mutex_unlock(&memfile_lock);
+	
+	return buffer->buf;
+}
+
+/* memory used by the memfile, shared buffers are divided over their users */
+size_t BLO_memfile_memory(MemFile *memfile)
+{
+	MemFileChunk *chunk;
+	double memory = 0.0;
+	
+	BLI_mutex_lock(&memfile_lock);
+	for (chunk = memfile->chunks.first; chunk; chunk = chunk->next) {
+		MemFileBuffer *buffer = chunk->buffer;
+		unsigned int size = (buffer->buf) ? buffer->size : buffer->zsize;
+		
+		memory += (double)(size + sizeof(MemFileBuffer)) / (double)buffer->users + sizeof(MemFileChunk);
+	}
+	BLI_mutex_unlock(&memfile_lock);
+	
+	return (size_t)memory;
+}
+
+static void memfile_compress_task(TaskPool *UNUSED(pool), void *taskdata, int UNUSED(threadid))
+{
+	MemFileBuffer *buffer = taskdata;
+	char *zbuf = NULL;
+	uLongf zsize = 0;
+	bool cold;
+	
+	BLI_mutex_lock(&memfile_lock);
+	cold = (!memfile_compress_stop && buffer->buf && memfile_write - buffer->lastused >= MEMFILE_HOT_WRITES);
+	BLI_mutex_unlock(&memfile_lock);
+	
+	/* buf is only freed or replaced with the lock held by a compression task,
+	 * and our user keeps the buffer alive, so it can be read without the lock */
+	if (cold) {
+		zsize = compressBound(buffer->size);
+		zbuf = MEM_mallocN(zsize, "Chunk compressed buffer");
+		
+		if (compress2((Bytef *)zbuf, &zsize, (const Bytef *)buffer->buf, buffer->size, Z_BEST_SPEED) != Z_OK ||
+		    zsize > buffer->size - buffer->size / 4)
+		{
+			MEM_freeN(zbuf);
+			zbuf = NULL;
+		}
+		else {
+			zbuf = MEM_reallocN(zbuf, zsize);
+		}
+	}
+	
+	BLI_mutex_lock(&memfile_lock);
+	if (cold) {
+		/* don't compress buffers that got used again in the meantime */
+		if (zbuf && buffer->buf && memfile_write - buffer->lastused >= MEMFILE_HOT_WRITES) {
+			MEM_freeN(buffer->buf);
+			buffer->buf = NULL;
+			buffer->zbuf = zbuf;
+			buffer->zsize = (unsigned int)zsize;
+			zbuf = NULL;
+		}
+		else if (zbuf == NULL) {
+			buffer->nocompress = true;
+		}
+	}
+	buffer->compressing = false;
+	memfile_buffer_release(buffer);
+	BLI_mutex_unlock(&memfile_lock);
+	
+	if (zbuf) {
+		MEM_freeN(zbuf);
+	}
+}
+
+/* compress the buffers of an older undo step in the background */
+void BLO_memfile_compress(MemFile *memfile)
+{
+	MemFileChunk *chunk;
+	
+	if (memfile_compress_pool == NULL) {
+		memfile_compress_pool = BLI_task_pool_create(BLI_task_scheduler_get(), NULL);
+	}
+	
+	BLI_mutex_lock(&memfile_lock);
+	memfile_compress_stop = false;
+	for (chunk = memfile->chunks.first; chunk; chunk = chunk->next) {
+		MemFileBuffer *buffer = chunk->buffer;
+		
+		/* small chunks aren't worth the overhead */
+		if (buffer->buf && !buffer->compressing && !buffer->nocompress && buffer->size >= 1024 &&
+		    memfile_write - buffer->lastused >= MEMFILE_HOT_WRITES)
+		{
+			/* the task keeps a user, so the buffer isn't freed before it ran */
+			buffer->users++;
+			buffer->compressing = true;
+			BLI_task_pool_push(memfile_compress_pool, memfile_compress_task, buffer, false, TASK_PRIORITY_LOW);
+		}
+	}
+	BLI_mutex_unlock(&memfile_lock);
+}
+
+/* skip compression tasks that didn't run yet and wait for the others to finish */
+void BLO_memfile_compress_finish(void)
+{
+	if (memfile_compress_pool) {
+		BLI_mutex_lock(&memfile_lock);
+		memfile_compress_stop = true;
+		BLI_mutex_unlock(&memfile_lock);
+		
+		BLI_task_pool_work_and_wait(memfile_compress_pool);
+		BLI_task_pool_free(memfile_compress_pool);
+		memfile_compress_pool = NULL;
+	}
+}
+
 /* not memfile itself */
 void BLO_free_memfile(MemFile *memfile)
 {
 	MemFileChunk *chunk;
 	
+	BLI_mutex_lock(&memfile_lock);
 	while ((chunk = BLI_pophead(&memfile->chunks))) {
-		if (chunk->ident == 0)
-			MEM_freeN(chunk->buf);
+		memfile_buffer_release(chunk->buffer);
 		MEM_freeN(chunk);
 	}
+	BLI_mutex_unlock(&memfile_lock);
 	memfile->size = 0;
 }
 
@@ -62,75 +284,82 @@ void BLO_free_memfile(MemFile *memfile)
 /* result is that 'first' is being freed */
 void BLO_merge_memfile(MemFile *first, MemFile *second)
 {
-	MemFileChunk *fc, *sc;
-	
-	fc = first->chunks.first;
-	sc = second->chunks.first;
-	while (fc || sc) {
-		if (fc && sc) {
-			if (sc->ident) {
-				sc->ident = 0;
-				fc->ident = 1;
-			}
-		}
-		if (fc) fc = fc->next;
-		if (sc) sc = sc->next;
-	}
+	/* buffers are reference counted, 'second' keeps the ones it shares with 'first' */
+	UNUSED_VARS(second);
 	
 	BLO_free_memfile(first);
 }
 
-static int my_memcmp(const int *mem1, const int *mem2, const int len)
-{
-	register int a = len;
-	register const int *mema = mem1;
-	register const int *memb = mem2;
-	
-	while (a--) {
-		if (*mema != *memb) return 1;
-		mema++;
-		memb++;
-	}
-	return 0;
-}
-
 void add_memfilechunk(MemFile *compare, MemFile *current, const char *buf, unsigned int size)
 {
 	static MemFileChunk *compchunk = NULL;
 	MemFileChunk *curchunk;
+	MemFileBuffer *buffer = NULL;
 	
 	/* this function inits when compare != NULL or when current == NULL  */
 	if (compare) {
 		compchunk = compare->chunks.first;
+		memfile_write++;
 		return;
 	}
 	if (current == NULL) {
 		compchunk = NULL;
+		memfile_write++;
 		return;
 	}
 	
 	curchunk = MEM_mallocN(sizeof(MemFileChunk), "MemFileChunk");
 	curchunk->size = size;
-	curchunk->buf = NULL;
-	curchunk->ident = 0;
+	curchunk->buffer = NULL;
 	BLI_addtail(&current->chunks, curchunk);
 	
-	/* we compare compchunk with buf */
+	BLI_mutex_lock(&memfile_lock);
+	
+	/* unchanged data is mostly at the same position as in the previous memfile */
 	if (compchunk) {
-		if (compchunk->size == curchunk->size) {
-			if (my_memcmp((int *)compchunk->buf, (const int *)buf, size / 4) == 0) {
-				curchunk->buf = compchunk->buf;
-				curchunk->ident = 1;
-			}
+		MemFileBuffer *compbuffer = compchunk->buffer;
+		
+		if (compbuffer->size == size && compbuffer->buf && memcmp(compbuffer->buf, buf, size) == 0) {
+			buffer = compbuffer;
 		}
 		compchunk = compchunk->next;
 	}
 	
-	/* not equal... */
-	if (curchunk->buf == NULL) {
-		curchunk->buf = MEM_mallocN(size, "Chunk buffer");
-		memcpy(curchunk->buf, buf, size);
-		current->size += size;
+	/* otherwise look for the same content anywhere in the undo stack */
+	if (buffer == NULL) {
+		MemFileBuffer key;
+		BLI_HashMurmur2A mm2;
+		
+		BLI_hash_mm2a_init(&mm2, 0);
+		BLI_hash_mm2a_add(&mm2, (const unsigned char *)buf, size);
+		
+		key.buf = (char *)buf;
+		key.size = size;
+		key.hash = BLI_hash_mm2a_end(&mm2);
+		
+		if (memfile_buffers == NULL) {
+			memfile_buffers = BLI_ghash_new(memfile_buffer_hash, memfile_buffer_cmp, "MemFile buffers");
+		}
+		
+		buffer = BLI_ghash_lookup(memfile_buffers, &key);
+		
+		/* not equal... */
+		if (buffer == NULL) {
+			buffer = MEM_callocN(sizeof(MemFileBuffer), "MemFileBuffer");
+			buffer->buf = MEM_mallocN(size, "Chunk buffer");
+			memcpy(buffer->buf, buf, size);
+			buffer->size = size;
+			buffer->hash = key.hash;
+			BLI_ghash_insert(memfile_buffers, buffer, buffer);
+			
+			current->size += size;
+		}
 	}
+	
+	buffer->users++;
+	buffer->lastused = memfile_write;
+	curchunk->buffer = buffer;
+	
+	BLI_mutex_unlock(&memfile_lock);
 }
 
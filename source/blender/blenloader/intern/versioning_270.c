@@ -418,6 +418,15 @@ void blo_do_versions_270(FileData *fd, Library *UNUSED(lib), Main *main)
 			}
 		}
 
+		if (!DNA_struct_elem_find(fd->filesdna, "bNodeTree", "int", "cache_size")) {
+			Scene *scene;
+			for (scene = main->scene.first; scene != NULL; scene = scene->id.next) {
+				if (scene->nodetree) {
+					scene->nodetree->cache_size = 1024;
+				}
+			}
+		}
+
 		if (!DNA_struct_elem_find(fd->filesdna, "bStretchToConstraint", "float", "bulge_min")) {
 			Object *ob;
 
@@ -143,6 +143,8 @@
 #include "BLI_blenlib.h"
 #include "BLI_linklist.h"
 #include "BLI_mempool.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
 
 #include "BKE_action.h"
 #include "BKE_blender.h"
@@ -200,7 +202,7 @@ struct WriteWrap {
 	/* internal */
 	union {
 		int file_handle;
-		gzFile gz_handle;
+		struct ZlibWriter *zlib_writer;
 	} _user_data;
 };
 
@@ -232,31 +234,277 @@ static size_t ww_write_none(WriteWrap *ww, const char *buf, size_t buf_len)
 }
 #undef FILE_HANDLE
 
-/* zlib */
-#define FILE_HANDLE(ww) \
-	(ww)->_user_data.gz_handle
+/* zlib, written as a gzip stream compressed in blocks on worker threads.
+ *
+ * Every block is deflated on its own, primed with the end of the previous block.
+ * All blocks but the last end with a sync flush, so the blocks concatenate into
+ * a single deflate stream that gzread() reads like any other gzip file. */
 
-static bool ww_open_zlib(WriteWrap *ww, const char *filepath)
+#define ZLIB_BLOCK_SIZE (1 << 20)
+#define ZLIB_DICT_SIZE  (1 << 15)
+
+typedef struct ZlibBlock {
+	struct ZlibBlock *next, *prev;
+
+	char *in;                      /* uncompressed data, freed once compressed */
+	size_t in_len;
+	char dict[ZLIB_DICT_SIZE];     /* end of the previous block */
+	unsigned int dict_len;
+
+	char *out;
+	size_t out_len;
+	uLong crc;
+
+	bool last, done, error;
+} ZlibBlock;
+
+typedef struct ZlibWriter {
+	int file_handle;
+
+	TaskPool *pool;
+	ThreadMutex mutex;             /* for ZlibBlock.done */
+	ThreadCondition done_cond;     /* signaled when a block is done */
+	int max_blocks;
+	bool threaded;                 /* false when there are no worker threads to wait for */
+
+	ListBase blocks;               /* compressing or compressed blocks, in file order */
+	int totblock;
+	ZlibBlock *block;              /* block being filled */
+
+	uLong crc;
+	size_t total_in;
+	bool error;
+} ZlibWriter;
+
+static void zlib_block_compress_task(TaskPool *pool, void *taskdata, int UNUSED(threadid))
 {
-	gzFile file;
+	ZlibWriter *writer = BLI_task_pool_userdata(pool);
+	ZlibBlock *block = taskdata;
+	z_stream strm;
+	size_t out_size;
+	int ret;
 
-	file = BLI_gzopen(filepath, "wb1");
+	block->crc = crc32(0L, (const Bytef *)block->in, (uInt)block->in_len);
 
-	if (file != Z_NULL) {
-		FILE_HANDLE(ww) = file;
-		return true;
+	memset(&strm, 0, sizeof(strm));
+	/* negative window bits give a raw deflate stream, level 1 like before */
+	if (deflateInit2(&strm, 1, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK) {
+		/* room for the sync flush marker too */
+		out_size = deflateBound(&strm, block->in_len) + 16;
+		block->out = MEM_mallocN(out_size, "ZlibBlock.out");
+
+		if (block->dict_len) {
+			deflateSetDictionary(&strm, (const Bytef *)block->dict, block->dict_len);
+		}
+
+		strm.next_in = (Bytef *)block->in;
+		strm.avail_in = (uInt)block->in_len;
+		strm.next_out = (Bytef *)block->out;
+		strm.avail_out = (uInt)out_size;
+
+		ret = deflate(&strm, block->last ? Z_FINISH : Z_SYNC_FLUSH);
+
+		/* the output of a sync flush is only complete when there is room left */
+		if (block->last ? (ret != Z_STREAM_END) : (ret != Z_OK || strm.avail_out == 0)) {
+			block->error = true;
+		}
+		block->out_len = out_size - strm.avail_out;
+
+		deflateEnd(&strm);
+	}
+	else {
+		block->error = true;
+	}
+
+	MEM_freeN(block->in);
+	block->in = NULL;
+
+	BLI_mutex_lock(&writer->mutex);
+	block->done = true;
+	BLI_condition_notify_all(&writer->done_cond);
+	BLI_mutex_unlock(&writer->mutex);
+}
+
+static bool zlib_write_all(ZlibWriter *writer, const void *buf, size_t buf_len)
+{
+	const char *data = buf;
+
+	while (buf_len > 0) {
+		int written = write(writer->file_handle, data, buf_len);
+		if (written <= 0) {
+			return false;
+		}
+		data += written;
+		buf_len -= (size_t)written;
+	}
+	return true;
+}
+
+/* write out the compressed blocks at the start of the list,
+ * optionally waiting for the first block to be compressed */
+static void zlib_writer_flush(ZlibWriter *writer, bool wait)
+{
+	ZlibBlock *block;
+
+	if (wait && (block = writer->blocks.first)) {
+		if (writer->threaded) {
+			/* only wait for the oldest block, the others keep compressing while it's written */
+			BLI_mutex_lock(&writer->mutex);
+			while (!block->done) {
+				BLI_condition_wait(&writer->done_cond, &writer->mutex);
+			}
+			BLI_mutex_unlock(&writer->mutex);
+		}
+		else {
+			/* tasks only run while waiting for the pool here */
+			BLI_task_pool_work_and_wait(writer->pool);
+		}
+	}
+
+	while ((block = writer->blocks.first)) {
+		bool done;
+
+		BLI_mutex_lock(&writer->mutex);
+		done = block->done;
+		BLI_mutex_unlock(&writer->mutex);
+
+		if (!done) {
+			break;
+		}
+
+		if (block->error || !zlib_write_all(writer, block->out, block->out_len)) {
+			writer->error = true;
+		}
+		writer->crc = crc32_combine(writer->crc, block->crc, (z_off_t)block->in_len);
+		writer->total_in += block->in_len;
+
+		BLI_remlink(&writer->blocks, block);
+		writer->totblock--;
+		if (block->out) {
+			MEM_freeN(block->out);
+		}
+		MEM_freeN(block);
+	}
+}
+
+static ZlibBlock *zlib_block_new(void)
+{
+	ZlibBlock *block = MEM_callocN(sizeof(ZlibBlock), "ZlibBlock");
+	block->in = MEM_mallocN(ZLIB_BLOCK_SIZE, "ZlibBlock.in");
+	return block;
+}
+
+/* hand the current block to the compression tasks and start a new one */
+static void zlib_writer_push(ZlibWriter *writer, bool last)
+{
+	ZlibBlock *block = writer->block;
+
+	block->last = last;
+
+	if (!last) {
+		/* prime the next block with the end of this one, before a task frees it */
+		writer->block = zlib_block_new();
+		writer->block->dict_len = (unsigned int)MIN2(block->in_len, ZLIB_DICT_SIZE);
+		memcpy(writer->block->dict, block->in + block->in_len - writer->block->dict_len, writer->block->dict_len);
 	}
 	else {
+		writer->block = NULL;
+	}
+
+	BLI_addtail(&writer->blocks, block);
+	writer->totblock++;
+	/* low priority keeps the queue in file order, so the oldest block is compressed first */
+	BLI_task_pool_push(writer->pool, zlib_block_compress_task, block, false, TASK_PRIORITY_LOW);
+
+	/* don't keep more uncompressed data around than the threads can work on */
+	zlib_writer_flush(writer, writer->totblock > writer->max_blocks);
+}
+
+#define FILE_HANDLE(ww) \
+	(ww)->_user_data.zlib_writer
+
+static bool ww_open_zlib(WriteWrap *ww, const char *filepath)
+{
+	/* gzip header: magic, deflate, no flags, no time, no extra flags, unix */
+	const unsigned char header[10] = {0x1f, 0x8b, Z_DEFLATED, 0, 0, 0, 0, 0, 0, 3};
+	ZlibWriter *writer;
+	TaskScheduler *scheduler;
+	int file;
+
+	file = BLI_open(filepath, O_BINARY + O_WRONLY + O_CREAT + O_TRUNC, 0666);
+
+	if (file == -1) {
 		return false;
 	}
+
+	scheduler = BLI_task_scheduler_get();
+
+	writer = MEM_callocN(sizeof(ZlibWriter), "ZlibWriter");
+	writer->file_handle = file;
+	writer->pool = BLI_task_pool_create(scheduler, writer);
+	writer->max_blocks = 2 * BLI_task_scheduler_num_threads(scheduler);
+	writer->threaded = BLI_task_scheduler_num_threads(scheduler) > 1;
+	writer->crc = crc32(0L, Z_NULL, 0);
+	writer->block = zlib_block_new();
+	BLI_mutex_init(&writer->mutex);
+	BLI_condition_init(&writer->done_cond);
+
+	if (!zlib_write_all(writer, header, sizeof(header))) {
+		writer->error = true;
+	}
+
+	FILE_HANDLE(ww) = writer;
+	return true;
 }
 static bool ww_close_zlib(WriteWrap *ww)
 {
-	return (gzclose(FILE_HANDLE(ww)) == Z_OK);
+	ZlibWriter *writer = FILE_HANDLE(ww);
+	unsigned char trailer[8];
+	bool ok;
+	int i;
+
+	/* the last block finishes the deflate stream, even when it's empty */
+	zlib_writer_push(writer, true);
+	BLI_task_pool_work_and_wait(writer->pool);
+	zlib_writer_flush(writer, false);
+
+	/* gzip trailer: crc and uncompressed size modulo 2^32, little endian */
+	for (i = 0; i < 4; i++) {
+		trailer[i] = (unsigned char)(writer->crc >> (8 * i));
+		trailer[i + 4] = (unsigned char)((uint64_t)writer->total_in >> (8 * i));
+	}
+	if (!writer->error && !zlib_write_all(writer, trailer, sizeof(trailer))) {
+		writer->error = true;
+	}
+
+	ok = (close(writer->file_handle) != -1) && !writer->error;
+
+	BLI_task_pool_free(writer->pool);
+	BLI_condition_end(&writer->done_cond);
+	BLI_mutex_end(&writer->mutex);
+	MEM_freeN(writer);
+
+	return ok;
 }
 static size_t ww_write_zlib(WriteWrap *ww, const char *buf, size_t buf_len)
 {
-	return gzwrite(FILE_HANDLE(ww), buf, buf_len);
+	ZlibWriter *writer = FILE_HANDLE(ww);
+	size_t buf_done = 0;
+
+	while (buf_done < buf_len) {
+		ZlibBlock *block = writer->block;
+		size_t len = MIN2(buf_len - buf_done, ZLIB_BLOCK_SIZE - block->in_len);
+
+		memcpy(block->in + block->in_len, buf + buf_done, len);
+		block->in_len += len;
+		buf_done += len;
+
+		if (block->in_len == ZLIB_BLOCK_SIZE) {
+			zlib_writer_push(writer, false);
+		}
+	}
+
+	return (writer->error) ? 0 : buf_len;
 }
 #undef FILE_HANDLE
 
@@ -472,6 +720,12 @@ static void writestruct_at_address(WriteData *wd, int filecode, const char *stru
 
 	if (bh.len==0) return;
 
+	/* for undo, start a new chunk at every ID so the chunks of unchanged IDs keep their content
+	 * when data before them changes size, they are then shared with the previous undo steps */
+	if (wd->current && filecode != DATA) {
+		mywrite(wd, MYWRITE_FLUSH, 0);
+	}
+
 	mywrite(wd, &bh, sizeof(BHead));
 	mywrite(wd, data, bh.len);
 }
@@ -3683,7 +3937,9 @@ int BLO_write_file(Main *mainvar, const char *filepath, int write_flags, ReportL
 	/* actual file writing */
 	err = write_file_handle(mainvar, &ww, NULL, NULL, write_user_block, write_flags, thumb);
 
-	ww.close(&ww);
+	if (ww.close(&ww) == false) {
+		err = 1;
+	}
 
 	if (UNLIKELY(path_list_backup)) {
 		BKE_bpath_list_restore(mainvar, path_list_flag, path_list_backup);
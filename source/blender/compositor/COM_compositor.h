@@ -327,8 +327,9 @@ void COM_deinitialize(void);
 /**
  * @brief Clear all compositor caches. (Compositor system will still remain available). 
  * To deinitialize the compositor use the COM_deinitialize method.
+ * The caches are freed before the next execution, so this can be called while the compositor is running.
  */
-// void COM_clearCaches(void); // NOT YET WRITTEN
+void COM_clearCaches(void);
 
 /**
  * @brief Return a list of highlighted bnodes pointers.
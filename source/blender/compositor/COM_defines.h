@@ -107,6 +107,12 @@ typedef enum OrderOfChunks {
 
 #define COM_NUMBER_OF_CHANNELS 4
 
+/**
+ * @brief number of pixels an operation processes at once when executing a row
+ * @see SocketReader.executeRow
+ */
+#define COM_ROW_BLOCK_SIZE 64
+
 #define COM_BLUR_BOKEH_PIXELS 512
 
 #endif  /* __COM_DEFINES_H__ */
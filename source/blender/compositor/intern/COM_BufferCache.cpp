@@ -0,0 +1,251 @@
+/*
+ * Copyright 2015, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <map>
+#include <stdio.h>
+#include <string.h>
+
+#include "COM_BufferCache.h"
+#include "COM_MemoryBuffer.h"
+#include "COM_MemoryProxy.h"
+#include "COM_WriteBufferOperation.h"
+
+extern "C" {
+#  include "BLI_fileops.h"
+#  include "BLI_path_util.h"
+#  include "BLI_rect.h"
+#  include "BLI_string.h"
+#  include "BKE_appdir.h"
+}
+
+/**
+ * @brief the disk tier may use this many times the memory limit
+ */
+#define COM_BUFFER_CACHE_DISK_FACTOR 4
+
+typedef struct BufferCacheEntry {
+	/* buffer in memory, NULL when the buffer is written to disk */
+	MemoryBuffer *buffer;
+	DataType datatype;
+	rcti rect;
+	/* size of the buffer data in bytes */
+	size_t size;
+	/* counter value at the last use, for least recently used eviction */
+	unsigned int lastUsed;
+} BufferCacheEntry;
+
+typedef std::map<BufferCacheKey, BufferCacheEntry> BufferCacheEntries;
+
+static BufferCacheEntries g_entries;
+static size_t g_memoryLimit = 0;
+static size_t g_memoryInUse = 0;
+static size_t g_diskInUse = 0;
+static bool g_useDisk = false;
+static unsigned int g_useCounter = 0;
+
+void BufferCacheHash::addString(const char *str)
+{
+	if (str) {
+		add(str, strlen(str));
+	}
+	addInt(0);
+}
+
+static void buffer_cache_filepath(char *filepath, BufferCacheKey key)
+{
+	char filename[64];
+	BLI_snprintf(filename, sizeof(filename), "compositor_cache_%016llx.bin", (unsigned long long)key);
+	BLI_make_file_string("/", filepath, BKE_tempdir_session(), filename);
+}
+
+static bool buffer_cache_write(BufferCacheKey key, MemoryBuffer *buffer, size_t size)
+{
+	char filepath[FILE_MAX];
+	buffer_cache_filepath(filepath, key);
+
+	FILE *file = BLI_fopen(filepath, "wb");
+	if (file == NULL) {
+		return false;
+	}
+	bool ok = (fwrite(buffer->getBuffer(), 1, size, file) == size);
+	fclose(file);
+
+	if (!ok) {
+		BLI_delete(filepath, false, false);
+	}
+	return ok;
+}
+
+static MemoryBuffer *buffer_cache_read(BufferCacheKey key, MemoryProxy *memoryProxy, BufferCacheEntry &entry)
+{
+	char filepath[FILE_MAX];
+	buffer_cache_filepath(filepath, key);
+
+	FILE *file = BLI_fopen(filepath, "rb");
+	if (file == NULL) {
+		return NULL;
+	}
+	MemoryBuffer *buffer = new MemoryBuffer(memoryProxy, 1, &entry.rect);
+	bool ok = (fread(buffer->getBuffer(), 1, entry.size, file) == entry.size);
+	fclose(file);
+
+	if (!ok) {
+		delete buffer;
+		return NULL;
+	}
+	return buffer;
+}
+
+/* free the entry data, the entry itself stays in the map */
+static void buffer_cache_free_entry(BufferCacheKey key, BufferCacheEntry &entry)
+{
+	if (entry.buffer) {
+		delete entry.buffer;
+		entry.buffer = NULL;
+		g_memoryInUse -= entry.size;
+	}
+	else {
+		char filepath[FILE_MAX];
+		buffer_cache_filepath(filepath, key);
+		BLI_delete(filepath, false, false);
+		g_diskInUse -= entry.size;
+	}
+}
+
+static BufferCacheEntries::iterator buffer_cache_least_recently_used(bool inMemory)
+{
+	BufferCacheEntries::iterator result = g_entries.end();
+	for (BufferCacheEntries::iterator it = g_entries.begin(); it != g_entries.end(); ++it) {
+		if ((it->second.buffer != NULL) != inMemory) {
+			continue;
+		}
+		if (result == g_entries.end() || it->second.lastUsed < result->second.lastUsed) {
+			result = it;
+		}
+	}
+	return result;
+}
+
+/* move least recently used buffers to disk or free them until the limits are met */
+static void buffer_cache_evict()
+{
+	while (g_memoryInUse > g_memoryLimit) {
+		BufferCacheEntries::iterator it = buffer_cache_least_recently_used(true);
+		BufferCacheEntry &entry = it->second;
+
+		if (g_useDisk && buffer_cache_write(it->first, entry.buffer, entry.size)) {
+			delete entry.buffer;
+			entry.buffer = NULL;
+			g_memoryInUse -= entry.size;
+			g_diskInUse += entry.size;
+		}
+		else {
+			buffer_cache_free_entry(it->first, entry);
+			g_entries.erase(it);
+		}
+	}
+
+	const size_t diskLimit = (g_useDisk) ? g_memoryLimit * COM_BUFFER_CACHE_DISK_FACTOR : 0;
+	while (g_diskInUse > diskLimit) {
+		BufferCacheEntries::iterator it = buffer_cache_least_recently_used(false);
+		buffer_cache_free_entry(it->first, it->second);
+		g_entries.erase(it);
+	}
+}
+
+void BufferCache::setLimits(size_t memoryLimit, bool useDisk)
+{
+	g_memoryLimit = memoryLimit;
+	g_useDisk = useDisk;
+	buffer_cache_evict();
+}
+
+MemoryBuffer *BufferCache::acquire(BufferCacheKey key, MemoryProxy *memoryProxy)
+{
+	BufferCacheEntries::iterator it = g_entries.find(key);
+	if (it == g_entries.end()) {
+		return NULL;
+	}
+
+	BufferCacheEntry &entry = it->second;
+	WriteBufferOperation *operation = memoryProxy->getWriteBufferOperation();
+
+	/* keys include the resolution and datatype, but hash collisions should never give wrong buffers */
+	if (entry.datatype != memoryProxy->getDataType() ||
+	    BLI_rcti_size_x(&entry.rect) != (int)operation->getWidth() ||
+	    BLI_rcti_size_y(&entry.rect) != (int)operation->getHeight())
+	{
+		buffer_cache_free_entry(key, entry);
+		g_entries.erase(it);
+		return NULL;
+	}
+
+	/* ownership goes to the proxy, the buffer is added again after execution */
+	MemoryBuffer *buffer;
+	if (entry.buffer) {
+		buffer = entry.buffer;
+		buffer->setMemoryProxy(memoryProxy);
+		entry.buffer = NULL;
+		g_memoryInUse -= entry.size;
+	}
+	else {
+		buffer = buffer_cache_read(key, memoryProxy, entry);
+		buffer_cache_free_entry(key, entry);
+	}
+	g_entries.erase(it);
+
+	if (buffer) {
+		buffer->setCreatedState();
+	}
+	return buffer;
+}
+
+void BufferCache::release(BufferCacheKey key, MemoryBuffer *buffer)
+{
+	remove(key);
+
+	BufferCacheEntry entry;
+	entry.buffer = buffer;
+	entry.datatype = buffer->getDataType();
+	entry.rect = *buffer->getRect();
+	entry.size = sizeof(float) * buffer->getNumberOfChannels() * BLI_rcti_size_x(&entry.rect) * BLI_rcti_size_y(&entry.rect);
+	entry.lastUsed = ++g_useCounter;
+	buffer->setMemoryProxy(NULL);
+
+	g_entries[key] = entry;
+	g_memoryInUse += entry.size;
+
+	buffer_cache_evict();
+}
+
+void BufferCache::remove(BufferCacheKey key)
+{
+	BufferCacheEntries::iterator it = g_entries.find(key);
+	if (it != g_entries.end()) {
+		buffer_cache_free_entry(key, it->second);
+		g_entries.erase(it);
+	}
+}
+
+void BufferCache::clear()
+{
+	for (BufferCacheEntries::iterator it = g_entries.begin(); it != g_entries.end(); ++it) {
+		buffer_cache_free_entry(it->first, it->second);
+	}
+	g_entries.clear();
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2015, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _COM_BufferCache_h_
+#define _COM_BufferCache_h_
+
+#include <stddef.h>
+
+extern "C" {
+#  include "BLI_sys_types.h"
+}
+
+#ifdef WITH_CXX_GUARDEDALLOC
+#  include "MEM_guardedalloc.h"
+#endif
+
+class MemoryBuffer;
+class MemoryProxy;
+
+/**
+ * @brief key of a buffer in the BufferCache.
+ * The key is a hash of the settings of the operation writing the buffer and of all operations it depends on.
+ * 0 is used for buffers that can't be cached.
+ * @ingroup Memory
+ */
+typedef uint64_t BufferCacheKey;
+
+/**
+ * @brief incremental FNV-1a hash used to construct BufferCacheKeys
+ * @ingroup Memory
+ */
+class BufferCacheHash {
+private:
+	uint64_t m_hash;
+
+public:
+	BufferCacheHash() : m_hash(14695981039346656037ULL) {}
+
+	void add(const void *data, size_t size)
+	{
+		const unsigned char *bytes = (const unsigned char *)data;
+		for (size_t i = 0; i < size; i++) {
+			m_hash ^= bytes[i];
+			m_hash *= 1099511628211ULL;
+		}
+	}
+
+	void addInt(int value) { add(&value, sizeof(value)); }
+	void addFloat(float value) { add(&value, sizeof(value)); }
+	void addPointer(const void *pointer) { add(&pointer, sizeof(pointer)); }
+	void addKey(BufferCacheKey key) { add(&key, sizeof(key)); }
+	void addString(const char *str);
+
+	/**
+	 * @brief get the key, never 0 so the result is always a valid key
+	 */
+	BufferCacheKey getKey() const { return (m_hash != 0) ? m_hash : 1; }
+};
+
+/**
+ * @brief cache of the buffers of MemoryProxies between executions of the compositor.
+ *
+ * When a node is tweaked, only the buffers depending on it get a new key, so all
+ * buffers upstream can be reused from the previous execution. The cache keeps the
+ * most recently used buffers in memory, when the memory limit is exceeded the least
+ * recently used buffers are written to disk (when enabled) or freed.
+ *
+ * The cache is only accessed from the thread running COM_execute, which is guarded
+ * by the compositor mutex, so it doesn't need its own locking.
+ * @ingroup Memory
+ */
+class BufferCache {
+public:
+	/**
+	 * @brief set the memory limit in bytes and whether buffers exceeding it are written to disk
+	 */
+	static void setLimits(size_t memoryLimit, bool useDisk);
+
+	/**
+	 * @brief take a buffer out of the cache, loading it from disk when needed.
+	 * @param key key of the buffer
+	 * @param memoryProxy the proxy the buffer will be used for, the buffer is only returned when
+	 * resolution and datatype match
+	 * @return the buffer or NULL, the caller owns the buffer
+	 */
+	static MemoryBuffer *acquire(BufferCacheKey key, MemoryProxy *memoryProxy);
+
+	/**
+	 * @brief add a completely calculated buffer to the cache, the cache takes ownership of the buffer
+	 */
+	static void release(BufferCacheKey key, MemoryBuffer *buffer);
+
+	/**
+	 * @brief remove a buffer from the cache, used when its content is outdated
+	 */
+	static void remove(BufferCacheKey key);
+
+	/**
+	 * @brief remove all buffers from the cache
+	 */
+	static void clear();
+
+#ifdef WITH_CXX_GUARDEDALLOC
+	MEM_CXX_CLASS_ALLOC_FUNCS("COM:BufferCache")
+#endif
+};
+
+#endif /* _COM_BufferCache_h_ */
@@ -186,6 +186,12 @@ public:
 	void setFastCalculation(bool fastCalculation) {this->m_fastCalculation = fastCalculation;}
 	bool isFastCalculation() const { return this->m_fastCalculation; }
 	bool isGroupnodeBufferEnabled() const { return this->getbNodeTree()->flag & NTREE_COM_GROUPNODE_BUFFER; }
+
+	/**
+	 * @brief are buffers kept between executions, only done when editing
+	 * @see BufferCache
+	 */
+	bool isBufferCacheEnabled() const { return !this->m_rendering && (this->getbNodeTree()->flag & NTREE_COM_BUFFER_CACHE); }
 };
 
 
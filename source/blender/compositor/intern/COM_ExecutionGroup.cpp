@@ -118,8 +118,14 @@ void ExecutionGroup::initExecution()
 	this->m_chunkExecutionStates = NULL;
 	if (this->m_numberOfChunks != 0) {
 		this->m_chunkExecutionStates = (ChunkExecutionState *)MEM_mallocN(sizeof(ChunkExecutionState) * this->m_numberOfChunks, __func__);
+		/* chunks of a buffer restored from the BufferCache don't need to be calculated */
+		ChunkExecutionState state = COM_ES_NOT_SCHEDULED;
+		NodeOperation *operation = this->getOutputOperation();
+		if (operation->isWriteBufferOperation() && ((WriteBufferOperation *)operation)->getMemoryProxy()->isCached()) {
+			state = COM_ES_EXECUTED;
+		}
 		for (index = 0; index < this->m_numberOfChunks; index++) {
-			this->m_chunkExecutionStates[index] = COM_ES_NOT_SCHEDULED;
+			this->m_chunkExecutionStates[index] = state;
 		}
 	}
 
@@ -151,6 +157,30 @@ void ExecutionGroup::deinitExecution()
 	this->m_cachedReadOperations.clear();
 	this->m_bTree = NULL;
 }
+
+void ExecutionGroup::storeInBufferCache(bool cancelled)
+{
+	NodeOperation *operation = this->getOutputOperation();
+	if (!operation->isWriteBufferOperation()) {
+		return;
+	}
+	MemoryProxy *memoryProxy = ((WriteBufferOperation *)operation)->getMemoryProxy();
+	if (memoryProxy->isCached()) {
+		/* unchanged, store it again */
+		memoryProxy->storeInCache();
+		return;
+	}
+	if (cancelled || this->m_numberOfChunks == 0) {
+		return;
+	}
+	for (unsigned int index = 0; index < this->m_numberOfChunks; index++) {
+		if (this->m_chunkExecutionStates[index] != COM_ES_EXECUTED) {
+			return;
+		}
+	}
+	memoryProxy->storeInCache();
+}
+
 void ExecutionGroup::determineResolution(unsigned int resolution[2])
 {
 	NodeOperation *operation = this->getOutputOperation();
@@ -363,6 +363,13 @@ public:
 	 * @note It will release all needed resources
 	 */
 	void deinitExecution();
+
+	/**
+	 * @brief hand the buffer written by this ExecutionGroup over to the BufferCache.
+	 * @note Only complete buffers are stored, this must be called before the operations are deinitialized.
+	 * @param cancelled the execution was cancelled, calculated chunks can be unfinished
+	 */
+	void storeInBufferCache(bool cancelled);
 	
 	
 	/**
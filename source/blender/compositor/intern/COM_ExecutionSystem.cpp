@@ -28,6 +28,7 @@ extern "C" {
 #include "BKE_node.h"
 }
 
+#include "COM_BufferCache.h"
 #include "COM_Converter.h"
 #include "COM_NodeOperationBuilder.h"
 #include "COM_NodeOperation.h"
@@ -63,6 +64,15 @@ ExecutionSystem::ExecutionSystem(RenderData *rd, Scene *scene, bNodeTree *editin
 	this->m_context.setViewSettings(viewSettings);
 	this->m_context.setDisplaySettings(displaySettings);
 
+	if (this->m_context.isBufferCacheEnabled()) {
+		BufferCache::setLimits((size_t)editingtree->cache_size * 1024 * 1024,
+		                       (editingtree->flag & NTREE_COM_BUFFER_CACHE_DISK) != 0);
+	}
+	else if (!(editingtree->flag & NTREE_COM_BUFFER_CACHE)) {
+		/* free the memory when the cache is disabled */
+		BufferCache::clear();
+	}
+
 	{
 		NodeOperationBuilder builder(&m_context, editingtree);
 		builder.convertToOperations(this);
@@ -166,6 +176,16 @@ void ExecutionSystem::execute()
 	WorkScheduler::finish();
 	WorkScheduler::stop();
 
+	/* keep the buffers for the next execution */
+	if (this->m_context.isBufferCacheEnabled()) {
+		const bNodeTree *bTree = this->m_context.getbNodeTree();
+		bool cancelled = bTree->test_break && bTree->test_break(bTree->tbh);
+		for (index = 0; index < this->m_groups.size(); index++) {
+			ExecutionGroup *executionGroup = this->m_groups[index];
+			executionGroup->storeInBufferCache(cancelled);
+		}
+	}
+
 	for (index = 0; index < this->m_operations.size(); index++) {
 		NodeOperation *operation = this->m_operations[index];
 		operation->deinitExecution();
@@ -32,6 +32,19 @@ unsigned int MemoryBuffer::determineBufferSize()
 	return getWidth() * getHeight();
 }
 
+unsigned int MemoryBuffer::determineNumberOfChannels(DataType datatype)
+{
+	switch (datatype) {
+		case COM_DT_VALUE:
+			return 1;
+		case COM_DT_VECTOR:
+			return 3;
+		case COM_DT_COLOR:
+		default:
+			return COM_NUMBER_OF_CHANNELS;
+	}
+}
+
 int MemoryBuffer::getWidth() const
 {
 	return this->m_rect.xmax - this->m_rect.xmin;
@@ -46,9 +59,10 @@ MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, unsigned int chunkNumber, r
 	BLI_rcti_init(&this->m_rect, rect->xmin, rect->xmax, rect->ymin, rect->ymax);
 	this->m_memoryProxy = memoryProxy;
 	this->m_chunkNumber = chunkNumber;
-	this->m_buffer = (float *)MEM_mallocN_aligned(sizeof(float) * determineBufferSize() * COM_NUMBER_OF_CHANNELS, 16, "COM_MemoryBuffer");
+	this->m_datatype = (memoryProxy) ? memoryProxy->getDataType() : COM_DT_COLOR;
+	this->m_num_channels = determineNumberOfChannels(this->m_datatype);
+	this->m_buffer = (float *)MEM_mallocN_aligned(sizeof(float) * determineBufferSize() * this->m_num_channels, 16, "COM_MemoryBuffer");
 	this->m_state = COM_MB_ALLOCATED;
-	this->m_datatype = COM_DT_COLOR;
 	this->m_chunkWidth = this->m_rect.xmax - this->m_rect.xmin;
 }
 
@@ -57,20 +71,35 @@ MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, rcti *rect)
 	BLI_rcti_init(&this->m_rect, rect->xmin, rect->xmax, rect->ymin, rect->ymax);
 	this->m_memoryProxy = memoryProxy;
 	this->m_chunkNumber = -1;
-	this->m_buffer = (float *)MEM_mallocN_aligned(sizeof(float) * determineBufferSize() * COM_NUMBER_OF_CHANNELS, 16, "COM_MemoryBuffer");
+	this->m_datatype = (memoryProxy) ? memoryProxy->getDataType() : COM_DT_COLOR;
+	this->m_num_channels = determineNumberOfChannels(this->m_datatype);
+	this->m_buffer = (float *)MEM_mallocN_aligned(sizeof(float) * determineBufferSize() * this->m_num_channels, 16, "COM_MemoryBuffer");
+	this->m_state = COM_MB_TEMPORARILY;
+	this->m_chunkWidth = this->m_rect.xmax - this->m_rect.xmin;
+}
+
+MemoryBuffer::MemoryBuffer(DataType datatype, rcti *rect)
+{
+	BLI_rcti_init(&this->m_rect, rect->xmin, rect->xmax, rect->ymin, rect->ymax);
+	this->m_memoryProxy = NULL;
+	this->m_chunkNumber = -1;
+	this->m_datatype = datatype;
+	this->m_num_channels = determineNumberOfChannels(this->m_datatype);
+	this->m_buffer = (float *)MEM_mallocN_aligned(sizeof(float) * determineBufferSize() * this->m_num_channels, 16, "COM_MemoryBuffer");
 	this->m_state = COM_MB_TEMPORARILY;
-	this->m_datatype = COM_DT_COLOR;
 	this->m_chunkWidth = this->m_rect.xmax - this->m_rect.xmin;
 }
+
 MemoryBuffer *MemoryBuffer::duplicate()
 {
-	MemoryBuffer *result = new MemoryBuffer(this->m_memoryProxy, &this->m_rect);
-	memcpy(result->m_buffer, this->m_buffer, this->determineBufferSize() * COM_NUMBER_OF_CHANNELS * sizeof(float));
+	MemoryBuffer *result = new MemoryBuffer(this->m_datatype, &this->m_rect);
+	result->m_memoryProxy = this->m_memoryProxy;
+	memcpy(result->m_buffer, this->m_buffer, this->determineBufferSize() * this->m_num_channels * sizeof(float));
 	return result;
 }
 void MemoryBuffer::clear()
 {
-	memset(this->m_buffer, 0, this->determineBufferSize() * COM_NUMBER_OF_CHANNELS * sizeof(float));
+	memset(this->m_buffer, 0, this->determineBufferSize() * this->m_num_channels * sizeof(float));
 }
 
 float *MemoryBuffer::convertToValueBuffer()
@@ -83,7 +112,7 @@ float *MemoryBuffer::convertToValueBuffer()
 	const float *fp_src = this->m_buffer;
 	float       *fp_dst = result;
 
-	for (i = 0; i < size; i++, fp_dst++, fp_src += COM_NUMBER_OF_CHANNELS) {
+	for (i = 0; i < size; i++, fp_dst++, fp_src += this->m_num_channels) {
 		*fp_dst = *fp_src;
 	}
 
@@ -98,7 +127,7 @@ float MemoryBuffer::getMaximumValue()
 
 	const float *fp_src = this->m_buffer;
 
-	for (i = 0; i < size; i++, fp_src += COM_NUMBER_OF_CHANNELS) {
+	for (i = 0; i < size; i++, fp_src += this->m_num_channels) {
 		float value = *fp_src;
 		if (value > result) {
 			result = value;
@@ -116,7 +145,7 @@ float MemoryBuffer::getMaximumValue(rcti *rect)
 	BLI_rcti_isect(rect, &this->m_rect, &rect_clamp);
 
 	if (!BLI_rcti_is_empty(&rect_clamp)) {
-		MemoryBuffer *temp = new MemoryBuffer(NULL, &rect_clamp);
+		MemoryBuffer *temp = new MemoryBuffer(this->m_datatype, &rect_clamp);
 		temp->copyContentFrom(this);
 		float result = temp->getMaximumValue();
 		delete temp;
@@ -150,11 +179,46 @@ void MemoryBuffer::copyContentFrom(MemoryBuffer *otherBuffer)
 	int offset;
 	int otherOffset;
 
+	if (this->m_num_channels == otherBuffer->m_num_channels) {
+		for (otherY = minY; otherY < maxY; otherY++) {
+			otherOffset = ((otherY - otherBuffer->m_rect.ymin) * otherBuffer->m_chunkWidth + minX - otherBuffer->m_rect.xmin) * this->m_num_channels;
+			offset = ((otherY - this->m_rect.ymin) * this->m_chunkWidth + minX - this->m_rect.xmin) * this->m_num_channels;
+			memcpy(&this->m_buffer[offset], &otherBuffer->m_buffer[otherOffset], (maxX - minX) * this->m_num_channels * sizeof(float));
+		}
+	}
+	else {
+		/* different layouts, convert pixel by pixel */
+		float color[4];
+		unsigned int otherX;
+
+		for (otherY = minY; otherY < maxY; otherY++) {
+			for (otherX = minX; otherX < maxX; otherX++) {
+				otherBuffer->read(color, otherX, otherY);
+				this->writePixel(otherX, otherY, color);
+			}
+		}
+	}
+}
+
+void MemoryBuffer::readRow(float *result, int xmin, int xmax, int y)
+{
+	if (y < this->m_rect.ymin || y >= this->m_rect.ymax ||
+	    xmin < this->m_rect.xmin || xmax > this->m_rect.xmax)
+	{
+		/* partially outside of the buffer, read with clipping */
+		for (int x = xmin; x < xmax; x++, result += COM_NUMBER_OF_CHANNELS)
+			read(result, x, y);
+		return;
+	}
 
-	for (otherY = minY; otherY < maxY; otherY++) {
-		otherOffset = ((otherY - otherBuffer->m_rect.ymin) * otherBuffer->m_chunkWidth + minX - otherBuffer->m_rect.xmin) * COM_NUMBER_OF_CHANNELS;
-		offset = ((otherY - this->m_rect.ymin) * this->m_chunkWidth + minX - this->m_rect.xmin) * COM_NUMBER_OF_CHANNELS;
-		memcpy(&this->m_buffer[offset], &otherBuffer->m_buffer[otherOffset], (maxX - minX) * COM_NUMBER_OF_CHANNELS * sizeof(float));
+	const float *pixel = &this->m_buffer[(this->m_chunkWidth * (y - this->m_rect.ymin) + xmin - this->m_rect.xmin) * this->m_num_channels];
+
+	if (this->m_num_channels == COM_NUMBER_OF_CHANNELS) {
+		memcpy(result, pixel, (xmax - xmin) * COM_NUMBER_OF_CHANNELS * sizeof(float));
+	}
+	else {
+		for (int x = xmin; x < xmax; x++, result += COM_NUMBER_OF_CHANNELS, pixel += this->m_num_channels)
+			readChannels(result, pixel);
 	}
 }
 
@@ -163,8 +227,8 @@ void MemoryBuffer::writePixel(int x, int y, const float color[4])
 	if (x >= this->m_rect.xmin && x < this->m_rect.xmax &&
 	    y >= this->m_rect.ymin && y < this->m_rect.ymax)
 	{
-		const int offset = (this->m_chunkWidth * (y - this->m_rect.ymin) + x - this->m_rect.xmin) * COM_NUMBER_OF_CHANNELS;
-		copy_v4_v4(&this->m_buffer[offset], color);
+		const int offset = (this->m_chunkWidth * (y - this->m_rect.ymin) + x - this->m_rect.xmin) * this->m_num_channels;
+		memcpy(&this->m_buffer[offset], color, this->m_num_channels * sizeof(float));
 	}
 }
 
@@ -173,8 +237,9 @@ void MemoryBuffer::addPixel(int x, int y, const float color[4])
 	if (x >= this->m_rect.xmin && x < this->m_rect.xmax &&
 	    y >= this->m_rect.ymin && y < this->m_rect.ymax)
 	{
-		const int offset = (this->m_chunkWidth * (y - this->m_rect.ymin) + x - this->m_rect.xmin) * COM_NUMBER_OF_CHANNELS;
-		add_v4_v4(&this->m_buffer[offset], color);
+		const int offset = (this->m_chunkWidth * (y - this->m_rect.ymin) + x - this->m_rect.xmin) * this->m_num_channels;
+		for (unsigned int i = 0; i < this->m_num_channels; i++)
+			this->m_buffer[offset + i] += color[i];
 	}
 }
 
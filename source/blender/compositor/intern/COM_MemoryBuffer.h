@@ -70,6 +70,11 @@ private:
 	 */
 	DataType m_datatype;
 	
+	/**
+	 * @brief number of floats stored per pixel, depends on the datatype
+	 */
+	unsigned int m_num_channels;
+	
 	
 	/**
 	 * @brief region of this buffer inside relative to the MemoryProxy
@@ -108,6 +113,11 @@ public:
 	 */
 	MemoryBuffer(MemoryProxy *memoryProxy, rcti *rect);
 	
+	/**
+	 * @brief construct new temporarily MemoryBuffer for an area, with the number of channels of datatype
+	 */
+	MemoryBuffer(DataType datatype, rcti *rect);
+	
 	/**
 	 * @brief destructor
 	 */
@@ -121,9 +131,35 @@ public:
 	/**
 	 * @brief get the data of this MemoryBuffer
 	 * @note buffer should already be available in memory
+	 * @see getNumberOfChannels for the number of floats per pixel
 	 */
 	float *getBuffer() { return this->m_buffer; }
 	
+	/**
+	 * @brief get the number of floats stored per pixel
+	 */
+	unsigned int getNumberOfChannels() const { return this->m_num_channels; }
+
+	/**
+	 * @brief get the datatype the buffer was allocated for
+	 */
+	DataType getDataType() const { return this->m_datatype; }
+
+	/**
+	 * @brief get the MemoryProxy this buffer belongs to
+	 */
+	MemoryProxy *getMemoryProxy() { return this->m_memoryProxy; }
+
+	/**
+	 * @brief set the MemoryProxy this buffer belongs to, used when the buffer is reused from the BufferCache
+	 */
+	void setMemoryProxy(MemoryProxy *memoryProxy) { this->m_memoryProxy = memoryProxy; }
+	
+	/**
+	 * @brief get the number of floats stored per pixel for a datatype
+	 */
+	static unsigned int determineNumberOfChannels(DataType datatype);
+	
 	/**
 	 * @brief after execution the state will be set to available by calling this method
 	 */
@@ -164,6 +200,23 @@ public:
 		}
 	}
 	
+	/**
+	 * @brief copy a pixel of the buffer to a full color, channels that are not stored are zero
+	 */
+	inline void readChannels(float result[4], const float *pixel) const
+	{
+		if (this->m_num_channels == COM_NUMBER_OF_CHANNELS) {
+			copy_v4_v4(result, pixel);
+		}
+		else {
+			unsigned int i;
+			for (i = 0; i < this->m_num_channels; i++)
+				result[i] = pixel[i];
+			for (; i < COM_NUMBER_OF_CHANNELS; i++)
+				result[i] = 0.0f;
+		}
+	}
+
 	inline void read(float result[4], int x, int y,
 	                 MemoryBufferExtend extend_x = COM_MB_CLIP,
 	                 MemoryBufferExtend extend_y = COM_MB_CLIP)
@@ -176,8 +229,8 @@ public:
 		}
 		else {
 			wrap_pixel(x, y, extend_x, extend_y);
-			const int offset = (this->m_chunkWidth * y + x) * COM_NUMBER_OF_CHANNELS;
-			copy_v4_v4(result, &this->m_buffer[offset]);
+			const int offset = (this->m_chunkWidth * y + x) * this->m_num_channels;
+			readChannels(result, &this->m_buffer[offset]);
 		}
 	}
 
@@ -186,22 +239,28 @@ public:
 	                        MemoryBufferExtend extend_y = COM_MB_CLIP)
 	{
 		wrap_pixel(x, y, extend_x, extend_y);
-		const int offset = (this->m_chunkWidth * y + x) * COM_NUMBER_OF_CHANNELS;
+		const int offset = (this->m_chunkWidth * y + x) * this->m_num_channels;
 
 		BLI_assert(offset >= 0);
-		BLI_assert(offset < this->determineBufferSize() * COM_NUMBER_OF_CHANNELS);
+		BLI_assert(offset < this->determineBufferSize() * this->m_num_channels);
 		BLI_assert(!(extend_x == COM_MB_CLIP && (x < m_rect.xmin || x >= m_rect.xmax)) &&
 		           !(extend_y == COM_MB_CLIP && (y < m_rect.ymin || y >= m_rect.ymax)));
 
 #if 0
 		/* always true */
 		BLI_assert((int)(MEM_allocN_len(this->m_buffer) / sizeof(*this->m_buffer)) ==
-		           (int)(this->determineBufferSize() * COM_NUMBER_OF_CHANNELS));
+		           (int)(this->determineBufferSize() * this->m_num_channels));
 #endif
 
-		copy_v4_v4(result, &this->m_buffer[offset]);
+		readChannels(result, &this->m_buffer[offset]);
 	}
 	
+	/**
+	 * @brief read a row of pixels as full colors
+	 * @param result float array of (xmax - xmin) * COM_NUMBER_OF_CHANNELS
+	 */
+	void readRow(float *result, int xmin, int xmax, int y);
+	
 	void writePixel(int x, int y, const float color[4]);
 	void addPixel(int x, int y, const float color[4]);
 	inline void readBilinear(float result[4], float x, float y,
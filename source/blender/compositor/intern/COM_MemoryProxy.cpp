@@ -27,6 +27,11 @@ MemoryProxy::MemoryProxy()
 {
 	this->m_writeBufferOperation = NULL;
 	this->m_executor = NULL;
+	this->m_datatype = COM_DT_COLOR;
+	this->m_buffer = NULL;
+	this->m_cacheKey = 0;
+	this->m_useCachedBuffer = false;
+	this->m_isCached = false;
 }
 
 void MemoryProxy::allocate(unsigned int width, unsigned int height)
@@ -37,11 +42,28 @@ void MemoryProxy::allocate(unsigned int width, unsigned int height)
 	result.ymin = 0;
 	result.ymax = height;
 
+	if (this->m_cacheKey != 0 && this->m_useCachedBuffer) {
+		this->m_buffer = BufferCache::acquire(this->m_cacheKey, this);
+		if (this->m_buffer) {
+			this->m_isCached = true;
+			return;
+		}
+	}
+
 	this->m_buffer = new MemoryBuffer(this, 1, &result);
 }
 
+void MemoryProxy::storeInCache()
+{
+	if (this->m_cacheKey != 0 && this->m_buffer) {
+		BufferCache::release(this->m_cacheKey, this->m_buffer);
+		this->m_buffer = NULL;
+	}
+}
+
 void MemoryProxy::free()
 {
+	this->m_isCached = false;
 	if (this->m_buffer) {
 		delete this->m_buffer;
 		this->m_buffer = NULL;
@@ -26,6 +26,7 @@ class MemoryProxy;
 #ifndef _COM_MemoryProxy_h_
 #define _COM_MemoryProxy_h_
 #include "COM_ExecutionGroup.h"
+#include "COM_BufferCache.h"
 
 class ExecutionGroup;
 class WriteBufferOperation;
@@ -49,9 +50,9 @@ private:
 	ExecutionGroup *m_executor;
 	
 	/**
-	 * @brief datatype of this MemoryProxy
+	 * @brief datatype of this MemoryProxy, determines the number of channels of the buffer
 	 */
-	/* DataType m_datatype; */ /* UNUSED */
+	DataType m_datatype;
 	
 	/**
 	 * @brief channel information of this buffer
@@ -63,6 +64,22 @@ private:
 	 */
 	MemoryBuffer *m_buffer;
 
+	/**
+	 * @brief key of the buffer in the BufferCache, 0 when the buffer can't be cached
+	 */
+	BufferCacheKey m_cacheKey;
+
+	/**
+	 * @brief can a buffer from the BufferCache be used.
+	 * false when an operation the buffer depends on is tagged for update
+	 */
+	bool m_useCachedBuffer;
+
+	/**
+	 * @brief the buffer is restored from the BufferCache and doesn't need to be calculated
+	 */
+	bool m_isCached;
+
 public:
 	MemoryProxy();
 	
@@ -89,6 +106,17 @@ public:
 	 */
 	WriteBufferOperation *getWriteBufferOperation() { return this->m_writeBufferOperation; }
 
+	/**
+	 * @brief set the datatype of the buffer, value and vector buffers use less channels
+	 * @note only use for buffers that are only accessed through the MemoryBuffer read methods
+	 */
+	void setDataType(DataType datatype) { this->m_datatype = datatype; }
+
+	/**
+	 * @brief get the datatype of the buffer
+	 */
+	DataType getDataType() const { return this->m_datatype; }
+
 	/**
 	 * @brief allocate memory of size width x height
 	 */
@@ -104,6 +132,28 @@ public:
 	 */
 	inline MemoryBuffer *getBuffer() { return this->m_buffer; }
 
+	/**
+	 * @brief set the key of the buffer in the BufferCache
+	 * @param key the key, 0 when the buffer can't be cached
+	 * @param useCachedBuffer can a cached buffer be used, otherwise the buffer is calculated and replaces the cached one
+	 */
+	void setCacheKey(BufferCacheKey key, bool useCachedBuffer)
+	{
+		this->m_cacheKey = key;
+		this->m_useCachedBuffer = useCachedBuffer;
+	}
+
+	/**
+	 * @brief is the buffer restored from the BufferCache during allocate
+	 */
+	bool isCached() const { return this->m_isCached; }
+
+	/**
+	 * @brief hand the calculated buffer over to the BufferCache, instead of freeing it
+	 * @note only call when all chunks of the buffer are calculated
+	 */
+	void storeInCache();
+
 #ifdef WITH_CXX_GUARDEDALLOC
 	MEM_CXX_CLASS_ALLOC_FUNCS("COM:MemoryProxy")
 #endif
@@ -19,10 +19,22 @@
  *		Lukas Toenne
  */
 
+#include <typeinfo>
+
 extern "C" {
 #include "BLI_utildefines.h"
+
+#include "DNA_camera_types.h"
+#include "DNA_color_types.h"
+#include "DNA_object_types.h"
+
+#include "BKE_camera.h"
+#include "BKE_node.h"
 }
 
+#include "MEM_guardedalloc.h"
+
+#include "COM_BufferCache.h"
 #include "COM_NodeConverter.h"
 #include "COM_Converter.h"
 #include "COM_Debug.h"
@@ -112,6 +124,12 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
 	/* surround complex ops with read/write buffer */
 	add_complex_operation_buffers();
 	
+	/* use compact buffers for value and vector data where possible */
+	determine_buffer_datatypes();
+	
+	/* reuse buffers of the previous execution */
+	determine_buffer_cache_keys();
+	
 	/* links not available from here on */
 	/* XXX make m_links a local variable to avoid confusion! */
 	m_links.clear();
@@ -131,6 +149,8 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
 void NodeOperationBuilder::addOperation(NodeOperation *operation)
 {
 	m_operations.push_back(operation);
+	if (m_current_node)
+		m_operation_nodes[operation] = m_current_node;
 }
 
 void NodeOperationBuilder::mapInputSocket(NodeInput *node_socket, NodeOperationInput *operation_socket)
@@ -567,6 +587,239 @@ void NodeOperationBuilder::add_complex_operation_buffers()
 	}
 }
 
+void NodeOperationBuilder::determine_buffer_datatypes()
+{
+	/* Complex operations and OpenCL kernels access the buffer data directly and
+	 * expect COM_NUMBER_OF_CHANNELS floats per pixel. Other operations only read
+	 * through the MemoryBuffer methods, so buffers which are only used by those
+	 * can store just the channels of their datatype.
+	 */
+	std::set<MemoryProxy *> full_proxies;
+	for (Links::const_iterator it = m_links.begin(); it != m_links.end(); ++it) {
+		const Link &link = *it;
+		NodeOperation &from = link.from()->getOperation();
+		NodeOperation &to = link.to()->getOperation();
+		
+		if (from.isReadBufferOperation() && to.isComplex())
+			full_proxies.insert(((ReadBufferOperation &)from).getMemoryProxy());
+	}
+	
+	for (Operations::const_iterator it = m_operations.begin(); it != m_operations.end(); ++it) {
+		NodeOperation *op = *it;
+		if (!op->isWriteBufferOperation())
+			continue;
+		
+		WriteBufferOperation *writeOperation = (WriteBufferOperation *)op;
+		MemoryProxy *memoryProxy = writeOperation->getMemoryProxy();
+		NodeOperationInput *input = writeOperation->getInputSocket(0);
+		if (!input->isConnected())
+			continue;
+		
+		if (input->getLink()->getOperation().isOpenCL())
+			continue;
+		if (full_proxies.find(memoryProxy) != full_proxies.end())
+			continue;
+		
+		memoryProxy->setDataType(input->getLink()->getDataType());
+	}
+}
+
+/* buffer cache key of the result of an operation */
+typedef struct BufferCacheState {
+	/* 0 when the result can't be cached */
+	BufferCacheKey key;
+	/* a node the result depends on is tagged for update */
+	bool dirty;
+} BufferCacheState;
+
+typedef std::map<NodeOperation *, BufferCacheState> BufferCacheStates;
+
+static void hash_mem(BufferCacheHash &hash, const void *mem)
+{
+	if (mem)
+		hash.add(mem, MEM_allocN_len(mem));
+}
+
+static void hash_context(BufferCacheHash &hash, const CompositorContext &context)
+{
+	const RenderData *rd = context.getRenderData();
+	const ColorManagedViewSettings *view_settings = context.getViewSettings();
+	const ColorManagedDisplaySettings *display_settings = context.getDisplaySettings();
+	
+	hash.addPointer(context.getScene());
+	hash.addInt(context.getFramenumber());
+	hash.addInt(context.getQuality());
+	hash.addInt(context.isFastCalculation());
+	hash.addInt(rd->xsch);
+	hash.addInt(rd->ysch);
+	hash.addInt(rd->size);
+	
+	if (view_settings) {
+		hash.addString(view_settings->look);
+		hash.addString(view_settings->view_transform);
+		hash.addFloat(view_settings->exposure);
+		hash.addFloat(view_settings->gamma);
+		hash.addInt(view_settings->flag);
+	}
+	if (display_settings) {
+		hash.addString(display_settings->display_device);
+	}
+}
+
+/* hash all settings of a node, data of other datablocks is only hashed by pointer,
+ * changes to it are detected by the node being tagged for update */
+static void hash_node(BufferCacheHash &hash, Node *node, const CompositorContext &context)
+{
+	bNode *b_node = node->getbNode();
+	
+	hash.addInt(b_node->type);
+	hash.addString(b_node->idname);
+	hash.addInt(b_node->custom1);
+	hash.addInt(b_node->custom2);
+	hash.addFloat(b_node->custom3);
+	hash.addFloat(b_node->custom4);
+	hash.addPointer(b_node->id);
+	hash_mem(hash, b_node->storage);
+	
+	for (bNodeSocket *b_sock = (bNodeSocket *)b_node->inputs.first; b_sock; b_sock = b_sock->next)
+		hash_mem(hash, b_sock->default_value);
+	
+	/* storage with pointers to further data */
+	if (ELEM(b_node->type, CMP_NODE_CURVE_RGB, CMP_NODE_CURVE_VEC, CMP_NODE_TIME, CMP_NODE_HUECORRECT) && b_node->storage) {
+		CurveMapping *cumap = (CurveMapping *)b_node->storage;
+		for (int a = 0; a < CM_TOT; a++) {
+			CurveMap *cuma = &cumap->cm[a];
+			if (cuma->curve)
+				hash.add(cuma->curve, sizeof(CurveMapPoint) * cuma->totpoint);
+		}
+	}
+	
+	/* camera settings used for the radius, see DefocusNode */
+	if (b_node->type == CMP_NODE_DEFOCUS) {
+		Scene *scene = b_node->id ? (Scene *)b_node->id : context.getScene();
+		Object *camob = scene ? scene->camera : NULL;
+		hash.addPointer(camob);
+		if (camob && camob->type == OB_CAMERA) {
+			Camera *camera = (Camera *)camob->data;
+			hash.addFloat(camera->lens);
+			hash.addFloat(camera->sensor_x);
+			hash.addFloat(camera->sensor_y);
+			hash.addInt(camera->sensor_fit);
+			hash.addFloat(BKE_camera_object_dof_distance(camob));
+		}
+	}
+}
+
+/* can the result of a node change without the node being tagged for update */
+static bool is_volatile_node(Node *node, const CompositorContext &context)
+{
+	bNode *b_node = node->getbNode();
+	
+	if (ELEM(b_node->type, CMP_NODE_MASK, CMP_NODE_TEXTURE))
+		return true;
+	/* datablock users are only tagged in the base tree, not in node groups */
+	if (b_node->id && node->getbNodeTree() != context.getbNodeTree())
+		return true;
+	return false;
+}
+
+static const BufferCacheState &determine_buffer_cache_state(BufferCacheStates &states,
+                                                            const NodeOperationBuilder::OperationNodeMap &operation_nodes,
+                                                            const CompositorContext &context,
+                                                            const BufferCacheHash &context_hash,
+                                                            NodeOperation *op)
+{
+	BufferCacheStates::const_iterator it = states.find(op);
+	if (it != states.end())
+		return it->second;
+	
+	BufferCacheState state;
+	state.key = 0;
+	state.dirty = false;
+	
+	if (op->isReadBufferOperation()) {
+		/* same result as the buffer that is read */
+		MemoryProxy *memproxy = ((ReadBufferOperation *)op)->getMemoryProxy();
+		state = determine_buffer_cache_state(states, operation_nodes, context, context_hash,
+		                                     memproxy->getWriteBufferOperation());
+	}
+	else {
+		BufferCacheHash hash = context_hash;
+		bool valid = true;
+		
+		hash.addString(typeid(*op).name());
+		hash.addInt(op->getWidth());
+		hash.addInt(op->getHeight());
+		
+		if (op->isSetOperation()) {
+			float value[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+			op->readSampled(value, 0.0f, 0.0f, COM_PS_NEAREST);
+			hash.add(value, sizeof(value));
+		}
+		
+		NodeOperationBuilder::OperationNodeMap::const_iterator node_it = operation_nodes.find(op);
+		if (node_it != operation_nodes.end()) {
+			Node *node = node_it->second;
+			hash_node(hash, node, context);
+			if (node->getbNode()->need_exec || is_volatile_node(node, context))
+				state.dirty = true;
+		}
+		
+		for (int k = 0; k < op->getNumberOfInputSockets(); ++k) {
+			NodeOperationInput *input = op->getInputSocket(k);
+			NodeOperationOutput *link = input->getLink();
+			hash.addInt(input->getResizeMode());
+			if (!link)
+				continue;
+			
+			NodeOperation *from = &link->getOperation();
+			const BufferCacheState &input_state = determine_buffer_cache_state(states, operation_nodes, context,
+			                                                                   context_hash, from);
+			if (input_state.key == 0)
+				valid = false;
+			if (input_state.dirty)
+				state.dirty = true;
+			
+			hash.addKey(input_state.key);
+			for (int index = 0; index < from->getNumberOfOutputSockets(); ++index) {
+				if (from->getOutputSocket(index) == link)
+					hash.addInt(index);
+			}
+		}
+		
+		if (op->isWriteBufferOperation())
+			hash.addInt(((WriteBufferOperation *)op)->getMemoryProxy()->getDataType());
+		
+		state.key = (valid) ? hash.getKey() : 0;
+	}
+	
+	return states[op] = state;
+}
+
+void NodeOperationBuilder::determine_buffer_cache_keys()
+{
+	if (!m_context->isBufferCacheEnabled())
+		return;
+	
+	BufferCacheHash context_hash;
+	hash_context(context_hash, *m_context);
+	
+	BufferCacheStates states;
+	for (Operations::const_iterator it = m_operations.begin(); it != m_operations.end(); ++it) {
+		NodeOperation *op = *it;
+		if (!op->isWriteBufferOperation())
+			continue;
+		
+		const BufferCacheState &state = determine_buffer_cache_state(states, m_operation_nodes, *m_context, context_hash, op);
+		MemoryProxy *memproxy = ((WriteBufferOperation *)op)->getMemoryProxy();
+		memproxy->setCacheKey(state.key, !state.dirty);
+		
+		/* the cached buffer is outdated, remove it right away in case this execution is cancelled */
+		if (state.key != 0 && state.dirty)
+			BufferCache::remove(state.key);
+	}
+}
+
 typedef std::set<NodeOperation*> Tags;
 
 static void find_reachable_operations_recursive(Tags &reachable, NodeOperation *op)
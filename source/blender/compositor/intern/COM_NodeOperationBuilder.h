@@ -73,6 +73,8 @@ public:
 	typedef std::vector<NodeOperationInput *> OpInputs;
 	typedef std::map<NodeInput *, OpInputs> OpInputInverseMap;
 	
+	typedef std::map<NodeOperation *, Node *> OperationNodeMap;
+	
 private:
 	const CompositorContext *m_context;
 	NodeGraph m_graph;
@@ -85,6 +87,8 @@ private:
 	InputSocketMap m_input_map;
 	/** Maps node outputs to operation outputs */
 	OutputSocketMap m_output_map;
+	/** Maps operations to the node they are created by */
+	OperationNodeMap m_operation_nodes;
 	
 	Node *m_current_node;
 	
@@ -148,6 +152,10 @@ protected:
 	void add_complex_operation_buffers();
 	void add_input_buffers(NodeOperation *operation, NodeOperationInput *input);
 	void add_output_buffers(NodeOperation *operation, NodeOperationOutput *output);
+	/** Use the datatype of the written data for buffers that are not accessed directly */
+	void determine_buffer_datatypes();
+	/** Determine the keys of buffers in the BufferCache, so unchanged buffers can be reused */
+	void determine_buffer_cache_keys();
 	
 	/** Remove unreachable operations */
 	void prune_operations();
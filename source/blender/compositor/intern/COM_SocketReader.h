@@ -90,6 +90,21 @@ protected:
 	 */
 	virtual void executePixelFiltered(float output[4], float x, float y, float dx[2], float dy[2], PixelSampler sampler) {}
 
+	/**
+	 * @brief calculate a row of pixels
+	 * @note this method is called for non-complex, operations can implement it to avoid a
+	 * virtual call per pixel. The default implementation calls executePixelSampled for every pixel.
+	 * @param output is a float array of (xmax - xmin) * COM_NUMBER_OF_CHANNELS to store the result
+	 * @param xmin the first x-coordinate of the row in image space
+	 * @param xmax the x-coordinate after the last pixel of the row
+	 * @param y the y-coordinate of the row in image space
+	 */
+	virtual void executeRow(float *output, int xmin, int xmax, int y) {
+		for (int x = xmin; x < xmax; x++, output += COM_NUMBER_OF_CHANNELS) {
+			executePixelSampled(output, x, y, COM_PS_NEAREST);
+		}
+	}
+
 public:
 	inline void readSampled(float result[4], float x, float y, PixelSampler sampler) {
 		executePixelSampled(result, x, y, sampler);
@@ -100,6 +115,9 @@ public:
 	inline void readFiltered(float result[4], float x, float y, float dx[2], float dy[2], PixelSampler sampler) {
 		executePixelFiltered(result, x, y, dx, dy, sampler);
 	}
+	inline void readRow(float *result, int xmin, int xmax, int y) {
+		executeRow(result, xmin, xmax, y);
+	}
 
 	virtual void *initializeTileData(rcti *rect) { return 0; }
 	virtual void deinitializeTileData(rcti *rect, void *data) {}
@@ -25,11 +25,13 @@ extern "C" {
 #include "BKE_node.h"
 #include "BLI_threads.h"
 }
+#include "atomic_ops.h"
 #include "BKE_main.h"
 #include "BKE_scene.h"
 #include "BKE_global.h"
 
 #include "COM_compositor.h"
+#include "COM_BufferCache.h"
 #include "COM_ExecutionSystem.h"
 #include "COM_WorkScheduler.h"
 #include "clew.h"
@@ -38,9 +40,14 @@ extern "C" {
 static ThreadMutex s_compositorMutex;
 static bool is_compositorMutex_init = false;
 
+/* incremented by COM_clearCaches, which can be called while the compositor is running */
+static uint32_t s_cacheGeneration = 0;
+static uint32_t s_executedCacheGeneration = 0;
+
 static void intern_freeCompositorCaches()
 {
 	deintializeDistortionCache();
+	BufferCache::clear();
 }
 
 void COM_execute(RenderData *rd, Scene *scene, bNodeTree *editingtree, int rendering,
@@ -64,6 +71,13 @@ void COM_execute(RenderData *rd, Scene *scene, bNodeTree *editingtree, int rende
 		return;
 	}
 
+	/* free caches cleared since the last execution */
+	uint32_t cacheGeneration = atomic_add_uint32(&s_cacheGeneration, 0);
+	if (cacheGeneration != s_executedCacheGeneration) {
+		intern_freeCompositorCaches();
+		s_executedCacheGeneration = cacheGeneration;
+	}
+
 	/* Make sure node tree has previews.
 	 * Don't create previews in advance, this is done when adding preview operations.
 	 * Reserved preview size is determined by render output for now.
@@ -101,13 +115,9 @@ void COM_execute(RenderData *rd, Scene *scene, bNodeTree *editingtree, int rende
 	BLI_mutex_unlock(&s_compositorMutex);
 }
 
-static void UNUSED_FUNCTION(COM_freeCaches)()
+void COM_clearCaches()
 {
-	if (is_compositorMutex_init) {
-		BLI_mutex_lock(&s_compositorMutex);
-		intern_freeCompositorCaches();
-		BLI_mutex_unlock(&s_compositorMutex);
-	}
+	atomic_add_uint32(&s_cacheGeneration, 1);
 }
 
 void COM_deinitialize()
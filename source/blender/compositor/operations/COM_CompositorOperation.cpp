@@ -127,7 +127,7 @@ void CompositorOperation::deinitExecution()
 
 void CompositorOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 {
-	float color[8]; // 7 is enough
+	float row[COM_ROW_BLOCK_SIZE * COM_NUMBER_OF_CHANNELS];
 	float *buffer = this->m_outputBuffer;
 	float *zbuffer = this->m_depthBuffer;
 
@@ -138,7 +138,6 @@ void CompositorOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 	int y2 = rect->ymax;
 	int offset = (y1 * this->getWidth() + x1);
 	int add = (this->getWidth() - (x2 - x1));
-	int offset4 = offset * COM_NUMBER_OF_CHANNELS;
 	int x;
 	int y;
 	bool breaked = false;
@@ -184,26 +183,33 @@ void CompositorOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 #endif
 
 	for (y = y1; y < y2 && (!breaked); y++) {
-		for (x = x1; x < x2 && (!breaked); x++) {
-			int input_x = x + dx, input_y = y + dy;
+		int input_y = y + dy;
+
+		/* the color is written directly into the output buffer, alpha and depth go through a block */
+		this->m_imageInput->readRow(buffer + offset * COM_NUMBER_OF_CHANNELS, x1 + dx, x2 + dx, input_y);
+
+		for (x = x1; x < x2; x += COM_ROW_BLOCK_SIZE) {
+			int num = min(COM_ROW_BLOCK_SIZE, x2 - x);
+			int input_x = x + dx;
+			int i;
 
-			this->m_imageInput->readSampled(color, input_x, input_y, COM_PS_NEAREST);
 			if (this->m_useAlphaInput) {
-				this->m_alphaInput->readSampled(&(color[3]), input_x, input_y, COM_PS_NEAREST);
+				this->m_alphaInput->readRow(row, input_x, input_x + num, input_y);
+				for (i = 0; i < num; i++) {
+					buffer[(offset + i) * COM_NUMBER_OF_CHANNELS + 3] = row[i * COM_NUMBER_OF_CHANNELS];
+				}
 			}
 
-			copy_v4_v4(buffer + offset4, color);
-
-			this->m_depthInput->readSampled(color, input_x, input_y, COM_PS_NEAREST);
-			zbuffer[offset] = color[0];
-			offset4 += COM_NUMBER_OF_CHANNELS;
-			offset++;
-			if (isBreaked()) {
-				breaked = true;
+			this->m_depthInput->readRow(row, input_x, input_x + num, input_y);
+			for (i = 0; i < num; i++) {
+				zbuffer[offset + i] = row[i * COM_NUMBER_OF_CHANNELS];
 			}
+			offset += num;
+		}
+		if (isBreaked()) {
+			breaked = true;
 		}
 		offset += add;
-		offset4 += add * COM_NUMBER_OF_CHANNELS;
 	}
 }
 
@@ -55,6 +55,16 @@ void ConvertValueToColorOperation::executePixelSampled(float output[4], float x,
 	output[3] = 1.0f;
 }
 
+void ConvertValueToColorOperation::executeRow(float *output, int xmin, int xmax, int y)
+{
+	/* input and output rows have the same stride, convert in place */
+	this->m_inputOperation->readRow(output, xmin, xmax, y);
+	for (int x = xmin; x < xmax; x++, output += COM_NUMBER_OF_CHANNELS) {
+		output[1] = output[2] = output[0];
+		output[3] = 1.0f;
+	}
+}
+
 
 /* ******** Color to Value ******** */
 
@@ -71,6 +81,14 @@ void ConvertColorToValueOperation::executePixelSampled(float output[4], float x,
 	output[0] = (inputColor[0] + inputColor[1] + inputColor[2]) / 3.0f;
 }
 
+void ConvertColorToValueOperation::executeRow(float *output, int xmin, int xmax, int y)
+{
+	this->m_inputOperation->readRow(output, xmin, xmax, y);
+	for (int x = xmin; x < xmax; x++, output += COM_NUMBER_OF_CHANNELS) {
+		output[0] = (output[0] + output[1] + output[2]) / 3.0f;
+	}
+}
+
 
 /* ******** Color to BW ******** */
 
@@ -87,6 +105,14 @@ void ConvertColorToBWOperation::executePixelSampled(float output[4], float x, fl
 	output[0] = rgb_to_bw(inputColor);
 }
 
+void ConvertColorToBWOperation::executeRow(float *output, int xmin, int xmax, int y)
+{
+	this->m_inputOperation->readRow(output, xmin, xmax, y);
+	for (int x = xmin; x < xmax; x++, output += COM_NUMBER_OF_CHANNELS) {
+		output[0] = rgb_to_bw(output);
+	}
+}
+
 
 /* ******** Color to Vector ******** */
 
@@ -72,6 +72,12 @@ void MathBaseOperation::clampIfNeeded(float *color)
 	}
 }
 
+void MathBaseOperation::readRowInputs(float *value1, float *value2, int xmin, int xmax, int y)
+{
+	this->m_inputValue1Operation->readRow(value1, xmin, xmax, y);
+	this->m_inputValue2Operation->readRow(value2, xmin, xmax, y);
+}
+
 void MathAddOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -85,6 +91,18 @@ void MathAddOperation::executePixelSampled(float output[4], float x, float y, Pi
 	clampIfNeeded(output);
 }
 
+struct MathAddKernel {
+	static inline float apply(float a, float b) { return a + b; }
+#ifdef __SSE2__
+	static inline __m128 apply(__m128 a, __m128 b) { return _mm_add_ps(a, b); }
+#endif
+};
+
+void MathAddOperation::executeRow(float *output, int xmin, int xmax, int y)
+{
+	executeRowKernel<MathAddKernel>(output, xmin, xmax, y);
+}
+
 void MathSubtractOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -98,6 +116,18 @@ void MathSubtractOperation::executePixelSampled(float output[4], float x, float
 	clampIfNeeded(output);
 }
 
+struct MathSubtractKernel {
+	static inline float apply(float a, float b) { return a - b; }
+#ifdef __SSE2__
+	static inline __m128 apply(__m128 a, __m128 b) { return _mm_sub_ps(a, b); }
+#endif
+};
+
+void MathSubtractOperation::executeRow(float *output, int xmin, int xmax, int y)
+{
+	executeRowKernel<MathSubtractKernel>(output, xmin, xmax, y);
+}
+
 void MathMultiplyOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -111,6 +141,18 @@ void MathMultiplyOperation::executePixelSampled(float output[4], float x, float
 	clampIfNeeded(output);
 }
 
+struct MathMultiplyKernel {
+	static inline float apply(float a, float b) { return a * b; }
+#ifdef __SSE2__
+	static inline __m128 apply(__m128 a, __m128 b) { return _mm_mul_ps(a, b); }
+#endif
+};
+
+void MathMultiplyOperation::executeRow(float *output, int xmin, int xmax, int y)
+{
+	executeRowKernel<MathMultiplyKernel>(output, xmin, xmax, y);
+}
+
 void MathDivideOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -265,6 +307,18 @@ void MathMinimumOperation::executePixelSampled(float output[4], float x, float y
 	clampIfNeeded(output);
 }
 
+struct MathMinimumKernel {
+	static inline float apply(float a, float b) { return min(a, b); }
+#ifdef __SSE2__
+	static inline __m128 apply(__m128 a, __m128 b) { return _mm_min_ps(a, b); }
+#endif
+};
+
+void MathMinimumOperation::executeRow(float *output, int xmin, int xmax, int y)
+{
+	executeRowKernel<MathMinimumKernel>(output, xmin, xmax, y);
+}
+
 void MathMaximumOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -278,6 +332,18 @@ void MathMaximumOperation::executePixelSampled(float output[4], float x, float y
 	clampIfNeeded(output);
 }
 
+struct MathMaximumKernel {
+	static inline float apply(float a, float b) { return max(a, b); }
+#ifdef __SSE2__
+	static inline __m128 apply(__m128 a, __m128 b) { return _mm_max_ps(a, b); }
+#endif
+};
+
+void MathMaximumOperation::executeRow(float *output, int xmin, int xmax, int y)
+{
+	executeRowKernel<MathMaximumKernel>(output, xmin, xmax, y);
+}
+
 void MathRoundOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -24,6 +24,9 @@
 #define _COM_MathBaseOperation_h
 #include "COM_NodeOperation.h"
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
 
 /**
  * this program converts an input color to an output value.
@@ -46,6 +49,69 @@ protected:
 	MathBaseOperation();
 
 	void clampIfNeeded(float color[4]);
+
+	/**
+	 * read a block of at most COM_ROW_BLOCK_SIZE pixels of both inputs for executeRow
+	 */
+	void readRowInputs(float *value1, float *value2, int xmin, int xmax, int y);
+
+#ifdef __SSE2__
+	/**
+	 * gather the first channel of four consecutive pixels of a row
+	 */
+	static inline __m128 loadRowValues(const float *row)
+	{
+		return _mm_set_ps(row[3 * COM_NUMBER_OF_CHANNELS], row[2 * COM_NUMBER_OF_CHANNELS],
+		                  row[COM_NUMBER_OF_CHANNELS], row[0]);
+	}
+
+	/**
+	 * scatter four values to the first channel of consecutive pixels of a row, clamped if needed
+	 */
+	inline void storeRowValues(float *output, __m128 result)
+	{
+		float values[4];
+		if (this->m_useClamp) {
+			result = _mm_min_ps(_mm_max_ps(result, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+		}
+		_mm_storeu_ps(values, result);
+		output[0] = values[0];
+		output[COM_NUMBER_OF_CHANNELS] = values[1];
+		output[2 * COM_NUMBER_OF_CHANNELS] = values[2];
+		output[3 * COM_NUMBER_OF_CHANNELS] = values[3];
+	}
+#endif
+
+	/**
+	 * row loop shared by the operations that implement executeRow, Kernel::apply
+	 * combines two values, with an __m128 overload for four values at once when SSE2 is available
+	 */
+	template<typename Kernel>
+	void executeRowKernel(float *output, int xmin, int xmax, int y)
+	{
+		float inputValue1[COM_ROW_BLOCK_SIZE * COM_NUMBER_OF_CHANNELS];
+		float inputValue2[COM_ROW_BLOCK_SIZE * COM_NUMBER_OF_CHANNELS];
+
+		for (int x = xmin; x < xmax; x += COM_ROW_BLOCK_SIZE) {
+			int num = min(COM_ROW_BLOCK_SIZE, xmax - x);
+			int i = 0;
+			readRowInputs(inputValue1, inputValue2, x, x + num, y);
+
+#ifdef __SSE2__
+			for (; i + 4 <= num; i += 4, output += 4 * COM_NUMBER_OF_CHANNELS) {
+				__m128 a = loadRowValues(&inputValue1[i * COM_NUMBER_OF_CHANNELS]);
+				__m128 b = loadRowValues(&inputValue2[i * COM_NUMBER_OF_CHANNELS]);
+				storeRowValues(output, Kernel::apply(a, b));
+			}
+#endif
+			for (; i < num; i++, output += COM_NUMBER_OF_CHANNELS) {
+				output[0] = Kernel::apply(inputValue1[i * COM_NUMBER_OF_CHANNELS],
+				                          inputValue2[i * COM_NUMBER_OF_CHANNELS]);
+
+				clampIfNeeded(output);
+			}
+		}
+	}
 public:
 	/**
 	 * the inner loop of this program
@@ -74,16 +140,19 @@ class MathAddOperation : public MathBaseOperation {
 public:
 	MathAddOperation() : MathBaseOperation() {}
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int xmin, int xmax, int y);
 };
 class MathSubtractOperation : public MathBaseOperation {
 public:
 	MathSubtractOperation() : MathBaseOperation() {}
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int xmin, int xmax, int y);
 };
 class MathMultiplyOperation : public MathBaseOperation {
 public:
 	MathMultiplyOperation() : MathBaseOperation() {}
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int xmin, int xmax, int y);
 };
 class MathDivideOperation : public MathBaseOperation {
 public:
@@ -135,11 +204,13 @@ class MathMinimumOperation : public MathBaseOperation {
 public:
 	MathMinimumOperation() : MathBaseOperation() {}
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int xmin, int xmax, int y);
 };
 class MathMaximumOperation : public MathBaseOperation {
 public:
 	MathMaximumOperation() : MathBaseOperation() {}
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int xmin, int xmax, int y);
 };
 class MathRoundOperation : public MathBaseOperation {
 public:
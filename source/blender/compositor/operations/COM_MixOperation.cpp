@@ -69,6 +69,19 @@ void MixBaseOperation::executePixelSampled(float output[4], float x, float y, Pi
 	output[3] = inputColor1[3];
 }
 
+void MixBaseOperation::readRowInputs(float *value, float *color1, float *color2, int xmin, int xmax, int y)
+{
+	this->m_inputValueOperation->readRow(value, xmin, xmax, y);
+	this->m_inputColor1Operation->readRow(color1, xmin, xmax, y);
+	this->m_inputColor2Operation->readRow(color2, xmin, xmax, y);
+
+	if (this->useValueAlphaMultiply()) {
+		for (int i = 0; i < xmax - xmin; i++) {
+			value[i * COM_NUMBER_OF_CHANNELS] *= color2[i * COM_NUMBER_OF_CHANNELS + 3];
+		}
+	}
+}
+
 void MixBaseOperation::determineResolution(unsigned int resolution[2], unsigned int preferredResolution[2])
 {
 	NodeOperationInput *socket;
@@ -129,6 +142,21 @@ void MixAddOperation::executePixelSampled(float output[4], float x, float y, Pix
 	clampIfNeeded(output);
 }
 
+struct MixAddKernel {
+	static inline float apply(float c1, float c2, float value) { return c1 + value * c2; }
+#ifdef __SSE2__
+	static inline __m128 apply(__m128 c1, __m128 c2, __m128 value)
+	{
+		return _mm_add_ps(c1, _mm_mul_ps(value, c2));
+	}
+#endif
+};
+
+void MixAddOperation::executeRow(float *output, int xmin, int xmax, int y)
+{
+	executeRowKernel<MixAddKernel>(output, xmin, xmax, y);
+}
+
 /* ******** Mix Blend Operation ******** */
 
 MixBlendOperation::MixBlendOperation() : MixBaseOperation()
@@ -160,6 +188,21 @@ void MixBlendOperation::executePixelSampled(float output[4], float x, float y, P
 	clampIfNeeded(output);
 }
 
+struct MixBlendKernel {
+	static inline float apply(float c1, float c2, float value) { return (1.0f - value) * c1 + value * c2; }
+#ifdef __SSE2__
+	static inline __m128 apply(__m128 c1, __m128 c2, __m128 value)
+	{
+		return _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.0f), value), c1), _mm_mul_ps(value, c2));
+	}
+#endif
+};
+
+void MixBlendOperation::executeRow(float *output, int xmin, int xmax, int y)
+{
+	executeRowKernel<MixBlendKernel>(output, xmin, xmax, y);
+}
+
 /* ******** Mix Burn Operation ******** */
 
 MixBurnOperation::MixBurnOperation() : MixBaseOperation()
@@ -623,6 +666,21 @@ void MixMultiplyOperation::executePixelSampled(float output[4], float x, float y
 	clampIfNeeded(output);
 }
 
+struct MixMultiplyKernel {
+	static inline float apply(float c1, float c2, float value) { return c1 * ((1.0f - value) + value * c2); }
+#ifdef __SSE2__
+	static inline __m128 apply(__m128 c1, __m128 c2, __m128 value)
+	{
+		return _mm_mul_ps(c1, _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), value), _mm_mul_ps(value, c2)));
+	}
+#endif
+};
+
+void MixMultiplyOperation::executeRow(float *output, int xmin, int xmax, int y)
+{
+	executeRowKernel<MixMultiplyKernel>(output, xmin, xmax, y);
+}
+
 /* ******** Mix Ovelray Operation ******** */
 
 MixOverlayOperation::MixOverlayOperation() : MixBaseOperation()
@@ -806,6 +864,21 @@ void MixSubtractOperation::executePixelSampled(float output[4], float x, float y
 	clampIfNeeded(output);
 }
 
+struct MixSubtractKernel {
+	static inline float apply(float c1, float c2, float value) { return c1 - value * c2; }
+#ifdef __SSE2__
+	static inline __m128 apply(__m128 c1, __m128 c2, __m128 value)
+	{
+		return _mm_sub_ps(c1, _mm_mul_ps(value, c2));
+	}
+#endif
+};
+
+void MixSubtractOperation::executeRow(float *output, int xmin, int xmax, int y)
+{
+	executeRowKernel<MixSubtractKernel>(output, xmin, xmax, y);
+}
+
 /* ******** Mix Value Operation ******** */
 
 MixValueOperation::MixValueOperation() : MixBaseOperation()
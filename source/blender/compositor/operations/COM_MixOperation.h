@@ -24,6 +24,10 @@
 #define _COM_MixBaseOperation_h
 #include "COM_NodeOperation.h"
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 
 /**
  * All this programs converts an input color to an output value.
@@ -51,6 +55,63 @@ protected:
 		}
 	}
 	
+	/**
+	 * read a block of at most COM_ROW_BLOCK_SIZE pixels of all inputs for executeRow,
+	 * the value is multiplied with the alpha of the second color when needed
+	 */
+	void readRowInputs(float *value, float *color1, float *color2, int xmin, int xmax, int y);
+
+#ifdef __SSE2__
+	/**
+	 * store the RGB of a mixed color with the alpha of the first color, clamped if needed
+	 */
+	inline void storeMixedColor(float output[4], __m128 result, __m128 color1)
+	{
+		const __m128 mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+		result = _mm_or_ps(_mm_and_ps(mask, result), _mm_andnot_ps(mask, color1));
+		if (m_useClamp) {
+			result = _mm_min_ps(_mm_max_ps(result, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+		}
+		_mm_storeu_ps(output, result);
+	}
+#endif
+
+	/**
+	 * row loop shared by the operations that implement executeRow, Kernel::apply mixes one
+	 * channel of both colors with the value, with an __m128 overload for all channels at once
+	 * when SSE2 is available. The alpha of the first color is kept.
+	 */
+	template<typename Kernel>
+	void executeRowKernel(float *output, int xmin, int xmax, int y)
+	{
+		float inputColor1[COM_ROW_BLOCK_SIZE * COM_NUMBER_OF_CHANNELS];
+		float inputColor2[COM_ROW_BLOCK_SIZE * COM_NUMBER_OF_CHANNELS];
+		float inputValue[COM_ROW_BLOCK_SIZE * COM_NUMBER_OF_CHANNELS];
+
+		for (int x = xmin; x < xmax; x += COM_ROW_BLOCK_SIZE) {
+			int num = min(COM_ROW_BLOCK_SIZE, xmax - x);
+			readRowInputs(inputValue, inputColor1, inputColor2, x, x + num, y);
+
+			for (int i = 0; i < num; i++, output += COM_NUMBER_OF_CHANNELS) {
+				const float *color1 = &inputColor1[i * COM_NUMBER_OF_CHANNELS];
+				const float *color2 = &inputColor2[i * COM_NUMBER_OF_CHANNELS];
+				const float value = inputValue[i * COM_NUMBER_OF_CHANNELS];
+#ifdef __SSE2__
+				__m128 c1 = _mm_loadu_ps(color1);
+				__m128 c2 = _mm_loadu_ps(color2);
+				storeMixedColor(output, Kernel::apply(c1, c2, _mm_set1_ps(value)), c1);
+#else
+				output[0] = Kernel::apply(color1[0], color2[0], value);
+				output[1] = Kernel::apply(color1[1], color2[1], value);
+				output[2] = Kernel::apply(color1[2], color2[2], value);
+				output[3] = color1[3];
+
+				clampIfNeeded(output);
+#endif
+			}
+		}
+	}
+	
 public:
 	/**
 	 * Default constructor
@@ -84,12 +145,14 @@ class MixAddOperation : public MixBaseOperation {
 public:
 	MixAddOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int xmin, int xmax, int y);
 };
 
 class MixBlendOperation : public MixBaseOperation {
 public:
 	MixBlendOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int xmin, int xmax, int y);
 };
 
 class MixBurnOperation : public MixBaseOperation {
@@ -156,6 +219,7 @@ class MixMultiplyOperation : public MixBaseOperation {
 public:
 	MixMultiplyOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int xmin, int xmax, int y);
 };
 
 class MixOverlayOperation : public MixBaseOperation {
@@ -186,6 +250,7 @@ class MixSubtractOperation : public MixBaseOperation {
 public:
 	MixSubtractOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int xmin, int xmax, int y);
 };
 
 class MixValueOperation : public MixBaseOperation {
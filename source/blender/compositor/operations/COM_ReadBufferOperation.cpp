@@ -66,6 +66,20 @@ void ReadBufferOperation::executePixelSampled(float output[4], float x, float y,
 	}
 }
 
+void ReadBufferOperation::executeRow(float *output, int xmin, int xmax, int y)
+{
+	if (m_single_value) {
+		/* write buffer has a single value stored at (0,0) */
+		float color[4];
+		m_buffer->read(color, 0, 0);
+		for (int x = xmin; x < xmax; x++, output += COM_NUMBER_OF_CHANNELS)
+			copy_v4_v4(output, color);
+	}
+	else {
+		m_buffer->readRow(output, xmin, xmax, y);
+	}
+}
+
 void ReadBufferOperation::executePixelExtend(float output[4], float x, float y, PixelSampler sampler,
                                              MemoryBufferExtend extend_x, MemoryBufferExtend extend_y)
 {
@@ -32,6 +32,13 @@ void SetColorOperation::executePixelSampled(float output[4], float x, float y, P
 	copy_v4_v4(output, this->m_color);
 }
 
+void SetColorOperation::executeRow(float *output, int xmin, int xmax, int y)
+{
+	for (int x = xmin; x < xmax; x++, output += COM_NUMBER_OF_CHANNELS) {
+		copy_v4_v4(output, this->m_color);
+	}
+}
+
 void SetColorOperation::determineResolution(unsigned int resolution[2], unsigned int preferredResolution[2])
 {
 	resolution[0] = preferredResolution[0];
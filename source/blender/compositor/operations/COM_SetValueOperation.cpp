@@ -32,6 +32,13 @@ void SetValueOperation::executePixelSampled(float output[4], float x, float y, P
 	output[0] = this->m_value;
 }
 
+void SetValueOperation::executeRow(float *output, int xmin, int xmax, int y)
+{
+	for (int x = xmin; x < xmax; x++, output += COM_NUMBER_OF_CHANNELS) {
+		output[0] = this->m_value;
+	}
+}
+
 void SetValueOperation::determineResolution(unsigned int resolution[2], unsigned int preferredResolution[2])
 {
 	resolution[0] = preferredResolution[0];
@@ -90,32 +90,35 @@ void ViewerOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 	const int x2 = rect->xmax;
 	const int y2 = rect->ymax;
 	const int offsetadd = (this->getWidth() - (x2 - x1));
-	const int offsetadd4 = offsetadd * 4;
 	int offset = (y1 * this->getWidth() + x1);
-	int offset4 = offset * 4;
-	float alpha[4], depth[4];
+	float row[COM_ROW_BLOCK_SIZE * COM_NUMBER_OF_CHANNELS];
 	int x;
 	int y;
 	bool breaked = false;
 
 	for (y = y1; y < y2 && (!breaked); y++) {
-		for (x = x1; x < x2; x++) {
-			this->m_imageInput->readSampled(&(buffer[offset4]), x, y, COM_PS_NEAREST);
+		this->m_imageInput->readRow(&(buffer[offset * 4]), x1, x2, y);
+
+		for (x = x1; x < x2; x += COM_ROW_BLOCK_SIZE) {
+			int num = min(COM_ROW_BLOCK_SIZE, x2 - x);
+			int i;
+
 			if (this->m_useAlphaInput) {
-				this->m_alphaInput->readSampled(alpha, x, y, COM_PS_NEAREST);
-				buffer[offset4 + 3] = alpha[0];
+				this->m_alphaInput->readRow(row, x, x + num, y);
+				for (i = 0; i < num; i++) {
+					buffer[(offset + i) * 4 + 3] = row[i * COM_NUMBER_OF_CHANNELS];
+				}
 			}
-			this->m_depthInput->readSampled(depth, x, y, COM_PS_NEAREST);
-			depthbuffer[offset] = depth[0];
-
-			offset ++;
-			offset4 += 4;
+			this->m_depthInput->readRow(row, x, x + num, y);
+			for (i = 0; i < num; i++) {
+				depthbuffer[offset + i] = row[i * COM_NUMBER_OF_CHANNELS];
+			}
+			offset += num;
 		}
 		if (isBreaked()) {
 			breaked = true;
 		}
 		offset += offsetadd;
-		offset4 += offsetadd4;
 	}
 	updateImage(rect);
 }
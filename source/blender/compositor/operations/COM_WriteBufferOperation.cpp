@@ -61,6 +61,7 @@ void WriteBufferOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 {
 	MemoryBuffer *memoryBuffer = this->m_memoryProxy->getBuffer();
 	float *buffer = memoryBuffer->getBuffer();
+	const unsigned int num_channels = memoryBuffer->getNumberOfChannels();
 	if (this->m_input->isComplex()) {
 		void *data = this->m_input->initializeTileData(rect);
 		int x1 = rect->xmin;
@@ -71,10 +72,17 @@ void WriteBufferOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 		int y;
 		bool breaked = false;
 		for (y = y1; y < y2 && (!breaked); y++) {
-			int offset4 = (y * memoryBuffer->getWidth() + x1) * COM_NUMBER_OF_CHANNELS;
+			int offset = (y * memoryBuffer->getWidth() + x1) * num_channels;
 			for (x = x1; x < x2; x++) {
-				this->m_input->read(&(buffer[offset4]), x, y, data);
-				offset4 += COM_NUMBER_OF_CHANNELS;
+				if (num_channels == COM_NUMBER_OF_CHANNELS) {
+					this->m_input->read(&(buffer[offset]), x, y, data);
+				}
+				else {
+					float color[4];
+					this->m_input->read(color, x, y, data);
+					memcpy(&(buffer[offset]), color, sizeof(float) * num_channels);
+				}
+				offset += num_channels;
 			}
 			if (isBreaked()) {
 				breaked = true;
@@ -96,10 +104,21 @@ void WriteBufferOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 		int y;
 		bool breaked = false;
 		for (y = y1; y < y2 && (!breaked); y++) {
-			int offset4 = (y * memoryBuffer->getWidth() + x1) * COM_NUMBER_OF_CHANNELS;
-			for (x = x1; x < x2; x++) {
-				this->m_input->readSampled(&(buffer[offset4]), x, y, COM_PS_NEAREST);
-				offset4 += COM_NUMBER_OF_CHANNELS;
+			int offset = (y * memoryBuffer->getWidth() + x1) * num_channels;
+			if (num_channels == COM_NUMBER_OF_CHANNELS) {
+				/* execute the whole row at once, directly into the buffer */
+				this->m_input->readRow(&(buffer[offset]), x1, x2, y);
+			}
+			else {
+				float row[COM_ROW_BLOCK_SIZE * COM_NUMBER_OF_CHANNELS];
+				for (x = x1; x < x2; x += COM_ROW_BLOCK_SIZE) {
+					int xmax = min(x + COM_ROW_BLOCK_SIZE, x2);
+					this->m_input->readRow(row, x, xmax, y);
+					for (int i = 0; i < xmax - x; i++) {
+						memcpy(&(buffer[offset]), &row[i * COM_NUMBER_OF_CHANNELS], sizeof(float) * num_channels);
+						offset += num_channels;
+					}
+				}
 			}
 			if (isBreaked()) {
 				breaked = true;
@@ -58,6 +58,7 @@
 #include "IMB_imbuf_types.h"
 
 #include "BKE_anim.h"
+#include "BKE_animsys.h"
 #include "BKE_constraint.h"
 #include "BKE_context.h"
 #include "BKE_curve.h"
@@ -368,6 +369,9 @@ static bool ED_object_editmode_load_ex(Object *obedit, const bool freedata)
 	 */
 	DAG_id_tag_update((ID *)obedit->data, 0);
 
+	/* the vertices, bones, points... animation paths resolved to were replaced */
+	BKE_animsys_eval_plans_invalidate();
+
 	return true;
 }
 
@@ -51,6 +51,7 @@
 #include "DNA_scene_types.h"
 #include "DNA_object_types.h"
 
+#include "BKE_animsys.h"
 #include "BKE_context.h"
 #include "BKE_depsgraph.h"
 #include "BKE_key.h"
@@ -149,6 +150,9 @@ static bool ED_object_shape_key_remove(Main *bmain, Object *ob)
 		if (kb->data) MEM_freeN(kb->data);
 		MEM_freeN(kb);
 
+		/* animation may have resolved paths to the key block */
+		BKE_animsys_eval_plans_invalidate();
+
 		if (ob->shapenr > 1) {
 			ob->shapenr--;
 		}
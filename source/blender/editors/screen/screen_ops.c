@@ -58,6 +58,7 @@
 #include "BKE_report.h"
 #include "BKE_scene.h"
 #include "BKE_screen.h"
+#include "BKE_sequencer.h"
 #include "BKE_editmesh.h"
 #include "BKE_sound.h"
 #include "BKE_mask.h"
@@ -3546,10 +3547,13 @@ int ED_screen_animation_play(bContext *C, int sync, int mode)
 		/* stop playback now */
 		ED_screen_animation_timer(C, 0, 0, 0, 0);
 		sound_stop_scene(scene);
+		BKE_sequencer_prefetch_stop();
 	}
 	else {
 		int refresh = SPACE_TIME; /* these settings are currently only available from a menu in the TimeLine */
 		
+		BKE_sequencer_prefetch_stats_reset();
+
 		if (mode == 1)  /* XXX only play audio forwards!? */
 			sound_play_scene(scene);
 		
@@ -36,7 +36,10 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "PIL_time.h"
+
 #include "BLI_blenlib.h"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
 #include "DNA_packedFile_types.h"
@@ -325,6 +328,9 @@ static int sound_mixdown_exec(bContext *C, wmOperator *op)
 	AUD_Container container;
 	AUD_Codec codec;
 	const char *result;
+	unsigned int start, length;
+	int threads;
+	double time;
 
 	sound_bake_animation_exec(C, op);
 
@@ -343,17 +349,28 @@ static int sound_mixdown_exec(bContext *C, wmOperator *op)
 	BLI_strncpy(filename, path, sizeof(filename));
 	BLI_path_abs(filename, bmain->name);
 
+	start = SFRA * specs.rate / FPS;
+	length = (EFRA - SFRA) * specs.rate / FPS;
+	threads = BLI_system_thread_count();
+	time = PIL_check_seconds_timer();
+
 	if (split)
-		result = AUD_mixdown_per_channel(scene->sound_scene, SFRA * specs.rate / FPS, (EFRA - SFRA) * specs.rate / FPS,
-		                                 accuracy, filename, specs, container, codec, bitrate);
+		result = AUD_mixdown_per_channel(scene->sound_scene, start, length, accuracy, filename, specs, container,
+		                                 codec, bitrate, threads);
 	else
-		result = AUD_mixdown(scene->sound_scene, SFRA * specs.rate / FPS, (EFRA - SFRA) * specs.rate / FPS,
-		                     accuracy, filename, specs, container, codec, bitrate);
+		result = AUD_mixdown(scene->sound_scene, start, length, accuracy, filename, specs, container,
+		                     codec, bitrate, threads);
 
 	if (result) {
 		BKE_report(op->reports, RPT_ERROR, result);
 		return OPERATOR_CANCELLED;
 	}
+
+	time = PIL_check_seconds_timer() - time;
+	if (time > 0.0) {
+		BKE_reportf(op->reports, RPT_INFO, "Mixdown: %.1f seconds of audio per second (%d threads)",
+		            (double)length / specs.rate / time, threads);
+	}
 #else // WITH_AUDASPACE
 	(void)C;
 	(void)op;
@@ -61,6 +61,7 @@
 #include "ED_gpencil.h"
 #include "ED_markers.h"
 #include "ED_mask.h"
+#include "ED_screen.h"
 #include "ED_sequencer.h"
 #include "ED_space_api.h"
 
@@ -873,12 +874,13 @@ ImBuf *sequencer_ibuf_get(struct Main *bmain, Scene *scene, SpaceSeq *sseq, int
 	 */
 	G.is_break = false;
 
+	/* frames ahead are only rendered during playback, the overlay frame doesn't move with it */
 	if (special_seq_update)
 		ibuf = BKE_sequencer_give_ibuf_direct(&context, cfra + frame_ofs, special_seq_update);
-	else if (!U.prefetchframes) // XXX || (G.f & G_PLAYANIM) == 0) {
-		ibuf = BKE_sequencer_give_ibuf(&context, cfra + frame_ofs, sseq->chanshown);
+	else if (U.prefetchframes && frame_ofs == 0 && ED_screen_animation_playing(bmain->wm.first))
+		ibuf = BKE_sequencer_give_ibuf_threaded(&context, cfra, sseq->chanshown, U.prefetchframes);
 	else
-		ibuf = BKE_sequencer_give_ibuf_threaded(&context, cfra + frame_ofs, sseq->chanshown);
+		ibuf = BKE_sequencer_give_ibuf(&context, cfra + frame_ofs, sseq->chanshown);
 
 	/* restore state so real rendering would be canceled (if needed) */
 	G.is_break = is_break;
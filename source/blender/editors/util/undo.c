@@ -38,10 +38,12 @@
 #include "DNA_object_types.h"
 #include "DNA_scene_types.h"
 
+#include "BLI_string.h"
 #include "BLI_utildefines.h"
 
 #include "BLF_translation.h"
 
+#include "BKE_animsys.h"
 #include "BKE_blender.h"
 #include "BKE_context.h"
 #include "BKE_global.h"
@@ -83,6 +85,9 @@ void ED_undo_push(bContext *C, const char *str)
 	if (G.debug & G_DEBUG)
 		printf("%s: %s\n", __func__, str);
 
+	/* any operator may have changed data that animation paths resolved to */
+	BKE_animsys_eval_plans_invalidate();
+
 	if (obedit) {
 		if (U.undosteps == 0) return;
 		
@@ -550,7 +555,17 @@ static int undo_history_invoke(bContext *C, wmOperator *op, const wmEvent *UNUSE
 					add_col = false;
 				}
 				if (item[i].identifier) {
-					uiItemIntO(column, item[i].name, item[i].icon, op->type->idname, "item", item[i].value);
+					const char *name = item[i].name;
+					char name_mem[UI_MAX_NAME_STR];
+
+					/* memory of global undo steps, shared data is divided over the steps using it */
+					if (undosys == UNDOSYSTEM_GLOBAL) {
+						BLI_snprintf(name_mem, sizeof(name_mem), "%s (%.2fM)", name,
+						             (double)(BKE_undo_get_memory(item[i].value) >> 10) / 1024.0);
+						name = name_mem;
+					}
+
+					uiItemIntO(column, name, item[i].icon, op->type->idname, "item", item[i].value);
 					++c;
 					add_col = true;
 				}
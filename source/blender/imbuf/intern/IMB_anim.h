@@ -121,6 +121,7 @@
 
 struct _AviMovie;
 struct anim_index;
+struct AnimReadahead;
 
 struct anim {
 	int ib_flags;
@@ -179,6 +180,12 @@ struct anim {
 	int64_t last_pts;
 	int64_t next_pts;
 	AVPacket next_packet;
+
+	/* frames decoded ahead of the last fetched one, see ffmpeg_fetchibuf */
+	struct AnimReadahead *readahead;
+	/* sorted pts of the keyframes seen while decoding, for seeking without index */
+	int64_t *keyframe_pts;
+	int keyframe_pts_len;
 #endif
 
 #ifdef WITH_REDCODE
@@ -196,4 +203,6 @@ struct anim {
 	char colorspace[64];
 };
 
+void imb_anim_readahead_stop(struct anim *anim);
+
 #endif
@@ -67,6 +67,7 @@
 #include "BLI_utildefines.h"
 #include "BLI_string.h"
 #include "BLI_path_util.h"
+#include "BLI_threads.h"
 
 #include "MEM_guardedalloc.h"
 
@@ -763,6 +764,62 @@ static void ffmpeg_postprocess(struct anim *anim)
 	}
 }
 
+/* Keyframe index
+ *
+ * Without a timecode index the pts of every keyframe that gets decoded is
+ * remembered, so later seeks can go straight to the keyframe before the
+ * wanted frame instead of guessing with the preseek distance, and short
+ * jumps within the current GOP are scanned instead of seeked.
+ */
+
+/* seeks forward are replaced by scanning up to this many frames */
+#define ANIM_KEYFRAME_SCAN_MAX 100
+
+/* index of the last known keyframe at or before pts, -1 when there is none */
+static int ffmpeg_keyframe_find(struct anim *anim, int64_t pts)
+{
+	int low = 0, high = anim->keyframe_pts_len;
+
+	while (low < high) {
+		int mid = (low + high) / 2;
+
+		if (anim->keyframe_pts[mid] <= pts) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+
+	return low - 1;
+}
+
+static void ffmpeg_keyframe_add(struct anim *anim, int64_t pts)
+{
+	int index = ffmpeg_keyframe_find(anim, pts);
+
+	if (pts == AV_NOPTS_VALUE || (index != -1 && anim->keyframe_pts[index] == pts)) {
+		return;
+	}
+
+	if ((anim->keyframe_pts_len % 64) == 0) {
+		size_t size = sizeof(int64_t) * (anim->keyframe_pts_len + 64);
+
+		if (anim->keyframe_pts) {
+			anim->keyframe_pts = MEM_reallocN(anim->keyframe_pts, size);
+		}
+		else {
+			anim->keyframe_pts = MEM_mallocN(size, "anim keyframe pts");
+		}
+	}
+
+	index++;
+	memmove(&anim->keyframe_pts[index + 1], &anim->keyframe_pts[index],
+	        sizeof(int64_t) * (anim->keyframe_pts_len - index));
+	anim->keyframe_pts[index] = pts;
+	anim->keyframe_pts_len++;
+}
+
 /* decode one video frame also considering the packet read into next_packet */
 
 static int ffmpeg_decode_video_frame(struct anim *anim)
@@ -803,6 +860,10 @@ static int ffmpeg_decode_video_frame(struct anim *anim)
 				anim->next_pts = av_get_pts_from_frame(
 				        anim->pFormatCtx, anim->pFrame);
 
+				if (anim->pFrame->key_frame) {
+					ffmpeg_keyframe_add(anim, anim->next_pts);
+				}
+
 				av_log(anim->pFormatCtx,
 				       AV_LOG_DEBUG,
 				       "  FRAME DONE: next_pts=%lld "
@@ -842,6 +903,10 @@ static int ffmpeg_decode_video_frame(struct anim *anim)
 			anim->next_pts = av_get_pts_from_frame(
 				anim->pFormatCtx, anim->pFrame);
 
+			if (anim->pFrame->key_frame) {
+				ffmpeg_keyframe_add(anim, anim->next_pts);
+			}
+
 			av_log(anim->pFormatCtx,
 			       AV_LOG_DEBUG,
 			       "  FRAME DONE (after EOF): next_pts=%lld "
@@ -944,8 +1009,8 @@ static int ffmpeg_seek_by_byte(AVFormatContext *pFormatCtx)
 	return false;
 }
 
-static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position,
-                               IMB_Timecode_Type tc)
+static ImBuf *ffmpeg_fetchibuf_direct(struct anim *anim, int position,
+                                      IMB_Timecode_Type tc)
 {
 	int64_t pts_to_search = 0;
 	double frame_rate;
@@ -955,6 +1020,7 @@ static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position,
 	AVStream *v_st;
 	int new_frame_index = 0; /* To quiet gcc barking... */
 	int old_frame_index = 0; /* To quiet gcc barking... */
+	int keyframe;
 
 	if (anim == NULL) return (0);
 
@@ -1026,6 +1092,18 @@ static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position,
 
 		ffmpeg_decode_video_frame_scan(anim, pts_to_search);
 	}
+	else if (!tc_index &&
+	         position > anim->curposition + 1 &&
+	         position - (anim->curposition + 1) < ANIM_KEYFRAME_SCAN_MAX &&
+	         (keyframe = ffmpeg_keyframe_find(anim, pts_to_search)) != -1 &&
+	         anim->keyframe_pts[keyframe] <= anim->next_pts)
+	{
+		av_log(anim->pFormatCtx, AV_LOG_DEBUG, 
+		       "FETCH: no keyframe in between "
+		       "(keyframe index tells us)\n");
+
+		ffmpeg_decode_video_frame_scan(anim, pts_to_search);
+	}
 	else if (position != anim->curposition + 1) {
 		long long pos;
 		int ret;
@@ -1060,6 +1138,18 @@ static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position,
 				                    dts, AVSEEK_FLAG_BACKWARD);
 			}
 		}
+		else if (!ffmpeg_seek_by_byte(anim->pFormatCtx) &&
+		         (keyframe = ffmpeg_keyframe_find(anim, pts_to_search)) != -1)
+		{
+			pos = anim->keyframe_pts[keyframe];
+
+			av_log(anim->pFormatCtx, AV_LOG_DEBUG, 
+			       "KEYFRAME INDEX seek pts = %lld\n", pos);
+
+			ret = av_seek_frame(anim->pFormatCtx, 
+			                    anim->videoStream,
+			                    pos, AVSEEK_FLAG_BACKWARD);
+		}
 		else {
 			pos = (long long) (position - anim->preseek) *
 			      AV_TIME_BASE / frame_rate;
@@ -1132,10 +1222,197 @@ static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position,
 	return anim->last_frame;
 }
 
+/* Read-ahead
+ *
+ * Once frames are fetched in order, a thread keeps decoding and converting
+ * the following frames into a small ring buffer, so playback and tracking
+ * get them without waiting for the decoder. The thread owns the decoder
+ * state while it runs, every other access to it stops the thread first.
+ */
+
+#define ANIM_READAHEAD_FRAMES 4
+
+typedef struct AnimReadahead {
+	ThreadMutex mutex;
+	ThreadCondition cond;
+	ListBase threads;
+	bool running, stop, failed;
+	IMB_Timecode_Type tc;
+
+	/* decoded frames with consecutive positions, starting at first_position */
+	ImBuf *frames[ANIM_READAHEAD_FRAMES];
+	int first_position;
+	int head, count;
+
+	/* last position fetched by the caller, to detect sequential access */
+	int last_position;
+} AnimReadahead;
+
+static ImBuf *ffmpeg_readahead_pop(AnimReadahead *ra)
+{
+	ImBuf *ibuf = ra->frames[ra->head];
+
+	ra->frames[ra->head] = NULL;
+	ra->head = (ra->head + 1) % ANIM_READAHEAD_FRAMES;
+	ra->count--;
+	ra->first_position++;
+
+	return ibuf;
+}
+
+static void *ffmpeg_readahead_thread(void *data)
+{
+	struct anim *anim = data;
+	AnimReadahead *ra = anim->readahead;
+
+	BLI_mutex_lock(&ra->mutex);
+
+	while (!ra->stop) {
+		int position = ra->first_position + ra->count;
+		ImBuf *ibuf;
+
+		if (ra->count == ANIM_READAHEAD_FRAMES || position >= anim->duration || ra->failed) {
+			BLI_condition_wait(&ra->cond, &ra->mutex);
+			continue;
+		}
+
+		BLI_mutex_unlock(&ra->mutex);
+		ibuf = ffmpeg_fetchibuf_direct(anim, position, ra->tc);
+		BLI_mutex_lock(&ra->mutex);
+
+		if (ibuf) {
+			ra->frames[(ra->head + ra->count) % ANIM_READAHEAD_FRAMES] = ibuf;
+			ra->count++;
+		}
+		else {
+			ra->failed = true;
+		}
+
+		BLI_condition_notify_all(&ra->cond);
+	}
+
+	BLI_mutex_unlock(&ra->mutex);
+
+	return NULL;
+}
+
+static void ffmpeg_readahead_start(struct anim *anim, int position, IMB_Timecode_Type tc)
+{
+	AnimReadahead *ra = anim->readahead;
+
+	ra->tc = tc;
+	ra->first_position = position;
+	ra->head = 0;
+	ra->count = 0;
+	ra->stop = false;
+	ra->failed = false;
+	ra->running = true;
+
+	/* also makes guarded allocation thread safe until the thread is stopped */
+	BLI_init_threads(&ra->threads, ffmpeg_readahead_thread, 1);
+	BLI_insert_thread(&ra->threads, anim);
+}
+
+static void ffmpeg_readahead_stop(struct anim *anim)
+{
+	AnimReadahead *ra = anim->readahead;
+
+	if (ra == NULL || !ra->running) {
+		return;
+	}
+
+	BLI_mutex_lock(&ra->mutex);
+	ra->stop = true;
+	BLI_condition_notify_all(&ra->cond);
+	BLI_mutex_unlock(&ra->mutex);
+
+	BLI_end_threads(&ra->threads);
+	ra->running = false;
+
+	while (ra->count) {
+		IMB_freeImBuf(ffmpeg_readahead_pop(ra));
+	}
+}
+
+static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position,
+                               IMB_Timecode_Type tc)
+{
+	AnimReadahead *ra = anim->readahead;
+	ImBuf *ibuf = NULL;
+	bool sequential;
+
+	if (ra == NULL) {
+		ra = anim->readahead = MEM_callocN(sizeof(AnimReadahead), "anim readahead");
+		BLI_mutex_init(&ra->mutex);
+		BLI_condition_init(&ra->cond);
+		/* the first fetch doesn't count as sequential, it's often a single preview frame */
+		ra->last_position = -2;
+	}
+
+	if (ra->running) {
+		BLI_mutex_lock(&ra->mutex);
+
+		if (ra->tc == tc &&
+		    position >= ra->first_position &&
+		    position <= ra->first_position + ANIM_READAHEAD_FRAMES)
+		{
+			while (ibuf == NULL && !ra->failed) {
+				if (ra->count == 0) {
+					BLI_condition_wait(&ra->cond, &ra->mutex);
+				}
+				else {
+					ImBuf *frame = ffmpeg_readahead_pop(ra);
+
+					/* frames skipped by the caller are dropped */
+					if (ra->first_position - 1 == position) {
+						ibuf = frame;
+					}
+					else {
+						IMB_freeImBuf(frame);
+					}
+
+					/* room for the thread to decode the next frame */
+					BLI_condition_notify_all(&ra->cond);
+				}
+			}
+		}
+
+		BLI_mutex_unlock(&ra->mutex);
+
+		if (ibuf) {
+			ra->last_position = position;
+			return ibuf;
+		}
+	}
+
+	sequential = (position == ra->last_position + 1);
+
+	ffmpeg_readahead_stop(anim);
+	ibuf = ffmpeg_fetchibuf_direct(anim, position, tc);
+	ra->last_position = position;
+
+	if (ibuf && sequential && position + 1 < anim->duration) {
+		ffmpeg_readahead_start(anim, position + 1, tc);
+	}
+
+	return ibuf;
+}
+
 static void free_anim_ffmpeg(struct anim *anim)
 {
 	if (anim == NULL) return;
 
+	if (anim->readahead) {
+		ffmpeg_readahead_stop(anim);
+		BLI_mutex_end(&anim->readahead->mutex);
+		BLI_condition_end(&anim->readahead->cond);
+		MEM_freeN(anim->readahead);
+		anim->readahead = NULL;
+	}
+
+	MEM_SAFE_FREE(anim->keyframe_pts);
+	anim->keyframe_pts_len = 0;
+
 	if (anim->pCodecCtx) {
 		avcodec_close(anim->pCodecCtx);
 		avformat_close_input(&anim->pFormatCtx);
@@ -1157,6 +1434,15 @@ static void free_anim_ffmpeg(struct anim *anim)
 
 #endif
 
+void imb_anim_readahead_stop(struct anim *anim)
+{
+#ifdef WITH_FFMPEG
+	ffmpeg_readahead_stop(anim);
+#else
+	(void)anim;
+#endif
+}
+
 #ifdef WITH_REDCODE
 
 static int startredcode(struct anim *anim)
@@ -1380,9 +1666,8 @@ struct ImBuf *IMB_anim_absolute(struct anim *anim, int position,
 #endif
 #ifdef WITH_FFMPEG
 		case ANIM_FFMPEG:
+			/* curposition is set by the decoder, which may run ahead on its own thread */
 			ibuf = ffmpeg_fetchibuf(anim, position, tc);
-			if (ibuf)
-				anim->curposition = position;
 			filter_y = 0; /* done internally */
 			break;
 #endif
@@ -1396,7 +1681,7 @@ struct ImBuf *IMB_anim_absolute(struct anim *anim, int position,
 
 	if (ibuf) {
 		if (filter_y) IMB_filtery(ibuf);
-		BLI_snprintf(ibuf->name, sizeof(ibuf->name), "%s.%04d", anim->name, anim->curposition + 1);
+		BLI_snprintf(ibuf->name, sizeof(ibuf->name), "%s.%04d", anim->name, position + 1);
 		
 	}
 	return(ibuf);
@@ -1216,6 +1216,9 @@ void IMB_free_indices(struct anim *anim)
 {
 	int i;
 
+	/* the read-ahead thread uses the timecode index */
+	imb_anim_readahead_stop(anim);
+
 	for (i = 0; i < IMB_PROXY_MAX_SLOT; i++) {
 		if (anim->proxy_anim[i]) {
 			IMB_close_anim(anim->proxy_anim[i]);
@@ -810,6 +810,68 @@ void IMB_exr_read_channels(void *handle)
 	}
 }
 
+/* Read image rows ymin to ymax (bottom-up, like the rest of blender) into the
+ * channel rects. The rects point to the pixels of row 0, so they can be set to
+ * a buffer that only holds the rows being read. */
+void IMB_exr_read_scanlines(void *handle, int ymin, int ymax)
+{
+	ExrHandle *data = (ExrHandle *)handle;
+	FrameBuffer frameBuffer;
+	ExrChannel *echan;
+
+	const StringAttribute *ta = data->ifile->header().findTypedAttribute <StringAttribute> ("BlenderMultiChannel");
+	short flip = (ta && strncmp(ta->value().c_str(), "Blender V2.43", 13) == 0);
+
+	for (echan = (ExrChannel *)data->channels.first; echan; echan = echan->next) {
+		if (echan->rect) {
+			if (flip)
+				frameBuffer.insert(echan->name, Slice(Imf::FLOAT,  (char *)echan->rect,
+				                                      echan->xstride * sizeof(float), echan->ystride * sizeof(float)));
+			else
+				frameBuffer.insert(echan->name, Slice(Imf::FLOAT,  (char *)(echan->rect + echan->xstride * (data->height - 1) * data->width),
+				                                      echan->xstride * sizeof(float), -echan->ystride * sizeof(float)));
+		}
+	}
+
+	data->ifile->setFrameBuffer(frameBuffer);
+
+	try {
+		if (flip)
+			data->ifile->readPixels(ymin, ymax);
+		else
+			data->ifile->readPixels(data->height - 1 - ymax, data->height - 1 - ymin);
+	}
+	catch (const std::exception &exc) {
+		std::cerr << "OpenEXR-readPixels: ERROR: " << exc.what() << std::endl;
+	}
+}
+
+/* Write the next num_rows rows of a scanline file, files are written from the
+ * top row down. Like IMB_exr_read_scanlines the channel rects point to the
+ * pixels of row 0. */
+void IMB_exr_write_scanlines(void *handle, int num_rows)
+{
+	ExrHandle *data = (ExrHandle *)handle;
+	FrameBuffer frameBuffer;
+	ExrChannel *echan;
+
+	for (echan = (ExrChannel *)data->channels.first; echan; echan = echan->next) {
+		/* last scanline, stride negative */
+		float *rect = echan->rect + echan->xstride * (data->height - 1) * data->width;
+
+		frameBuffer.insert(echan->name, Slice(Imf::FLOAT,  (char *)rect,
+		                                      echan->xstride * sizeof(float), -echan->ystride * sizeof(float)));
+	}
+
+	data->ofile->setFrameBuffer(frameBuffer);
+	try {
+		data->ofile->writePixels(num_rows);
+	}
+	catch (const std::exception &exc) {
+		std::cerr << "OpenEXR-writePixels: ERROR: " << exc.what() << std::endl;
+	}
+}
+
 void IMB_exr_multilayer_convert(void *handle, void *base,
                                 void * (*addlayer)(void *base, const char *str),
                                 void (*addpass)(void *base, void *lay, const char *str,
@@ -58,6 +58,8 @@ void    IMB_exr_set_channel(void *handle, const char *layname, const char *passn
 
 void    IMB_exr_read_channels(void *handle);
 void    IMB_exr_write_channels(void *handle);
+void    IMB_exr_read_scanlines(void *handle, int ymin, int ymax);
+void    IMB_exr_write_scanlines(void *handle, int num_rows);
 void    IMB_exrtile_write_channels(void *handle, int partx, int party, int level);
 void    IMB_exrtile_clear_channels(void *handle);
 
@@ -866,6 +866,8 @@ typedef struct AnimData {
 	short act_blendmode;    /* accumulation mode for active action */
 	short act_extendmode;   /* extrapolation mode for active action */
 	float act_influence;    /* influence for active action */
+
+	struct AnimEvalPlan *eval_plan;  /* runtime: RNA bindings resolved for evaluation, not saved */
 } AnimData;
 
 /* Animation Data settings (mostly for NLA) */
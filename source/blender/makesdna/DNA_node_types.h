@@ -346,7 +346,7 @@ typedef struct bNodeTree {
 	int update;						/* update flags */
 	short is_updating;				/* flag to prevent reentrant update calls */
 	short done;						/* generic temporary flag for recursion check (DFS/BFS) */
-	int pad2;
+	int cache_size;					/* compositor buffer cache memory limit in MB */
 	
 	int nodetype DNA_DEPRECATED;	/* specific node type this tree is used for */
 
@@ -406,6 +406,8 @@ typedef struct bNodeTree {
 #define NTREE_COM_GROUPNODE_BUFFER	8	/* use groupnode buffers */
 #define NTREE_VIEWER_BORDER			16	/* use a border for viewer nodes */
 #define NTREE_IS_LOCALIZED			32	/* tree is localized copy, free when deleting node groups */
+#define NTREE_COM_BUFFER_CACHE		64	/* keep compositor buffers between executions */
+#define NTREE_COM_BUFFER_CACHE_DISK	128	/* write compositor buffers exceeding the cache memory limit to disk */
 
 /* XXX not nice, but needed as a temporary flags
  * for group updates after library linking.
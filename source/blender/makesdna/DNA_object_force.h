@@ -206,6 +206,8 @@ typedef struct PointCache {
 
 	struct PTCacheEdit *edit;
 	void (*free_edit)(struct PTCacheEdit *edit);	/* free callback */
+
+	struct PTCacheArchive *archive;	/* open disk cache archive (runtime only) */
 } PointCache;
 
 typedef struct SBVertex {
@@ -409,6 +411,8 @@ typedef struct SoftBody {
 /* high resolution cache is saved for smoke for backwards compatibility, so set this flag to know it's a "fake" cache */
 #define PTCACHE_FAKE_SMOKE			(1<<12)
 #define PTCACHE_IGNORE_CLEAR		(1<<13)
+/* all frames of the disk cache are stored in a single archive file */
+#define PTCACHE_DISK_ARCHIVE		(1<<14)
 
 /* PTCACHE_OUTDATED + PTCACHE_FRAMES_SKIPPED */
 #define PTCACHE_REDO_NEEDED			258
@@ -380,6 +380,9 @@ static void rna_FCurve_RnaPath_set(PointerRNA *ptr, const char *value)
 	}
 	else
 		fcu->rna_path = NULL;
+	
+	/* the new string may reuse the address of the old one */
+	BKE_animsys_eval_plans_invalidate();
 }
 
 static void rna_FCurve_group_set(PointerRNA *ptr, PointerRNA value)
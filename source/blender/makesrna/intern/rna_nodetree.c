@@ -7704,6 +7704,22 @@ static void rna_def_composite_nodetree(BlenderRNA *brna)
 	RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_VIEWER_BORDER);
 	RNA_def_property_ui_text(prop, "Viewer Border", "Use boundaries for viewer nodes and composite backdrop");
 	RNA_def_property_update(prop, NC_NODE | ND_DISPLAY, "rna_NodeTree_update");
+
+	prop = RNA_def_property(srna, "use_buffer_cache", PROP_BOOLEAN, PROP_NONE);
+	RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_COM_BUFFER_CACHE);
+	RNA_def_property_ui_text(prop, "Buffer Cache", "Keep intermediate buffers while editing, "
+	                                               "so only nodes affected by a change are recalculated");
+
+	prop = RNA_def_property(srna, "use_buffer_cache_disk", PROP_BOOLEAN, PROP_NONE);
+	RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_COM_BUFFER_CACHE_DISK);
+	RNA_def_property_ui_text(prop, "Cache to Disk", "Write cached buffers exceeding the memory limit "
+	                                                "to the temporary directory instead of freeing them");
+
+	prop = RNA_def_property(srna, "buffer_cache_size", PROP_INT, PROP_NONE);
+	RNA_def_property_int_sdna(prop, NULL, "cache_size");
+	RNA_def_property_range(prop, 0, INT_MAX);
+	RNA_def_property_ui_range(prop, 0, 16384, 64, -1);
+	RNA_def_property_ui_text(prop, "Cache Limit", "Memory used for cached buffers (in megabytes)");
 }
 
 static void rna_def_shader_nodetree(BlenderRNA *brna)
@@ -157,6 +157,39 @@ static void rna_Cache_toggle_disk_cache(Main *UNUSED(bmain), Scene *UNUSED(scene
 	BLI_freelistN(&pidlist);
 }
 
+static void rna_Cache_toggle_disk_archive(Main *UNUSED(bmain), Scene *UNUSED(scene), PointerRNA *ptr)
+{
+	Object *ob = (Object *)ptr->id.data;
+	PointCache *cache = (PointCache *)ptr->data;
+	PTCacheID *pid = NULL;
+	ListBase pidlist;
+
+	if (!ob)
+		return;
+
+	BKE_ptcache_ids_from_object(&pidlist, ob, NULL, 0);
+
+	for (pid = pidlist.first; pid; pid = pid->next) {
+		if (pid->cache == cache)
+			break;
+	}
+
+	if (pid) {
+		BKE_ptcache_toggle_disk_archive(pid);
+		DAG_id_tag_update(&ob->id, OB_RECALC_DATA);
+	}
+
+	BLI_freelistN(&pidlist);
+}
+
+static int rna_PointCache_disk_archive_editable(PointerRNA *ptr)
+{
+	PointCache *cache = (PointCache *)ptr->data;
+
+	/* baked caches can't be cleared to be written in the other format */
+	return (cache->flag & PTCACHE_BAKED) == 0;
+}
+
 static void rna_Cache_idname_change(Main *UNUSED(bmain), Scene *UNUSED(scene), PointerRNA *ptr)
 {
 	Object *ob = (Object *)ptr->id.data;
@@ -840,6 +873,14 @@ static void rna_def_pointcache(BlenderRNA *brna)
 	RNA_def_property_ui_text(prop, "Disk Cache", "Save cache files to disk (.blend file must be saved first)");
 	RNA_def_property_update(prop, NC_OBJECT, "rna_Cache_toggle_disk_cache");
 
+	prop = RNA_def_property(srna, "use_disk_archive", PROP_BOOLEAN, PROP_NONE);
+	RNA_def_property_boolean_sdna(prop, NULL, "flag", PTCACHE_DISK_ARCHIVE);
+	RNA_def_property_editable_func(prop, "rna_PointCache_disk_archive_editable");
+	RNA_def_property_ui_text(prop, "Single File",
+	                         "Store all frames of the disk cache in one indexed file, which is memory mapped and "
+	                         "only decompresses the data that is needed");
+	RNA_def_property_update(prop, NC_OBJECT, "rna_Cache_toggle_disk_archive");
+
 	prop = RNA_def_property(srna, "is_outdated", PROP_BOOLEAN, PROP_NONE);
 	RNA_def_property_boolean_sdna(prop, NULL, "flag", PTCACHE_OUTDATED);
 	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
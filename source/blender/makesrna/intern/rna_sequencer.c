@@ -870,6 +870,30 @@ static void rna_SequenceEditor_overlay_lock_set(PointerRNA *ptr, int value)
 	}
 }
 
+static float rna_SequenceEditor_prefetch_hit_ratio_get(PointerRNA *UNUSED(ptr))
+{
+	SeqPrefetchStats stats;
+	BKE_sequencer_prefetch_stats_get(&stats);
+
+	return (stats.requested) ? (float)stats.hits / (float)stats.requested : 0.0f;
+}
+
+static float rna_SequenceEditor_prefetch_miss_time_get(PointerRNA *UNUSED(ptr))
+{
+	SeqPrefetchStats stats;
+	BKE_sequencer_prefetch_stats_get(&stats);
+
+	return (stats.requested > stats.hits) ? (float)(stats.miss_time / (stats.requested - stats.hits)) : 0.0f;
+}
+
+static float rna_SequenceEditor_prefetch_frame_time_get(PointerRNA *UNUSED(ptr))
+{
+	SeqPrefetchStats stats;
+	BKE_sequencer_prefetch_stats_get(&stats);
+
+	return (stats.prefetched) ? (float)(stats.prefetch_time / stats.prefetched) : 0.0f;
+}
+
 static int rna_SequenceEditor_overlay_frame_get(PointerRNA *ptr)
 {
 	Scene *scene = (Scene *)ptr->id.data;
@@ -1611,6 +1635,24 @@ static void rna_def_editor(BlenderRNA *brna)
 	RNA_def_property_int_funcs(prop, "rna_SequenceEditor_overlay_frame_get",
 	                           "rna_SequenceEditor_overlay_frame_set", NULL);
 	RNA_def_property_update(prop, NC_SPACE | ND_SPACE_SEQUENCER, NULL);
+
+	/* prefetch statistics, shared by all scenes */
+	prop = RNA_def_property(srna, "prefetch_hit_ratio", PROP_FLOAT, PROP_FACTOR);
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_float_funcs(prop, "rna_SequenceEditor_prefetch_hit_ratio_get", NULL, NULL);
+	RNA_def_property_ui_text(prop, "Prefetch Hit Ratio",
+	                         "Part of the frames shown during playback that were already prefetched");
+
+	prop = RNA_def_property(srna, "prefetch_miss_time", PROP_FLOAT, PROP_NONE);
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_float_funcs(prop, "rna_SequenceEditor_prefetch_miss_time_get", NULL, NULL);
+	RNA_def_property_ui_text(prop, "Prefetch Miss Time",
+	                         "Average time in seconds spent waiting for frames that were not prefetched");
+
+	prop = RNA_def_property(srna, "prefetch_frame_time", PROP_FLOAT, PROP_NONE);
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_float_funcs(prop, "rna_SequenceEditor_prefetch_frame_time_get", NULL, NULL);
+	RNA_def_property_ui_text(prop, "Prefetch Frame Time", "Average time in seconds to prefetch a frame");
 }
 
 static void rna_def_filter_video(StructRNA *srna)
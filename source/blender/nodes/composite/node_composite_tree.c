@@ -268,6 +268,11 @@ void ntreeCompositTagRender(Scene *curscene)
 {
 	Scene *sce;
 
+#ifdef WITH_COMPOSITOR
+	/* cached buffers can depend on the previous render result */
+	COM_clearCaches();
+#endif
+
 	for (sce = G.main->scene.first; sce; sce = sce->id.next) {
 		if (sce->nodetree) {
 			bNode *node;
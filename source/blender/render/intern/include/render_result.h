@@ -77,6 +77,7 @@ void render_result_single_layer_end(struct Render *re);
 
 void render_result_exr_file_begin(struct Render *re);
 void render_result_exr_file_end(struct Render *re);
+bool render_result_exr_file_stream_end(struct Render *re, const char *filepath, int compress);
 
 void render_result_exr_file_merge(struct RenderResult *rr, struct RenderResult *rrpart);
 
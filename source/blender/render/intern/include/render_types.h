@@ -145,6 +145,8 @@ struct Render
 	 * write lock, all external code must use a read lock. internal code is assumed
 	 * to not conflict with writes, so no lock used for that */
 	ThreadRWMutex resultmutex;
+	/* file the save buffers are written to at the end of the render, with R_STREAM_OUTPUT */
+	char stream_filepath[1024]; /* FILE_MAX */
 	
 	/* window size, display rect, viewplane */
 	int winx, winy;			/* buffer width and height with percentage applied
@@ -628,6 +630,8 @@ typedef struct LampRen {
 #define R_BAKING		64
 #define R_ANIMATION		128
 #define R_NEED_VCOL		256
+#define R_STREAM_OUTPUT	512
+#define R_STREAM_OUTPUT_FAILED	1024
 
 /* vlakren->flag (vlak = face in dutch) char!!! */
 #define R_SMOOTH		1
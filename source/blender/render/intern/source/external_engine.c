@@ -586,6 +586,9 @@ int RE_engine_render(Render *re, int do_all)
 
 		if ((type->flag & RE_USE_SAVE_BUFFERS) && (re->r.scemode & R_EXR_TILE_FILE))
 			savebuffers = RR_USE_EXR;
+		/* output is written from the tile files, see render_stream_output_begin */
+		if ((type->flag & RE_USE_SAVE_BUFFERS) && (re->flag & R_STREAM_OUTPUT))
+			savebuffers = RR_USE_EXR;
 		re->result = render_result_new(re, &re->disprect, 0, savebuffers, RR_ALL_LAYERS);
 	}
 	BLI_rw_mutex_unlock(&re->resultmutex);
@@ -658,7 +661,12 @@ int RE_engine_render(Render *re, int do_all)
 
 	if (re->result->do_exr_tile) {
 		BLI_rw_mutex_lock(&re->resultmutex, THREAD_LOCK_WRITE);
-		render_result_exr_file_end(re);
+		if (re->flag & R_STREAM_OUTPUT) {
+			if (!render_result_exr_file_stream_end(re, re->stream_filepath, re->r.im_format.exr_codec))
+				re->flag |= R_STREAM_OUTPUT_FAILED;
+		}
+		else
+			render_result_exr_file_end(re);
 		BLI_rw_mutex_unlock(&re->resultmutex);
 	}
 
@@ -2800,6 +2800,43 @@ void RE_SetReports(Render *re, ReportList *reports)
 	re->reports = reports;
 }
 
+/* Background renders to multilayer files can be written from the save buffers
+ * tile files when the engine is done, so the full result never needs to be in
+ * memory. Anything that needs the pixels after the engine rules this out. */
+static void render_stream_output_begin(Render *re, Main *bmain, Scene *scene, const char *name_override)
+{
+	RenderEngineType *type = RE_engines_find(re->r.engine);
+
+	re->flag &= ~(R_STREAM_OUTPUT | R_STREAM_OUTPUT_FAILED);
+
+	if (!G.background || !RE_engine_is_external(re) || !(type->flag & RE_USE_SAVE_BUFFERS))
+		return;
+	if (re->r.im_format.imtype != R_IMF_IMTYPE_MULTILAYER)
+		return;
+	if (re->r.scemode & (R_FULL_SAMPLE | R_SINGLE_LAYER | R_EXR_CACHE_FILE))
+		return;
+	if ((re->r.mode & R_BORDER) && !(re->r.mode & R_CROP))
+		return;
+	if ((re->r.stamp & R_STAMP_ALL) && (re->r.stamp & R_STAMP_DRAW))
+		return;
+	if ((re->r.scemode & R_DOCOMP) && scene->use_nodes && scene->nodetree)
+		return;
+	if (RE_seq_render_active(scene, &re->r))
+		return;
+#ifdef WITH_FREESTYLE
+	if (re->r.mode & R_EDGE_FRS)
+		return;
+#endif
+
+	if (name_override)
+		BLI_strncpy(re->stream_filepath, name_override, sizeof(re->stream_filepath));
+	else
+		BKE_makepicstring(re->stream_filepath, scene->r.pic, bmain->name, scene->r.cfra,
+		                  &scene->r.im_format, (scene->r.scemode & R_EXTENSION) != 0, true);
+
+	re->flag |= R_STREAM_OUTPUT;
+}
+
 /* general Blender frame render call */
 void RE_BlenderFrame(Render *re, Main *bmain, Scene *scene, SceneRenderLayer *srl, Object *camera_override,
                      unsigned int lay_override, int frame, const bool write_still)
@@ -2816,6 +2853,14 @@ void RE_BlenderFrame(Render *re, Main *bmain, Scene *scene, SceneRenderLayer *sr
 
 		BLI_callback_exec(re->main, (ID *)scene, BLI_CB_EVT_RENDER_PRE);
 
+		if (write_still && !BKE_imtype_is_movie(scene->r.im_format.imtype)) {
+			char name[FILE_MAX];
+			BKE_makepicstring(name, scene->r.pic, bmain->name, scene->r.cfra,
+			                  &scene->r.im_format, (scene->r.scemode & R_EXTENSION) != 0, false);
+
+			render_stream_output_begin(re, bmain, scene, name);
+		}
+
 		do_render_all_options(re);
 
 		if (write_still && !G.is_break) {
@@ -2833,6 +2878,8 @@ void RE_BlenderFrame(Render *re, Main *bmain, Scene *scene, SceneRenderLayer *sr
 			}
 		}
 
+		re->flag &= ~(R_STREAM_OUTPUT | R_STREAM_OUTPUT_FAILED);
+
 		BLI_callback_exec(re->main, (ID *)scene, BLI_CB_EVT_RENDER_POST); /* keep after file save */
 		if (write_still) {
 			BLI_callback_exec(re->main, (ID *)scene, BLI_CB_EVT_RENDER_WRITE);
@@ -2915,8 +2962,19 @@ static int do_write_image_or_movie(Render *re, Main *bmain, Scene *scene, bMovie
 			                  &scene->r.im_format, (scene->r.scemode & R_EXTENSION) != 0, true);
 		
 		if (re->r.im_format.imtype == R_IMF_IMTYPE_MULTILAYER) {
-			if (re->result) {
-				RE_WriteRenderResult(re->reports, re->result, name, scene->r.im_format.exr_codec);
+			if (re->flag & R_STREAM_OUTPUT) {
+				/* already written from the tile files by the render engine,
+				 * which reported the error if that failed */
+				ok = (re->flag & R_STREAM_OUTPUT_FAILED) == 0;
+			}
+			else if (re->result) {
+				ok = RE_WriteRenderResult(re->reports, re->result, name, scene->r.im_format.exr_codec);
+			}
+
+			if (ok == 0) {
+				printf("Render error: cannot save %s\n", name);
+			}
+			else if ((re->flag & R_STREAM_OUTPUT) || re->result) {
 				printf("Saved: %s", name);
 			}
 		}
@@ -3092,6 +3150,8 @@ void RE_BlenderAnim(Render *re, Main *bmain, Scene *scene, Object *camera_overri
 			/* run callbacs before rendering, before the scene is updated */
 			BLI_callback_exec(re->main, (ID *)scene, BLI_CB_EVT_RENDER_PRE);
 
+			if (BKE_imtype_is_movie(scene->r.im_format.imtype) == 0)
+				render_stream_output_begin(re, bmain, scene, NULL);
 			
 			do_render_all_options(re);
 			totrendered++;
@@ -3103,6 +3163,8 @@ void RE_BlenderAnim(Render *re, Main *bmain, Scene *scene, Object *camera_overri
 			}
 			else
 				G.is_break = true;
+
+			re->flag &= ~(R_STREAM_OUTPUT | R_STREAM_OUTPUT_FAILED);
 		
 			if (G.is_break == true) {
 				/* remove touched file */
@@ -37,8 +37,10 @@
 
 #include "BKE_appdir.h"
 #include "BLI_utildefines.h"
+#include "BLI_fileops.h"
 #include "BLI_listbase.h"
 #include "BLI_hash_md5.h"
+#include "BLI_math_base.h"
 #include "BLI_path_util.h"
 #include "BLI_rect.h"
 #include "BLI_string.h"
@@ -1052,6 +1054,133 @@ void render_result_exr_file_end(Render *re)
 	render_result_exr_file_read_sample(re, 0);
 }
 
+/* point the channels of a layer to band buffers that start at row y */
+static void render_result_stream_channels(void *exrhandle, RenderLayer *rl, int rectx, int y, bool add)
+{
+	RenderPass *rpass;
+	int a;
+
+	for (a = 0; a < 4; a++) {
+		float *rect = rl->rectf + 4 * rectx * y + a;
+
+		if (add)
+			IMB_exr_add_channel(exrhandle, rl->name, get_pass_name(SCE_PASS_COMBINED, a), 4, 4 * rectx, rect);
+		else
+			IMB_exr_set_channel(exrhandle, rl->name, get_pass_name(SCE_PASS_COMBINED, a), 4, 4 * rectx, rect);
+	}
+
+	for (rpass = rl->passes.first; rpass; rpass = rpass->next) {
+		int xstride = rpass->channels;
+
+		for (a = 0; a < xstride; a++) {
+			float *rect = rpass->rect + xstride * rectx * y + a;
+
+			if (add)
+				IMB_exr_add_channel(exrhandle, rl->name, get_pass_name(rpass->passtype, a), xstride, xstride * rectx, rect);
+			else
+				IMB_exr_set_channel(exrhandle, rl->name, get_pass_name(rpass->passtype, a), xstride, xstride * rectx, rect);
+		}
+	}
+}
+
+/* end write of exr tile file, and copy the tile files into the multilayer file
+ * at filepath. this goes a band of scanlines at a time, so unlike
+ * render_result_exr_file_end the full result is never read back into memory */
+bool render_result_exr_file_stream_end(Render *re, const char *filepath, int compress)
+{
+	RenderResult *rr = re->result;
+	RenderLayer *rl;
+	RenderPass *rpass;
+	void *exrhandle;
+	char str[FILE_MAX];
+	const int rows = max_ii(re->party, 1);
+	const size_t band_size = (size_t)rr->rectx * rows;
+	bool success = true;
+	int y;
+
+	save_empty_result_tiles(re);
+
+	for (rl = rr->layers.first; rl; rl = rl->next) {
+		IMB_exr_close(rl->exrhandle);
+		rl->exrhandle = NULL;
+	}
+	rr->do_exr_tile = false;
+
+	if (re->test_break(re->tbh))
+		return true;
+
+	/* open tile files, the layer and pass rects are used for the bands */
+	for (rl = rr->layers.first; rl; rl = rl->next) {
+		int rectx, recty;
+
+		render_result_exr_file_path(re->scene, rl->name, rr->sample_nr, str);
+		rl->exrhandle = IMB_exr_get_handle();
+
+		if (IMB_exr_begin_read(rl->exrhandle, str, &rectx, &recty) == 0 || rectx != rr->rectx || recty != rr->recty) {
+			printf("cannot read: %s\n", str);
+			success = false;
+		}
+
+		rl->rectf = MEM_mapallocN(sizeof(float) * 4 * band_size, "stream band combined");
+		for (rpass = rl->passes.first; rpass; rpass = rpass->next)
+			rpass->rect = MEM_mapallocN(sizeof(float) * rpass->channels * band_size, "stream band pass");
+	}
+
+	exrhandle = IMB_exr_get_handle();
+
+	for (rl = rr->layers.first; rl; rl = rl->next)
+		render_result_stream_channels(exrhandle, rl, rr->rectx, 0, true);
+
+	if (success) {
+		BLI_make_existing_file(filepath);
+		printf("write exr file from tmp files, %dx%d, %s\n", rr->rectx, rr->recty, filepath);
+
+		success = IMB_exr_begin_write(exrhandle, filepath, rr->rectx, rr->recty, compress) != 0;
+	}
+
+	/* scanline files are written from the top row down */
+	for (y = rr->recty; success && y > 0; y -= rows) {
+		int ymin = max_ii(y - rows, 0);
+
+		for (rl = rr->layers.first; rl; rl = rl->next) {
+			/* rects point to row 0, which may lie before the band */
+			render_result_stream_channels(rl->exrhandle, rl, rr->rectx, -ymin, false);
+			render_result_stream_channels(exrhandle, rl, rr->rectx, -ymin, false);
+
+			IMB_exr_read_scanlines(rl->exrhandle, ymin, y - 1);
+		}
+
+		IMB_exr_write_scanlines(exrhandle, y - ymin);
+	}
+
+	IMB_exr_close(exrhandle);
+
+	for (rl = rr->layers.first; rl; rl = rl->next) {
+		IMB_exr_close(rl->exrhandle);
+		rl->exrhandle = NULL;
+
+		MEM_freeN(rl->rectf);
+		rl->rectf = NULL;
+		for (rpass = rl->passes.first; rpass; rpass = rpass->next) {
+			MEM_freeN(rpass->rect);
+			rpass->rect = NULL;
+		}
+
+		/* the tile files can be as large as the output, don't keep them around,
+		 * unless writing failed and they are the only copy of the render */
+		render_result_exr_file_path(re->scene, rl->name, rr->sample_nr, str);
+		if (success)
+			BLI_delete(str, false, false);
+		else
+			printf("render result kept in tile file: %s\n", str);
+	}
+
+	if (!success)
+		BKE_reportf(re->reports, RPT_ERROR, "Error writing render result to %s (see console)", filepath);
+
+	return success;
+}
+
 /* save part into exr file */
 void render_result_exr_file_merge(RenderResult *rr, RenderResult *rrpart)
 {
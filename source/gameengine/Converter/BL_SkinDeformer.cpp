@@ -37,11 +37,15 @@
 #include <Eigen/Core>
 #include <Eigen/LU>
 
+#include <algorithm>
+
 #include "BL_SkinDeformer.h"
 #include "CTR_Map.h"
 #include "STR_HashedString.h"
 #include "RAS_IPolygonMaterial.h"
 #include "RAS_MeshObject.h"
+#include "KX_KetsjiEngine.h"
+#include "KX_PythonInit.h"
 
 //#include "BL_ArmatureController.h"
 #include "DNA_armature_types.h"
@@ -57,6 +61,7 @@
 extern "C"{
 	#include "BKE_lattice.h"
 	#include "BKE_deform.h"
+	#include "BLI_task.h"
 }
  
 
@@ -172,6 +177,10 @@ void BL_SkinDeformer::ProcessReplica()
 	m_lastArmaUpdate = -1;
 	m_releaseobject = false;
 	m_dfnrToPC = NULL;
+	m_skinOffsets.clear();
+	m_skinGroups.clear();
+	m_skinWeights.clear();
+	m_skinNormalGroup.clear();
 }
 
 void BL_SkinDeformer::BlenderDeformVerts()
@@ -195,13 +204,148 @@ void BL_SkinDeformer::BlenderDeformVerts()
 #endif
 }
 
+/* flatten the deform weights of the mesh, only depends on the mesh and the bones */
+void BL_SkinDeformer::BuildSkinWeights(int defbase_tot)
+{
+	MDeformVert *dv = m_bmesh->dvert;
+	MDeformWeight *dw;
+
+	m_skinOffsets.resize(m_bmesh->totvert + 1);
+	m_skinNormalGroup.resize(m_bmesh->totvert);
+	m_skinGroups.clear();
+	m_skinWeights.clear();
+
+	for (int i=0; i<m_bmesh->totvert; ++i, dv++)
+	{
+		const int first = m_skinGroups.size();
+		float contrib = 0.f, max_weight = -1.f;
+
+		m_skinOffsets[i] = first;
+		m_skinNormalGroup[i] = -1;
+
+		dw = dv->dw;
+		for (unsigned int j= dv->totweight; j != 0; j--, dw++)
+		{
+			const int index = dw->def_nr;
+
+			if (index < defbase_tot && m_dfnrToPC[index] && dw->weight)
+			{
+				m_skinGroups.push_back(index);
+				m_skinWeights.push_back(dw->weight);
+
+				// Save the most influential channel so we can use it to update the vertex normal
+				if (dw->weight > max_weight)
+				{
+					max_weight = dw->weight;
+					m_skinNormalGroup[i] = index;
+				}
+
+				contrib += dw->weight;
+			}
+		}
+
+		for (int j=first; j<(int)m_skinWeights.size(); ++j)
+			m_skinWeights[j] /= contrib;
+	}
+	m_skinOffsets[m_bmesh->totvert] = m_skinGroups.size();
+}
+
+void BL_SkinDeformer::SkinVerts(int start, int end)
+{
+	for (int i=start; i<end; ++i)
+	{
+		const int first = m_skinOffsets[i], last = m_skinOffsets[i + 1];
+
+		/* vertices without deforming bones keep their position */
+		if (first == last)
+			continue;
+
+		Eigen::Map<Eigen::Vector3f> norm = Eigen::Vector3f::Map(m_transnors[i]);
+		Eigen::Vector4f co(m_transverts[i][0],
+		                   m_transverts[i][1],
+		                   m_transverts[i][2],
+		                   1.f);
+		Eigen::Vector4f vec(0, 0, 0, 0);
+
+		// Update Vertex Position
+		for (int j=first; j<last; ++j)
+			vec.noalias() += m_skinWeights[j] * (Eigen::Matrix4f::Map(&m_skinMatrices[16 * m_skinGroups[j]]) * co);
+
+		// Update Vertex Normal
+		norm = Eigen::Matrix4f::Map(&m_skinNormalMatrices[16 * m_skinNormalGroup[i]]).topLeftCorner<3, 3>() * norm;
+
+		m_transverts[i][0] = vec[0];
+		m_transverts[i][1] = vec[1];
+		m_transverts[i][2] = vec[2];
+	}
+}
+
+void BL_SkinDeformer::CopyTransverts(RAS_TexVert *vertex, int start, int end)
+{
+	// copy the deformed data to the display array
+	for (int i=start; i<end; i++) {
+		RAS_TexVert& v = vertex[i];
+		v.SetXYZ(m_transverts[v.getOrigIndex()]);
+		if (m_copyNormals)
+			v.SetNormal(m_transnors[v.getOrigIndex()]);
+	}
+}
+
+/* Large meshes are skinned in ranges of this many vertices on the engine task
+ * scheduler, on top of the deformers of different armatures that are already
+ * updated in parallel by KX_Scene::UpdateAnimations(). */
+#define SKIN_TASK_SIZE 4096
+
+struct SkinTask {
+	BL_SkinDeformer *deformer;
+	RAS_TexVert *vertex;
+	int start, end;
+};
+
+static void skin_verts_task(TaskPool *UNUSED(pool), void *taskdata, int UNUSED(threadid))
+{
+	SkinTask *task = (SkinTask*)taskdata;
+	task->deformer->SkinVerts(task->start, task->end);
+}
+
+static void copy_transverts_task(TaskPool *UNUSED(pool), void *taskdata, int UNUSED(threadid))
+{
+	SkinTask *task = (SkinTask*)taskdata;
+	task->deformer->CopyTransverts(task->vertex, task->start, task->end);
+}
+
+static TaskScheduler *skin_task_scheduler()
+{
+	KX_KetsjiEngine *engine = KX_GetActiveEngine();
+	return (engine) ? engine->GetTaskScheduler() : NULL;
+}
+
+static void skin_run_tasks(std::vector<SkinTask> &tasks, TaskRunFunction run)
+{
+	TaskScheduler *scheduler = skin_task_scheduler();
+
+	if (tasks.size() < 2 || !scheduler || BLI_task_scheduler_num_threads(scheduler) < 2) {
+		for (size_t i=0; i<tasks.size(); ++i)
+			run(NULL, &tasks[i], 0);
+		return;
+	}
+
+	TaskPool *pool = BLI_task_pool_create(scheduler, NULL);
+
+	for (size_t i=0; i<tasks.size(); ++i)
+		BLI_task_pool_push(pool, run, &tasks[i], false, TASK_PRIORITY_HIGH);
+
+	BLI_task_pool_work_and_wait(pool);
+	BLI_task_pool_free(pool);
+}
+
 void BL_SkinDeformer::BGEDeformVerts()
 {
 	Object *par_arma = m_armobj->GetArmatureObject();
 	MDeformVert *dverts = m_bmesh->dvert;
 	bDeformGroup *dg;
 	int defbase_tot;
-	Eigen::Matrix4f pre_mat, post_mat, chan_mat, norm_chan_mat;
+	Eigen::Matrix4f pre_mat, post_mat;
 
 	if (!dverts)
 		return;
@@ -221,71 +365,37 @@ void BL_SkinDeformer::BGEDeformVerts()
 			if (m_dfnrToPC[i] && m_dfnrToPC[i]->bone->flag & BONE_NO_DEFORM)
 				m_dfnrToPC[i] = NULL;
 		}
+
+		BuildSkinWeights(defbase_tot);
 	}
 
 	post_mat = Eigen::Matrix4f::Map((float*)m_obmat).inverse() * Eigen::Matrix4f::Map((float*)m_armobj->GetArmatureObject()->obmat);
 	pre_mat = post_mat.inverse();
 
-	MDeformVert *dv= dverts;
-	MDeformWeight *dw;
+	/* the blended position is sum(weight * post_mat * chan_mat * pre_mat * co),
+	 * so the bone matrices are brought into mesh space once per pose */
+	m_skinMatrices.resize(16 * defbase_tot);
+	m_skinNormalMatrices.resize(16 * defbase_tot);
 
-	for (int i=0; i<m_bmesh->totvert; ++i, dv++)
+	for (int i=0; i<defbase_tot; ++i)
 	{
-		float contrib = 0.f, weight, max_weight=-1.f;
-		bPoseChannel *pchan=NULL;
-		Eigen::Map<Eigen::Vector3f> norm = Eigen::Vector3f::Map(m_transnors[i]);
-		Eigen::Vector4f vec(0, 0, 0, 1);
-		Eigen::Vector4f co(m_transverts[i][0],
-							m_transverts[i][1],
-							m_transverts[i][2],
-							1.f);
-
-		if (!dv->totweight)
+		if (!m_dfnrToPC[i])
 			continue;
 
-		co = pre_mat * co;
-
-		dw= dv->dw;
-
-		for (unsigned int j= dv->totweight; j != 0; j--, dw++)
-		{
-			const int index = dw->def_nr;
-
-			if (index < defbase_tot && (pchan=m_dfnrToPC[index]))
-			{
-				weight = dw->weight;
-
-				if (weight)
-				{
-					chan_mat = Eigen::Matrix4f::Map((float*)pchan->chan_mat);
-
-					// Update Vertex Position
-					vec.noalias() += (chan_mat*co - co)*weight;
-
-					// Save the most influential channel so we can use it to update the vertex normal
-					if (weight > max_weight)
-					{
-						max_weight = weight;
-						norm_chan_mat = chan_mat;
-					}
+		Eigen::Matrix4f::Map(&m_skinNormalMatrices[16 * i]) = Eigen::Matrix4f::Map((float*)m_dfnrToPC[i]->chan_mat);
+		Eigen::Matrix4f::Map(&m_skinMatrices[16 * i]) = post_mat * Eigen::Matrix4f::Map((float*)m_dfnrToPC[i]->chan_mat) * pre_mat;
+	}
 
-					contrib += weight;
-				}
-			}
-		}
-		
-		// Update Vertex Normal
-		norm = norm_chan_mat.topLeftCorner<3, 3>()*norm;
+	std::vector<SkinTask> tasks;
 
-		co.noalias() += vec/contrib;
-		co[3] = 1.f; // Make sure we have a 1 for the w component!
+	for (int start=0; start<m_bmesh->totvert; start += SKIN_TASK_SIZE)
+	{
+		SkinTask task = {this, NULL, start, std::min(start + SKIN_TASK_SIZE, m_bmesh->totvert)};
+		tasks.push_back(task);
+	}
 
-		co = post_mat * co;
+	skin_run_tasks(tasks, skin_verts_task);
 
-		m_transverts[i][0] = co[0];
-		m_transverts[i][1] = co[1];
-		m_transverts[i][2] = co[2];
-	}
 	m_copyNormals = true;
 }
 
@@ -294,9 +404,11 @@ void BL_SkinDeformer::UpdateTransverts()
 	RAS_MeshSlot::iterator it;
 	RAS_MeshMaterial *mmat;
 	RAS_MeshSlot *slot;
-	size_t i, nmat, imat;
+	size_t nmat, imat;
 
 	if (m_transverts) {
+		std::vector<SkinTask> tasks;
+
 		// the vertex cache is unique to this deformer, no need to update it
 		// if it wasn't updated! We must update all the materials at once
 		// because we will not get here again for the other material
@@ -308,19 +420,17 @@ void BL_SkinDeformer::UpdateTransverts()
 
 			slot = *mmat->m_slots[(void*)m_gameobj];
 
-			// for each array
+			// for each array, split in ranges that can be copied in parallel
 			for (slot->begin(it); !slot->end(it); slot->next(it)) {
-				// for each vertex
-				// copy the untransformed data from the original mvert
-				for (i=it.startvertex; i<it.endvertex; i++) {
-					RAS_TexVert& v = it.vertex[i];
-					v.SetXYZ(m_transverts[v.getOrigIndex()]);
-					if (m_copyNormals)
-						v.SetNormal(m_transnors[v.getOrigIndex()]);
+				for (int start=it.startvertex; start<(int)it.endvertex; start += SKIN_TASK_SIZE) {
+					SkinTask task = {this, it.vertex, start, std::min(start + SKIN_TASK_SIZE, (int)it.endvertex)};
+					tasks.push_back(task);
 				}
 			}
 		}
 
+		skin_run_tasks(tasks, copy_transverts_task);
+
 		if (m_copyNormals)
 			m_copyNormals = false;
 	}
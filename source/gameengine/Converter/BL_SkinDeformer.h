@@ -36,6 +36,8 @@
 #  pragma warning (disable:4786)  /* get rid of stupid stl-visual compiler debug warning */
 #endif  /* WIN32 */
 
+#include <vector>
+
 #include "CTR_HashedPtr.h"
 #include "BL_MeshDeformer.h"
 #include "BL_ArmatureObject.h"
@@ -98,6 +100,10 @@ public:
 		return false;
 	}
 
+	/* used by the skinning tasks of BGEDeformVerts() and UpdateTransverts() */
+	void SkinVerts(int start, int end);
+	void CopyTransverts(class RAS_TexVert *vertex, int start, int end);
+
 protected:
 	BL_ArmatureObject*		m_armobj;	//	Our parent object
 	float					m_time;
@@ -111,8 +117,22 @@ protected:
 	struct bPoseChannel**	m_dfnrToPC;
 	short					m_deformflags;
 
+	/* Influences of vertex i are stored at m_skinOffsets[i] to m_skinOffsets[i + 1]
+	 * in m_skinGroups and m_skinWeights, the weights are normalized. They are built
+	 * with m_dfnrToPC since they only include deforming bones. m_skinNormalGroup is
+	 * the most influential group of each vertex, used to rotate the normal. */
+	std::vector<int>		m_skinOffsets;
+	std::vector<int>		m_skinGroups;
+	std::vector<float>		m_skinWeights;
+	std::vector<int>		m_skinNormalGroup;
+	/* 4x4 matrices per deform group, updated once per pose: the bone matrix in
+	 * mesh space and the channel matrix for the normals */
+	std::vector<float>		m_skinMatrices;
+	std::vector<float>		m_skinNormalMatrices;
+
 	void BlenderDeformVerts();
 	void BGEDeformVerts();
+	void BuildSkinWeights(int defbase_tot);
 
 	void UpdateTransverts();
 
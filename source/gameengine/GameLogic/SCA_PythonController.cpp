@@ -48,9 +48,12 @@
 
 #include <algorithm>
 
+#include "PIL_time.h"
+
 
 // initialize static member variables
 SCA_PythonController* SCA_PythonController::m_sCurrentController = NULL;
+double SCA_PythonController::m_sPythonTime = 0.0;
 
 
 SCA_PythonController::SCA_PythonController(SCA_IObject* gameobj, int mode)
@@ -420,7 +423,9 @@ void SCA_PythonController::Trigger(SCA_LogicManager* logicmgr)
 
 			excdict= PyDict_Copy(m_pythondictionary);
 
+			double starttime = PIL_check_seconds_timer();
 			resultobj = PyEval_EvalCode((PyObject *)m_bytecode, excdict, excdict);
+			m_sPythonTime += PIL_check_seconds_timer() - starttime;
 
 			/* PyRun_SimpleString(m_scriptText.Ptr()); */
 			break;
@@ -440,7 +445,9 @@ void SCA_PythonController::Trigger(SCA_LogicManager* logicmgr)
 				PyTuple_SET_ITEM(args, 0, GetProxy());
 			}
 
+			double starttime = PIL_check_seconds_timer();
 			resultobj = PyObject_CallObject(m_function, args);
+			m_sPythonTime += PIL_check_seconds_timer() - starttime;
 			Py_XDECREF(args);
 			break;
 		}
@@ -71,6 +71,7 @@ class SCA_PythonController : public SCA_IController
 	};
 
 	static SCA_PythonController* m_sCurrentController; // protected !!!
+	static double m_sPythonTime; // time spent running controllers, reset by the engine profile
 
 	//for debugging
 	//virtual	CValue*		AddRef();
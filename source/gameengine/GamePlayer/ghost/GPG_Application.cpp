@@ -568,6 +568,13 @@ bool GPG_Application::initEngine(GHOST_IWindow* window, const int stereoMode)
 		bool useLists = (SYS_GetCommandLineInt(syshandle, "displaylists", gm->flag & GAME_DISPLAY_LISTS) != 0) && GPU_display_list_support();
 		bool nodepwarnings = (SYS_GetCommandLineInt(syshandle, "ignore_deprecation_warnings", 1) != 0);
 		bool restrictAnimFPS = gm->flag & GAME_RESTRICT_ANIM_UPDATES;
+		bool useRender = (SYS_GetCommandLineInt(syshandle, "norender", 0) == 0);
+		int benchmarkFrames = SYS_GetCommandLineInt(syshandle, "benchmark_frames", 0);
+		const char *benchmarkFile = SYS_GetCommandLineString(syshandle, "benchmark_file", "");
+
+		// benchmarks run every frame with a fixed time step, as fast as possible
+		if (benchmarkFrames > 0)
+			fixed_framerate = true;
 
 		if (GLEW_ARB_multitexture && GLEW_VERSION_1_1)
 			m_blendermat = (SYS_GetCommandLineInt(syshandle, "blender_material", 1) != 0);
@@ -582,7 +589,9 @@ bool GPG_Application::initEngine(GHOST_IWindow* window, const int stereoMode)
 		if (!m_canvas)
 			return false;
 
-		if (gm->vsync == VSYNC_ADAPTIVE)
+		if (benchmarkFrames > 0)
+			m_canvas->SetSwapInterval(0);
+		else if (gm->vsync == VSYNC_ADAPTIVE)
 			m_canvas->SetSwapInterval(-1);
 		else
 			m_canvas->SetSwapInterval((gm->vsync == VSYNC_ON) ? 1 : 0);
@@ -644,6 +653,8 @@ bool GPG_Application::initEngine(GHOST_IWindow* window, const int stereoMode)
 #endif
 
 		m_ketsjiengine->SetUseFixedTime(fixed_framerate);
+		m_ketsjiengine->SetUseRender(useRender);
+		m_ketsjiengine->SetBenchmark(benchmarkFrames, benchmarkFile);
 		m_ketsjiengine->SetTimingDisplay(frameRate, profile, properties);
 		m_ketsjiengine->SetRestrictAnimationFPS(restrictAnimFPS);
 
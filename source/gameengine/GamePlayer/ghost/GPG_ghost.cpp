@@ -214,7 +214,7 @@ static void usage(const char* program, bool isBlenderPlayer)
 	printf("\n");
 	printf("usage:   %s [--options] %s\n\n", program, example_filename);
 	printf("Available options are: [-w [w h l t]] [-f [fw fh fb ff]] %s[-g gamengineoptions] ", consoleoption);
-	printf("[-s stereomode] [-m aasamples]\n");
+	printf("[-s stereomode] [-m aasamples] [-b frames [file]]\n");
 	printf("Optional parameters must be passed in order.\n");
 	printf("Default values are set in the blend file.\n\n");
 	printf("  -h: Prints this command summary\n\n");
@@ -257,6 +257,12 @@ static void usage(const char* program, bool isBlenderPlayer)
 	printf("             sphericalpanoramic     (Spherical Panoramic)\n");
 	printf("       Example: -D  or  -D mode cubemap\n\n");
 	printf("  -m: maximum anti-aliasing (eg. 2,4,8,16)\n\n");
+	printf("  -b: run a benchmark with a fixed time step and quit\n");
+	printf("       frames = number of frames to run\n");
+	printf("       --Optional parameters--\n");
+	printf("       file   = file to write the profile timings of each frame to,\n");
+	printf("                as JSON when it ends with .json, CSV otherwise\n");
+	printf("       Example: -b 1000  or  -b 1000 timings.csv  or  -b 500 timings.json -g norender\n\n");
 	printf("  -i: parent window's ID\n\n");
 #ifdef _WIN32
 	printf("  -c: keep console window open\n\n");
@@ -270,6 +276,7 @@ static void usage(const char* program, bool isBlenderPlayer)
 	printf("       show_framerate                 0         Show the frame rate\n");
 	printf("       show_properties                0         Show debug properties\n");
 	printf("       show_profile                   0         Show profiling information\n");
+	printf("       norender                       0         Only update the game, don't render frames\n");
 	printf("       blender_material               0         Enable material settings\n");
 	printf("       ignore_deprecation_warnings    1         Ignore deprecation warnings\n");
 	printf("\n");
@@ -575,7 +582,14 @@ int main(int argc, char** argv)
 					}
 					else
 					{
-//						SYS_WriteCommandLineInt(syshandle, argv[i++], 1);
+						// Flag without value, e.g. "-g norender"
+						SYS_WriteCommandLineInt(syshandle, paramname, 1);
+						SYS_WriteCommandLineFloat(syshandle, paramname, 1.0f);
+						SYS_WriteCommandLineString(syshandle, paramname, "1");
+#if defined(DEBUG)
+						printf("%s = '1'\n", paramname);
+#endif
+						i++;
 					}
 				}
 				break;
@@ -676,6 +690,22 @@ int main(int argc, char** argv)
 				}
 				break;
 			}
+			case 'b': //benchmark
+			{
+				i++;
+				if ((i + 1) <= validArguments && argv[i][0] != '-')
+				{
+					SYS_WriteCommandLineInt(syshandle, "benchmark_frames", atoi(argv[i++]));
+					if ((i + 1) <= validArguments && argv[i][0] != '-')
+						SYS_WriteCommandLineString(syshandle, "benchmark_file", argv[i++]);
+				}
+				else
+				{
+					error = true;
+					printf("error: No number of frames supplied for -b\n");
+				}
+				break;
+			}
 			case 'c': //keep console (windows only)
 			{
 				i++;
@@ -38,6 +38,7 @@
 #include <stdio.h>
 
 #include "BLI_task.h"
+#include "BLI_path_util.h"
 
 #include "KX_KetsjiEngine.h"
 
@@ -55,6 +56,7 @@
 #include "MT_Vector3.h"
 #include "MT_Transform.h"
 #include "SCA_IInputDevice.h"
+#include "SCA_PythonController.h"
 #include "KX_Camera.h"
 #include "KX_Dome.h"
 #include "KX_Light.h"
@@ -95,9 +97,11 @@
 const char KX_KetsjiEngine::m_profileLabels[tc_numCategories][15] = {
 	"Physics:",		// tc_physics
 	"Logic:",		// tc_logic
+	"Python:",		// tc_python
 	"Animations:",	// tc_animations
 	"Network:",		// tc_network
 	"Scenegraph:",	// tc_scenegraph
+	"Occlusion:",	// tc_occlusion
 	"Rasterizer:",	// tc_rasterizer
 	"Services:",	// tc_services
 	"Overhead:",	// tc_overhead
@@ -160,6 +164,9 @@ KX_KetsjiEngine::KX_KetsjiEngine(KX_ISystem* system)
 	// Set up timing info display variables
 	m_show_framerate(false),
 	m_show_profile(false),
+	m_culledObjects(0),
+	m_useRender(true),
+	m_benchmarkFrames(0),
 	m_showProperties(false),
 	m_showBackground(false),
 	m_show_debug_properties(false),
@@ -514,6 +521,25 @@ void KX_KetsjiEngine::EndFrame()
 		RenderDebugProperties();
 	}
 
+	NextProfileMeasurement();
+
+	m_logger->StartLog(tc_rasterizer, m_kxsystem->GetTimeInSeconds(), true);
+	m_rasterizer->EndFrame();
+	// swap backbuffer (drawing into this buffer) <-> front/visible buffer
+	m_logger->StartLog(tc_latency, m_kxsystem->GetTimeInSeconds(), true);
+	m_rasterizer->SwapBuffers();
+	m_logger->StartLog(tc_rasterizer, m_kxsystem->GetTimeInSeconds(), true);
+	
+	m_canvas->EndDraw();
+}
+
+void KX_KetsjiEngine::NextProfileMeasurement()
+{
+	// python controllers run during the logic, show their time separately
+	m_logger->AddTime(tc_logic, -SCA_PythonController::m_sPythonTime);
+	m_logger->AddTime(tc_python, SCA_PythonController::m_sPythonTime);
+	SCA_PythonController::m_sPythonTime = 0.0;
+
 	double tottime = m_logger->GetAverage();
 	if (tottime < 1e-6)
 		tottime = 1e-6;
@@ -535,14 +561,8 @@ void KX_KetsjiEngine::EndFrame()
 	// Go to next profiling measurement, time spend after this call is shown in the next frame.
 	m_logger->NextMeasurement(m_kxsystem->GetTimeInSeconds());
 
-	m_logger->StartLog(tc_rasterizer, m_kxsystem->GetTimeInSeconds(), true);
-	m_rasterizer->EndFrame();
-	// swap backbuffer (drawing into this buffer) <-> front/visible buffer
-	m_logger->StartLog(tc_latency, m_kxsystem->GetTimeInSeconds(), true);
-	m_rasterizer->SwapBuffers();
-	m_logger->StartLog(tc_rasterizer, m_kxsystem->GetTimeInSeconds(), true);
-	
-	m_canvas->EndDraw();
+	if (m_benchmarkFrames)
+		RecordBenchmarkFrame();
 }
 
 //#include "PIL_time.h"
@@ -798,6 +818,20 @@ bool KX_KetsjiEngine::NextFrame()
 
 void KX_KetsjiEngine::Render()
 {
+	if (!m_useRender) {
+		// animations are updated while rendering, the rest is skipped
+		KX_SceneList::iterator sceneit;
+		for (sceneit = m_scenes.begin(); sceneit != m_scenes.end(); sceneit++) {
+			m_logger->StartLog(tc_animations, m_kxsystem->GetTimeInSeconds(), true);
+			(*sceneit)->UpdateAnimations(GetFrameTime());
+		}
+
+		m_logger->StartLog(tc_overhead, m_kxsystem->GetTimeInSeconds(), true);
+		NextProfileMeasurement();
+		m_logger->StartLog(tc_outside, m_kxsystem->GetTimeInSeconds(), true);
+		return;
+	}
+
 	if (m_usedome) {
 		RenderDome();
 		return;
@@ -807,6 +841,7 @@ void KX_KetsjiEngine::Render()
 
 	m_logger->StartLog(tc_rasterizer, m_kxsystem->GetTimeInSeconds(), true);
 	SG_SetActiveStage(SG_STAGE_RENDER);
+	m_culledObjects = 0;
 
 	// hiding mouse cursor each frame
 	// (came back when going out of focus and then back in again)
@@ -1157,6 +1192,8 @@ void KX_KetsjiEngine::RenderShadowBuffers(KX_Scene *scene)
 			/* update scene */
 			m_logger->StartLog(tc_scenegraph, m_kxsystem->GetTimeInSeconds(), true);
 			scene->CalculateVisibleMeshes(m_rasterizer, cam, raslight->GetShadowLayer());
+			m_logger->AddTime(tc_scenegraph, -scene->GetOcclusionTime());
+			m_logger->AddTime(tc_occlusion, scene->GetOcclusionTime());
 
 			m_logger->StartLog(tc_animations, m_kxsystem->GetTimeInSeconds(), true);
 			scene->UpdateAnimations(GetFrameTime());
@@ -1294,6 +1331,9 @@ void KX_KetsjiEngine::RenderFrame(KX_Scene* scene, KX_Camera* cam)
 	SG_SetActiveStage(SG_STAGE_CULLING);
 
 	scene->CalculateVisibleMeshes(m_rasterizer,cam);
+	m_logger->AddTime(tc_scenegraph, -scene->GetOcclusionTime());
+	m_logger->AddTime(tc_occlusion, scene->GetOcclusionTime());
+	m_culledObjects += scene->GetCulledObjects();
 
 	m_logger->StartLog(tc_animations, m_kxsystem->GetTimeInSeconds(), true);
 	SG_SetActiveStage(SG_STAGE_ANIMATION_UPDATE);
@@ -1353,6 +1393,11 @@ void KX_KetsjiEngine::StopEngine()
 
 		// cleanup all the stuff
 		m_rasterizer->Exit();
+
+		if (m_benchmarkFrames) {
+			WriteBenchmark();
+			m_benchmarkTimes.clear();
+		}
 	}
 }
 
@@ -1500,6 +1545,21 @@ void KX_KetsjiEngine::RenderDebugProperties()
 			m_rasterizer->RenderBox2D(xcoord + (int)(2.2 * profile_indent), ycoord, m_canvas->GetWidth(), m_canvas->GetHeight(), time/tottime);
 			ycoord += const_ysize;
 		}
+
+		m_rasterizer->RenderText2D(RAS_IRasterizer::RAS_TEXT_PADDED,
+		                            "Culled:",
+		                            xcoord + const_xindent,
+		                            ycoord,
+		                            m_canvas->GetWidth(),
+		                            m_canvas->GetHeight());
+
+		debugtxt.Format("%d objects", m_culledObjects);
+		m_rasterizer->RenderText2D(RAS_IRasterizer::RAS_TEXT_PADDED,
+		                            debugtxt.ReadPtr(),
+		                            xcoord + const_xindent + profile_indent, ycoord,
+		                            m_canvas->GetWidth(),
+		                            m_canvas->GetHeight());
+		ycoord += const_ysize;
 	}
 	// Add the ymargin for titles below the other section of debug info
 	ycoord += title_y_top_margin;
@@ -1828,6 +1888,101 @@ bool KX_KetsjiEngine::GetUseFixedTime(void) const
 	return m_bFixedTime;
 }
 
+void KX_KetsjiEngine::SetUseRender(bool useRender)
+{
+	m_useRender = useRender;
+}
+
+bool KX_KetsjiEngine::GetUseRender(void) const
+{
+	return m_useRender;
+}
+
+void KX_KetsjiEngine::SetBenchmark(int numFrames, const STR_String& filepath)
+{
+	m_benchmarkFrames = (numFrames > 0) ? numFrames : 0;
+	m_benchmarkFile = filepath;
+	m_benchmarkTimes.clear();
+}
+
+void KX_KetsjiEngine::RecordBenchmarkFrame()
+{
+	for (int i = tc_first; i < tc_numCategories; i++)
+		m_benchmarkTimes.push_back(m_logger->GetLastMeasurement((KX_TimeCategory)i));
+	m_benchmarkTimes.push_back(m_logger->GetLastMeasurement());
+
+	if ((int)m_benchmarkTimes.size() >= m_benchmarkFrames * (tc_numCategories + 1))
+		RequestExit(KX_EXIT_REQUEST_QUIT_GAME);
+}
+
+/* column name of a profile category, the label in lower case without colon */
+static STR_String benchmark_column_name(const char *label)
+{
+	STR_String name;
+	for (const char *c = label; *c && *c != ':'; c++)
+		name += (*c == ' ') ? '_' : *c;
+	return name.Lower();
+}
+
+void KX_KetsjiEngine::WriteBenchmark()
+{
+	const int numColumns = tc_numCategories + 1;
+	const int numFrames = m_benchmarkTimes.size() / numColumns;
+	STR_String columns[tc_numCategories + 1];
+	double total = 0.0;
+
+	if (numFrames == 0)
+		return;
+
+	for (int i = tc_first; i < tc_numCategories; i++)
+		columns[i] = benchmark_column_name(m_profileLabels[i]);
+	columns[tc_numCategories] = "total";
+
+	for (int frame = 0; frame < numFrames; frame++)
+		total += m_benchmarkTimes[frame * numColumns + tc_numCategories];
+
+	printf("Benchmark: %d frames, %.3f ms per frame on average\n", numFrames, total / numFrames * 1000.0);
+
+	if (m_benchmarkFile.IsEmpty())
+		return;
+
+	FILE *fp = fopen(m_benchmarkFile.ReadPtr(), "w");
+	if (!fp) {
+		printf("Benchmark: could not write %s\n", m_benchmarkFile.ReadPtr());
+		return;
+	}
+
+	// times are written in milliseconds
+	if (BLI_testextensie(m_benchmarkFile.ReadPtr(), ".json")) {
+		fprintf(fp, "{\n\t\"columns\": [");
+		for (int i = 0; i < numColumns; i++)
+			fprintf(fp, "%s\"%s\"", (i) ? ", " : "", columns[i].ReadPtr());
+		fprintf(fp, "],\n\t\"frames\": [\n");
+		for (int frame = 0; frame < numFrames; frame++) {
+			fprintf(fp, "\t\t[");
+			for (int i = 0; i < numColumns; i++)
+				fprintf(fp, "%s%.4f", (i) ? ", " : "", m_benchmarkTimes[frame * numColumns + i] * 1000.0);
+			fprintf(fp, "]%s\n", (frame + 1 < numFrames) ? "," : "");
+		}
+		fprintf(fp, "\t]\n}\n");
+	}
+	else {
+		fprintf(fp, "frame");
+		for (int i = 0; i < numColumns; i++)
+			fprintf(fp, ",%s", columns[i].ReadPtr());
+		fprintf(fp, "\n");
+		for (int frame = 0; frame < numFrames; frame++) {
+			fprintf(fp, "%d", frame);
+			for (int i = 0; i < numColumns; i++)
+				fprintf(fp, ",%.4f", m_benchmarkTimes[frame * numColumns + i] * 1000.0);
+			fprintf(fp, "\n");
+		}
+	}
+
+	fclose(fp);
+	printf("Benchmark: timings written to %s\n", m_benchmarkFile.ReadPtr());
+}
+
 double KX_KetsjiEngine::GetSuspendedDelta()
 {
 	return m_suspendeddelta;
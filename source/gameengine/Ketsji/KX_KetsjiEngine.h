@@ -148,9 +148,11 @@ private:
 		tc_first = 0,
 		tc_physics = 0,
 		tc_logic,
+		tc_python,		// time spent in python controllers, part of the logic
 		tc_animations,
 		tc_network,
 		tc_scenegraph,
+		tc_occlusion,	// time spent rasterizing the occlusion buffer
 		tc_rasterizer,
 		tc_services,	// time spent in miscelaneous activities
 		tc_overhead,	// profile info drawing overhead
@@ -170,6 +172,16 @@ private:
 	bool					m_show_framerate;
 	/** Show profiling info on the game display? */
 	bool					m_show_profile;
+	/** Number of objects culled in the last frame, shown with the profile */
+	int						m_culledObjects;
+	/** Render frames or only update the game, see SetUseRender() */
+	bool					m_useRender;
+	/** Number of frames to run for a benchmark, 0 when not benchmarking */
+	int						m_benchmarkFrames;
+	/** File the benchmark timings are written to, see WriteBenchmark() */
+	STR_String				m_benchmarkFile;
+	/** Time of each category and the total per benchmark frame, in seconds */
+	std::vector<double>		m_benchmarkTimes;
 	/** Show any debug (scene) object properties on the game display? */
 	bool					m_showProperties;
 	/** Show background behind text for readability? */
@@ -205,6 +217,9 @@ private:
 	void					RenderDebugProperties();
 	void					RenderShadowBuffers(KX_Scene *scene);
 	void					SetBackGround(KX_WorldInfo* worldinfo);
+	void					NextProfileMeasurement();
+	void					RecordBenchmarkFrame();
+	void					WriteBenchmark();
 
 public:
 	KX_KetsjiEngine(class KX_ISystem* system);
@@ -286,6 +301,26 @@ public:
 	 */ 
 	bool GetUseFixedTime(void) const;
 
+	/**
+	 * Sets whether frames are rendered. Without rendering only the game logic,
+	 * physics, scenegraph and animations are updated, used for benchmarks.
+	 */
+	void SetUseRender(bool useRender);
+
+	/**
+	 * Returns whether frames are rendered.
+	 */
+	bool GetUseRender(void) const;
+
+	/**
+	 * Runs a benchmark: the engine exits after numFrames frames and the time of
+	 * each profile category per frame is written to filepath when the engine
+	 * stops, as JSON when the name ends with .json and as CSV otherwise.
+	 * \param numFrames	Number of frames to run, 0 disables the benchmark.
+	 * \param filepath	File to write, or an empty string to only print a summary.
+	 */
+	void SetBenchmark(int numFrames, const STR_String& filepath);
+
 	/**
 	 * Returns current render frame clock time
 	 */
@@ -81,6 +81,12 @@ public :
 	~KX_NormalParentRelation(
 	);
 
+		bool
+	IsThreadSafe(
+	) {
+		return true;
+	}
+
 private :
 
 	KX_NormalParentRelation(
@@ -136,6 +142,12 @@ public :
 		return true;
 	}
 
+		bool
+	IsThreadSafe(
+	) {
+		return true;
+	}
+
 private :
 
 	KX_VertexParentRelation(
@@ -163,6 +163,8 @@ KX_Scene::KX_Scene(class SCA_IInputDevice* keyboarddevice,
 
 	m_dbvt_culling = false;
 	m_dbvt_occlusion_res = 0;
+	m_occlusion_time = 0.0;
+	m_culled_objects = 0;
 	m_activity_culling = false;
 	m_suspend = false;
 	m_isclearingZbuffer = true;
@@ -1500,6 +1502,7 @@ void KX_Scene::PhysicsCullingCallback(KX_ClientObjectInfo *objectInfo, void* cul
 void KX_Scene::CalculateVisibleMeshes(RAS_IRasterizer* rasty,KX_Camera* cam, int layer)
 {
 	bool dbvt_culling = false;
+	m_occlusion_time = 0.0;
 	if (m_dbvt_culling) 
 	{
 		// test culling through Bullet
@@ -1523,6 +1526,8 @@ void KX_Scene::CalculateVisibleMeshes(RAS_IRasterizer* rasty,KX_Camera* cam, int
 		dbvt_culling = m_physicsEnvironment->CullingTest(PhysicsCullingCallback,&info,planes,5,m_dbvt_occlusion_res,
 		                                                 KX_GetActiveEngine()->GetCanvas()->GetViewPort(),
 		                                                 mvmat, pmat);
+		if (dbvt_culling)
+			m_occlusion_time = m_physicsEnvironment->GetOcclusionTime();
 	}
 	if (!dbvt_culling) {
 		// the physics engine couldn't help us, do it the hard way
@@ -1534,6 +1539,14 @@ void KX_Scene::CalculateVisibleMeshes(RAS_IRasterizer* rasty,KX_Camera* cam, int
 
 	// Now that we know visible meshes, update LoDs
 	UpdateObjectLods();
+
+	// count the culled objects for the profile
+	m_culled_objects = 0;
+	for (int i = 0; i < m_objectlist->GetCount(); i++) {
+		KX_GameObject *gameobj = static_cast<KX_GameObject*>(m_objectlist->GetValue(i));
+		if (gameobj->GetMeshCount() > 0 && gameobj->GetCulled())
+			m_culled_objects++;
+	}
 }
 
 // logic stuff
@@ -1700,6 +1713,46 @@ void KX_Scene::LogicEndFrame()
 
 
 
+/* The scenegraph is updated one depth level at a time: the nodes of a level
+ * only read the world transform of their parent in the level above, so nodes
+ * with a thread safe parent relation and no controllers are updated in
+ * parallel, in ranges of this many nodes. */
+#define SG_UPDATE_TASK_SIZE 64
+
+struct SG_UpdateEntry
+{
+	SG_Node *node;
+	bool parentUpdated;
+	bool updated;
+};
+
+struct SG_UpdateTask
+{
+	SG_UpdateEntry *entries;
+	int count;
+	double curtime;
+};
+
+static bool update_parents_in_thread(SG_Node *node)
+{
+	return (node->GetSGControllerList().empty() && node->GetParentRelation()->IsThreadSafe());
+}
+
+static void update_parents_entry(SG_UpdateEntry &entry, double curtime)
+{
+	entry.updated = entry.node->UpdateNodeWorldData(curtime, entry.parentUpdated);
+}
+
+static void update_parents_thread_func(TaskPool *UNUSED(pool), void *taskdata, int UNUSED(threadid))
+{
+	SG_UpdateTask *task = (SG_UpdateTask*)taskdata;
+
+	for (int i = 0; i < task->count; i++) {
+		if (update_parents_in_thread(task->entries[i].node))
+			update_parents_entry(task->entries[i], task->curtime);
+	}
+}
+
 /**
  * UpdateParents: SceneGraph transformation update.
  */
@@ -1707,17 +1760,81 @@ void KX_Scene::UpdateParents(double curtime)
 {
 	// we use the SG dynamic list
 	SG_Node* node;
+	std::vector<SG_UpdateEntry> level, nextlevel;
+	std::vector<SG_UpdateTask> tasks;
+	TaskScheduler *scheduler = KX_GetActiveEngine()->GetTaskScheduler();
 
-	while ((node = SG_Node::GetNextScheduled(m_sghead)) != NULL)
+	// updating nodes can schedule other nodes, loop until the list is empty
+	while (!m_sghead.Empty())
 	{
-		node->UpdateWorldData(curtime);
-	}
+		// the first level holds the scheduled nodes without scheduled ancestor,
+		// the other scheduled nodes are reached from them
+		SG_DList::iterator<SG_Node> it(m_sghead);
+		for (it.begin(); !it.end(); ++it)
+		{
+			node = *it;
+			SG_Node *parent = node->GetSGParent();
+			while (parent && parent->Empty())
+				parent = parent->GetSGParent();
+
+			if (!parent) {
+				SG_UpdateEntry entry = {node, false, false};
+				level.push_back(entry);
+			}
+		}
+
+		while (!level.empty())
+		{
+			int numthreaded = 0;
+
+			// nodes that can't be updated in threads are updated on the main thread first
+			for (size_t i = 0; i < level.size(); i++) {
+				if (update_parents_in_thread(level[i].node))
+					numthreaded++;
+				else
+					update_parents_entry(level[i], curtime);
+			}
+
+			if (numthreaded >= 2 * SG_UPDATE_TASK_SIZE && BLI_task_scheduler_num_threads(scheduler) > 1) {
+				TaskPool *pool = BLI_task_pool_create(scheduler, NULL);
+
+				tasks.clear();
+				for (size_t i = 0; i < level.size(); i += SG_UPDATE_TASK_SIZE) {
+					int count = level.size() - i;
+					SG_UpdateTask task = {&level[i], (count < SG_UPDATE_TASK_SIZE) ? count : SG_UPDATE_TASK_SIZE, curtime};
+					tasks.push_back(task);
+				}
+				for (size_t i = 0; i < tasks.size(); i++)
+					BLI_task_pool_push(pool, update_parents_thread_func, &tasks[i], false, TASK_PRIORITY_HIGH);
 
-	//for (int i=0; i<GetRootParentList()->GetCount(); i++)
-	//{
-	//	KX_GameObject* parentobj = (KX_GameObject*)GetRootParentList()->GetValue(i);
-	//	parentobj->NodeUpdateGS(curtime);
-	//}
+				BLI_task_pool_work_and_wait(pool);
+				BLI_task_pool_free(pool);
+			}
+			else if (numthreaded) {
+				SG_UpdateTask task = {&level[0], (int)level.size(), curtime};
+				update_parents_thread_func(NULL, &task, 0);
+			}
+
+			// notify the clients and gather the next level, children of nodes that
+			// were not updated only need an update when they are scheduled themselves
+			nextlevel.clear();
+			for (size_t i = 0; i < level.size(); i++) {
+				SG_UpdateEntry &entry = level[i];
+
+				entry.node->EndNodeWorldData(entry.updated);
+
+				if (!entry.updated && !entry.parentUpdated)
+					continue;
+
+				NodeList &children = entry.node->GetSGChildren();
+				for (NodeList::iterator cit = children.begin(); cit != children.end(); ++cit) {
+					SG_UpdateEntry child = {*cit, entry.parentUpdated, false};
+					nextlevel.push_back(child);
+				}
+			}
+			level.swap(nextlevel);
+		}
+	}
 
 	// the list must be empty here
 	assert(m_sghead.Empty());
@@ -266,6 +266,13 @@ protected:
 	 */ 
 	int m_dbvt_occlusion_res;
 
+	/**
+	 * Time spent rasterizing the occlusion buffer and number of culled
+	 * objects in the last call to CalculateVisibleMeshes
+	 */
+	double m_occlusion_time;
+	int m_culled_objects;
+
 	/**
 	 * The framing settings used by this scene
 	 */
@@ -565,6 +572,8 @@ public:
 	bool GetDbvtCulling() { return m_dbvt_culling; }
 	void SetDbvtOcclusionRes(int i) { m_dbvt_occlusion_res = i; }
 	int GetDbvtOcclusionRes() { return m_dbvt_occlusion_res; }
+	double GetOcclusionTime() { return m_occlusion_time; }
+	int GetCulledObjects() { return m_culled_objects; }
 	
 	void SetSceneConverter(class KX_BlenderSceneConverter* sceneConverter);
 
@@ -102,6 +102,13 @@ void KX_TimeCategoryLogger::EndLog(double now)
 }
 
 
+void KX_TimeCategoryLogger::AddTime(TimeCategory tc, double time)
+{
+	//assert(m_loggers[tc] != m_loggers.end());
+	m_loggers[tc]->AddTime(time);
+}
+
+
 void KX_TimeCategoryLogger::NextMeasurement(double now)
 {
 	KX_TimeLoggerMap::iterator it;
@@ -131,6 +138,26 @@ double KX_TimeCategoryLogger::GetAverage(void)
 }
 
 
+double KX_TimeCategoryLogger::GetLastMeasurement(TimeCategory tc)
+{
+	//assert(m_loggers[tc] != m_loggers.end());
+	return m_loggers[tc]->GetLastMeasurement();
+}
+
+
+double KX_TimeCategoryLogger::GetLastMeasurement(void)
+{
+	double time = 0.0;
+
+	KX_TimeLoggerMap::iterator it;
+	for (it = m_loggers.begin(); it != m_loggers.end(); it++) {
+		time += it->second->GetLastMeasurement();
+	}
+
+	return time;
+}
+
+
 void KX_TimeCategoryLogger::DisposeLoggers(void)
 {
 	KX_TimeLoggerMap::iterator it;
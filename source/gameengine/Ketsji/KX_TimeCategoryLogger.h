@@ -98,6 +98,14 @@ public:
 	 */
 	virtual void EndLog(double now);
 
+	/**
+	 * Adds time to the current measurement of the given category, negative
+	 * values remove time. Used to move time measured elsewhere between categories.
+	 * \param tc	The category to add the time to.
+	 * \param time	The time to add.
+	 */
+	virtual void AddTime(TimeCategory tc, double time);
+
 	/**
 	 * Logs time in next measurement.
 	 * \param now	The current time.
@@ -115,6 +123,16 @@ public:
 	 */
 	virtual double GetAverage(void);
 
+	/**
+	 * Returns the last complete measurement of the given category.
+	 */
+	virtual double GetLastMeasurement(TimeCategory tc);
+
+	/**
+	 * Returns the last complete measurement for grand total.
+	 */
+	virtual double GetLastMeasurement(void);
+
 protected:
 	/**  
 	 * Disposes loggers.
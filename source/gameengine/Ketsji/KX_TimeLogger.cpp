@@ -81,6 +81,14 @@ void KX_TimeLogger::EndLog(double now)
 }
 
 
+void KX_TimeLogger::AddTime(double time)
+{
+	if (m_measurements.size() > 0) {
+		m_measurements[0] += time;
+	}
+}
+
+
 void KX_TimeLogger::NextMeasurement(double now)
 {
 	// End logging to current measurement
@@ -115,3 +123,13 @@ double KX_TimeLogger::GetAverage(void) const
 	return avg;
 }
 
+
+double KX_TimeLogger::GetLastMeasurement(void) const
+{
+	if (m_measurements.size() > 1) {
+		return m_measurements[1];
+	}
+
+	return 0.0;
+}
+
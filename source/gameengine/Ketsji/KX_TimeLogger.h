@@ -80,6 +80,12 @@ public:
 	 */
 	virtual void EndLog(double now);
 
+	/**
+	 * Adds time to the current measurement, negative values remove time.
+	 * \param time	The time to add.
+	 */
+	virtual void AddTime(double time);
+
 	/**
 	 * Logs time in next measurement.
 	 * \param now	The current time.
@@ -92,6 +98,12 @@ public:
 	 */
 	virtual double GetAverage(void) const;
 
+	/**
+	 * Returns the last complete measurement, the one before the current.
+	 * \return The last complete measurement or 0 if there is none.
+	 */
+	virtual double GetLastMeasurement(void) const;
+
 protected:
 	/** Storage for the measurements. */
 	std::deque<double> m_measurements;
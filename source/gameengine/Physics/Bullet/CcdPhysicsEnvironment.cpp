@@ -24,6 +24,7 @@ subject to the following restrictions:
 #include "CcdGraphicController.h"
 
 #include <algorithm>
+#include <vector>
 #include "btBulletDynamicsCommon.h"
 #include "LinearMath/btIDebugDraw.h"
 #include "BulletCollision/CollisionDispatch/btGhostObject.h"
@@ -42,6 +43,7 @@ subject to the following restrictions:
 #include "PHY_Pro.h"
 #include "KX_GameObject.h"
 #include "KX_PythonInit.h" // for KX_RasterizerDrawDebugLine
+#include "KX_KetsjiEngine.h"
 #include "KX_BlenderSceneConverter.h"
 #include "RAS_MeshObject.h"
 #include "RAS_Polygon.h"
@@ -53,6 +55,8 @@ subject to the following restrictions:
 
 extern "C" {
 	#include "BLI_utildefines.h"
+	#include "BLI_task.h"
+	#include "PIL_time.h"
 	#include "BKE_object.h"
 }
 
@@ -399,6 +403,7 @@ static void DrawAabb(btIDebugDraw* debugDrawer,const btVector3& from,const btVec
 CcdPhysicsEnvironment::CcdPhysicsEnvironment(bool useDbvtCulling,btDispatcher* dispatcher,btOverlappingPairCache* pairCache)
 :m_cullingCache(NULL),
 m_cullingTree(NULL),
+m_occlusionTime(0.0),
 m_numIterations(10),
 m_numTimeSubSteps(1),
 m_ccdMode(0),
@@ -1356,17 +1361,56 @@ PHY_IPhysicsController* CcdPhysicsEnvironment::RayTest(PHY_IRayCastFilterCallbac
 
 // Handles occlusion culling. 
 // The implementation is based on the CDTestFramework
+//
+// The occluders in the view frustum are first collected and rasterized in
+// tiles of the buffer in parallel, then the culling tree is traversed and the
+// objects are tested against the complete buffer. The depth stored in the
+// buffer is 1/w, larger values are closer to the camera.
+
+// size of the tiles the occluders are binned into, in pixels
+#define OCCLUSION_TILE_SIZE 32
+// size of the blocks of the hierarchical depth buffer, in pixels
+#define OCCLUSION_BLOCK_SIZE 8
+
+#if defined(__SSE2__) && !defined(BT_USE_DOUBLE_PRECISION)
+#  define OCCLUSION_USE_SSE2
+#  include <emmintrin.h>
+#endif
+
 struct OcclusionBuffer
 {
 	struct WriteOCL
 	{
+		enum { Deferred = 1 };
 		static inline bool Process(btScalar& q,btScalar v) { if (q<v) q=v;return(false); }
 		static inline void Occlusion(bool& flag) { flag = true; }
+#ifdef OCCLUSION_USE_SSE2
+		static inline bool Process4(btScalar* q, __m128 v, __m128 mask)
+		{
+			__m128 o = _mm_loadu_ps(q);
+			_mm_storeu_ps(q, _mm_or_ps(_mm_and_ps(mask, _mm_max_ps(o, v)), _mm_andnot_ps(mask, o)));
+			return(false);
+		}
+#endif
 	};
 	struct QueryOCL
 	{
+		enum { Deferred = 0 };
 		static inline bool Process(btScalar& q,btScalar v) { return(q<=v); }
 		static inline void Occlusion(bool& flag) { }
+#ifdef OCCLUSION_USE_SSE2
+		static inline bool Process4(btScalar* q, __m128 v, __m128 mask)
+		{
+			return(_mm_movemask_ps(_mm_and_ps(mask, _mm_cmple_ps(_mm_loadu_ps(q), v))) != 0);
+		}
+#endif
+	};
+	// triangle in buffer coordinates, counter clockwise
+	struct Triangle
+	{
+		int			x[3];
+		int			y[3];
+		btScalar	z[3];
 	};
 	btScalar*						m_buffer;
 	size_t							m_bufferSize;
@@ -1377,6 +1421,11 @@ struct OcclusionBuffer
 	btScalar						m_offsets[2];
 	btScalar						m_wtc[16];		// world to clip transform
 	btScalar						m_mtc[16];		// model to clip transform
+	std::vector<Triangle>			m_triangles;	// occluder triangles waiting to be rasterized
+	std::vector<std::vector<int> >	m_bins;			// triangles overlapping each tile
+	int								m_tiles[2];
+	std::vector<btScalar>			m_blocks;		// minimum depth of each block of the buffer
+	int								m_blockSizes[2];
 	// constructor: size=largest dimension of the buffer. 
 	// Buffer size depends on aspect ratio
 	OcclusionBuffer()
@@ -1414,6 +1463,7 @@ struct OcclusionBuffer
 	{
 		m_initialized=false;
 		m_occlusion=false;
+		m_triangles.clear();
 		// compute the size of the buffer
 		int			maxsize;
 		double		ratio;
@@ -1448,23 +1498,23 @@ struct OcclusionBuffer
 		}
 		if (!m_buffer)
 		{
-			m_buffer = (btScalar*)calloc(1, newsize);
+			m_buffer = (btScalar*)malloc(newsize);
 			m_bufferSize = newsize;
-		} else
-		{
-			// buffer exists already, just clears it
-			memset(m_buffer, 0, newsize);
 		}
 		// memory allocate must succeed
 		assert(m_buffer != NULL);
+		// the buffer is cleared per tile while rasterizing
+		m_tiles[0] = (m_sizes[0]+OCCLUSION_TILE_SIZE-1)/OCCLUSION_TILE_SIZE;
+		m_tiles[1] = (m_sizes[1]+OCCLUSION_TILE_SIZE-1)/OCCLUSION_TILE_SIZE;
+		m_bins.resize(m_tiles[0]*m_tiles[1]);
+		m_blockSizes[0] = (m_sizes[0]+OCCLUSION_BLOCK_SIZE-1)/OCCLUSION_BLOCK_SIZE;
+		m_blockSizes[1] = (m_sizes[1]+OCCLUSION_BLOCK_SIZE-1)/OCCLUSION_BLOCK_SIZE;
+		m_blocks.resize(m_blockSizes[0]*m_blockSizes[1]);
 		m_initialized = true;
-		m_occlusion = false;
 	}
 	void		SetModelMatrix(double *fl)
 	{
 		CMmat4mul(m_mtc,m_wtc,fl);
-		if (!m_initialized)
-			initialize();
 	}
 
 	// transform a segment in world coordinate to clip coordinate
@@ -1565,6 +1615,7 @@ struct OcclusionBuffer
 		return(ni);
 	}
 	// write or check a triangle to buffer. a,b,c in device coordinates (-1,+1)
+	// triangles written to the buffer are only collected, they are rasterized by rasterizeTile()
 	template <typename POLICY>
 	inline bool	draw(	const btVector4& a,
 						const btVector4& b,
@@ -1578,11 +1629,11 @@ struct OcclusionBuffer
 		// further down we are normally going to write to the Zbuffer, mark it so
 		POLICY::Occlusion(m_occlusion);
 
-		int x[3], y[3], ib=1, ic=2;
-		btScalar z[3];
-		x[0]=(int)(a.x()*m_scales[0]+m_offsets[0]);
-		y[0]=(int)(a.y()*m_scales[1]+m_offsets[1]);
-		z[0]=a.z();
+		Triangle t;
+		int ib=1, ic=2;
+		t.x[0]=(int)(a.x()*m_scales[0]+m_offsets[0]);
+		t.y[0]=(int)(a.y()*m_scales[1]+m_offsets[1]);
+		t.z[0]=a.z();
 		if (a2 < 0.f)
 		{
 			// negative aire is possible with double face => must
@@ -1590,35 +1641,49 @@ struct OcclusionBuffer
 			ib=2;
 			ic=1;
 		}
-		x[ib]=(int)(b.x()*m_scales[0]+m_offsets[0]);
-		x[ic]=(int)(c.x()*m_scales[0]+m_offsets[0]);
-		y[ib]=(int)(b.y()*m_scales[1]+m_offsets[1]);
-		y[ic]=(int)(c.y()*m_scales[1]+m_offsets[1]);
-		z[ib]=b.z();
-		z[ic]=c.z();
+		t.x[ib]=(int)(b.x()*m_scales[0]+m_offsets[0]);
+		t.x[ic]=(int)(c.x()*m_scales[0]+m_offsets[0]);
+		t.y[ib]=(int)(b.y()*m_scales[1]+m_offsets[1]);
+		t.y[ic]=(int)(c.y()*m_scales[1]+m_offsets[1]);
+		t.z[ib]=b.z();
+		t.z[ic]=c.z();
+		if (POLICY::Deferred)
+		{
+			m_triangles.push_back(t);
+			return(false);
+		}
+		return(rasterize<POLICY>(t,0,0,m_sizes[0],m_sizes[1]));
+	}
+	// write or check the part of a triangle inside the rectangle (rx0,ry0)-(rx1,ry1) of the buffer
+	template <typename POLICY>
+	inline bool	rasterize(Triangle t, int rx0, int ry0, int rx1, int ry1)
+	{
+		int*			x=t.x;
+		int*			y=t.y;
+		btScalar*		z=t.z;
 		const int		mix=btMax(0,btMin(x[0],btMin(x[1],x[2])));
 		const int		mxx=btMin(m_sizes[0],1+btMax(x[0],btMax(x[1],x[2])));
 		const int		miy=btMax(0,btMin(y[0],btMin(y[1],y[2])));
 		const int		mxy=btMin(m_sizes[1],1+btMax(y[0],btMax(y[1],y[2])));
 		const int		width=mxx-mix;
 		const int		height=mxy-miy;
+		// part of the triangle inside the rectangle
+		const int		tix=btMax(mix,rx0);
+		const int		txx=btMin(mxx,rx1);
+		const int		tiy=btMax(miy,ry0);
+		const int		txy=btMin(mxy,ry1);
+		if (tix>=txx || tiy>=txy)
+			return(false);
 		if ((width*height) <= 1)
 		{
-			// degenerated in at most one single pixel
+			// degenerated in one single pixel
 			btScalar* scan=&m_buffer[miy*m_sizes[0]+mix];
-			// use for loop to detect the case where width or height == 0
-			for (int iy=miy;iy<mxy;++iy)
-			{
-				for (int ix=mix;ix<mxx;++ix)
-				{
-					if (POLICY::Process(*scan,z[0])) 
-						return(true);
-					if (POLICY::Process(*scan,z[1])) 
-						return(true);
-					if (POLICY::Process(*scan,z[2])) 
-						return(true);
-				}
-			}
+			if (POLICY::Process(*scan,z[0])) 
+				return(true);
+			if (POLICY::Process(*scan,z[1])) 
+				return(true);
+			if (POLICY::Process(*scan,z[2])) 
+				return(true);
 		}
 		else if (width == 1) {
 			// Degenerated in at least 2 vertical lines
@@ -1638,14 +1703,15 @@ struct OcclusionBuffer
 			dzy[0] = (dy[0]) ? (z[0] - z[1]) / dy[0] : btScalar(0.f);
 			dzy[1] = (dy[1]) ? (z[1] - z[2]) / dy[1] : btScalar(0.f);
 			dzy[2] = (dy[2]) ? (z[2] - z[0]) / dy[2] : btScalar(0.f);
-			btScalar v[3] = {dzy[0] * (miy - y[0]) + z[0],
-			                 dzy[1] * (miy - y[1]) + z[1],
-			                 dzy[2] * (miy - y[2]) + z[2]};
-			dy[0] = y[1]-y[0];
-			dy[1] = y[0]-y[1];
-			dy[2] = y[2]-y[0];
-			btScalar* scan=&m_buffer[miy*m_sizes[0]+mix];
-			for (int iy=miy;iy<mxy;++iy)
+			btScalar v[3] = {dzy[0] * (tiy - y[0]) + z[0],
+			                 dzy[1] * (tiy - y[1]) + z[1],
+			                 dzy[2] * (tiy - y[2]) + z[2]};
+			// distance to the end of the first and last edge, from the start of the second one
+			dy[0] = y[1]-tiy;
+			dy[1] = tiy-y[1];
+			dy[2] = y[2]-tiy;
+			btScalar* scan=&m_buffer[tiy*m_sizes[0]+mix];
+			for (int iy=tiy;iy<txy;++iy)
 			{
 				if (dy[0] >= 0 && POLICY::Process(*scan,v[0])) 
 					return(true);
@@ -1675,14 +1741,14 @@ struct OcclusionBuffer
 			dzx[0] = (dx[0]) ? (z[0]-z[1])/dx[0] : btScalar(0.f);
 			dzx[1] = (dx[1]) ? (z[1]-z[2])/dx[1] : btScalar(0.f);
 			dzx[2] = (dx[2]) ? (z[2]-z[0])/dx[2] : btScalar(0.f);
-			btScalar v[3] = {dzx[0] * (mix - x[0]) + z[0],
-			                 dzx[1] * (mix - x[1]) + z[1],
-			                 dzx[2] * (mix - x[2]) + z[2]};
-			dx[0] = x[1]-x[0];
-			dx[1] = x[0]-x[1];
-			dx[2] = x[2]-x[0];
-			btScalar* scan=&m_buffer[miy*m_sizes[0]+mix];
-			for (int ix=mix;ix<mxx;++ix)
+			btScalar v[3] = {dzx[0] * (tix - x[0]) + z[0],
+			                 dzx[1] * (tix - x[1]) + z[1],
+			                 dzx[2] * (tix - x[2]) + z[2]};
+			dx[0] = x[1]-tix;
+			dx[1] = tix-x[1];
+			dx[2] = x[2]-tix;
+			btScalar* scan=&m_buffer[miy*m_sizes[0]+tix];
+			for (int ix=tix;ix<txx;++ix)
 			{
 				if (dx[0] >= 0 && POLICY::Process(*scan,v[0])) 
 					return(true);
@@ -1696,25 +1762,63 @@ struct OcclusionBuffer
 			}
 		}
 		else {
-			// general case
+			// general case, the edge functions c are stepped by dx per pixel and dy per line
 			const int       dx[] = {y[0] - y[1],
 			                        y[1] - y[2],
 			                        y[2] - y[0]};
-			const int       dy[] = {x[1] - x[0] - dx[0] * width,
-			                        x[2] - x[1] - dx[1] * width,
-			                        x[0] - x[2] - dx[2] * width};
+			const int       dy[] = {x[1] - x[0],
+			                        x[2] - x[1],
+			                        x[0] - x[2]};
 			const int       a = x[2] * y[0] + x[0] * y[1] - x[2] * y[1] - x[0] * y[2] + x[1] * y[2] - x[1] * y[0];
+			// vertices on a line after rounding, the depth can't be interpolated
+			if (a == 0)
+				return(false);
 			const btScalar  ia = 1 / (btScalar)a;
 			const btScalar  dzx = ia*(y[2]*(z[1]-z[0])+y[1]*(z[0]-z[2])+y[0]*(z[2]-z[1]));
-			const btScalar  dzy = ia*(x[2]*(z[0]-z[1])+x[0]*(z[1]-z[2])+x[1]*(z[2]-z[0]))-(dzx*width);
-			int             c[] = {miy*x[1]+mix*y[0]-x[1]*y[0]-mix*y[1]+x[0]*y[1]-miy*x[0],
-			                        miy*x[2]+mix*y[1]-x[2]*y[1]-mix*y[2]+x[1]*y[2]-miy*x[1],
-			                        miy*x[0]+mix*y[2]-x[0]*y[2]-mix*y[0]+x[2]*y[0]-miy*x[2]};
-			btScalar        v = ia*((z[2]*c[0])+(z[0]*c[1])+(z[1]*c[2]));
-			btScalar       *scan = &m_buffer[miy*m_sizes[0]];
-			for (int iy=miy;iy<mxy;++iy)
+			const btScalar  dzy = ia*(x[2]*(z[0]-z[1])+x[0]*(z[1]-z[2])+x[1]*(z[2]-z[0]));
+			int             cy[] = {tiy*x[1]+tix*y[0]-x[1]*y[0]-tix*y[1]+x[0]*y[1]-tiy*x[0],
+			                        tiy*x[2]+tix*y[1]-x[2]*y[1]-tix*y[2]+x[1]*y[2]-tiy*x[1],
+			                        tiy*x[0]+tix*y[2]-x[0]*y[2]-tix*y[0]+x[2]*y[0]-tiy*x[2]};
+			btScalar        vy = ia*((z[2]*cy[0])+(z[0]*cy[1])+(z[1]*cy[2]));
+			btScalar       *scan = &m_buffer[tiy*m_sizes[0]];
+#ifdef OCCLUSION_USE_SSE2
+			// edge functions and depth of 4 pixels at once
+			const __m128i   dx4[] = {_mm_set1_epi32(4*dx[0]), _mm_set1_epi32(4*dx[1]), _mm_set1_epi32(4*dx[2])};
+			const __m128i   ox4[] = {_mm_set_epi32(3*dx[0], 2*dx[0], dx[0], 0),
+			                         _mm_set_epi32(3*dx[1], 2*dx[1], dx[1], 0),
+			                         _mm_set_epi32(3*dx[2], 2*dx[2], dx[2], 0)};
+			const __m128    dzx4 = _mm_set1_ps(4*dzx);
+			const __m128    oz4 = _mm_set_ps(3*dzx, 2*dzx, dzx, 0.f);
+			const __m128i   outside = _mm_set1_epi32(-1);
+#endif
+			for (int iy=tiy;iy<txy;++iy)
 			{
-				for (int ix=mix;ix<mxx;++ix)
+				int         c[] = {cy[0], cy[1], cy[2]};
+				btScalar    v = vy;
+				int         ix = tix;
+#ifdef OCCLUSION_USE_SSE2
+				if (txx-ix >= 4)
+				{
+					__m128i c0 = _mm_add_epi32(_mm_set1_epi32(c[0]), ox4[0]);
+					__m128i c1 = _mm_add_epi32(_mm_set1_epi32(c[1]), ox4[1]);
+					__m128i c2 = _mm_add_epi32(_mm_set1_epi32(c[2]), ox4[2]);
+					__m128  v4 = _mm_add_ps(_mm_set1_ps(v), oz4);
+					for (;ix+4<=txx;ix+=4)
+					{
+						// inside when no edge function is negative
+						const __m128 mask = _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_or_si128(_mm_or_si128(c0, c1), c2), outside));
+						if (_mm_movemask_ps(mask) && POLICY::Process4(&scan[ix], v4, mask))
+							return(true);
+						c0 = _mm_add_epi32(c0, dx4[0]);
+						c1 = _mm_add_epi32(c1, dx4[1]);
+						c2 = _mm_add_epi32(c2, dx4[2]);
+						v4 = _mm_add_ps(v4, dzx4);
+					}
+					const int n = ix-tix;
+					c[0]+=n*dx[0];c[1]+=n*dx[1];c[2]+=n*dx[2];v+=n*dzx;
+				}
+#endif
+				for (;ix<txx;++ix)
 				{
 					if ((c[0]>=0)&&(c[1]>=0)&&(c[2]>=0))
 					{
@@ -1723,12 +1827,67 @@ struct OcclusionBuffer
 					}
 					c[0]+=dx[0];c[1]+=dx[1];c[2]+=dx[2];v+=dzx;
 				}
-				c[0]+=dy[0];c[1]+=dy[1];c[2]+=dy[2];v+=dzy;
+				cy[0]+=dy[0];cy[1]+=dy[1];cy[2]+=dy[2];vy+=dzy;
 				scan+=m_sizes[0];
 			}
 		}
 		return(false);
 	}
+	// sort the collected triangles into the tiles they overlap, returns the number of tiles
+	int			binTriangles()
+	{
+		if (!m_initialized)
+			initialize();
+		for (size_t i=0;i<m_bins.size();++i)
+			m_bins[i].clear();
+		for (size_t i=0;i<m_triangles.size();++i)
+		{
+			const Triangle&	t=m_triangles[i];
+			const int		mix=btMax(0,btMin(t.x[0],btMin(t.x[1],t.x[2])));
+			const int		mxx=btMin(m_sizes[0],1+btMax(t.x[0],btMax(t.x[1],t.x[2])));
+			const int		miy=btMax(0,btMin(t.y[0],btMin(t.y[1],t.y[2])));
+			const int		mxy=btMin(m_sizes[1],1+btMax(t.y[0],btMax(t.y[1],t.y[2])));
+			if (mix>=mxx || miy>=mxy)
+				continue;
+			for (int ty=miy/OCCLUSION_TILE_SIZE;ty<=(mxy-1)/OCCLUSION_TILE_SIZE;++ty)
+			{
+				for (int tx=mix/OCCLUSION_TILE_SIZE;tx<=(mxx-1)/OCCLUSION_TILE_SIZE;++tx)
+				{
+					m_bins[ty*m_tiles[0]+tx].push_back((int)i);
+				}
+			}
+		}
+		return(m_tiles[0]*m_tiles[1]);
+	}
+	// clear a tile, rasterize its triangles and update the minimum depth of its blocks,
+	// tiles don't share any pixels so they can be rasterized in parallel
+	void		rasterizeTile(int tile)
+	{
+		const int	x0=(tile%m_tiles[0])*OCCLUSION_TILE_SIZE;
+		const int	y0=(tile/m_tiles[0])*OCCLUSION_TILE_SIZE;
+		const int	x1=btMin(x0+OCCLUSION_TILE_SIZE,m_sizes[0]);
+		const int	y1=btMin(y0+OCCLUSION_TILE_SIZE,m_sizes[1]);
+		for (int iy=y0;iy<y1;++iy)
+			memset(&m_buffer[iy*m_sizes[0]+x0], 0, (x1-x0)*sizeof(btScalar));
+		const std::vector<int>&	bin=m_bins[tile];
+		for (size_t i=0;i<bin.size();++i)
+			rasterize<WriteOCL>(m_triangles[bin[i]],x0,y0,x1,y1);
+		// the tile size is a multiple of the block size, blocks never cross tiles
+		for (int by=y0;by<y1;by+=OCCLUSION_BLOCK_SIZE)
+		{
+			for (int bx=x0;bx<x1;bx+=OCCLUSION_BLOCK_SIZE)
+			{
+				btScalar	zmin=BT_LARGE_FLOAT;
+				for (int iy=by;iy<btMin(by+OCCLUSION_BLOCK_SIZE,y1);++iy)
+				{
+					const btScalar* scan=&m_buffer[iy*m_sizes[0]];
+					for (int ix=bx;ix<btMin(bx+OCCLUSION_BLOCK_SIZE,x1);++ix)
+						zmin=btMin(zmin,scan[ix]);
+				}
+				m_blocks[(by/OCCLUSION_BLOCK_SIZE)*m_blockSizes[0]+bx/OCCLUSION_BLOCK_SIZE]=zmin;
+			}
+		}
+	}
 	// clip than write or check a polygon 
 	template <const int NP,typename POLICY>
 	inline bool	clipDraw(	const btVector4* p,
@@ -1798,6 +1957,8 @@ struct OcclusionBuffer
 			// the box is clipped, it's probably a large box, don't waste our time to check
 			if ((x[i][2]+x[i][3])<=0) return(true);
 		}
+		if (queryBlocks(x))
+			return false;
 		static const int d[] = {1,0,3,2,
 		                        4,5,6,7,
 		                        4,7,3,0,
@@ -1816,8 +1977,99 @@ struct OcclusionBuffer
 		}
 		return false;
 	}
+	// hierarchical test of a box given by its corners in clip coordinates, all in front of the near plane.
+	// returns true when all blocks under the screen rectangle of the box are closer than the closest corner
+	inline bool	queryBlocks(const btVector4* x)
+	{
+		int			mix=m_sizes[0], mxx=-1, miy=m_sizes[1], mxy=-1;
+		btScalar	zmax=0.f;
+		for (int i=0;i<8;++i)
+		{
+			const btScalar	iw=1/x[i][3];
+			const int		px=(int)(x[i][0]*iw*m_scales[0]+m_offsets[0]);
+			const int		py=(int)(x[i][1]*iw*m_scales[1]+m_offsets[1]);
+			mix=btMin(mix,px);
+			mxx=btMax(mxx,px);
+			miy=btMin(miy,py);
+			mxy=btMax(mxy,py);
+			zmax=btMax(zmax,iw);
+		}
+		mix=btMax(mix,0);
+		miy=btMax(miy,0);
+		mxx=btMin(mxx,m_sizes[0]-1);
+		mxy=btMin(mxy,m_sizes[1]-1);
+		if (mix>mxx || miy>mxy)
+			return false;
+		for (int by=miy/OCCLUSION_BLOCK_SIZE;by<=mxy/OCCLUSION_BLOCK_SIZE;++by)
+		{
+			const btScalar* blocks=&m_blocks[by*m_blockSizes[0]];
+			for (int bx=mix/OCCLUSION_BLOCK_SIZE;bx<=mxx/OCCLUSION_BLOCK_SIZE;++bx)
+			{
+				if (blocks[bx]<=zmax)
+					return false;
+			}
+		}
+		return true;
+	}
+	// add the meshes of an occluder object
+	void		appendOccluder(KX_GameObject* gameobj)
+	{
+		double* fl = gameobj->GetOpenGLMatrixPtr()->getPointer();
+		// compute the transformation from model local space to clip space
+		SetModelMatrix(fl);
+		float face = (gameobj->IsNegativeScaling()) ? -1.0f : 1.0f;
+		// walk through the meshes and for each add to buffer
+		for (int i=0; i<gameobj->GetMeshCount(); i++)
+		{
+			RAS_MeshObject* meshobj = gameobj->GetMesh(i);
+			const float *v1, *v2, *v3, *v4;
+
+			int polycount = meshobj->NumPolygons();
+			for (int j=0; j<polycount; j++)
+			{
+				RAS_Polygon* poly = meshobj->GetPolygon(j);
+				switch (poly->VertexCount())
+				{
+				case 3:
+					v1 = poly->GetVertex(0)->getXYZ();
+					v2 = poly->GetVertex(1)->getXYZ();
+					v3 = poly->GetVertex(2)->getXYZ();
+					appendOccluderM(v1,v2,v3,((poly->IsTwoside())?0.f:face));
+					break;
+				case 4:
+					v1 = poly->GetVertex(0)->getXYZ();
+					v2 = poly->GetVertex(1)->getXYZ();
+					v3 = poly->GetVertex(2)->getXYZ();
+					v4 = poly->GetVertex(3)->getXYZ();
+					appendOccluderM(v1,v2,v3,v4,((poly->IsTwoside())?0.f:face));
+					break;
+				}
+			}
+		}
+	}
 };
 
+static KX_GameObject *culling_node_object(const btDbvtNode* leaf)
+{
+	btBroadphaseProxy*	proxy=(btBroadphaseProxy*)leaf->data;
+	// the client object is a graphic controller
+	CcdGraphicController* ctrl = static_cast<CcdGraphicController*>(proxy->m_clientObject);
+	KX_ClientObjectInfo *info = (KX_ClientObjectInfo*)ctrl->GetNewClientInfo();
+	return KX_GameObject::GetClientObject(info);
+}
+
+// collects the occluders in the view frustum
+struct	DbvtOccluderCallback : btDbvt::ICollide
+{
+	std::vector<KX_GameObject*> m_occluders;
+
+	void Process(const btDbvtNode* leaf)
+	{
+		KX_GameObject* gameobj = culling_node_object(leaf);
+		if (gameobj && gameobj->GetOccluder())
+			m_occluders.push_back(gameobj);
+	}
+};
 
 struct	DbvtCullingCallback : btDbvt::ICollide
 {
@@ -1833,6 +2085,13 @@ struct	DbvtCullingCallback : btDbvt::ICollide
 	}
 	bool Descent(const btDbvtNode* node)
 	{
+		if (node->isleaf())
+		{
+			// occluders are in the buffer already, with depth imprecision they could hide themselves
+			KX_GameObject* gameobj = culling_node_object(node);
+			if (gameobj && gameobj->GetOccluder())
+				return true;
+		}
 		return(m_ocb->queryOccluderW(node->volume.Center(),node->volume.Extents()));
 	}
 	void Process(const btDbvtNode* node,btScalar depth)
@@ -1845,55 +2104,21 @@ struct	DbvtCullingCallback : btDbvt::ICollide
 		// the client object is a graphic controller
 		CcdGraphicController* ctrl = static_cast<CcdGraphicController*>(proxy->m_clientObject);
 		KX_ClientObjectInfo *info = (KX_ClientObjectInfo*)ctrl->GetNewClientInfo();
-		if (m_ocb)
-		{
-			// means we are doing occlusion culling. Check if this object is an occluders
-			KX_GameObject* gameobj = KX_GameObject::GetClientObject(info);
-			if (gameobj && gameobj->GetOccluder())
-			{
-				double* fl = gameobj->GetOpenGLMatrixPtr()->getPointer();
-				// this will create the occlusion buffer if not already done
-				// and compute the transformation from model local space to clip space
-				m_ocb->SetModelMatrix(fl);
-				float face = (gameobj->IsNegativeScaling()) ? -1.0f : 1.0f;
-				// walk through the meshes and for each add to buffer
-				for (int i=0; i<gameobj->GetMeshCount(); i++)
-				{
-					RAS_MeshObject* meshobj = gameobj->GetMesh(i);
-					const float *v1, *v2, *v3, *v4;
-
-					int polycount = meshobj->NumPolygons();
-					for (int j=0; j<polycount; j++)
-					{
-						RAS_Polygon* poly = meshobj->GetPolygon(j);
-						switch (poly->VertexCount())
-						{
-						case 3:
-							v1 = poly->GetVertex(0)->getXYZ();
-							v2 = poly->GetVertex(1)->getXYZ();
-							v3 = poly->GetVertex(2)->getXYZ();
-							m_ocb->appendOccluderM(v1,v2,v3,((poly->IsTwoside())?0.f:face));
-							break;
-						case 4:
-							v1 = poly->GetVertex(0)->getXYZ();
-							v2 = poly->GetVertex(1)->getXYZ();
-							v3 = poly->GetVertex(2)->getXYZ();
-							v4 = poly->GetVertex(3)->getXYZ();
-							m_ocb->appendOccluderM(v1,v2,v3,v4,((poly->IsTwoside())?0.f:face));
-							break;
-						}
-					}
-				}
-			}
-		}
 		if (info)
 			(*m_clientCallback)(info, m_userData);
 	}
 };
 
+static void occlusion_tile_task(TaskPool *pool, void *taskdata, int UNUSED(threadid))
+{
+	OcclusionBuffer *ocb = (OcclusionBuffer *)BLI_task_pool_userdata(pool);
+	ocb->rasterizeTile(GET_INT_FROM_POINTER(taskdata));
+}
+
 static OcclusionBuffer gOcb;
 bool CcdPhysicsEnvironment::CullingTest(PHY_CullingCallback callback, void* userData, MT_Vector4 *planes, int nplanes, int occlusionRes, const int *viewport, double modelview[16], double projection[16])
 {
+	m_occlusionTime = 0.0;
 	if (!m_cullingTree)
 		return false;
 	DbvtCullingCallback dispatcher(callback, userData);
@@ -1909,7 +2134,24 @@ bool CcdPhysicsEnvironment::CullingTest(PHY_CullingCallback callback, void* user
 	// if occlusionRes != 0 => occlusion culling
 	if (occlusionRes)
 	{
+		double starttime = PIL_check_seconds_timer();
 		gOcb.setup(occlusionRes, viewport, modelview, projection);
+		// first fill the buffer with all occluders in the view frustum
+		DbvtOccluderCallback occluders;
+		btDbvt::collideKDOP(m_cullingTree->m_sets[1].m_root,planes_n,planes_o,nplanes,occluders);
+		btDbvt::collideKDOP(m_cullingTree->m_sets[0].m_root,planes_n,planes_o,nplanes,occluders);
+		for (size_t i=0; i<occluders.m_occluders.size(); i++)
+			gOcb.appendOccluder(occluders.m_occluders[i]);
+		if (gOcb.m_occlusion)
+		{
+			int tiles = gOcb.binTriangles();
+			TaskPool *pool = BLI_task_pool_create(KX_GetActiveEngine()->GetTaskScheduler(), &gOcb);
+			for (int i=0; i<tiles; i++)
+				BLI_task_pool_push(pool, occlusion_tile_task, SET_INT_IN_POINTER(i), false, TASK_PRIORITY_HIGH);
+			BLI_task_pool_work_and_wait(pool);
+			BLI_task_pool_free(pool);
+		}
+		m_occlusionTime = PIL_check_seconds_timer() - starttime;
 		dispatcher.m_ocb = &gOcb;
 		// occlusion culling, the direction of the view is taken from the first plan which MUST be the near plane
 		btDbvt::collideOCL(m_cullingTree->m_sets[1].m_root,planes_n,planes_o,planes_n[0],nplanes,dispatcher);
@@ -71,6 +71,7 @@ protected:
 	// for culling only
 	btOverlappingPairCache*				m_cullingCache;
 	struct btDbvtBroadphase*			m_cullingTree;	// broadphase for culling
+	double								m_occlusionTime;	// time spent rasterizing occluders in the last culling test
 
 	//solver iterations
 	int	m_numIterations;
@@ -193,6 +194,7 @@ protected:
 
 		virtual PHY_IPhysicsController* RayTest(PHY_IRayCastFilterCallback &filterCallback, float fromX,float fromY,float fromZ, float toX,float toY,float toZ);
 		virtual bool CullingTest(PHY_CullingCallback callback, void* userData, MT_Vector4* planes, int nplanes, int occlusionRes, const int *viewport, double modelview[16], double projection[16]);
+		virtual double GetOcclusionTime() { return m_occlusionTime; }
 
 
 		//Methods for gamelogic collision/physics callbacks
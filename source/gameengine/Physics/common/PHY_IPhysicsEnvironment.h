@@ -183,6 +183,8 @@ class PHY_IPhysicsEnvironment
 		// the plane number must be set as follow: near, far, left, right, top, botton
 		// the near plane must be the first one and must always be present, it is used to get the direction of the view
 		virtual bool CullingTest(PHY_CullingCallback callback, void *userData, MT_Vector4* planeNormals, int planeNumber, int occlusionRes, const int *viewport, double modelview[16], double projection[16]) = 0;
+		// time spent rasterizing occluders in the last culling test, in seconds
+		virtual double GetOcclusionTime() { return 0.0; }
 
 		//Methods for gamelogic collision/physics callbacks
 		//todo:
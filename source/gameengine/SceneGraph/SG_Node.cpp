@@ -191,12 +191,7 @@ void SG_Node::UpdateWorldData(double time, bool parentUpdated)
 	//if (!GetSGParent())
 	//	return;
 
-	if (UpdateSpatialData(GetSGParent(),time,parentUpdated))
-		// to update the 
-		ActivateUpdateTransformCallback();
-
-	// The node is updated, remove it from the update list
-	Delink();
+	EndNodeWorldData(UpdateNodeWorldData(time, parentUpdated));
 
 	// update children's worlddata
 	for (NodeList::iterator it = m_children.begin();it!=m_children.end();++it)
@@ -207,6 +202,23 @@ void SG_Node::UpdateWorldData(double time, bool parentUpdated)
 
 
 
+bool SG_Node::UpdateNodeWorldData(double time, bool& parentUpdated)
+{
+	return UpdateSpatialData(GetSGParent(), time, parentUpdated);
+}
+
+void SG_Node::EndNodeWorldData(bool updated)
+{
+	if (updated)
+		// to update the 
+		ActivateUpdateTransformCallback();
+
+	// The node is updated, remove it from the update list
+	Delink();
+}
+
+
+
 void SG_Node::SetSimulatedTime(double time,bool recurse)
 {
 
@@ -193,6 +193,28 @@ public:
 		bool parentUpdated=false
 	);
 
+	/**
+	 * Update the spatial data of this node without its children,
+	 * for scenegraph updates that handle the children themselves.
+	 * \return true if the world transform of the node was updated.
+	 */
+
+		bool
+	UpdateNodeWorldData(
+		double time,
+		bool& parentUpdated
+	);
+
+	/**
+	 * Notify the client after UpdateNodeWorldData() and remove
+	 * the node from the update list.
+	 */
+
+		void
+	EndNodeWorldData(
+		bool updated
+	);
+
 	/**
 	 * Update the simulation time of this node. Iterate through
 	 * the children nodes and update their simulated time.
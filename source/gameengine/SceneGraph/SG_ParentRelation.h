@@ -110,6 +110,17 @@ public :
 	) { 
 		return false;
 	}
+
+	/**
+	 * Relations that only read the parent and child transforms can be
+	 * updated from worker threads, the others are updated on the main thread
+	 */
+	virtual
+		bool
+	IsThreadSafe(
+	) {
+		return false;
+	}
 protected :
 
 	/** 
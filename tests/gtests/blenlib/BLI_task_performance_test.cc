@@ -0,0 +1,83 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_task.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+#include "PIL_time.h"
+
+#include "atomic_ops.h"
+};
+
+/* Task throughput benchmark, runs many tiny tasks with 1 to N threads and
+ * prints tasks per second, to measure scheduler overhead and scaling. */
+
+#define NUM_TASKS 200000
+#define NUM_SUBTASKS 32
+
+static void task_tiny_run(TaskPool *pool, void *UNUSED(taskdata), int UNUSED(threadid))
+{
+	size_t *count = (size_t *)BLI_task_pool_userdata(pool);
+	atomic_add_z(count, 1);
+}
+
+static void task_spawn_run(TaskPool *pool, void *UNUSED(taskdata), int UNUSED(threadid))
+{
+	int i;
+
+	for (i = 0; i < NUM_SUBTASKS; i++)
+		BLI_task_pool_push(pool, task_tiny_run, NULL, false, TASK_PRIORITY_HIGH);
+}
+
+static double task_throughput(int num_threads, bool spawn)
+{
+	TaskScheduler *scheduler = BLI_task_scheduler_create(num_threads);
+	size_t count = 0;
+	TaskPool *pool = BLI_task_pool_create(scheduler, &count);
+	double time;
+	int i;
+
+	time = PIL_check_seconds_timer();
+
+	if (spawn) {
+		/* tasks pushed from worker threads */
+		for (i = 0; i < NUM_TASKS / NUM_SUBTASKS; i++)
+			BLI_task_pool_push(pool, task_spawn_run, NULL, false, TASK_PRIORITY_LOW);
+	}
+	else {
+		/* tasks pushed from the main thread */
+		for (i = 0; i < NUM_TASKS; i++)
+			BLI_task_pool_push(pool, task_tiny_run, NULL, false, TASK_PRIORITY_LOW);
+	}
+
+	BLI_task_pool_work_and_wait(pool);
+
+	time = PIL_check_seconds_timer() - time;
+
+	EXPECT_EQ((size_t)NUM_TASKS, count);
+
+	BLI_task_pool_free(pool);
+	BLI_task_scheduler_free(scheduler);
+
+	return NUM_TASKS / time;
+}
+
+TEST(task, ThroughputScaling)
+{
+	int max_threads = BLI_system_thread_count();
+	int num_threads;
+
+	printf("%8s %16s %16s\n", "threads", "main tasks/s", "spawned tasks/s");
+
+	for (num_threads = 1; ; num_threads = MIN2(num_threads * 2, max_threads)) {
+		double main_rate = task_throughput(num_threads, false);
+		double spawn_rate = task_throughput(num_threads, true);
+
+		printf("%8d %16.0f %16.0f\n", num_threads, main_rate, spawn_rate);
+
+		if (num_threads == max_threads)
+			break;
+	}
+}
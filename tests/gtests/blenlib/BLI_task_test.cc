@@ -0,0 +1,187 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_task.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "atomic_ops.h"
+};
+
+#define NUM_TASKS 10000
+#define NUM_SUBTASKS 16
+
+#define NUM_BURIED_THREADS 8
+
+typedef struct TaskTestData {
+	TaskScheduler *scheduler;
+	size_t count;
+	TaskPool *other_pool;
+} TaskTestData;
+
+static void task_count_run(TaskPool *pool, void *UNUSED(taskdata), int UNUSED(threadid))
+{
+	TaskTestData *data = (TaskTestData *)BLI_task_pool_userdata(pool);
+	atomic_add_z(&data->count, 1);
+}
+
+static void task_spawn_run(TaskPool *pool, void *UNUSED(taskdata), int UNUSED(threadid))
+{
+	TaskTestData *data = (TaskTestData *)BLI_task_pool_userdata(pool);
+	int i;
+
+	atomic_add_z(&data->count, 1);
+
+	/* tasks pushed from worker threads go to their own queue */
+	for (i = 0; i < NUM_SUBTASKS; i++)
+		BLI_task_pool_push(pool, task_count_run, NULL, false, TASK_PRIORITY_LOW);
+}
+
+static void task_nested_run(TaskPool *pool, void *UNUSED(taskdata), int UNUSED(threadid))
+{
+	TaskTestData *data = (TaskTestData *)BLI_task_pool_userdata(pool);
+	TaskPool *subpool = BLI_task_pool_create(data->scheduler, data);
+	int i;
+
+	for (i = 0; i < NUM_SUBTASKS; i++)
+		BLI_task_pool_push(subpool, task_count_run, NULL, false, TASK_PRIORITY_HIGH);
+
+	BLI_task_pool_work_and_wait(subpool);
+	BLI_task_pool_free(subpool);
+}
+
+static void task_buried_run(TaskPool *pool, void *UNUSED(taskdata), int UNUSED(threadid))
+{
+	TaskTestData *data = (TaskTestData *)BLI_task_pool_userdata(pool);
+	TaskPool *subpool = BLI_task_pool_create(data->scheduler, data);
+	int i;
+
+	for (i = 0; i < NUM_SUBTASKS; i++)
+		BLI_task_pool_push(subpool, task_count_run, NULL, false, TASK_PRIORITY_HIGH);
+
+	/* ends up at the bottom of the deque, below the tasks of the subpool */
+	BLI_task_pool_push(data->other_pool, task_count_run, NULL, false, TASK_PRIORITY_HIGH);
+
+	BLI_task_pool_work_and_wait(subpool);
+	BLI_task_pool_free(subpool);
+}
+
+static void task_range_run(void *userdata, int iter)
+{
+	int *values = (int *)userdata;
+	values[iter] += iter;
+}
+
+TEST(task, PoolAllTasksRun)
+{
+	TaskTestData data = {BLI_task_scheduler_create(TASK_SCHEDULER_AUTO_THREADS), 0};
+	TaskPool *pool = BLI_task_pool_create(data.scheduler, &data);
+	int i;
+
+	for (i = 0; i < NUM_TASKS; i++)
+		BLI_task_pool_push(pool, task_count_run, NULL, false, TASK_PRIORITY_LOW);
+
+	BLI_task_pool_work_and_wait(pool);
+
+	EXPECT_EQ((size_t)NUM_TASKS, data.count);
+	EXPECT_EQ((size_t)NUM_TASKS, BLI_task_pool_tasks_done(pool));
+
+	BLI_task_pool_free(pool);
+	BLI_task_scheduler_free(data.scheduler);
+}
+
+TEST(task, PoolSpawnFromTasks)
+{
+	TaskTestData data = {BLI_task_scheduler_create(TASK_SCHEDULER_AUTO_THREADS), 0};
+	TaskPool *pool = BLI_task_pool_create(data.scheduler, &data);
+	int i;
+
+	for (i = 0; i < NUM_TASKS / NUM_SUBTASKS; i++)
+		BLI_task_pool_push(pool, task_spawn_run, NULL, false, TASK_PRIORITY_LOW);
+
+	BLI_task_pool_work_and_wait(pool);
+
+	EXPECT_EQ((size_t)(NUM_TASKS / NUM_SUBTASKS) * (NUM_SUBTASKS + 1), data.count);
+
+	BLI_task_pool_free(pool);
+	BLI_task_scheduler_free(data.scheduler);
+}
+
+TEST(task, PoolNested)
+{
+	TaskTestData data = {BLI_task_scheduler_create(TASK_SCHEDULER_AUTO_THREADS), 0};
+	TaskPool *pool = BLI_task_pool_create(data.scheduler, &data);
+	int i;
+
+	for (i = 0; i < NUM_TASKS / NUM_SUBTASKS; i++)
+		BLI_task_pool_push(pool, task_nested_run, NULL, false, TASK_PRIORITY_LOW);
+
+	BLI_task_pool_work_and_wait(pool);
+
+	EXPECT_EQ((size_t)(NUM_TASKS / NUM_SUBTASKS) * NUM_SUBTASKS, data.count);
+
+	BLI_task_pool_free(pool);
+	BLI_task_scheduler_free(data.scheduler);
+}
+
+TEST(task, PoolNestedBuried)
+{
+	/* fixed number of threads, so there are workers even on a single core */
+	TaskTestData data = {BLI_task_scheduler_create(NUM_BURIED_THREADS), 0};
+	TaskPool *pool = BLI_task_pool_create(data.scheduler, &data);
+	int i;
+
+	data.other_pool = BLI_task_pool_create(data.scheduler, &data);
+
+	for (i = 0; i < NUM_TASKS / NUM_SUBTASKS; i++)
+		BLI_task_pool_push(pool, task_buried_run, NULL, false, TASK_PRIORITY_LOW);
+
+	BLI_task_pool_work_and_wait(pool);
+	BLI_task_pool_work_and_wait(data.other_pool);
+
+	EXPECT_EQ((size_t)(NUM_TASKS / NUM_SUBTASKS) * (NUM_SUBTASKS + 1), data.count);
+
+	BLI_task_pool_free(data.other_pool);
+	BLI_task_pool_free(pool);
+	BLI_task_scheduler_free(data.scheduler);
+}
+
+TEST(task, PoolNumThreads)
+{
+	TaskTestData data = {BLI_task_scheduler_create(TASK_SCHEDULER_AUTO_THREADS), 0};
+	TaskPool *pool = BLI_task_pool_create(data.scheduler, &data);
+	int i;
+
+	BLI_pool_set_num_threads(pool, 1);
+
+	for (i = 0; i < NUM_TASKS; i++)
+		BLI_task_pool_push(pool, task_spawn_run, NULL, false, TASK_PRIORITY_LOW);
+
+	BLI_task_pool_work_and_wait(pool);
+
+	EXPECT_EQ((size_t)NUM_TASKS * (NUM_SUBTASKS + 1), data.count);
+
+	BLI_task_pool_free(pool);
+	BLI_task_scheduler_free(data.scheduler);
+}
+
+TEST(task, ParallelRange)
+{
+	int values[NUM_TASKS];
+	int i;
+
+	BLI_threadapi_init();
+
+	for (i = 0; i < NUM_TASKS; i++)
+		values[i] = i;
+
+	BLI_task_parallel_range_ex(0, NUM_TASKS, values, task_range_run, 0, false);
+	BLI_task_parallel_range_ex(0, NUM_TASKS, values, task_range_run, 0, true);
+
+	for (i = 0; i < NUM_TASKS; i++)
+		EXPECT_EQ(3 * i, values[i]);
+
+	BLI_threadapi_exit();
+}
@@ -0,0 +1,76 @@
+# Apache License, Version 2.0
+
+# ./blender.bin --background -noaudio --python tests/python/bl_animsys_remove_data.py -- --verbose
+
+# Animation evaluation caches the data its paths resolve to, removing that data
+# from a script (without an undo push) must not leave stale bindings behind.
+
+import unittest
+import bpy
+
+
+def keyframe_linear(struct, prop, values):
+    for frame, value in values:
+        setattr(struct, prop, value)
+        struct.keyframe_insert(prop, frame=frame)
+
+
+class AnimsysRemoveDataTest(unittest.TestCase):
+
+    def setUp(self):
+        bpy.ops.wm.read_factory_settings()
+        self.scene = bpy.context.scene
+
+    def test_remove_node(self):
+        scene = self.scene
+        scene.use_nodes = True
+        tree = scene.node_tree
+
+        node_remove = tree.nodes.new("CompositorNodeMixRGB")
+        node_remove.name = "Remove"
+        node_keep = tree.nodes.new("CompositorNodeMixRGB")
+        node_keep.name = "Keep"
+
+        keyframe_linear(node_remove.inputs[0], "default_value", ((1, 0.0), (11, 1.0)))
+        keyframe_linear(node_keep.inputs[0], "default_value", ((1, 0.0), (11, 1.0)))
+
+        scene.frame_set(6)
+        self.assertAlmostEqual(tree.nodes["Keep"].inputs[0].default_value, 0.5, places=3)
+
+        tree.nodes.remove(node_remove)
+
+        # evaluating the animation again must not write to the removed node
+        for frame in (7, 1, 11):
+            scene.frame_set(frame)
+            self.assertAlmostEqual(tree.nodes["Keep"].inputs[0].default_value, (frame - 1) / 10, places=3)
+
+    def test_remove_sequence(self):
+        scene = self.scene
+        sequences = scene.sequence_editor_create().sequences
+
+        strip_remove = sequences.new_effect(name="Remove", type='COLOR', channel=1, frame_start=1, frame_end=20)
+        strip_keep = sequences.new_effect(name="Keep", type='COLOR', channel=2, frame_start=1, frame_end=20)
+
+        keyframe_linear(strip_remove, "blend_alpha", ((1, 0.0), (11, 1.0)))
+        keyframe_linear(strip_keep, "blend_alpha", ((1, 0.0), (11, 1.0)))
+
+        scene.frame_set(6)
+        self.assertAlmostEqual(sequences["Keep"].blend_alpha, 0.5, places=3)
+
+        sequences.remove(strip_remove)
+
+        # the F-Curve of the removed strip stays, but must not be written through
+        for frame in (7, 1, 11):
+            scene.frame_set(frame)
+            self.assertAlmostEqual(sequences["Keep"].blend_alpha, (frame - 1) / 10, places=3)
+
+        # a new strip with the same name is animated again
+        strip_new = sequences.new_effect(name="Remove", type='COLOR', channel=1, frame_start=1, frame_end=20)
+        scene.frame_set(6)
+        self.assertAlmostEqual(strip_new.blend_alpha, 0.5, places=3)
+
+
+if __name__ == '__main__':
+    import sys
+    sys.argv = [__file__] + (sys.argv[sys.argv.index("--") + 1:] if "--" in sys.argv else [])
+    unittest.main()
@@ -0,0 +1,153 @@
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software Foundation,
+#  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+# <pep8 compliant>
+
+"""
+Measure the time it takes to load a set of .blend files.
+
+Example Usage:
+
+./blender.bin --background --factory-startup --python tests/python/bl_load_benchmark.py -- \
+    --path="/data/production" \
+    --match="*.blend" \
+    --repeat=3
+
+./blender.bin --background --factory-startup --python tests/python/bl_load_benchmark.py -- \
+    --path="/data/production" \
+    --csv=/tmp/load_times.csv
+"""
+
+import os
+import sys
+
+
+def file_generator(path, match):
+    import fnmatch
+
+    match_upper = match.upper()
+
+    for dirpath, dirnames, filenames in os.walk(path):
+
+        # skip '.svn'
+        if dirpath.startswith("."):
+            continue
+
+        for filename in filenames:
+            if fnmatch.fnmatchcase(filename.upper(), match_upper):
+                yield os.path.join(dirpath, filename)
+
+
+def load_benchmark(path="",
+                   match="*.blend",
+                   repeat=1,
+                   csv_path="",
+                   ):
+    import time
+    import bpy
+
+    path = os.path.abspath(os.path.normpath(path))
+
+    if os.path.isfile(path):
+        files = [path]
+    else:
+        files = sorted(file_generator(path, match))
+
+    print("Loading %d files, %d time(s) each" % (len(files), repeat))
+
+    results = []
+
+    for i, f in enumerate(files):
+        times = []
+
+        for _ in range(repeat):
+            time_start = time.perf_counter()
+            result = bpy.ops.wm.open_mainfile(filepath=f, load_ui=False)
+            times.append(time.perf_counter() - time_start)
+
+            if 'FINISHED' not in result:
+                break
+
+        if 'FINISHED' not in result:
+            print("    %s: failed to load # %d of %d" % (f, i + 1, len(files)))
+            continue
+
+        size = os.path.getsize(f)
+        results.append((f, size, min(times), sum(times) / len(times)))
+
+        print("    %s: %.3fs min, %.3fs avg, %.1f MB/s # %d of %d" %
+              (f, min(times), sum(times) / len(times), (size / (1024.0 * 1024.0)) / min(times), i + 1, len(files)))
+
+    total_min = sum(r[2] for r in results)
+    total_avg = sum(r[3] for r in results)
+    print("finished, loaded:%d,  failed:%d,  total %.3fs min, %.3fs avg" %
+          (len(results), len(files) - len(results), total_min, total_avg))
+
+    if csv_path:
+        with open(csv_path, "w") as fh:
+            fh.write("file,size,min,avg\n")
+            for f, size, time_min, time_avg in results:
+                fh.write("%s,%d,%f,%f\n" % (f, size, time_min, time_avg))
+        print("Timings written to %r" % csv_path)
+
+
+def main():
+    import optparse
+
+    # get the args passed to blender after "--", all of which are ignored by blender specifically
+    # so python may receive its own arguments
+    argv = sys.argv
+
+    if "--" not in argv:
+        argv = []  # as if no args are passed
+    else:
+        argv = argv[argv.index("--") + 1:]  # get all args after "--"
+
+    # When --help or no args are given, print this help
+    usage_text = "Run blender in background mode with this script:"
+    usage_text += "  blender --background --factory-startup --python " + __file__ + " -- [options]"
+
+    parser = optparse.OptionParser(usage=usage_text)
+
+    parser.add_option("-p", "--path", dest="path", help="A .blend file or a path to search for files", type="string")
+    parser.add_option("-m", "--match", dest="match", help="Wildcard to match filename", type="string")
+    parser.add_option("-r", "--repeat", dest="repeat", help="Number of times each file is loaded", metavar='int')
+    parser.add_option("-c", "--csv", dest="csv_path", help="Write the timings to a CSV file", metavar='string')
+
+    options, args = parser.parse_args(argv)  # In this example we wont use the args
+
+    if not argv:
+        parser.print_help()
+        return
+
+    if not options.path:
+        print("Error: --path=\"some path\" argument not given, aborting.")
+        parser.print_help()
+        return
+
+    load_benchmark(path=options.path,
+                   match=options.match or "*.blend",
+                   repeat=max(1, int(options.repeat or 1)),
+                   csv_path=options.csv_path or "",
+                   )
+
+    print("load benchmark finished, exiting")
+
+
+if __name__ == "__main__":
+    main()